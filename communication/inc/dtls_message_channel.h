@@ -149,6 +149,14 @@ private:
 
 	virtual ProtocolError establish() override;
 
+	/**
+	 * Generates the ephemeral key pair for the next full handshake in advance.
+	 *
+	 * Calling this method while the network connection is being established keeps the point
+	 * multiplication off the handshake's critical path.
+	 */
+	ProtocolError precompute_keys();
+
 	/**
 	 * Retrieve first the 2 byte length from the stream, which determines
 	 */
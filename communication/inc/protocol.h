@@ -6,6 +6,7 @@
 #include "ping.h"
 #include "chunked_transfer.h"
 #include "firmware_update.h"
+#include "ack_scheduler.h"
 #include "spark_descriptor.h"
 #include "spark_protocol_functions.h"
 #include "functions.h"
@@ -155,7 +156,16 @@ protected:
 		/**
 		 * Support for compressed/combined OTA updates.
 		 */
-		COMPRESSED_OTA = 0x10
+		COMPRESSED_OTA = 0x10,
+		/**
+		 * Metrics are encoded as deltas against the last acknowledged metrics.
+		 */
+		DELTA_METRICS = 0x20,
+		/**
+		 * Subscriptions are registered in a single batched request. The flag is cleared if the
+		 * server rejects such a request.
+		 */
+		BATCHED_SUBSCRIPTIONS = 0x40
 	};
 
 	/**
@@ -168,6 +178,11 @@ protected:
 	 */
 	CompletionHandlerMap<message_id_t> ack_handlers;
 
+	/**
+	 * Manages acknowledgements for confirmable requests received from the server.
+	 */
+	AckScheduler ack_scheduler;
+
 	/**
 	 * The token ID for the next request made.
 	 * If we have a bone-fide CoAP layer this will eventually disappear into that layer, just like message-id has.
@@ -391,6 +406,34 @@ public:
 		}
 	}
 
+	void set_delta_metrics_enabled(bool enabled)
+	{
+		if (enabled) {
+			protocol_flags |= ProtocolFlag::DELTA_METRICS;
+		} else {
+			protocol_flags &= ~ProtocolFlag::DELTA_METRICS;
+		}
+	}
+
+	bool is_delta_metrics_enabled() const
+	{
+		return protocol_flags & ProtocolFlag::DELTA_METRICS;
+	}
+
+	void set_batched_subscriptions_enabled(bool enabled)
+	{
+		if (enabled) {
+			protocol_flags |= ProtocolFlag::BATCHED_SUBSCRIPTIONS;
+		} else {
+			protocol_flags &= ~ProtocolFlag::BATCHED_SUBSCRIPTIONS;
+		}
+	}
+
+	bool is_batched_subscriptions_enabled() const
+	{
+		return protocol_flags & ProtocolFlag::BATCHED_SUBSCRIPTIONS;
+	}
+
 	void set_system_version(uint16_t version)
 	{
 		system_version = version;
@@ -411,6 +454,20 @@ public:
 		max_transmit_message_size = size;
 	}
 
+	void set_ack_delay(system_tick_t delay)
+	{
+		ack_scheduler.setDelay(delay);
+	}
+
+	/**
+	 * Set the maximum time an outgoing message can be held back for packing it together with
+	 * other messages. Setting the delay to 0 disables packing.
+	 */
+	virtual ProtocolError set_message_packing_delay(system_tick_t /* delay */)
+	{
+		return ProtocolError::NOT_IMPLEMENTED;
+	}
+
 	size_t get_max_transmit_message_size() const;
 
 	size_t get_max_event_data_size() const {
@@ -643,6 +700,10 @@ public:
 	MessageChannel& get_channel() {
 		return channel;
 	}
+
+	AckScheduler& get_ack_scheduler() {
+		return ack_scheduler;
+	}
 };
 
 }
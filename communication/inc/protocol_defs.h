@@ -153,11 +153,22 @@ enum Enum
     MAX_TRANSMIT_MESSAGE_SIZE = 7, ///< Maximum size of of outgoing CoAP message (set).
     MAX_EVENT_DATA_SIZE = 8, ///< Maximum size of event data (get).
     MAX_VARIABLE_VALUE_SIZE = 9, ///< Maximum size of a variable value (get).
-    MAX_FUNCTION_ARGUMENT_SIZE = 10 ///< Maximum size of a function call argument (get).
+    MAX_FUNCTION_ARGUMENT_SIZE = 10, ///< Maximum size of a function call argument (get).
+    ACK_DELAY = 11, ///< Delay for acknowledgements of confirmable requests in milliseconds (set).
+    MESSAGE_PACKING_DELAY = 12, ///< Maximum time an outgoing message can be held back for packing in milliseconds (set).
+    DELTA_METRICS = 13, ///< Enable/disable change-only encoding of the metrics (set).
+    BATCHED_SUBSCRIPTIONS = 14 ///< Enable/disable batched registration of the event subscriptions (set).
 };
 
 }
 
+/**
+ * Recommended delay for acknowledgements of confirmable requests in milliseconds.
+ *
+ * The delay needs to be well below the server's initial retransmission timeout (2 seconds).
+ */
+const system_tick_t DEFAULT_ACK_DELAY = 200;
+
 typedef std::function<system_tick_t()> millis_callback;
 typedef std::function<int()> callback;
 
@@ -53,7 +53,8 @@ namespace SparkAppStateSelector {
 		SYSTEM_MODULE_VERSION = 5,
 		MAX_MESSAGE_SIZE = 6,
 		MAX_BINARY_SIZE = 7,
-		OTA_CHUNK_SIZE = 8
+		OTA_CHUNK_SIZE = 8,
+		DESCRIBE_METRICS = 9
 	};
 }
 
@@ -142,6 +143,23 @@ struct SparkDescriptor
      * @return true on success or false on failure.
      */
     bool (*append_app_info)(appender_fn appender, void* append, void* reserved);
+
+    /**
+     * Get a portion of the value of a variable asynchronously.
+     *
+     * The completion callback receives up to `size` bytes of the variable value starting at
+     * `offset`. Only streaming variables, which generate the requested portion on demand without
+     * having the entire value in RAM, can be read this way.
+     *
+     * @param key Variable name.
+     * @param offset Offset in the variable value.
+     * @param size Maximum size of the data to get.
+     * @param callback Completion callback.
+     * @param context Context of the variable request. This argument needs to be passed to the completion callback.
+     * @return `false` if the variable is not a streaming variable. The completion callback is not
+     *         invoked in this case.
+     */
+    bool (*read_variable_async)(const char* key, size_t offset, size_t size, GetVariableCallback callback, void* context);
 };
 
-PARTICLE_STATIC_ASSERT(SparkDescriptor_size, sizeof(SparkDescriptor)==64 || sizeof(void*)!=4);
+PARTICLE_STATIC_ASSERT(SparkDescriptor_size, sizeof(SparkDescriptor)==68 || sizeof(void*)!=4);
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logging.h"
+
+#include "ack_scheduler.h"
+
+#include "message_channel.h"
+#include "messages.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace particle {
+
+namespace protocol {
+
+AckScheduler::AckScheduler() :
+        stats_(),
+        callbacks_(nullptr),
+        channel_(nullptr),
+        delay_(0),
+        count_(0) {
+}
+
+void AckScheduler::init(MessageChannel* channel, const SparkCallbacks& callbacks) {
+    channel_ = channel;
+    callbacks_ = &callbacks;
+}
+
+void AckScheduler::setDelay(system_tick_t delay) {
+    delay_ = std::min(delay, MAX_ACK_DELAY);
+}
+
+ProtocolError AckScheduler::ack(Message& request, message_id_t id) {
+    for (unsigned i = 0; i < count_; ++i) {
+        if (pending_[i].id == id) {
+            // The request was retransmitted while its acknowledgement was pending
+            return ProtocolError::NO_ERROR;
+        }
+    }
+    if (!delay_ || !callbacks_ || count_ >= ACK_BATCH_SIZE) {
+        // The channel buffer is occupied by the request so the acknowledgement is stored past
+        // the end of the request data
+        const auto length = request.length();
+        const auto capacity = request.capacity();
+        Message msg;
+        ProtocolError err = channel_->response(request, msg, 4 /* Empty ACK */);
+        if (err != ProtocolError::NO_ERROR) {
+            return err;
+        }
+        err = sendAck(msg, id);
+        // BufferMessageChannel::response() alters the capacity of the original message
+        request.set_buffer(request.buf(), capacity);
+        request.set_length(length);
+        return err;
+    }
+    pending_[count_].id = id;
+    pending_[count_].time = callbacks_->millis();
+    ++count_;
+    ++stats_.delayedAcks;
+    return ProtocolError::NO_ERROR;
+}
+
+bool AckScheduler::take(message_id_t id) {
+    for (unsigned i = 0; i < count_; ++i) {
+        if (pending_[i].id == id) {
+            std::memmove(pending_ + i, pending_ + i + 1, (count_ - i - 1) * sizeof(PendingAck));
+            --count_;
+            ++stats_.piggybackedAcks;
+            ++stats_.savedDatagrams;
+            return true;
+        }
+    }
+    return false;
+}
+
+ProtocolError AckScheduler::process() {
+    if (!count_) {
+        return ProtocolError::NO_ERROR;
+    }
+    if (count_ < ACK_BATCH_SIZE && callbacks_->millis() - pending_[0].time < delay_) {
+        return ProtocolError::NO_ERROR;
+    }
+    return flush();
+}
+
+ProtocolError AckScheduler::flush() {
+    while (count_ > 0) {
+        Message msg;
+        ProtocolError err = channel_->create(msg);
+        if (err == ProtocolError::NO_ERROR) {
+            err = sendAck(msg, pending_[0].id);
+        }
+        if (err != ProtocolError::NO_ERROR) {
+            LOG(ERROR, "Failed to send ACK: %d", (int)err);
+            return err;
+        }
+        std::memmove(pending_, pending_ + 1, (count_ - 1) * sizeof(PendingAck));
+        --count_;
+    }
+    return ProtocolError::NO_ERROR;
+}
+
+void AckScheduler::reset() {
+    count_ = 0;
+}
+
+ProtocolError AckScheduler::sendAck(Message& msg, message_id_t id) {
+    msg.set_length(Messages::empty_ack(msg.buf(), 0, 0));
+    msg.set_id(id);
+    const auto err = channel_->send(msg);
+    if (err != ProtocolError::NO_ERROR) {
+        return err;
+    }
+    ++stats_.sentAcks;
+    return ProtocolError::NO_ERROR;
+}
+
+} // namespace protocol
+
+} // namespace particle
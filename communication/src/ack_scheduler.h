@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "spark_protocol_functions.h"
+#include "protocol_defs.h"
+#include "coap.h"
+
+#include <cstdint>
+#include <cstddef>
+
+namespace particle {
+
+namespace protocol {
+
+/**
+ * Maximum acknowledgement delay in milliseconds.
+ */
+const system_tick_t MAX_ACK_DELAY = 500;
+
+/**
+ * Maximum number of delayed acknowledgements.
+ *
+ * All pending acknowledgements are sent once this number is reached.
+ */
+const unsigned ACK_BATCH_SIZE = 4;
+
+class Message;
+class MessageChannel;
+
+/**
+ * Acknowledgement statistics.
+ */
+struct AckSchedulerStats {
+    unsigned sentAcks; // Number of sent empty acknowledgements
+    unsigned delayedAcks; // Number of acknowledgements that were delayed
+    unsigned piggybackedAcks; // Number of acknowledgements sent together with a response
+    unsigned savedDatagrams; // Number of datagrams that didn't need to be sent
+};
+
+/**
+ * Scheduler for the acknowledgements of confirmable requests received from the server.
+ *
+ * Only the requests that get a response, such as function calls and variable requests, should be
+ * acknowledged via the scheduler. Delaying the acknowledgement of any other message would only
+ * increase the chance that the server retransmits it.
+ *
+ * When delayed acknowledgements are enabled, the empty ACK for a request is held back for up to the
+ * configured delay so that the response to the request can be sent in the ACK message instead
+ * (piggybacked response). Acknowledgements that were not taken by a response are sent together
+ * once the oldest of them expires or the number of pending acknowledgements reaches `ACK_BATCH_SIZE`.
+ */
+class AckScheduler {
+public:
+    AckScheduler();
+
+    void init(MessageChannel* channel, const SparkCallbacks& callbacks);
+
+    /**
+     * Set the acknowledgement delay.
+     *
+     * @param delay Delay in milliseconds. Setting this parameter to 0 disables delayed acknowledgements.
+     */
+    void setDelay(system_tick_t delay);
+
+    /**
+     * Get the acknowledgement delay.
+     */
+    system_tick_t delay() const {
+        return delay_;
+    }
+
+    /**
+     * Acknowledge a confirmable request.
+     *
+     * The acknowledgement is sent immediately if delayed acknowledgements are disabled or too many
+     * acknowledgements are pending. In that case, the acknowledgement is stored in the channel buffer
+     * past the end of the request data.
+     *
+     * @param request Request message.
+     * @param id Message ID of the request.
+     */
+    ProtocolError ack(Message& request, message_id_t id);
+
+    /**
+     * Take over a pending acknowledgement.
+     *
+     * If this method returns `true`, the caller is responsible for sending the response to the
+     * request as an ACK message with the given message ID.
+     *
+     * @param id Message ID of the request.
+     * @return `true` if the acknowledgement was pending, or `false` if it has already been sent.
+     */
+    bool take(message_id_t id);
+
+    /**
+     * Send the acknowledgements that are due.
+     *
+     * This method must not be called while a received message is being processed, as it uses the
+     * buffer of the message channel.
+     */
+    ProtocolError process();
+
+    /**
+     * Send all pending acknowledgements.
+     */
+    ProtocolError flush();
+
+    /**
+     * Discard all pending acknowledgements.
+     */
+    void reset();
+
+    bool hasPending() const {
+        return count_ > 0;
+    }
+
+    const AckSchedulerStats& stats() const {
+        return stats_;
+    }
+
+private:
+    struct PendingAck {
+        message_id_t id; // Message ID of the request
+        system_tick_t time; // Time when the request was received
+    };
+
+    PendingAck pending_[ACK_BATCH_SIZE]; // Pending acknowledgements, oldest first
+    AckSchedulerStats stats_; // Statistics
+    const SparkCallbacks* callbacks_; // System callbacks
+    MessageChannel* channel_; // Message channel
+    system_tick_t delay_; // Acknowledgement delay
+    unsigned count_; // Number of pending acknowledgements
+
+    ProtocolError sendAck(Message& msg, message_id_t id);
+};
+
+} // namespace protocol
+
+} // namespace particle
@@ -142,7 +142,10 @@ ProtocolError CoAPMessageStore::receive(Message& msg, Channel& channel, system_t
 		message_id_t id = msg.get_id();
 		CoAPMessage* coap_msg = from_id(id);
 		if (coap_msg) {
-			g_coapRoundTripMSec = time - coap_msg->get_send_time();
+			const system_tick_t roundTrip = time - coap_msg->get_send_time();
+			g_coapRoundTripMSec = roundTrip;
+			g_coapRoundTripHistogram.record(roundTrip);
+			g_coapRoundTripSeries.record(roundTrip, time);
 		}
 		if (msgtype==CoAPType::RESET) {
 			LOG(WARN, "Received RST message; discarding session");
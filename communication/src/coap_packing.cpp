@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "coap_packing.h"
+
+#include "system_error.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace particle {
+
+namespace protocol {
+
+namespace {
+
+// Offset of the first message in the buffer. A record containing a single message is sent
+// starting from this offset, without the framing
+const size_t FIRST_MESSAGE_OFFSET = 1 /* Marker */ + COAP_PACKED_MESSAGE_HEADER_SIZE;
+
+const size_t MAX_PACKED_MESSAGE_SIZE = 0xffff;
+
+} // namespace
+
+CoapMessagePacker::CoapMessagePacker() :
+        maxSize_(0),
+        size_(0),
+        count_(0) {
+}
+
+int CoapMessagePacker::init(size_t maxSize) {
+    maxSize = std::min(maxSize, (size_t)PROTOCOL_BUFFER_SIZE);
+    if (maxSize <= FIRST_MESSAGE_OFFSET) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    // The first message can occupy the entire record if it's sent without the framing
+    buf_.reset(new(std::nothrow) uint8_t[maxSize + FIRST_MESSAGE_OFFSET]);
+    if (!buf_) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    buf_[0] = COAP_PACKED_RECORD_MARKER;
+    maxSize_ = maxSize;
+    clear();
+    return 0;
+}
+
+void CoapMessagePacker::destroy() {
+    buf_.reset();
+    maxSize_ = 0;
+    clear();
+}
+
+bool CoapMessagePacker::append(const uint8_t* data, size_t size) {
+    if (!buf_ || !size || size > MAX_PACKED_MESSAGE_SIZE) {
+        return false;
+    }
+    if (count_ > 0) {
+        if (size_ + COAP_PACKED_MESSAGE_HEADER_SIZE + size > maxSize_) {
+            return false;
+        }
+    } else if (size > maxSize_) {
+        return false;
+    }
+    uint8_t* d = buf_.get() + size_;
+    d[0] = (size >> 8) & 0xff;
+    d[1] = size & 0xff;
+    std::memcpy(d + COAP_PACKED_MESSAGE_HEADER_SIZE, data, size);
+    size_ += COAP_PACKED_MESSAGE_HEADER_SIZE + size;
+    ++count_;
+    return true;
+}
+
+const uint8_t* CoapMessagePacker::data() const {
+    if (count_ == 1) {
+        return buf_.get() + FIRST_MESSAGE_OFFSET;
+    }
+    return buf_.get();
+}
+
+size_t CoapMessagePacker::size() const {
+    if (count_ == 0) {
+        return 0;
+    }
+    if (count_ == 1) {
+        return size_ - FIRST_MESSAGE_OFFSET;
+    }
+    return size_;
+}
+
+void CoapMessagePacker::clear() {
+    size_ = 1; // Marker
+    count_ = 0;
+}
+
+CoapPackedRecordReader::CoapPackedRecordReader(const uint8_t* data, size_t size) :
+        data_(data),
+        end_(data + size),
+        msgData_(nullptr),
+        msgSize_(0),
+        packed_(size > 0 && data[0] == COAP_PACKED_RECORD_MARKER),
+        error_(false) {
+    if (packed_) {
+        ++data_;
+    }
+}
+
+bool CoapPackedRecordReader::next() {
+    if (error_ || data_ >= end_) {
+        return false;
+    }
+    if (!packed_) {
+        msgData_ = data_;
+        msgSize_ = end_ - data_;
+        data_ = end_;
+        return true;
+    }
+    if (end_ - data_ < (ptrdiff_t)COAP_PACKED_MESSAGE_HEADER_SIZE) {
+        error_ = true;
+        return false;
+    }
+    const size_t size = ((size_t)data_[0] << 8) | data_[1];
+    data_ += COAP_PACKED_MESSAGE_HEADER_SIZE;
+    if (!size || (size_t)(end_ - data_) < size) {
+        error_ = true;
+        return false;
+    }
+    msgData_ = data_;
+    msgSize_ = size;
+    data_ += size;
+    return true;
+}
+
+} // namespace protocol
+
+} // namespace particle
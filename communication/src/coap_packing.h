@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "message_channel.h"
+#include "protocol_defs.h"
+
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Maximum size of a packed record.
+ *
+ * The record is sent in a single DTLS record, so the size needs to leave enough room for the DTLS,
+ * UDP and IP headers within the path MTU.
+ */
+#ifndef COAP_MAX_PACKED_RECORD_SIZE
+#define COAP_MAX_PACKED_RECORD_SIZE 1024
+#endif
+
+namespace particle {
+
+namespace protocol {
+
+/**
+ * First byte of a packed record.
+ *
+ * The version field of the byte is 0, which makes a packed record distinguishable from a CoAP
+ * message (RFC 7252 requires the version to be 1). The marker is followed by one or more entries
+ * each consisting of a 16-bit big-endian length and the contents of a CoAP message.
+ */
+const uint8_t COAP_PACKED_RECORD_MARKER = 0x00;
+
+/**
+ * Size of the length field preceding each message in a packed record.
+ */
+const size_t COAP_PACKED_MESSAGE_HEADER_SIZE = 2;
+
+/**
+ * Maximum time in milliseconds a message can be held back for packing.
+ */
+const system_tick_t MAX_COAP_PACKING_DELAY = 100;
+
+/**
+ * Buffer accumulating outgoing CoAP messages for sending them in a single record.
+ *
+ * A record containing only one message is sent as is, without any framing.
+ */
+class CoapMessagePacker {
+public:
+    CoapMessagePacker();
+
+    /**
+     * Allocate the buffer.
+     *
+     * @param maxSize Maximum size of a record.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int init(size_t maxSize = COAP_MAX_PACKED_RECORD_SIZE);
+
+    /**
+     * Free the buffer.
+     */
+    void destroy();
+
+    /**
+     * Add a message to the record.
+     *
+     * @param data Message data.
+     * @param size Message size.
+     * @return `true` if the message was added, or `false` if it doesn't fit in the record.
+     */
+    bool append(const uint8_t* data, size_t size);
+
+    /**
+     * Get the record data.
+     */
+    const uint8_t* data() const;
+
+    /**
+     * Get the record size.
+     */
+    size_t size() const;
+
+    /**
+     * Get the number of messages in the record.
+     */
+    unsigned count() const {
+        return count_;
+    }
+
+    /**
+     * Check if the buffer is allocated.
+     */
+    bool isInitialized() const {
+        return (bool)buf_;
+    }
+
+    /**
+     * Remove all messages from the record.
+     */
+    void clear();
+
+private:
+    std::unique_ptr<uint8_t[]> buf_;
+    size_t maxSize_;
+    size_t size_;
+    unsigned count_;
+};
+
+/**
+ * Iterator over the CoAP messages contained in a received record.
+ *
+ * A record that doesn't start with `COAP_PACKED_RECORD_MARKER` is treated as a single message.
+ */
+class CoapPackedRecordReader {
+public:
+    CoapPackedRecordReader(const uint8_t* data, size_t size);
+
+    /**
+     * Advance to the next message.
+     *
+     * @return `true` if there's a message, or `false` if the end of the record was reached or the
+     *         record is malformed.
+     */
+    bool next();
+
+    const uint8_t* data() const {
+        return msgData_;
+    }
+
+    size_t size() const {
+        return msgSize_;
+    }
+
+    /**
+     * Check if the record is malformed.
+     */
+    bool hasError() const {
+        return error_;
+    }
+
+private:
+    const uint8_t* data_;
+    const uint8_t* end_;
+    const uint8_t* msgData_;
+    size_t msgSize_;
+    bool packed_;
+    bool error_;
+};
+
+/**
+ * Decorates a MessageChannel with packing of outgoing messages.
+ *
+ * When packing is enabled, outgoing messages are held back for up to the configured delay and sent
+ * together in a single record. The pending record is sent when the delay expires, which is checked
+ * every time the channel is polled for incoming messages, or when the next message doesn't fit in it.
+ *
+ * Packed records are not understood by a server that doesn't support them, so packing is disabled
+ * by default.
+ *
+ * @param T the baseclass
+ * @param M: a callable type that provides the current system ticks
+ */
+template<typename T, typename M>
+class CoAPPackingChannel: public T {
+    using channel = T;
+
+    CoapMessagePacker packer;
+    M millis;
+    system_tick_t packing_delay;
+    system_tick_t packing_start;
+
+public:
+    CoAPPackingChannel(M m = 0) :
+            millis(m),
+            packing_delay(0),
+            packing_start(0) {
+    }
+
+    void set_packing_millis(M m) {
+        this->millis = m;
+    }
+
+    /**
+     * Set the maximum time a message can be held back for packing.
+     *
+     * @param delay Delay in milliseconds. Setting this parameter to 0 disables packing.
+     */
+    ProtocolError set_packing_delay(system_tick_t delay) {
+        if (delay > MAX_COAP_PACKING_DELAY) {
+            delay = MAX_COAP_PACKING_DELAY;
+        }
+        if (delay && !packer.isInitialized() && packer.init() < 0) {
+            return ProtocolError::NO_MEMORY;
+        }
+        if (!delay) {
+            ProtocolError error = flush();
+            packer.destroy();
+            if (error != ProtocolError::NO_ERROR) {
+                return error;
+            }
+        }
+        packing_delay = delay;
+        return ProtocolError::NO_ERROR;
+    }
+
+    system_tick_t get_packing_delay() const {
+        return packing_delay;
+    }
+
+    /**
+     * Send the pending record.
+     */
+    ProtocolError flush() {
+        if (!packer.count()) {
+            return ProtocolError::NO_ERROR;
+        }
+        Message msg((uint8_t*)packer.data(), packer.size(), packer.size());
+        ProtocolError error = channel::send(msg);
+        packer.clear();
+        return error;
+    }
+
+    ProtocolError send(Message& msg) override {
+        if (!packing_delay || msg.send_direct() || msg.get_confirm_received()) {
+            // Preserve the order of the messages
+            ProtocolError error = flush();
+            if (error != ProtocolError::NO_ERROR) {
+                return error;
+            }
+            return channel::send(msg);
+        }
+        if (!packer.append(msg.buf(), msg.length())) {
+            ProtocolError error = flush();
+            if (error != ProtocolError::NO_ERROR) {
+                return error;
+            }
+            if (!packer.append(msg.buf(), msg.length())) {
+                return channel::send(msg); // Too large message
+            }
+        }
+        if (packer.count() == 1) {
+            packing_start = millis();
+        }
+        return ProtocolError::NO_ERROR;
+    }
+
+    ProtocolError receive(Message& msg) override {
+        if (packer.count() && millis() - packing_start >= packing_delay) {
+            ProtocolError error = flush();
+            if (error != ProtocolError::NO_ERROR) {
+                return error;
+            }
+        }
+        return channel::receive(msg);
+    }
+
+    ProtocolError command(Channel::Command cmd, void* arg) override {
+        if (cmd == Channel::CLOSE || cmd == Channel::DISCARD_SESSION) {
+            packer.clear();
+        } else {
+            ProtocolError error = flush();
+            if (error != ProtocolError::NO_ERROR) {
+                return error;
+            }
+        }
+        return channel::command(cmd, arg);
+    }
+
+    ProtocolError establish() override {
+        packer.clear();
+        return channel::establish();
+    }
+
+    void reset() override {
+        packer.clear();
+        channel::reset();
+    }
+};
+
+} // namespace protocol
+
+} // namespace particle
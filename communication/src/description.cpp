@@ -467,7 +467,10 @@ ProtocolError Description::serialize(Appender* appender, int descFlags) {
         // 16-bit Describe type
         appender->append((char)DescriptionType::DESCRIBE_METRICS);
         appender->append((char)0);
-        const int flags = 1; // Use binary encoding
+        int flags = 1; // Use binary encoding
+        if (proto_->is_delta_metrics_enabled()) {
+            flags |= 2; // Only encode the values that changed since the last acknowledged metrics
+        }
         const int page = 0; // Page number (unused)
         const bool ok = descriptor.append_metrics(Appender::callback, appender, flags, page, nullptr /* reserved */);
         if (!ok) {
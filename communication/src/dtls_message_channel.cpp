@@ -43,6 +43,7 @@ void mbedtls_ssl_update_out_pointers(mbedtls_ssl_context *ssl, mbedtls_ssl_trans
 #include "mbedtls/error.h"
 #include "mbedtls/ssl_internal.h"
 #include "mbedtls_util.h"
+#include "ecdh_precompute.h"
 #include "mbedtls/version.h"
 #include "timer_hal.h"
 #include <stdio.h>
@@ -426,7 +427,12 @@ ProtocolError DTLSMessageChannel::establish()
 			return error;
 	}
 	uint8_t random[64];
+	const system_tick_t start_millis = callbacks.millis();
 
+#if defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+	// Only the handshake is allowed to use the key pair generated by precompute_keys()
+	mbedtls_ecdh_use_precomputed_keypair(1);
+#endif // defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
 	do
 	{
 		while (ssl_context.state != MBEDTLS_SSL_HANDSHAKE_OVER)
@@ -446,6 +452,9 @@ ProtocolError DTLSMessageChannel::establish()
 	}
 	while(ret == MBEDTLS_ERR_SSL_WANT_READ ||
 	      ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+#if defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+	mbedtls_ecdh_use_precomputed_keypair(0);
+#endif // defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
 
 	bool ok = false;
 	if (ret) {
@@ -457,10 +466,29 @@ ProtocolError DTLSMessageChannel::establish()
 		reset_session();
 		return IO_ERROR_GENERIC_ESTABLISH;
 	}
+	LOG(INFO, "Handshake took %u ms", (unsigned)(callbacks.millis() - start_millis));
 
 	return NO_ERROR;
 }
 
+ProtocolError DTLSMessageChannel::precompute_keys()
+{
+#if defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+	// The server uses secp256r1 for the key exchange
+	if (mbedtls_ecdh_has_precomputed_keypair(MBEDTLS_ECP_DP_SECP256R1)) {
+		return NO_ERROR;
+	}
+	const system_tick_t start_millis = callbacks.millis();
+	const int r = mbedtls_ecdh_precompute_keypair(MBEDTLS_ECP_DP_SECP256R1, mbedtls_default_rng, nullptr);
+	if (r < 0) {
+		LOG(WARN, "Failed to precompute ECDH key pair: %d", r);
+		return UNKNOWN;
+	}
+	LOG(TRACE, "Precomputed ECDH key pair in %u ms", (unsigned)(callbacks.millis() - start_millis));
+#endif // defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+	return NO_ERROR;
+}
+
 ProtocolError DTLSMessageChannel::notify_established()
 {
 	sessionPersist.make_persistent();
@@ -34,6 +34,7 @@ void DTLSProtocol::init(const char *id,
 	mbedtls_default_rng(nullptr, &next_token, sizeof(next_token));
 
 	channel.set_millis(callbacks.millis);
+	channel.set_packing_millis(callbacks.millis);
 
 	uint8_t core_public[128];
 	int len = extract_public_ec_key_length(core_public, sizeof(core_public), keys.core_private, determine_der_length(keys.core_private, MAX_DEVICE_PRIVATE_KEY_LENGTH));
@@ -31,6 +31,7 @@
 #include "protocol.h"
 #include "dtls_message_channel.h"
 #include "coap_channel.h"
+#include "coap_packing.h"
 #include "eckeygen.h"
 #include <limits>
 #include "logging.h"
@@ -41,7 +42,8 @@ namespace protocol {
 
 class DTLSProtocol : public Protocol
 {
-	CoAPChannel<CoAPReliableChannel<DTLSMessageChannel, decltype(SparkCallbacks::millis)>> channel;
+	CoAPChannel<CoAPReliableChannel<CoAPPackingChannel<DTLSMessageChannel, decltype(SparkCallbacks::millis)>,
+			decltype(SparkCallbacks::millis)>> channel;
 
 	static void handle_seed(const uint8_t* data, size_t len)
 	{
@@ -82,18 +84,23 @@ public:
 		{
 		case ProtocolCommands::SLEEP: // Deprecated
 		case ProtocolCommands::DISCONNECT: {
-			int r = ProtocolError::NO_ERROR;
+			// Acknowledge the requests received from the server before disconnecting
+			int r = ack_scheduler.flush();
 			unsigned timeout = DEFAULT_DISCONNECT_COMMAND_TIMEOUT;
 			if (data) {
 				const auto d = (const spark_disconnect_command*)data;
 				if (d->timeout != 0) {
 					timeout = d->timeout;
 				}
-				if (d->cloud_reason != CLOUD_DISCONNECT_REASON_NONE) {
+				if (r == ProtocolError::NO_ERROR && d->cloud_reason != CLOUD_DISCONNECT_REASON_NONE) {
 					r = send_goodbye((cloud_disconnect_reason)d->cloud_reason, (network_disconnect_reason)d->network_reason,
 							(System_Reset_Reason)d->reset_reason, d->sleep_duration);
 				}
 			}
+			if (r == ProtocolError::NO_ERROR) {
+				// Send the messages held back for packing
+				r = channel.flush();
+			}
 			if (r == ProtocolError::NO_ERROR) {
 				r = wait_confirmable(timeout);
 			}
@@ -115,11 +122,19 @@ public:
 			}
 			return r;
 		}
+		case ProtocolCommands::PRECOMPUTE_KEYS: {
+			return channel.precompute_keys();
+		}
 		default:
 			return ProtocolError::UNKNOWN;
 		}
 	}
 
+	ProtocolError set_message_packing_delay(system_tick_t delay) override
+	{
+		return channel.set_packing_delay(delay);
+	}
+
 	int get_status(protocol_status* status) const override {
 		SPARK_ASSERT(status);
 		status->flags = 0;
@@ -24,6 +24,8 @@
 #include "message_channel.h"
 #include "messages.h"
 #include "spark_descriptor.h"
+#include "ack_scheduler.h"
+#include "endian_util.h"
 
 
 namespace particle
@@ -36,17 +38,27 @@ class Functions
     // TODO: This is quite a large buffer and there's no need for it to be allocated statically
     char function_arg[MAX_FUNCTION_ARG_LENGTH+1]; // add one for null terminator
 
-    ProtocolError function_result(MessageChannel& channel, const void* result, SparkReturnType::Enum, token_t token)
+    ProtocolError function_result(MessageChannel& channel, AckScheduler& acks, const void* result, SparkReturnType::Enum,
+            token_t token, message_id_t message_id)
     {
         Message message;
         channel.create(message, Messages::function_return_size);
-        size_t length = Messages::function_return(message.buf(), 0, token, long(result), channel.is_unreliable());
+        size_t length = 0;
+        if (acks.take(message_id)) {
+            // The request hasn't been acknowledged yet, send the result in the ACK
+            uint32_t value = nativeToBigEndian((uint32_t)long(result));
+            length = Messages::coded_ack(message.buf(), token, CoAPCode::CHANGED, 0, 0, (uint8_t*)&value, sizeof(value));
+            message.set_id(message_id);
+        } else {
+            length = Messages::function_return(message.buf(), 0, token, long(result), channel.is_unreliable());
+        }
         message.set_length(length);
         return channel.send(message);
     }
 
 public:
     ProtocolError handle_function_call(token_t token, message_id_t message_id, Message& message, MessageChannel& channel,
+            AckScheduler& acks,
             int (*call_function)(const char *function_key, const char *arg, SparkDescriptor::FunctionResultCallback callback, void* reserved))
     {
         // copy the function key
@@ -102,20 +114,25 @@ public:
         memcpy(function_arg, queue + q_index + 1, function_arg_length);
         function_arg[function_arg_length] = 0; // null terminate string
 
-        Message response;
-        channel.response(message, response, 16);
-        // send ACK
-        size_t response_length = Messages::coded_ack(response.buf(), has_function ? 0x00 : RESPONSE_CODE(4,00), 0, 0);
-        response.set_id(message_id);
-        response.set_length(response_length);
-        ProtocolError error = channel.send(response);
+        ProtocolError error = NO_ERROR;
+        if (has_function) {
+            // send ACK, or schedule it so that the result can be sent in the ACK
+            error = acks.ack(message, message_id);
+        } else {
+            Message response;
+            channel.response(message, response, 16);
+            size_t response_length = Messages::coded_ack(response.buf(), RESPONSE_CODE(4,00), 0, 0);
+            response.set_id(message_id);
+            response.set_length(response_length);
+            error = channel.send(response);
+        }
         if (error) {
             return error;
         }
 
         // call the given user function
-        auto callback = [=,&channel] (const void* result, SparkReturnType::Enum resultType )
-            { return this->function_result(channel, result, resultType, token); };
+        auto callback = [=,&channel,&acks] (const void* result, SparkReturnType::Enum resultType )
+            { return this->function_result(channel, acks, result, resultType, token, message_id); };
         call_function(function_key, function_arg, callback, NULL);
         return NO_ERROR;
     }
@@ -47,7 +47,8 @@ enum HelloFlag {
 	HELLO_FLAG_GOODBYE_SUPPORT = 0x10,
 	HELLO_FLAG_DEVICE_INITIATED_DESCRIBE = 0x20,
 	HELLO_FLAG_COMPRESSED_OTA = 0x40,
-	HELLO_FLAG_OTA_PROTOCOL_V3 = 0x80
+	HELLO_FLAG_OTA_PROTOCOL_V3 = 0x80,
+	HELLO_FLAG_BATCHED_SUBSCRIPTIONS = 0x100
 };
 
 struct ServerMovedContext {
@@ -96,6 +97,13 @@ ProtocolError Protocol::handle_received_message(Message& message,
 			code = CoAPCode::INTERNAL_SERVER_ERROR;
 		}
 		notify_message_complete(msg_id, code);
+		if (subscriptions.batched_subscription_rejected(msg_id, CoAPCode::is_success(code))) {
+			// The server doesn't support batched subscriptions
+			LOG(WARN, "Batched subscription request failed; sending subscriptions one by one");
+			protocol_flags &= ~ProtocolFlag::BATCHED_SUBSCRIPTIONS;
+			subscription_msg_ids.clear();
+			return send_subscriptions(true /* force */);
+		}
 		bool handled = false;
 		ProtocolError error = handle_app_state_reply(message, &handled);
 		if (error != ProtocolError::NO_ERROR) {
@@ -143,7 +151,7 @@ ProtocolError Protocol::handle_received_message(Message& message,
 			LOG(ERROR, "Missing request token");
 			return ProtocolError::MISSING_REQUEST_TOKEN;
 		}
-		return functions.handle_function_call(token, msg_id, message, channel,
+		return functions.handle_function_call(token, msg_id, message, channel, ack_scheduler,
 				descriptor.call_function);
 	}
 
@@ -413,6 +421,8 @@ void Protocol::init(const SparkCallbacks &callbacks,
 	copy_and_init(&this->descriptor, sizeof(this->descriptor), &descriptor,
 			descriptor.size);
 
+	ack_scheduler.init(&channel, this->callbacks);
+
 #if HAL_PLATFORM_OTA_PROTOCOL_V3
 	SPARK_ASSERT(firmwareUpdate.init(&channel, this->callbacks) == ProtocolError::NO_ERROR);
 #else
@@ -477,6 +487,11 @@ int Protocol::begin()
 		return error;
 	}
 
+	// The server doesn't necessarily retain the metrics acknowledged in the previous session
+	if (descriptor.app_state_selector_info) {
+		descriptor.app_state_selector_info(SparkAppStateSelector::DESCRIBE_METRICS, SparkAppStateUpdate::RESET, 0, nullptr);
+	}
+
 	if (session_resumed) {
 		// for now, unconditionally move the session on resumption
 		channel.command(MessageChannel::MOVE_SESSION, nullptr);
@@ -553,6 +568,7 @@ void Protocol::reset() {
 #else
 	chunkedTransfer.reset();
 #endif
+	ack_scheduler.reset();
 	pinger.reset();
 	timesync_.reset();
 	description.reset();
@@ -585,6 +601,9 @@ ProtocolError Protocol::hello(bool was_ota_upgrade_successful)
 #if HAL_PLATFORM_OTA_PROTOCOL_V3
 	flags |= HELLO_FLAG_OTA_PROTOCOL_V3;
 #endif
+	if (protocol_flags & ProtocolFlag::BATCHED_SUBSCRIPTIONS) {
+		flags |= HELLO_FLAG_BATCHED_SUBSCRIPTIONS;
+	}
 	size_t len = build_hello(message, flags);
 	message.set_length(len);
 	message.set_confirm_received(true); // Send synchronously
@@ -645,7 +664,12 @@ ProtocolError Protocol::event_loop(CoAPMessageType::Enum& message_type)
 
 	Message message;
 	message_type = CoAPMessageType::NONE;
-	ProtocolError error = channel.receive(message);
+	// Send the delayed acknowledgements before the channel buffer is reused for a received message
+	ProtocolError error = ack_scheduler.process();
+	if (!error)
+	{
+		error = channel.receive(message);
+	}
 	if (!error)
 	{
 		if (message.length())
@@ -716,8 +740,10 @@ ProtocolError Protocol::send_subscriptions(bool force)
 			return ProtocolError::NO_ERROR;
 		}
 	}
-	LOG(INFO, "Sending subscriptions");
-	const ProtocolError error = subscriptions.send_subscriptions(channel);
+	// A rejected batched request can only be detected if the request is confirmable
+	const bool batched = (protocol_flags & ProtocolFlag::BATCHED_SUBSCRIPTIONS) && channel.is_unreliable();
+	LOG(INFO, "Sending subscriptions%s", batched ? " (batched)" : "");
+	const ProtocolError error = subscriptions.send_subscriptions(channel, batched);
 	if (error == ProtocolError::NO_ERROR && descriptor.app_state_selector_info) {
 		subscription_msg_ids.append(subscriptions.subscription_message_ids());
 	}
@@ -767,6 +793,11 @@ ProtocolError Protocol::handle_app_state_reply(const Message& msg, bool* handled
 					SparkAppStateUpdate::COMPUTE_AND_PERSIST, 0, nullptr);
 			channel.command(Channel::LOAD_SESSION);
 		}
+		if ((desc_flags & DescriptionType::DESCRIBE_METRICS) && descriptor.app_state_selector_info) {
+			// The acknowledged metrics become the base for the following delta-encoded metrics
+			descriptor.app_state_selector_info(SparkAppStateSelector::DESCRIBE_METRICS,
+					SparkAppStateUpdate::PERSIST, 0, nullptr);
+		}
 	}
 	return ProtocolError::NO_ERROR;
 }
@@ -210,6 +210,14 @@ int spark_protocol_set_connection_property(ProtocolFacade* protocol, unsigned pr
         protocol->set_compressed_ota_enabled(value);
         return 0;
     }
+    case Connection::DELTA_METRICS: {
+        protocol->set_delta_metrics_enabled(value);
+        return 0;
+    }
+    case Connection::BATCHED_SUBSCRIPTIONS: {
+        protocol->set_batched_subscriptions_enabled(value);
+        return 0;
+    }
     case Connection::SYSTEM_MODULE_VERSION: {
         protocol->set_system_version(value);
         return 0;
@@ -226,6 +234,13 @@ int spark_protocol_set_connection_property(ProtocolFacade* protocol, unsigned pr
         protocol->set_max_transmit_message_size(value);
         return 0;
     }
+    case Connection::ACK_DELAY: {
+        protocol->set_ack_delay(value);
+        return 0;
+    }
+    case Connection::MESSAGE_PACKING_DELAY: {
+        return protocol->set_message_packing_delay(value);
+    }
     default:
         return ProtocolError::NOT_IMPLEMENTED;
     }
@@ -25,6 +25,16 @@
 
 namespace particle::protocol {
 
+namespace {
+
+// URI path of a batched subscription request
+const char* const BATCHED_SUBSCRIPTIONS_URI_PATH = "b";
+
+// Subscription flags that are sent to the server
+const int BATCHED_SUBSCRIPTION_FLAGS_MASK = SubscriptionFlag::BINARY_DATA | SubscriptionFlag::CBOR_DATA;
+
+} // namespace
+
 ProtocolError Subscriptions::send_subscription_impl(MessageChannel& channel, const char* filter, size_t filterLen, int flags) {
     Message msg;
     auto err = channel.create(msg);
@@ -62,6 +72,77 @@ ProtocolError Subscriptions::send_subscription_impl(MessageChannel& channel, con
     return ProtocolError::NO_ERROR;
 }
 
+/*
+ * The payload of a batched subscription request is a sequence of entries, one per subscription:
+ *
+ * Field       | Size
+ * ------------+----------------
+ * flags       | 1 byte
+ * filter size | 1 byte
+ * filter      | filter size
+ *
+ * The flags field contains the BINARY_DATA and CBOR_DATA subscription flags. If the subscriptions
+ * don't fit in one message, they are split across several requests.
+ */
+ProtocolError Subscriptions::send_batched_subscriptions(MessageChannel& channel) {
+    const size_t handlerCount = sizeof(event_handlers) / sizeof(event_handlers[0]);
+    size_t i = 0;
+    for (;;) {
+        while (i < handlerCount && !event_handlers[i].handler) {
+            ++i;
+        }
+        if (i == handlerCount) {
+            break;
+        }
+        Message msg;
+        auto err = channel.create(msg);
+        if (err != ProtocolError::NO_ERROR) {
+            return err;
+        }
+        CoapMessageEncoder e((char*)msg.buf(), msg.capacity());
+        e.type(channel.is_unreliable() ? CoapType::CON : CoapType::NON);
+        e.code(CoapCode::POST);
+        e.id(0); // Will be assigned and serialized by the message channel
+        e.option(CoapOption::URI_PATH, BATCHED_SUBSCRIPTIONS_URI_PATH);
+        auto payload = (uint8_t*)e.payloadData();
+        const size_t maxPayloadSize = e.maxPayloadSize();
+        size_t payloadSize = 0;
+        for (; i < handlerCount; ++i) {
+            const auto& h = event_handlers[i];
+            if (!h.handler) {
+                continue;
+            }
+            const size_t filterLen = strnlen(h.filter, sizeof(h.filter));
+            if (payloadSize + filterLen + 2 > maxPayloadSize) {
+                break;
+            }
+            payload[payloadSize++] = h.flags & BATCHED_SUBSCRIPTION_FLAGS_MASK;
+            payload[payloadSize++] = filterLen;
+            memcpy(payload + payloadSize, h.filter, filterLen);
+            payloadSize += filterLen;
+        }
+        if (!payloadSize) {
+            return ProtocolError::INSUFFICIENT_STORAGE; // A single entry doesn't fit in a message
+        }
+        e.payloadSize(payloadSize);
+        int r = e.encode();
+        if (r < 0) {
+            return ProtocolError::INTERNAL; // Should not happen
+        }
+        if (r > (int)msg.capacity()) {
+            return ProtocolError::INSUFFICIENT_STORAGE;
+        }
+        msg.set_length(r);
+        err = channel.send(msg);
+        if (err != ProtocolError::NO_ERROR) {
+            return err;
+        }
+        subscription_msg_ids.append(msg.get_id());
+        batch_msg_ids.append(msg.get_id());
+    }
+    return ProtocolError::NO_ERROR;
+}
+
 ProtocolError Subscriptions::handle_event(Message& msg, SparkDescriptor::CallEventHandlerCallback callback, MessageChannel& channel) {
     CoapMessageDecoder d;
     int r = d.decode((const char*)msg.buf(), msg.length());
@@ -42,9 +42,11 @@ public:
 private:
 	FilteringEventHandler event_handlers[MAX_SUBSCRIPTIONS];
 	Vector<message_handle_t> subscription_msg_ids;
+	Vector<message_handle_t> batch_msg_ids;
 
 protected:
 	ProtocolError send_subscription_impl(MessageChannel& channel, const char* filter, size_t filter_len, int flags);
+	ProtocolError send_batched_subscriptions(MessageChannel& channel);
 
 public:
 
@@ -166,9 +168,20 @@ public:
 		return INSUFFICIENT_STORAGE;
 	}
 
-	ProtocolError send_subscriptions(MessageChannel& channel)
+	/**
+	 * Sends all registered subscriptions.
+	 *
+	 * If `batched` is `true`, the subscriptions are sent in a single request, or in as few
+	 * requests as possible if they don't fit in one message. Otherwise, each subscription is
+	 * sent in a separate request.
+	 */
+	ProtocolError send_subscriptions(MessageChannel& channel, bool batched = false)
 	{
 		subscription_msg_ids.clear();
+		batch_msg_ids.clear();
+		if (batched) {
+			return send_batched_subscriptions(channel);
+		}
 		ProtocolError result = for_each([&](const FilteringEventHandler& handler) {
 			return send_subscription_impl(channel, handler.filter, strnlen(handler.filter, sizeof(handler.filter)), handler.flags);
 		});
@@ -185,6 +198,21 @@ public:
 	{
 		return subscription_msg_ids;
 	}
+
+	/**
+	 * Processes a reply for a previously sent message.
+	 *
+	 * @return `true` if the message is a batched subscription request and the server didn't
+	 *         accept it, otherwise `false`.
+	 */
+	bool batched_subscription_rejected(message_handle_t msg_id, bool success)
+	{
+		if (!batch_msg_ids.removeOne(msg_id) || success) {
+			return false;
+		}
+		batch_msg_ids.clear();
+		return true;
+	}
 };
 
 } // namespace protocol
@@ -19,9 +19,12 @@
 
 #include "protocol.h"
 #include "messages.h"
+#include "coap_message_encoder.h"
+#include "coap_message_decoder.h"
 
 #include "endian_util.h"
 
+#include <algorithm>
 #include <memory>
 #include <cstring>
 
@@ -29,14 +32,54 @@ namespace particle {
 
 namespace protocol {
 
+namespace {
+
+// Block sizes supported by RFC 7959
+const size_t MIN_BLOCK_SIZE = 16;
+const size_t MAX_BLOCK_SIZE = 1024;
+
+// Maximum size of an encoded Block2 option
+const size_t MAX_BLOCK_OPTION_SIZE = 1 /* Option header */ + 3 /* Option value */;
+
+unsigned encodeBlockOption(unsigned num, size_t size, bool m) {
+    // RFC 7959, 2.2. Structure of a Block Option
+    unsigned szx = 0;
+    while ((MIN_BLOCK_SIZE << szx) < size) {
+        ++szx;
+    }
+    unsigned opt = (num << 4) | szx;
+    if (m) {
+        opt |= 0x08;
+    }
+    return opt;
+}
+
+bool decodeBlockOption(unsigned opt, unsigned* num, size_t* size) {
+    const unsigned szx = opt & 0x07;
+    if (szx == 7) {
+        return false; // Reserved
+    }
+    *num = opt >> 4;
+    *size = MIN_BLOCK_SIZE << szx;
+    return true;
+}
+
+} // namespace
+
 struct Variables::Context {
-    Context(Variables* self, token_t token) :
+    Context(Variables* self, token_t token, message_id_t id, unsigned block_index = 0, size_t block_size = 0) :
             self(self),
-            token(token) {
+            token(token),
+            id(id),
+            block_index(block_index),
+            block_size(block_size) {
     }
 
     Variables* self;
     token_t token;
+    message_id_t id;
+    unsigned block_index; // Index of the requested block of the variable value
+    size_t block_size; // Block size, or 0 if the value is not requested in blocks
 };
 
 ProtocolError Variables::handle_request(Message& message, token_t token, message_id_t id) {
@@ -55,18 +98,53 @@ ProtocolError Variables::handle_request(Message& message, token_t token, message
 }
 
 ProtocolError Variables::handle_request(Message& message, token_t token, message_id_t id, const char* key) {
+    const auto& descriptor = protocol_->get_descriptor();
+    unsigned block_index = 0;
+    size_t block_size = 0;
+    if (descriptor.read_variable_async) {
+        // Streaming variables are read in blocks
+        CoapMessageDecoder d;
+        if (d.decode((const char*)message.buf(), message.length()) < 0) {
+            return send_error_ack(message, token, id, CoAPCode::BAD_REQUEST);
+        }
+        block_size = get_block_size();
+        const auto it = d.findOption(CoapOption::BLOCK2);
+        if (it) {
+            size_t size = 0;
+            if (!decodeBlockOption(it.toUInt(), &block_index, &size)) {
+                return send_error_ack(message, token, id, CoAPCode::BAD_OPTION);
+            }
+            if (size > block_size) {
+                // The block size can be reduced but the block number needs to be adjusted accordingly
+                // (RFC 7959, 2.4)
+                block_index *= size / block_size;
+            } else {
+                block_size = size;
+            }
+        }
+    }
     // Allocate a context for the request
-    std::unique_ptr<Context> ctx(new(std::nothrow) Context(this, token));
+    std::unique_ptr<Context> ctx(new(std::nothrow) Context(this, token, id, block_index, block_size));
     if (!ctx) {
         return send_error_ack(message, token, id, CoAPCode::INTERNAL_SERVER_ERROR);
     }
-    // Acknowledge the request
-    const auto result = send_empty_ack(message, id);
+    // Acknowledge the request, or schedule the acknowledgement so that the value can be sent in it
+    const auto result = protocol_->get_ack_scheduler().ack(message, id);
     if (result != ProtocolError::NO_ERROR) {
         return result;
     }
+    if (block_size) {
+        // Request one byte more than the block size to find out whether there are more blocks
+        const auto c = ctx.release(); // Transfer the ownership over the context object
+        if (descriptor.read_variable_async(key, block_index * block_size, block_size + 1, get_variable_callback, c)) {
+            return ProtocolError::NO_ERROR;
+        }
+        // Not a streaming variable
+        ctx.reset(c);
+        ctx->block_index = 0;
+        ctx->block_size = 0;
+    }
     // Get the value asynchronously
-    const auto& descriptor = protocol_->get_descriptor();
     descriptor.get_variable_async(key, get_variable_callback, ctx.release()); // Transfer the ownership over the context object
     return ProtocolError::NO_ERROR;
 }
@@ -100,13 +178,13 @@ ProtocolError Variables::handle_request_compat(Message& message, token_t token,
         // Unsupported variable type
         return send_error_ack(message, token, id, CoAPCode::INTERNAL_SERVER_ERROR);
     }
-    // Acknowledge the request
-    const auto result = send_empty_ack(message, id);
+    // Acknowledge the request, or schedule the acknowledgement so that the value can be sent in it
+    const auto result = protocol_->get_ack_scheduler().ack(message, id);
     if (result != ProtocolError::NO_ERROR) {
         return result;
     }
-    // Send a separate response
-    return send_response(token, value, value_size, value_type);
+    // Send the response
+    return send_response(token, id, value, value_size, value_type);
 }
 
 ProtocolError Variables::decode_request(Message& message, char* key) {
@@ -129,7 +207,7 @@ ProtocolError Variables::decode_request(Message& message, char* key) {
 }
 
 ProtocolError Variables::encode_response(Message& message, token_t token, const void* value, size_t value_size,
-        SparkReturnType::Enum value_type) {
+        SparkReturnType::Enum value_type, bool piggybacked) {
     const auto max_value_size = protocol_->get_max_variable_value_size();
     if (value_size > max_value_size) {
         value_size = max_value_size; // Truncate the value data
@@ -141,7 +219,7 @@ ProtocolError Variables::encode_response(Message& message, token_t token, const
             return ProtocolError::INSUFFICIENT_STORAGE;
         }
         const uint8_t v = *(const bool*)value ? 1 : 0;
-        msg_size = encode_response(message.buf(), token, &v, sizeof(v));
+        msg_size = encode_response(message.buf(), token, &v, sizeof(v), piggybacked);
         break;
     }
     case SparkReturnType::INT: {
@@ -149,18 +227,18 @@ ProtocolError Variables::encode_response(Message& message, token_t token, const
             return ProtocolError::INSUFFICIENT_STORAGE;
         }
         const uint32_t v = nativeToBigEndian(*(const uint32_t*)value);
-        msg_size = encode_response(message.buf(), token, &v, sizeof(v));
+        msg_size = encode_response(message.buf(), token, &v, sizeof(v), piggybacked);
         break;
     }
     case SparkReturnType::DOUBLE: {
         if (value_size < sizeof(double)) {
             return ProtocolError::INSUFFICIENT_STORAGE;
         }
-        msg_size = encode_response(message.buf(), token, value, sizeof(double));
+        msg_size = encode_response(message.buf(), token, value, sizeof(double), piggybacked);
         break;
     }
     case SparkReturnType::STRING: {
-        msg_size = encode_response(message.buf(), token, value, value_size);
+        msg_size = encode_response(message.buf(), token, value, value_size, piggybacked);
         break;
     }
     default:
@@ -170,33 +248,105 @@ ProtocolError Variables::encode_response(Message& message, token_t token, const
     return ProtocolError::NO_ERROR;
 }
 
-size_t Variables::encode_response(uint8_t* buffer, token_t token, const void* value, size_t value_size) {
+size_t Variables::encode_response(uint8_t* buffer, token_t token, const void* value, size_t value_size, bool piggybacked) {
+    if (piggybacked) {
+        return Messages::coded_ack(buffer, token, CoAPCode::CONTENT, 0 /* message_id_msb */, 0 /* message_id_lsb */,
+                (uint8_t*)value, value_size);
+    }
     auto& channel = protocol_->get_channel();
     return Messages::separate_response_with_payload(buffer, 0 /* message_id */, token, CoAPCode::CONTENT,
             (const uint8_t*)value, value_size, channel.is_unreliable());
 }
 
-ProtocolError Variables::send_response(token_t token, const void* value, size_t value_size, SparkReturnType::Enum value_type) {
+ProtocolError Variables::encode_block_response(Message& message, token_t token, const void* value, size_t value_size,
+        unsigned block_index, size_t block_size, bool has_more, bool piggybacked) {
+    CoapMessageEncoder e((char*)message.buf(), message.capacity());
+    if (piggybacked) {
+        e.type(CoapType::ACK);
+    } else {
+        e.type(protocol_->get_channel().is_unreliable() ? CoapType::CON : CoapType::NON);
+    }
+    e.code(CoapCode::CONTENT);
+    e.id(0); // Encoded by the message channel
+    e.token((const char*)&token, sizeof(token));
+    e.option(CoapOption::BLOCK2, encodeBlockOption(block_index, block_size, has_more));
+    e.payload((const char*)value, value_size);
+    const int r = e.encode();
+    if (r < 0) {
+        return ProtocolError::INTERNAL;
+    }
+    if (r > (int)message.capacity()) {
+        return ProtocolError::INSUFFICIENT_STORAGE;
+    }
+    message.set_length(r);
+    return ProtocolError::NO_ERROR;
+}
+
+ProtocolError Variables::send_response(token_t token, message_id_t id, const void* value, size_t value_size,
+        SparkReturnType::Enum value_type) {
     Message msg;
     auto& channel = protocol_->get_channel();
     ProtocolError result = channel.create(msg);
     if (result != ProtocolError::NO_ERROR) {
         return result;
     }
-    result = encode_response(msg, token, value, value_size, value_type);
+    // Send the value in the ACK if the request hasn't been acknowledged yet
+    const bool piggybacked = protocol_->get_ack_scheduler().take(id);
+    result = encode_response(msg, token, value, value_size, value_type, piggybacked);
     if (result != ProtocolError::NO_ERROR) {
+        if (piggybacked) {
+            return send_error_ack(msg, token, id, CoAPCode::INTERNAL_SERVER_ERROR);
+        }
         return send_error_response(msg, token, CoAPCode::INTERNAL_SERVER_ERROR);
     }
+    if (piggybacked) {
+        msg.set_id(id);
+    }
+    return channel.send(msg);
+}
+
+ProtocolError Variables::send_block_response(const Context& ctx, const void* value, size_t value_size,
+        SparkReturnType::Enum value_type) {
+    const bool has_more = value_size > ctx.block_size;
+    if (value_type != SparkReturnType::STRING || (ctx.block_index == 0 && !has_more)) {
+        // The value fits in a single message
+        return send_response(ctx.token, ctx.id, value, value_size, value_type);
+    }
+    if (ctx.block_index > 0 && value_size == 0) {
+        // The requested block is past the end of the value
+        return send_error_response(ctx.token, ctx.id, CoAPCode::NOT_FOUND);
+    }
+    Message msg;
+    auto& channel = protocol_->get_channel();
+    ProtocolError result = channel.create(msg);
+    if (result != ProtocolError::NO_ERROR) {
+        return result;
+    }
+    const bool piggybacked = protocol_->get_ack_scheduler().take(ctx.id);
+    result = encode_block_response(msg, ctx.token, value, std::min(value_size, ctx.block_size), ctx.block_index,
+            ctx.block_size, has_more, piggybacked);
+    if (result != ProtocolError::NO_ERROR) {
+        if (piggybacked) {
+            return send_error_ack(msg, ctx.token, ctx.id, CoAPCode::INTERNAL_SERVER_ERROR);
+        }
+        return send_error_response(msg, ctx.token, CoAPCode::INTERNAL_SERVER_ERROR);
+    }
+    if (piggybacked) {
+        msg.set_id(ctx.id);
+    }
     return channel.send(msg);
 }
 
-ProtocolError Variables::send_error_response(token_t token, uint8_t code) {
+ProtocolError Variables::send_error_response(token_t token, message_id_t id, uint8_t code) {
     Message msg;
     auto& channel = protocol_->get_channel();
     ProtocolError result = channel.create(msg);
     if (result != ProtocolError::NO_ERROR) {
         return result;
     }
+    if (protocol_->get_ack_scheduler().take(id)) {
+        return send_error_ack(msg, token, id, code);
+    }
     return send_error_response(msg, token, code);
 }
 
@@ -207,14 +357,6 @@ ProtocolError Variables::send_error_response(Message& message, token_t token, ui
     return channel.send(message);
 }
 
-ProtocolError Variables::send_empty_ack(Message& message, message_id_t id) {
-    const auto buf = message.buf();
-    const size_t size = Messages::coded_ack(buf, CoAPCode::NONE, 0 /* message_id_msb */, 0 /* message_id_lsb */);
-    message.set_length(size);
-    message.set_id(id);
-    return protocol_->get_channel().send(message);
-}
-
 ProtocolError Variables::send_error_ack(Message& message, token_t token, message_id_t id, uint8_t code) {
     const auto buf = message.buf();
     const size_t size = Messages::coded_ack(buf, token, code, 0 /* message_id_msb */, 0 /* message_id_lsb */);
@@ -223,13 +365,27 @@ ProtocolError Variables::send_error_ack(Message& message, token_t token, message
     return protocol_->get_channel().send(message);
 }
 
+size_t Variables::get_block_size() const {
+    // Use the largest block size that fits in a message together with the Block2 option
+    const size_t overhead = MAX_VARIABLE_VALUE_MESSAGE_SIZE - MAX_VARIABLE_VALUE_LENGTH + MAX_BLOCK_OPTION_SIZE;
+    const size_t max_msg_size = protocol_->get_max_transmit_message_size();
+    const size_t max_size = (max_msg_size > overhead) ? max_msg_size - overhead : 0;
+    size_t size = MAX_BLOCK_SIZE;
+    while (size > MIN_BLOCK_SIZE && size > max_size) {
+        size /= 2;
+    }
+    return size;
+}
+
 void Variables::get_variable_callback(int result, int type, void* data, size_t size, void* context) {
     const auto p = (Context*)context;
     if (result != ProtocolError::NO_ERROR) {
         const auto code = CoAP::codeForProtocolError((ProtocolError)result);
-        p->self->send_error_response(p->token, code);
+        p->self->send_error_response(p->token, p->id, code);
+    } else if (p->block_size) {
+        p->self->send_block_response(*p, data, size, (SparkReturnType::Enum)type);
     } else {
-        p->self->send_response(p->token, data, size, (SparkReturnType::Enum)type);
+        p->self->send_response(p->token, p->id, data, size, (SparkReturnType::Enum)type);
     }
     free(data);
     delete p;
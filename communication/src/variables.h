@@ -48,16 +48,21 @@ private:
     ProtocolError handle_request_compat(Message& message, token_t token, message_id_t id, const char* key);
 
     ProtocolError decode_request(Message& message, char* key);
-    ProtocolError encode_response(Message& message, token_t token, const void* value, size_t value_size, SparkReturnType::Enum value_type);
-    size_t encode_response(uint8_t* buffer, token_t token, const void* value, size_t value_size);
-
-    ProtocolError send_response(token_t token, const void* value, size_t value_size, SparkReturnType::Enum value_type);
-    ProtocolError send_error_response(token_t token, uint8_t code);
+    ProtocolError encode_response(Message& message, token_t token, const void* value, size_t value_size, SparkReturnType::Enum value_type,
+            bool piggybacked);
+    size_t encode_response(uint8_t* buffer, token_t token, const void* value, size_t value_size, bool piggybacked);
+    ProtocolError encode_block_response(Message& message, token_t token, const void* value, size_t value_size,
+            unsigned block_index, size_t block_size, bool has_more, bool piggybacked);
+
+    ProtocolError send_response(token_t token, message_id_t id, const void* value, size_t value_size, SparkReturnType::Enum value_type);
+    ProtocolError send_block_response(const Context& ctx, const void* value, size_t value_size, SparkReturnType::Enum value_type);
+    ProtocolError send_error_response(token_t token, message_id_t id, uint8_t code);
     ProtocolError send_error_response(Message& message, token_t token, uint8_t code);
 
-    ProtocolError send_empty_ack(Message& message, message_id_t id);
     ProtocolError send_error_ack(Message& message, token_t token, message_id_t id, uint8_t code);
 
+    size_t get_block_size() const;
+
     static void get_variable_callback(int result, int type, void* data, size_t size, void* context); // SparkDescriptor::GetVariableCallback
 };
 
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "mbedtls/ecp.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Generate an ephemeral ECDH key pair ahead of time.
+ *
+ * The key pair is used by the next call to `mbedtls_ecdh_gen_public()` with the same group made
+ * by the thread that enabled its use via `mbedtls_ecdh_use_precomputed_keypair()`, e.g. when the
+ * client key exchange message of a DTLS handshake is generated, which takes the point
+ * multiplication off the handshake's critical path. A precomputed key pair is used at most once.
+ * The function does nothing if a key pair for the group is already available.
+ *
+ * @param grp_id Group ID.
+ * @param f_rng Random number generator.
+ * @param p_rng Context of the random number generator.
+ * @return 0 on success, otherwise an error code defined by `system_error_t`.
+ */
+int mbedtls_ecdh_precompute_keypair(mbedtls_ecp_group_id grp_id, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng);
+
+/**
+ * Check if a precomputed key pair is available for the given group.
+ */
+int mbedtls_ecdh_has_precomputed_keypair(mbedtls_ecp_group_id grp_id);
+
+/**
+ * Discard the precomputed key pair.
+ */
+void mbedtls_ecdh_clear_precomputed_keypair(void);
+
+/**
+ * Allow or disallow the use of the precomputed key pair by the current thread.
+ *
+ * The precomputed key pair is only used by `mbedtls_ecdh_gen_public()` while its use is allowed
+ * and only in the thread that allowed it. Other callers always get a freshly generated key pair.
+ *
+ * @param enable Whether the use of the precomputed key pair is allowed.
+ */
+void mbedtls_ecdh_use_precomputed_keypair(int enable);
+
+#ifdef  __cplusplus
+}
+#endif
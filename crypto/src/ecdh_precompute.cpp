@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_ECDH_C)
+
+#include "ecdh_precompute.h"
+
+#include "mbedtls_util.h"
+#include "mbedtls/ecdh.h"
+#include "concurrent_hal.h"
+
+#include <atomic>
+
+namespace {
+
+enum KeypairState {
+    KEYPAIR_EMPTY,
+    KEYPAIR_BUSY, // Claimed by a thread that is updating or consuming the key pair
+    KEYPAIR_READY
+};
+
+// The key pair is only accessed by the thread that has moved the state to KEYPAIR_BUSY
+mbedtls_ecp_keypair g_keypair;
+std::atomic<int> g_keypairState(KEYPAIR_EMPTY);
+std::atomic<int> g_keypairGroup(MBEDTLS_ECP_DP_NONE);
+
+// Thread that is allowed to use the key pair
+std::atomic<os_thread_t> g_keypairConsumer(nullptr);
+std::atomic<bool> g_keypairConsumerSet(false);
+
+bool claimKeypair(int expectedState) {
+    return g_keypairState.compare_exchange_strong(expectedState, KEYPAIR_BUSY, std::memory_order_acquire,
+            std::memory_order_relaxed);
+}
+
+void releaseKeypair(int state) {
+    g_keypairState.store(state, std::memory_order_release);
+}
+
+bool isKeypairConsumer() {
+    return g_keypairConsumerSet.load(std::memory_order_relaxed) &&
+            g_keypairConsumer.load(std::memory_order_relaxed) == os_thread_current(nullptr);
+}
+
+} // namespace
+
+int mbedtls_ecdh_precompute_keypair(mbedtls_ecp_group_id grp_id, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+    if (mbedtls_ecdh_has_precomputed_keypair(grp_id)) {
+        return 0;
+    }
+    // Generate the key pair without holding the claim as it takes a while
+    mbedtls_ecp_keypair key;
+    mbedtls_ecp_keypair_init(&key);
+    const int r = mbedtls_ecp_gen_key(grp_id, &key, f_rng, p_rng);
+    if (r != 0) {
+        mbedtls_ecp_keypair_free(&key);
+        return mbedtls_to_system_error(r);
+    }
+    bool hadKeypair = true;
+    if (!claimKeypair(KEYPAIR_READY)) {
+        hadKeypair = false;
+        if (!claimKeypair(KEYPAIR_EMPTY)) {
+            // Another thread is using the key pair slot
+            mbedtls_ecp_keypair_free(&key);
+            return 0;
+        }
+    }
+    if (hadKeypair) {
+        mbedtls_ecp_keypair_free(&g_keypair); // Zeroizes the private key
+    }
+    // The new key pair takes over the memory allocated for the generated one
+    g_keypair = key;
+    g_keypairGroup.store(grp_id, std::memory_order_relaxed);
+    releaseKeypair(KEYPAIR_READY);
+    return 0;
+}
+
+int mbedtls_ecdh_has_precomputed_keypair(mbedtls_ecp_group_id grp_id) {
+    return g_keypairState.load(std::memory_order_acquire) == KEYPAIR_READY &&
+            g_keypairGroup.load(std::memory_order_relaxed) == grp_id;
+}
+
+void mbedtls_ecdh_clear_precomputed_keypair() {
+    if (claimKeypair(KEYPAIR_READY)) {
+        mbedtls_ecp_keypair_free(&g_keypair);
+        g_keypairGroup.store(MBEDTLS_ECP_DP_NONE, std::memory_order_relaxed);
+        releaseKeypair(KEYPAIR_EMPTY);
+    }
+}
+
+void mbedtls_ecdh_use_precomputed_keypair(int enable) {
+    if (enable) {
+        g_keypairConsumer.store(os_thread_current(nullptr), std::memory_order_relaxed);
+        g_keypairConsumerSet.store(true, std::memory_order_release);
+    } else {
+        g_keypairConsumerSet.store(false, std::memory_order_release);
+        g_keypairConsumer.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+#if defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+
+int mbedtls_ecdh_gen_public(mbedtls_ecp_group* grp, mbedtls_mpi* d, mbedtls_ecp_point* Q,
+        int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+    // Other users of ECDH, such as BLE pairing, always generate a fresh key pair
+    if (isKeypairConsumer() && mbedtls_ecdh_has_precomputed_keypair(grp->id) && claimKeypair(KEYPAIR_READY)) {
+        int r = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+        if (g_keypairGroup.load(std::memory_order_relaxed) == grp->id) {
+            r = mbedtls_mpi_copy(d, &g_keypair.d);
+            if (r == 0) {
+                r = mbedtls_ecp_copy(Q, &g_keypair.Q);
+            }
+        }
+        // An ephemeral key must not be reused
+        mbedtls_ecp_keypair_free(&g_keypair);
+        g_keypairGroup.store(MBEDTLS_ECP_DP_NONE, std::memory_order_relaxed);
+        releaseKeypair(KEYPAIR_EMPTY);
+        if (r == 0) {
+            return 0;
+        }
+    }
+    return mbedtls_ecp_gen_keypair(grp, d, Q, f_rng, p_rng);
+}
+
+#endif // defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+
+#endif // defined(MBEDTLS_ECDH_C)
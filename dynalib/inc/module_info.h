@@ -211,6 +211,32 @@ typedef struct compressed_module_header {
     uint32_t original_size;
 } __attribute__((__packed__)) compressed_module_header;
 
+#define COMPRESSED_MODULE_INDEX_MAGIC (0x5849) /* "IX" */
+
+/**
+ * Seek index of a compressed module.
+ *
+ * The index is optional. If present, it immediately follows the compressed module header and is
+ * included in the header size. When building the module, the compressor performs a full flush after
+ * every `interval` bytes of the uncompressed data so that the decompression can be restarted at any
+ * of these points without the preceding data. The structure is followed by `count` 32-bit offsets of
+ * the restart points in the compressed data.
+ */
+typedef struct compressed_module_index {
+    /**
+     * Magic number (`COMPRESSED_MODULE_INDEX_MAGIC`).
+     */
+    uint16_t magic;
+    /**
+     * Number of restart points.
+     */
+    uint16_t count;
+    /**
+     * Distance between restart points in the uncompressed data.
+     */
+    uint32_t interval;
+} __attribute__((__packed__)) compressed_module_index;
+
 typedef enum module_info_extension_type_t {
     MODULE_INFO_EXTENSION_END = 0x0000, // May be padded with size reflecting the padding amount
     MODULE_INFO_EXTENSION_PRODUCT_DATA = 0x0001,
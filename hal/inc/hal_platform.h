@@ -268,6 +268,11 @@
 #define HAL_PLATFORM_USB_CONTROL_INTERFACE (0)
 #endif // HAL_PLATFORM_USB_CONTROL_INTERFACE
 
+// Size of the ring buffer for USB control requests. 0 disables the pipelined mode of the channel
+#ifndef HAL_PLATFORM_USB_CONTROL_RING_BUFFER_SIZE
+#define HAL_PLATFORM_USB_CONTROL_RING_BUFFER_SIZE (0)
+#endif // HAL_PLATFORM_USB_CONTROL_RING_BUFFER_SIZE
+
 #ifndef HAL_PLATFORM_RNG
 #define HAL_PLATFORM_RNG (0)
 #endif // HAL_PLATFORM_RNG
@@ -606,6 +611,10 @@
 #define HAL_PLATFORM_INFLATE_USE_FILESYSTEM (0)
 #endif // HAL_PLATFORM_INFLATE_USE_FILESYSTEM
 
+#ifndef HAL_PLATFORM_INFLATE_FAST
+#define HAL_PLATFORM_INFLATE_FAST (0)
+#endif // HAL_PLATFORM_INFLATE_FAST
+
 #ifndef HAL_PLATFORM_ASSETS
 #define HAL_PLATFORM_ASSETS (0)
 #endif // HAL_PLATFORM_ASSETS
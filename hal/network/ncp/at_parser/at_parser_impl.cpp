@@ -21,6 +21,7 @@
 
 #include "stream.h"
 #include "logging.h"
+#include "spark_wiring_diagnostics.h"
 #include "scope_guard.h"
 #include "check.h"
 #include "debug.h"
@@ -93,6 +94,10 @@ inline system_tick_t millis() {
     return HAL_Timer_Get_Milli_Seconds();
 }
 
+// Time between sending a command and receiving its final result code
+HistogramDiagnosticData<> g_commandLatency(DIAG_ID_NETWORK_AT_COMMAND_LATENCY_HISTOGRAM,
+        DIAG_NAME_NETWORK_AT_COMMAND_LATENCY_HISTOGRAM);
+
 } // unnamed
 
 AtParserImpl::AtParserImpl(AtParserConfig conf) :
@@ -133,6 +138,7 @@ int AtParserImpl::sendCommand() {
     clearStatus(StatusFlag::WRITE_CMD);
     setStatus(StatusFlag::FLUSH_CMD);
     cmdTermOffs_ = 0;
+    cmdSendTime_ = millis();
     PARSER_CHECK(flushCommand(&cmdTimeout_));
     return 0;
 }
@@ -181,6 +187,7 @@ int AtParserImpl::readResult(int* errorCode) {
             if (checkStatus(StatusFlag::LINE_BEGIN)) {
                 const int ret = PARSER_CHECK(parseLine(ParseFlag::PARSE_RESULT | ParseFlag::PARSE_URC, &cmdTimeout_));
                 if (ret == ParseResult::PARSED_RESULT) {
+                    g_commandLatency.record(millis() - cmdSendTime_);
                     break;
                 }
             }
@@ -313,6 +320,7 @@ void AtParserImpl::reset() {
     bufPos_ = 0;
     cmdSize_ = 0;
     cmdTimeout_ = 0;
+    cmdSendTime_ = 0;
     cmdTermOffs_ = 0;
     respSize_ = 0;
     errorCode_ = 0;
@@ -127,6 +127,7 @@ private:
     int errorCode_; // Error code reported via "+CME ERROR" or "+CMS ERROR"
     size_t cmdTermOffs_; // Number of characters of the command terminator written to the stream
     unsigned cmdTimeout_; // Command timeout
+    system_tick_t cmdSendTime_; // Time when the command was sent
     unsigned status_; // Status flags
 
     Vector<UrcHandler> urcHandlers_; // URC handlers
@@ -38,6 +38,15 @@ const auto INFLATE_USE_FILESYSTEM_READ_CACHE_SIZE = 1024;
 
 #endif // HAL_PLATFORM_INFLATE_USE_FILESYSTEM
 
+#if HAL_PLATFORM_INFLATE_FAST
+
+inline bool useFastDecoder(const inflate_ctx* ctx) {
+    // The fast decoder needs the sliding window to be in RAM
+    return ctx->buf;
+}
+
+#endif // HAL_PLATFORM_INFLATE_FAST
+
 } // anonymous
 
 int inflate_create(inflate_ctx** ctx, const inflate_opts* opts, inflate_output output, void* user_data) {
@@ -110,7 +119,14 @@ void inflate_destroy(inflate_ctx* ctx) {
 }
 
 int inflate_reset(inflate_ctx* ctx) {
-    tinfl_init(&ctx->decomp);
+#if HAL_PLATFORM_INFLATE_FAST
+    if (useFastDecoder(ctx)) {
+        inflate_fast_reset(&ctx->fast);
+    } else
+#endif // HAL_PLATFORM_INFLATE_FAST
+    {
+        tinfl_init(&ctx->decomp);
+    }
     CHECK(inflate_reset_impl(ctx));
     ctx->buf_offs = 0;
     ctx->buf_avail = 0;
@@ -190,6 +206,31 @@ int inflate_input(inflate_ctx* ctx, const char* data, size_t* size, unsigned fla
             }
             break;
         }
+#if HAL_PLATFORM_INFLATE_FAST
+        if (useFastDecoder(ctx)) {
+            // Decode as much data as possible, up to the end of the buffer, so that it can be passed
+            // to the output callback in one piece
+            size_t srcSize = *size - srcOffs;
+            size_t pos = ctx->buf_offs;
+            const int r = inflate_fast_decode(&ctx->fast, (const uint8_t*)data + srcOffs, &srcSize, (uint8_t*)ctx->buf,
+                    ctx->buf_size, &pos, flags & INFLATE_HAS_MORE_INPUT);
+            if (r < 0) {
+                ctx->result = r;
+                break;
+            }
+            if (r == INFLATE_NEEDS_MORE_INPUT) {
+                needMore = true;
+            } else if (r == INFLATE_DONE) {
+                ctx->done = true;
+            } else if (pos == ctx->buf_offs) { // Sanity check to prevent the infinite loop
+                ctx->result = SYSTEM_ERROR_INTERNAL;
+                break;
+            }
+            ctx->buf_avail = pos - ctx->buf_offs;
+            srcOffs += srcSize;
+            continue;
+        }
+#endif // HAL_PLATFORM_INFLATE_FAST
         size_t srcSize = *size - srcOffs;
         size_t destSize = ctx->buf_size - ctx->buf_offs;
         const uint32_t tinflFlags = 
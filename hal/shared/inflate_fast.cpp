@@ -0,0 +1,647 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hal_platform.h"
+
+#if HAL_PLATFORM_COMPRESSED_OTA && HAL_PLATFORM_INFLATE_FAST
+
+#include "inflate_fast.h"
+#include "inflate.h"
+
+#include "system_error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+enum State {
+    STATE_HEADER,
+    STATE_STORED_LEN,
+    STATE_STORED_COPY,
+    STATE_TABLE_COUNTS,
+    STATE_CLEN_LENS,
+    STATE_CODE_LENS,
+    STATE_LITLEN,
+    STATE_LEN_EXTRA,
+    STATE_DIST,
+    STATE_DIST_EXTRA,
+    STATE_COPY,
+    STATE_DONE
+};
+
+enum TableType {
+    TABLE_CLEN,
+    TABLE_LITLEN,
+    TABLE_DIST
+};
+
+const unsigned MAX_CODE_BITS = 15;
+const unsigned CLEN_ROOT_BITS = 7;
+const unsigned CLEN_CODE_COUNT = 19;
+const unsigned MAX_MATCH_LEN = 258;
+
+// Minimum number of input bytes for the fast decoding loop. A single iteration consumes at most
+// 48 bits and the bit buffer is refilled by reading 4 bytes at a time
+const size_t FAST_MIN_INPUT = 16;
+
+const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99,
+        115, 131, 163, 195, 227, 258 };
+const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025,
+        1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12,
+        12, 13, 13 };
+const uint8_t CLEN_ORDER[CLEN_CODE_COUNT] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// A lookup table entry contains the number of bits of the code in bits 0-7, the entry type in
+// bits 8-15 and the value in bits 16-31. For a link to a second-level table, the value is the
+// offset of that table and the number of bits is the number of its index bits
+const unsigned OP_LITERAL = 0x00;
+const unsigned OP_BASE = 0x10; // Length or distance base. Bits 0-3 contain the number of extra bits
+const unsigned OP_END = 0x20;
+const unsigned OP_LINK = 0x40;
+const unsigned OP_INVALID = 0x80;
+
+inline uint32_t makeEntry(unsigned op, unsigned bits, unsigned value) {
+    return (value << 16) | (op << 8) | bits;
+}
+
+inline unsigned entryBits(uint32_t e) {
+    return e & 0xff;
+}
+
+inline unsigned entryOp(uint32_t e) {
+    return (e >> 8) & 0xff;
+}
+
+inline unsigned entryValue(uint32_t e) {
+    return e >> 16;
+}
+
+uint32_t symbolEntry(TableType type, unsigned sym, unsigned bits) {
+    if (type == TABLE_LITLEN) {
+        if (sym < 256) {
+            return makeEntry(OP_LITERAL, bits, sym);
+        }
+        if (sym == 256) {
+            return makeEntry(OP_END, bits, 0);
+        }
+        if (sym < 286) {
+            return makeEntry(OP_BASE | LENGTH_EXTRA[sym - 257], bits, LENGTH_BASE[sym - 257]);
+        }
+        return makeEntry(OP_INVALID, bits, 0);
+    }
+    if (type == TABLE_DIST) {
+        if (sym < 30) {
+            return makeEntry(OP_BASE | DIST_EXTRA[sym], bits, DIST_BASE[sym]);
+        }
+        return makeEntry(OP_INVALID, bits, 0);
+    }
+    return makeEntry(OP_LITERAL, bits, sym);
+}
+
+unsigned reverseBits(unsigned code, unsigned len) {
+    unsigned r = 0;
+    while (len--) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+// Builds a lookup table for a canonical Huffman code. Codes that don't fit in the first-level
+// table are resolved via second-level tables that follow it
+int buildTable(TableType type, const uint8_t* lens, unsigned count, uint32_t* table, unsigned tableSize,
+        unsigned rootBits) {
+    uint16_t lenCount[MAX_CODE_BITS + 1] = {};
+    for (unsigned i = 0; i < count; ++i) {
+        ++lenCount[lens[i]];
+    }
+    lenCount[0] = 0;
+    unsigned maxLen = MAX_CODE_BITS;
+    while (maxLen > 0 && !lenCount[maxLen]) {
+        --maxLen;
+    }
+    const unsigned rootSize = 1u << rootBits;
+    const uint32_t invalid = makeEntry(OP_INVALID, 0, 0);
+    for (unsigned i = 0; i < rootSize; ++i) {
+        table[i] = invalid;
+    }
+    if (!maxLen) {
+        return 0; // No codes
+    }
+    int left = 1;
+    for (unsigned len = 1; len <= MAX_CODE_BITS; ++len) {
+        left = (left << 1) - lenCount[len];
+        if (left < 0) {
+            return SYSTEM_ERROR_BAD_DATA; // Over-subscribed
+        }
+    }
+    // An incomplete code is only allowed if it consists of a single code of length 1
+    if (left > 0 && (type == TABLE_CLEN || maxLen != 1)) {
+        return SYSTEM_ERROR_BAD_DATA;
+    }
+    // Sort the symbols by code length
+    uint16_t offs[MAX_CODE_BITS + 1] = {};
+    for (unsigned len = 1; len < MAX_CODE_BITS; ++len) {
+        offs[len + 1] = offs[len] + lenCount[len];
+    }
+    uint16_t sorted[INFLATE_FAST_MAX_CODES];
+    for (unsigned i = 0; i < count; ++i) {
+        if (lens[i]) {
+            sorted[offs[lens[i]]++] = i;
+        }
+    }
+    unsigned used = rootSize;
+    unsigned curLow = (unsigned)-1;
+    uint32_t* sub = nullptr;
+    unsigned subBits = 0;
+    unsigned code = 0;
+    unsigned index = 0;
+    for (unsigned len = 1; len <= maxLen; ++len, code <<= 1) {
+        while (lenCount[len]) {
+            const unsigned sym = sorted[index++];
+            const unsigned rev = reverseBits(code, len);
+            if (len <= rootBits) {
+                const auto e = symbolEntry(type, sym, len);
+                for (unsigned i = rev; i < rootSize; i += (1u << len)) {
+                    table[i] = e;
+                }
+            } else {
+                const unsigned low = rev & (rootSize - 1);
+                if (low != curLow) {
+                    // Determine the size of the second-level table based on the remaining codes
+                    subBits = len - rootBits;
+                    int avail = 1 << subBits;
+                    while (subBits + rootBits < maxLen) {
+                        avail -= lenCount[subBits + rootBits];
+                        if (avail <= 0) {
+                            break;
+                        }
+                        ++subBits;
+                        avail <<= 1;
+                    }
+                    if (used + (1u << subBits) > tableSize) {
+                        return SYSTEM_ERROR_INTERNAL;
+                    }
+                    table[low] = makeEntry(OP_LINK, subBits, used);
+                    sub = table + used;
+                    used += 1u << subBits;
+                    curLow = low;
+                }
+                const auto e = symbolEntry(type, sym, len - rootBits);
+                for (unsigned i = rev >> rootBits; i < (1u << subBits); i += (1u << (len - rootBits))) {
+                    sub[i] = e;
+                }
+            }
+            --lenCount[len];
+            ++code;
+        }
+    }
+    return 0;
+}
+
+int buildFixedTables(inflate_fast_decoder* d) {
+    uint8_t lens[288];
+    memset(lens, 8, 144);
+    memset(lens + 144, 9, 112);
+    memset(lens + 256, 7, 24);
+    memset(lens + 280, 8, 8);
+    int r = buildTable(TABLE_LITLEN, lens, 288, d->litlen_table, INFLATE_FAST_LITLEN_TABLE_SIZE,
+            INFLATE_FAST_LITLEN_ROOT_BITS);
+    if (r < 0) {
+        return r;
+    }
+    memset(lens, 5, 32);
+    r = buildTable(TABLE_DIST, lens, 32, d->dist_table, INFLATE_FAST_DIST_TABLE_SIZE, INFLATE_FAST_DIST_ROOT_BITS);
+    if (r < 0) {
+        return r;
+    }
+    d->fixed_tables = true;
+    return 0;
+}
+
+inline uint32_t lookup(const uint32_t* table, unsigned rootBits, uint32_t bitBuf, unsigned* bits) {
+    auto e = table[bitBuf & ((1u << rootBits) - 1)];
+    if (entryOp(e) & OP_LINK) {
+        e = table[entryValue(e) + ((bitBuf >> rootBits) & ((1u << entryBits(e)) - 1))];
+        *bits = rootBits + entryBits(e);
+    } else {
+        *bits = entryBits(e);
+    }
+    return e;
+}
+
+inline uint32_t loadLe32(const uint8_t* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#else
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+#endif
+}
+
+// Copies `n` bytes within the buffer. The destination may overlap the source, in which case the
+// copied bytes are repeated as required by the Deflate format
+inline void copyMatch(uint8_t* dest, const uint8_t* src, size_t n) {
+    if (dest < src || (size_t)(dest - src) >= 8) {
+        // Each 8-byte chunk is read before it can be overwritten
+        while (n >= 8) {
+            uint8_t tmp[8];
+            memcpy(tmp, src, 8);
+            memcpy(dest, tmp, 8);
+            dest += 8;
+            src += 8;
+            n -= 8;
+        }
+    } else if (dest - src == 1) {
+        memset(dest, *src, n);
+        return;
+    }
+    while (n--) {
+        *dest++ = *src++;
+    }
+}
+
+} // namespace
+
+void inflate_fast_reset(inflate_fast_decoder* d) {
+    d->bit_buf = 0;
+    d->bit_count = 0;
+    d->state = STATE_HEADER;
+    d->length = 0;
+    d->dist = 0;
+    d->extra = 0;
+    d->have = 0;
+    d->total_out = 0;
+    d->last_block = false;
+    d->fixed_tables = false;
+}
+
+int inflate_fast_decode(inflate_fast_decoder* d, const uint8_t* data, size_t* size, uint8_t* buf, size_t bufSize,
+        size_t* bufPos, int hasMoreInput) {
+    const uint8_t* src = data;
+    const uint8_t* const srcEnd = data + *size;
+    const size_t startPos = *bufPos;
+    const size_t mask = bufSize - 1;
+    size_t pos = startPos;
+    uint32_t bitBuf = d->bit_buf;
+    unsigned bitCount = d->bit_count;
+    unsigned state = d->state;
+    int result = INFLATE_NEEDS_MORE_INPUT;
+
+    // Bits above bitCount in bitBuf are either zero or equal to the corresponding bits of the
+    // input data that hasn't been consumed yet, so it's safe to OR new data into the buffer
+    auto refill = [&]() {
+        while (bitCount <= 24 && src < srcEnd) {
+            bitBuf |= (uint32_t)*src++ << bitCount;
+            bitCount += 8;
+        }
+    };
+    auto refillFast = [&]() {
+        if (bitCount < 24) {
+            bitBuf |= loadLe32(src) << bitCount;
+            src += (31 - bitCount) >> 3;
+            bitCount |= 24;
+        }
+    };
+    auto drop = [&](unsigned n) {
+        bitBuf >>= n;
+        bitCount -= n;
+    };
+    auto bits = [&](unsigned n) -> unsigned {
+        return bitBuf & ((1u << n) - 1);
+    };
+    auto blockEnd = [&]() -> unsigned {
+        return d->last_block ? STATE_DONE : STATE_HEADER;
+    };
+    auto validDist = [&](unsigned dist) {
+        return dist <= bufSize && dist <= d->total_out + (pos - startPos);
+    };
+
+#define NEED_BITS(_n) \
+        do { \
+            refill(); \
+            if (bitCount < (_n)) { \
+                goto needInput; \
+            } \
+        } while (false)
+
+#define FAIL() \
+        do { \
+            result = SYSTEM_ERROR_BAD_DATA; \
+            goto exit; \
+        } while (false)
+
+    for (;;) {
+        switch (state) {
+        case STATE_HEADER: {
+            NEED_BITS(3);
+            d->last_block = bits(1);
+            const unsigned type = (bitBuf >> 1) & 0x03;
+            drop(3);
+            if (type == 0) {
+                drop(bitCount & 7);
+                state = STATE_STORED_LEN;
+            } else if (type == 1) {
+                if (!d->fixed_tables && buildFixedTables(d) < 0) {
+                    FAIL();
+                }
+                state = STATE_LITLEN;
+            } else if (type == 2) {
+                state = STATE_TABLE_COUNTS;
+            } else {
+                FAIL();
+            }
+            break;
+        }
+        case STATE_STORED_LEN: {
+            NEED_BITS(32);
+            const unsigned len = bitBuf & 0xffff;
+            if (len != (~bitBuf >> 16)) {
+                FAIL();
+            }
+            bitBuf = 0;
+            bitCount = 0;
+            d->length = len;
+            state = STATE_STORED_COPY;
+            break;
+        }
+        case STATE_STORED_COPY: {
+            while (d->length > 0) {
+                if (pos == bufSize) {
+                    goto outputFull;
+                }
+                if (src == srcEnd) {
+                    goto needInput;
+                }
+                const size_t n = std::min<size_t>(std::min<size_t>(d->length, srcEnd - src), bufSize - pos);
+                memcpy(buf + pos, src, n);
+                src += n;
+                pos += n;
+                d->length -= n;
+            }
+            state = blockEnd();
+            break;
+        }
+        case STATE_TABLE_COUNTS: {
+            NEED_BITS(14);
+            d->lit_count = bits(5) + 257;
+            d->dist_count = ((bitBuf >> 5) & 0x1f) + 1;
+            d->clen_count = ((bitBuf >> 10) & 0x0f) + 4;
+            drop(14);
+            if (d->lit_count > 286 || d->dist_count > 30) {
+                FAIL();
+            }
+            d->have = 0;
+            state = STATE_CLEN_LENS;
+            break;
+        }
+        case STATE_CLEN_LENS: {
+            while (d->have < d->clen_count) {
+                NEED_BITS(3);
+                d->lens[CLEN_ORDER[d->have++]] = bits(3);
+                drop(3);
+            }
+            for (unsigned i = d->have; i < CLEN_CODE_COUNT; ++i) {
+                d->lens[CLEN_ORDER[i]] = 0;
+            }
+            // The code length code is stored in the distance table until the actual tables are built
+            d->fixed_tables = false;
+            if (buildTable(TABLE_CLEN, d->lens, CLEN_CODE_COUNT, d->dist_table, INFLATE_FAST_DIST_TABLE_SIZE,
+                    CLEN_ROOT_BITS) < 0) {
+                FAIL();
+            }
+            d->have = 0;
+            state = STATE_CODE_LENS;
+            break;
+        }
+        case STATE_CODE_LENS: {
+            const unsigned total = d->lit_count + d->dist_count;
+            while (d->have < total) {
+                refill();
+                unsigned n = 0;
+                const auto e = lookup(d->dist_table, CLEN_ROOT_BITS, bitBuf, &n);
+                if (n > bitCount) {
+                    goto needInput;
+                }
+                if (entryOp(e) != OP_LITERAL) {
+                    FAIL();
+                }
+                const unsigned sym = entryValue(e);
+                if (sym < 16) {
+                    drop(n);
+                    d->lens[d->have++] = sym;
+                    continue;
+                }
+                const unsigned extra = (sym == 16) ? 2 : (sym == 17) ? 3 : 7;
+                if (n + extra > bitCount) {
+                    goto needInput;
+                }
+                drop(n);
+                unsigned rep = bits(extra);
+                drop(extra);
+                uint8_t len = 0;
+                if (sym == 16) {
+                    if (!d->have) {
+                        FAIL();
+                    }
+                    len = d->lens[d->have - 1];
+                    rep += 3;
+                } else if (sym == 17) {
+                    rep += 3;
+                } else {
+                    rep += 11;
+                }
+                if (d->have + rep > total) {
+                    FAIL();
+                }
+                memset(d->lens + d->have, len, rep);
+                d->have += rep;
+            }
+            if (!d->lens[256]) {
+                FAIL(); // No end-of-block code
+            }
+            if (buildTable(TABLE_LITLEN, d->lens, d->lit_count, d->litlen_table, INFLATE_FAST_LITLEN_TABLE_SIZE,
+                    INFLATE_FAST_LITLEN_ROOT_BITS) < 0 ||
+                    buildTable(TABLE_DIST, d->lens + d->lit_count, d->dist_count, d->dist_table,
+                    INFLATE_FAST_DIST_TABLE_SIZE, INFLATE_FAST_DIST_ROOT_BITS) < 0) {
+                FAIL();
+            }
+            state = STATE_LITLEN;
+            break;
+        }
+        case STATE_LITLEN: {
+            // Fast path: decode whole symbols without checking for the end of the input or output
+            while ((size_t)(srcEnd - src) >= FAST_MIN_INPUT && bufSize - pos >= MAX_MATCH_LEN) {
+                refillFast();
+                unsigned n = 0;
+                auto e = lookup(d->litlen_table, INFLATE_FAST_LITLEN_ROOT_BITS, bitBuf, &n);
+                drop(n);
+                unsigned op = entryOp(e);
+                if (op == OP_LITERAL) {
+                    buf[pos++] = entryValue(e);
+                    continue;
+                }
+                if (op == OP_END) {
+                    state = blockEnd();
+                    break;
+                }
+                if (!(op & OP_BASE)) {
+                    FAIL();
+                }
+                unsigned len = entryValue(e) + bits(op & 0x0f);
+                drop(op & 0x0f);
+                refillFast();
+                e = lookup(d->dist_table, INFLATE_FAST_DIST_ROOT_BITS, bitBuf, &n);
+                drop(n);
+                op = entryOp(e);
+                if (!(op & OP_BASE)) {
+                    FAIL();
+                }
+                if (bitCount < (op & 0x0f)) {
+                    refillFast();
+                }
+                const unsigned dist = entryValue(e) + bits(op & 0x0f);
+                drop(op & 0x0f);
+                if (!validDist(dist)) {
+                    FAIL();
+                }
+                const size_t srcPos = (pos - dist) & mask;
+                if (srcPos + len <= bufSize) {
+                    copyMatch(buf + pos, buf + srcPos, len);
+                } else {
+                    // The source wraps around the end of the buffer
+                    const size_t n1 = bufSize - srcPos;
+                    copyMatch(buf + pos, buf + srcPos, n1);
+                    copyMatch(buf + pos + n1, buf, len - n1);
+                }
+                pos += len;
+            }
+            if (state != STATE_LITLEN) {
+                break;
+            }
+            // Slow path
+            refill();
+            unsigned n = 0;
+            const auto e = lookup(d->litlen_table, INFLATE_FAST_LITLEN_ROOT_BITS, bitBuf, &n);
+            if (n > bitCount) {
+                goto needInput;
+            }
+            const unsigned op = entryOp(e);
+            if (op == OP_LITERAL) {
+                if (pos == bufSize) {
+                    goto outputFull;
+                }
+                drop(n);
+                buf[pos++] = entryValue(e);
+            } else if (op == OP_END) {
+                drop(n);
+                state = blockEnd();
+            } else if (op & OP_BASE) {
+                drop(n);
+                d->length = entryValue(e);
+                d->extra = op & 0x0f;
+                state = STATE_LEN_EXTRA;
+            } else {
+                FAIL();
+            }
+            break;
+        }
+        case STATE_LEN_EXTRA: {
+            NEED_BITS(d->extra);
+            d->length += bits(d->extra);
+            drop(d->extra);
+            state = STATE_DIST;
+            break;
+        }
+        case STATE_DIST: {
+            refill();
+            unsigned n = 0;
+            const auto e = lookup(d->dist_table, INFLATE_FAST_DIST_ROOT_BITS, bitBuf, &n);
+            if (n > bitCount) {
+                goto needInput;
+            }
+            const unsigned op = entryOp(e);
+            if (!(op & OP_BASE)) {
+                FAIL();
+            }
+            drop(n);
+            d->dist = entryValue(e);
+            d->extra = op & 0x0f;
+            state = STATE_DIST_EXTRA;
+            break;
+        }
+        case STATE_DIST_EXTRA: {
+            NEED_BITS(d->extra);
+            d->dist += bits(d->extra);
+            drop(d->extra);
+            if (!validDist(d->dist)) {
+                FAIL();
+            }
+            state = STATE_COPY;
+            break;
+        }
+        case STATE_COPY: {
+            while (d->length > 0) {
+                if (pos == bufSize) {
+                    goto outputFull;
+                }
+                const size_t srcPos = (pos - d->dist) & mask;
+                const size_t n = std::min<size_t>(std::min<size_t>(d->length, bufSize - pos), bufSize - srcPos);
+                copyMatch(buf + pos, buf + srcPos, n);
+                pos += n;
+                d->length -= n;
+            }
+            state = STATE_LITLEN;
+            break;
+        }
+        case STATE_DONE: {
+            // Return the whole bytes that were read past the end of the stream
+            const size_t unused = std::min<size_t>(bitCount >> 3, src - data);
+            src -= unused;
+            bitCount -= unused << 3;
+            result = INFLATE_DONE;
+            goto exit;
+        }
+        default:
+            result = SYSTEM_ERROR_INTERNAL;
+            goto exit;
+        }
+    }
+
+#undef FAIL
+#undef NEED_BITS
+
+needInput:
+    result = hasMoreInput ? (int)INFLATE_NEEDS_MORE_INPUT : (int)SYSTEM_ERROR_BAD_DATA;
+    goto exit;
+outputFull:
+    result = INFLATE_HAS_MORE_OUTPUT;
+exit:
+    d->bit_buf = bitCount ? (bitBuf & (0xffffffffu >> (32 - bitCount))) : 0;
+    d->bit_count = bitCount;
+    d->state = state;
+    d->total_out = std::min(d->total_out + (pos - startPos), bufSize);
+    *size = src - data;
+    *bufPos = pos;
+    return result;
+}
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA && HAL_PLATFORM_INFLATE_FAST
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of bits resolved by the first-level lookup tables
+#define INFLATE_FAST_LITLEN_ROOT_BITS 9
+#define INFLATE_FAST_DIST_ROOT_BITS 6
+
+// Maximum sizes of the lookup tables, including the second-level tables, for the above numbers
+// of root bits and codes of up to 15 bits (see ENOUGH_LENS and ENOUGH_DISTS in zlib's inftrees.h)
+#define INFLATE_FAST_LITLEN_TABLE_SIZE 852
+#define INFLATE_FAST_DIST_TABLE_SIZE 592
+
+// Maximum number of literal/length and distance codes in a dynamic block
+#define INFLATE_FAST_MAX_CODES (286 + 30)
+
+/**
+ * Raw Deflate decoder using multi-level Huffman lookup tables.
+ */
+typedef struct inflate_fast_decoder {
+    uint32_t litlen_table[INFLATE_FAST_LITLEN_TABLE_SIZE];
+    uint32_t dist_table[INFLATE_FAST_DIST_TABLE_SIZE]; // Also used for the code length code
+    uint8_t lens[INFLATE_FAST_MAX_CODES]; // Code lengths of the current dynamic block
+    uint32_t bit_buf;
+    unsigned bit_count;
+    unsigned state;
+    unsigned length; // Match length or number of bytes remaining in a stored block
+    unsigned dist; // Match distance
+    unsigned extra; // Number of extra bits of the current length or distance
+    unsigned lit_count; // Number of literal/length codes in a dynamic block
+    unsigned dist_count; // Number of distance codes in a dynamic block
+    unsigned clen_count; // Number of code length codes in a dynamic block
+    unsigned have; // Number of code lengths read so far
+    size_t total_out; // Number of bytes decoded so far, saturated at the window size
+    uint8_t last_block;
+    uint8_t fixed_tables; // Whether the lookup tables contain the fixed codes
+} inflate_fast_decoder;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void inflate_fast_reset(inflate_fast_decoder* d);
+
+/**
+ * Decode compressed data.
+ *
+ * The decoded data is written to a circular buffer of `buf_size` bytes, which also serves as the
+ * sliding window. The data is written starting at `*buf_pos` up to the end of the buffer.
+ *
+ * @param d Decoder instance.
+ * @param data Compressed data.
+ * @param[in,out] size Size of the compressed data. On return, number of bytes consumed.
+ * @param buf Buffer.
+ * @param buf_size Buffer size. Must be a power of two.
+ * @param[in,out] buf_pos Buffer offset. On return, offset of the end of the decoded data.
+ * @param has_more_input Whether more compressed data may follow.
+ * @return `INFLATE_DONE` if the end of the compressed stream has been reached,
+ *         `INFLATE_NEEDS_MORE_INPUT` if all input has been consumed,
+ *         `INFLATE_HAS_MORE_OUTPUT` if the end of the buffer has been reached,
+ *         or an error code defined by `system_error_t`.
+ */
+int inflate_fast_decode(inflate_fast_decoder* d, const uint8_t* data, size_t* size, uint8_t* buf, size_t buf_size,
+        size_t* buf_pos, int has_more_input);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -23,12 +23,23 @@
 #include "miniz_tinfl.h"
 #include "hal_platform.h"
 
+#if HAL_PLATFORM_INFLATE_FAST
+#include "inflate_fast.h"
+#endif // HAL_PLATFORM_INFLATE_FAST
+
 #if HAL_PLATFORM_INFLATE_USE_FILESYSTEM
 #include "filesystem.h"
 #endif // HAL_PLATFORM_INFLATE_USE_FILESYSTEM
 
 struct inflate_ctx {
+#if HAL_PLATFORM_INFLATE_FAST
+    union {
+        tinfl_decompressor decomp; // Used if the buffer is not in RAM
+        inflate_fast_decoder fast;
+    };
+#else
     tinfl_decompressor decomp;
+#endif // HAL_PLATFORM_INFLATE_FAST
     char* buf;
     size_t buf_size;
     size_t buf_offs;
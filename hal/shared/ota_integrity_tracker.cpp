@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ota_integrity_tracker.h"
+
+#include "system_error.h"
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+namespace particle {
+
+OtaIntegrityTracker::OtaIntegrityTracker(ModuleInfoOffsetFn infoOffsetFn, Crc32Fn crc32Fn) :
+        modules_(),
+        info_(),
+        header_(),
+        crcData_(),
+        infoOffsetFn_(infoOffsetFn),
+        crc32Fn_(crc32Fn) {
+    reset();
+}
+
+void OtaIntegrityTracker::reset() {
+    pos_ = 0;
+    moduleCount_ = 0;
+    sequential_ = true;
+    startModule();
+}
+
+void OtaIntegrityTracker::update(const uint8_t* data, size_t size, size_t offset) {
+    if (!sequential_ || offset != pos_) {
+        if (offset < pos_) {
+            // The data for which the checksums have been computed is being overwritten
+            moduleCount_ = 0;
+        }
+        sequential_ = false;
+        return;
+    }
+    while (size > 0) {
+        if (state_ == State::DONE) {
+            pos_ += size;
+            break;
+        }
+        const size_t n = std::min(size, nextBoundary() - pos_);
+        const size_t moduleOffs = pos_ - moduleStart_;
+        switch (state_) {
+        case State::HEADER: {
+            memcpy(header_ + moduleOffs, data, n);
+            break;
+        }
+        case State::INFO: {
+            if (moduleOffs + n > infoOffset_) {
+                const size_t skip = (moduleOffs < infoOffset_) ? infoOffset_ - moduleOffs : 0;
+                memcpy((uint8_t*)&info_ + moduleOffs + skip - infoOffset_, data + skip, n - skip);
+            }
+            break;
+        }
+        case State::CRC: {
+            memcpy(crcData_ + moduleOffs - moduleLength_, data, n);
+            break;
+        }
+        default:
+            break;
+        }
+        if (state_ != State::CRC) {
+            crc_ = crc32Fn_(data, n, &crc_);
+        }
+        data += n;
+        size -= n;
+        pos_ += n;
+        while (state_ != State::DONE && pos_ == nextBoundary()) {
+            processBoundary();
+        }
+    }
+}
+
+int OtaIntegrityTracker::moduleStatus(size_t offset, size_t length) const {
+    for (unsigned i = 0; i < moduleCount_; ++i) {
+        const auto& m = modules_[i];
+        if (m.offset == offset && m.length == length) {
+            return m.valid ? 1 : 0;
+        }
+    }
+    return SYSTEM_ERROR_NOT_FOUND;
+}
+
+int OtaIntegrityTracker::updateFromFlash(const uint8_t* data, size_t size, size_t offset, uintptr_t address,
+        FlashReadFn readFn) {
+    uint8_t buf[128];
+    size_t pos = 0;
+    while (pos < size) {
+        const size_t n = std::min(size - pos, sizeof(buf));
+        int r = readFn(address + pos, buf, n);
+        if (r == 0 && memcmp(buf, data + pos, n) != 0) {
+            r = SYSTEM_ERROR_BAD_DATA;
+        }
+        if (r != 0) {
+            // Forget the results computed so far
+            moduleCount_ = 0;
+            sequential_ = false;
+            return (r < 0) ? r : SYSTEM_ERROR_FLASH_IO;
+        }
+        update(buf, n, offset + pos);
+        pos += n;
+    }
+    return 0;
+}
+
+size_t OtaIntegrityTracker::nextBoundary() const {
+    switch (state_) {
+    case State::HEADER:
+        return moduleStart_ + HEADER_SIZE;
+    case State::INFO:
+        return moduleStart_ + infoOffset_ + sizeof(module_info_t);
+    case State::DATA:
+        return moduleStart_ + moduleLength_;
+    case State::CRC:
+        return moduleStart_ + moduleLength_ + sizeof(crcData_);
+    default:
+        return std::numeric_limits<size_t>::max();
+    }
+}
+
+void OtaIntegrityTracker::processBoundary() {
+    switch (state_) {
+    case State::HEADER: {
+        infoOffset_ = infoOffsetFn_ ? infoOffsetFn_(header_) : 0;
+        if (infoOffset_ < HEADER_SIZE) {
+            // The beginning of the module info has already been received
+            memcpy(&info_, header_ + infoOffset_, HEADER_SIZE - infoOffset_);
+        }
+        state_ = State::INFO;
+        break;
+    }
+    case State::INFO: {
+        moduleLength_ = (uintptr_t)info_.module_end_address - (uintptr_t)info_.module_start_address;
+        if (moduleLength_ < infoOffset_ + sizeof(module_info_t)) {
+            // Not a valid module. Leave it to the regular validation to report an error
+            state_ = State::DONE;
+            break;
+        }
+        state_ = State::DATA;
+        break;
+    }
+    case State::DATA: {
+        state_ = State::CRC;
+        break;
+    }
+    case State::CRC: {
+        // The CRC-32 is stored in big-endian format
+        const uint32_t expectedCrc = ((uint32_t)crcData_[0] << 24) | ((uint32_t)crcData_[1] << 16) |
+                ((uint32_t)crcData_[2] << 8) | (uint32_t)crcData_[3];
+        if (moduleCount_ < MAX_MODULES) {
+            auto& m = modules_[moduleCount_++];
+            m.offset = moduleStart_;
+            m.length = moduleLength_;
+            m.valid = (crc_ == expectedCrc);
+        }
+        if (info_.flags & MODULE_INFO_FLAG_COMBINED) {
+            startModule();
+        } else {
+            state_ = State::DONE;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void OtaIntegrityTracker::startModule() {
+    moduleStart_ = pos_;
+    moduleLength_ = 0;
+    infoOffset_ = 0;
+    crc_ = 0;
+    info_ = module_info_t();
+    state_ = State::HEADER;
+}
+
+} // namespace particle
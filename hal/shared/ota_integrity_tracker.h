@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "module_info.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+/**
+ * Computes the CRC-32 checksums of the modules contained in an OTA update while the update data
+ * is being received.
+ *
+ * The data is expected to be received sequentially. If a chunk arrives out of order, the tracker
+ * stops computing the checksums and the integrity of the remaining modules has to be checked by
+ * reading them back from flash.
+ */
+class OtaIntegrityTracker {
+public:
+    /**
+     * Number of bytes at the beginning of a module that are needed to determine the offset of
+     * its module info.
+     */
+    static constexpr size_t HEADER_SIZE = 8;
+
+    /**
+     * Maximum number of combined modules that can be tracked.
+     */
+    static constexpr unsigned MAX_MODULES = 4;
+
+    /**
+     * Returns the offset of the module info given the first `HEADER_SIZE` bytes of a module.
+     */
+    typedef size_t (*ModuleInfoOffsetFn)(const uint8_t* header);
+
+    /**
+     * CRC-32 function with the same signature as `Compute_CRC32()`.
+     */
+    typedef uint32_t (*Crc32Fn)(const uint8_t* data, uint32_t size, const uint32_t* crc);
+
+    /**
+     * Flash read function with the same signature as `HAL_OTA_Flash_Read()`.
+     */
+    typedef int (*FlashReadFn)(uintptr_t address, uint8_t* data, size_t size);
+
+    OtaIntegrityTracker(ModuleInfoOffsetFn infoOffsetFn, Crc32Fn crc32Fn);
+
+    /**
+     * Start tracking a new update.
+     */
+    void reset();
+
+    /**
+     * Process a chunk of the update data.
+     *
+     * @param data Chunk data.
+     * @param size Chunk size.
+     * @param offset Offset of the chunk in the update data.
+     */
+    void update(const uint8_t* data, size_t size, size_t offset);
+
+    /**
+     * Read back a chunk of the update data that has been written to flash, make sure it matches
+     * the source data and process it.
+     *
+     * The checksums are computed over the data read from flash so that a module is only reported
+     * as valid if its contents in flash are valid.
+     *
+     * @param data Source data.
+     * @param size Chunk size.
+     * @param offset Offset of the chunk in the update data.
+     * @param address Address of the chunk in flash.
+     * @param readFn Flash read function.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int updateFromFlash(const uint8_t* data, size_t size, size_t offset, uintptr_t address, FlashReadFn readFn);
+
+    /**
+     * Get the result of the integrity check of a module.
+     *
+     * @param offset Offset of the module in the update data.
+     * @param length Module length, not including the CRC-32.
+     * @return 1 if the checksum of the module is valid, 0 if it's invalid, or `SYSTEM_ERROR_NOT_FOUND`
+     *         if the module data hasn't been fully received sequentially.
+     */
+    int moduleStatus(size_t offset, size_t length) const;
+
+    /**
+     * Check if all data received so far has been received sequentially.
+     */
+    bool isSequential() const;
+
+private:
+    enum class State {
+        HEADER, // Receiving the module header
+        INFO, // Receiving the module info
+        DATA, // Receiving the rest of the module data
+        CRC, // Receiving the CRC-32
+        DONE // No more modules expected
+    };
+
+    struct Module {
+        uint32_t offset;
+        uint32_t length;
+        bool valid;
+    };
+
+    Module modules_[MAX_MODULES];
+    module_info_t info_;
+    uint8_t header_[HEADER_SIZE];
+    uint8_t crcData_[4];
+    ModuleInfoOffsetFn infoOffsetFn_;
+    Crc32Fn crc32Fn_;
+    size_t pos_; // Total number of bytes processed
+    size_t moduleStart_; // Offset of the current module
+    size_t moduleLength_; // Length of the current module
+    size_t infoOffset_; // Offset of the module info in the current module
+    uint32_t crc_; // CRC-32 of the current module
+    unsigned moduleCount_;
+    State state_;
+    bool sequential_;
+
+    size_t nextBoundary() const;
+    void processBoundary();
+    void startModule();
+};
+
+inline bool OtaIntegrityTracker::isSequential() const {
+    return sequential_;
+}
+
+} // namespace particle
@@ -43,6 +43,9 @@
 
 #include "eeprom_file.h"
 #include "eeprom_hal.h"
+#if HAL_PLATFORM_FILESYSTEM
+#include "system_cache.h"
+#endif // HAL_PLATFORM_FILESYSTEM
 #include "rtc_hal.h"
 
 #include <boost/algorithm/string.hpp>
@@ -304,6 +307,12 @@ void HAL_Core_System_Reset(void)
 
 void HAL_Core_System_Reset_Ex(int reason, uint32_t data, void *reserved)
 {
+#if HAL_PLATFORM_FILESYSTEM
+    if (reason != RESET_REASON_PANIC) {
+        // Write the pending modifications of the system cache to the filesystem
+        system_cache_flush();
+    }
+#endif // HAL_PLATFORM_FILESYSTEM
     HAL_Core_System_Reset();
 }
 
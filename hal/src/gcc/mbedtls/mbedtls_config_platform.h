@@ -21,3 +21,14 @@
 
 #undef MBEDTLS_SSL_MAX_CONTENT_LEN
 #define MBEDTLS_SSL_MAX_CONTENT_LEN 1152
+
+/* Use the SHA extensions of the host CPU if available (see sha256_host.c) */
+#define MBEDTLS_SHA256_PROCESS_ALT
+
+/* AES-NI support is detected at runtime and only available on x86-64 */
+#define MBEDTLS_AESNI_C
+
+/* Ephemeral ECDH keys can be generated ahead of time (see crypto/src/ecdh_precompute.cpp).
+ * Disabled until the override has been built against mbedTLS and the handshake time has been
+ * measured */
+//#define MBEDTLS_ECDH_GEN_PUBLIC_ALT
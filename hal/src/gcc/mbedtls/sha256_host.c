@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sha256_host.h"
+
+#include "system_error.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SHA256_HOST_HAVE_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define SHA256_HOST_HAVE_SHA_NI 0
+#endif
+
+typedef void(*sha256_host_process_fn)(uint32_t state[8], const uint8_t* data, size_t block_count);
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define S0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define S1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define G0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define G1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+static void process_portable(uint32_t state[8], const uint8_t* data, size_t block_count) {
+    uint32_t w[64];
+    for (; block_count > 0; --block_count, data += 64) {
+        for (unsigned i = 0; i < 16; ++i) {
+            const uint8_t* p = data + i * 4;
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+        }
+        for (unsigned i = 16; i < 64; ++i) {
+            w[i] = G1(w[i - 2]) + w[i - 7] + G0(w[i - 15]) + w[i - 16];
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (unsigned i = 0; i < 64; ++i) {
+            const uint32_t t1 = h + S1(e) + CH(e, f, g) + K[i] + w[i];
+            const uint32_t t2 = S0(a) + MAJ(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#if SHA256_HOST_HAVE_SHA_NI
+
+__attribute__((target("sha,sse4.1")))
+static void process_sha_ni(uint32_t state[8], const uint8_t* data, size_t block_count) {
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    // The SHA instructions expect the state as ABEF and CDGH
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xb1); // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1b); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0); // CDGH
+    for (; block_count > 0; --block_count, data += 64) {
+        const __m128i abef = state0;
+        const __m128i cdgh = state1;
+        __m128i msg[4];
+        for (unsigned i = 0; i < 16; ++i) {
+            __m128i m;
+            if (i < 4) {
+                m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), bswap);
+            } else {
+                // W[t] = G1(W[t-2]) + W[t-7] + G0(W[t-15]) + W[t-16]
+                m = _mm_sha256msg1_epu32(msg[i % 4], msg[(i + 1) % 4]);
+                m = _mm_add_epi32(m, _mm_alignr_epi8(msg[(i + 3) % 4], msg[(i + 2) % 4], 4));
+                m = _mm_sha256msg2_epu32(m, msg[(i + 3) % 4]);
+            }
+            msg[i % 4] = m;
+            m = _mm_add_epi32(m, _mm_loadu_si128((const __m128i*)&K[i * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(m, 0x0e));
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+    tmp = _mm_shuffle_epi32(state0, 0x1b); // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xb1); // DCHG
+    _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(tmp, state1, 0xf0)); // DCBA
+    _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(state1, tmp, 8)); // HGFE
+}
+
+static int has_sha_ni(void) {
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) {
+        return 0;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_SHA)) {
+        return 0;
+    }
+    return 1;
+}
+
+#endif // SHA256_HOST_HAVE_SHA_NI
+
+static sha256_host_impl g_impl = SHA256_HOST_IMPL_AUTO;
+static sha256_host_process_fn g_process = NULL;
+
+int sha256_host_select_impl(sha256_host_impl impl) {
+    if (impl == SHA256_HOST_IMPL_AUTO) {
+#if SHA256_HOST_HAVE_SHA_NI
+        impl = has_sha_ni() ? SHA256_HOST_IMPL_SHA_NI : SHA256_HOST_IMPL_PORTABLE;
+#else
+        impl = SHA256_HOST_IMPL_PORTABLE;
+#endif
+    }
+    switch (impl) {
+    case SHA256_HOST_IMPL_PORTABLE:
+        g_process = process_portable;
+        break;
+#if SHA256_HOST_HAVE_SHA_NI
+    case SHA256_HOST_IMPL_SHA_NI:
+        if (!has_sha_ni()) {
+            return SYSTEM_ERROR_NOT_SUPPORTED;
+        }
+        g_process = process_sha_ni;
+        break;
+#endif
+    default:
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    g_impl = impl;
+    return 0;
+}
+
+sha256_host_impl sha256_host_get_impl(void) {
+    if (!g_process) {
+        sha256_host_select_impl(SHA256_HOST_IMPL_AUTO);
+    }
+    return g_impl;
+}
+
+void sha256_host_process(uint32_t state[8], const uint8_t* data, size_t block_count) {
+    if (!g_process) {
+        sha256_host_select_impl(SHA256_HOST_IMPL_AUTO);
+    }
+    g_process(state, data, block_count);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * SHA-256 block function implementations.
+ */
+typedef enum sha256_host_impl {
+    SHA256_HOST_IMPL_AUTO = 0, ///< Best implementation supported by the CPU.
+    SHA256_HOST_IMPL_PORTABLE = 1, ///< Portable C implementation.
+    SHA256_HOST_IMPL_SHA_NI = 2 ///< x86 SHA extensions.
+} sha256_host_impl;
+
+/**
+ * Process a number of consecutive 64-byte blocks.
+ *
+ * The implementation is selected on the first call based on the features supported by the CPU.
+ *
+ * @param state Hash state.
+ * @param data Block data.
+ * @param block_count Number of blocks.
+ */
+void sha256_host_process(uint32_t state[8], const uint8_t* data, size_t block_count);
+
+/**
+ * Select the block function implementation.
+ *
+ * This function is intended for testing and benchmarking.
+ *
+ * @param impl Implementation.
+ * @return 0 on success, or `SYSTEM_ERROR_NOT_SUPPORTED` if the implementation is not supported
+ *         by the CPU.
+ */
+int sha256_host_select_impl(sha256_host_impl impl);
+
+/**
+ * Get the selected block function implementation.
+ */
+sha256_host_impl sha256_host_get_impl(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -56,6 +56,9 @@
 #include "flash_common.h"
 #include <nrf_pwm.h>
 #include "concurrent_hal.h"
+#if HAL_PLATFORM_FILESYSTEM
+#include "system_cache.h"
+#endif // HAL_PLATFORM_FILESYSTEM
 #include "user_hal.h"
 #include "nrfx_wdt.h"
 
@@ -504,6 +507,14 @@ void HAL_Core_System_Reset(void) {
 }
 
 void HAL_Core_System_Reset_Ex(int reason, uint32_t data, void *reserved) {
+#if HAL_PLATFORM_FILESYSTEM
+    // Write the pending modifications of the system cache to the filesystem. This can't be done
+    // in an ISR or after a panic, as it requires acquiring the filesystem lock
+    if (reason != RESET_REASON_PANIC && !hal_interrupt_is_isr() &&
+            os_scheduler_get_state(NULL) == OS_SCHEDULER_STATE_RUNNING) {
+        system_cache_flush();
+    }
+#endif // HAL_PLATFORM_FILESYSTEM
     if (HAL_Feature_Get(FEATURE_RESET_INFO)) {
         // Save reset info to backup registers
         HAL_Core_Write_Backup_Register(BKP_DR_02, reason);
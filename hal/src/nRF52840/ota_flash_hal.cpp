@@ -49,7 +49,9 @@ LOG_SOURCE_CATEGORY("hal.ota")
 #include <memory>
 #include "platform_radio_stack.h"
 #include "check.h"
+#include "scope_guard.h"
 #include "security_mode.h"
+#include "ota_integrity_tracker.h"
 
 extern volatile uint8_t SPARK_FLASH_UPDATE;
 
@@ -67,6 +69,16 @@ namespace {
 
 const uint16_t BOOTLOADER_MBR_UPDATE_MIN_VERSION = 1001; // 2.0.0-rc.1
 
+size_t moduleInfoOffset(const uint8_t* header) {
+    // See FLASH_ModuleInfo()
+    uint32_t sp = 0;
+    memcpy(&sp, header, sizeof(sp));
+    return ((sp & APP_START_MASK) == 0x20000000) ? 0x200 : 0;
+}
+
+// Checksums of the modules computed while the update data is being received
+OtaIntegrityTracker g_otaIntegrity(moduleInfoOffset, Compute_CRC32);
+
 } // anonymous
 
 static int flash_bootloader(const hal_module_t* mod, uint32_t moduleLength);
@@ -380,12 +392,30 @@ bool HAL_FLASH_Begin(uint32_t address, uint32_t length, void* reserved)
     if (r != FLASH_ACCESS_RESULT_OK) {
         return false;
     }
+    g_otaIntegrity.reset();
     return true;
 }
 
 int HAL_FLASH_Update(const uint8_t *pBuffer, uint32_t address, uint32_t length, void* reserved)
 {
-    return FLASH_Update(pBuffer, address, length);
+    int r = FLASH_Update(pBuffer, address, length);
+    if (r == FLASH_ACCESS_RESULT_OK && address >= module_ota.start_address) {
+        // Verify the written data and compute the checksums over the contents of the flash
+        if (g_otaIntegrity.updateFromFlash(pBuffer, length, address - module_ota.start_address, address,
+                HAL_OTA_Flash_Read) < 0) {
+            r = FLASH_ACCESS_RESULT_ERROR;
+        }
+    }
+    return r;
+}
+
+int check_received_module_crc32(const module_bounds_t* bounds, const module_info_t* info)
+{
+    if (bounds->location != module_ota.location || bounds->start_address < module_ota.start_address ||
+            bounds->start_address >= module_ota.end_address) {
+        return SYSTEM_ERROR_NOT_FOUND;
+    }
+    return g_otaIntegrity.moduleStatus(bounds->start_address - module_ota.start_address, module_length(info));
 }
 
 int HAL_OTA_Flash_Read(uintptr_t address, uint8_t* buffer, size_t size)
@@ -596,6 +626,10 @@ int HAL_FLASH_OTA_Validate(bool userDepsOptional, module_validation_flags_t flag
 
 int HAL_FLASH_End(void* reserved)
 {
+    SCOPE_GUARD({
+        // The OTA region may be modified by other means once the update is applied
+        g_otaIntegrity.reset();
+    });
     hal_module_t modules[MAX_COMBINED_MODULE_COUNT] = {};
     size_t moduleCount = CHECK(fetchModules(modules, MAX_COMBINED_MODULE_COUNT, true /* userDepsOptional */,
             MODULE_VALIDATION_INTEGRITY | MODULE_VALIDATION_DEPENDENCIES_FULL));
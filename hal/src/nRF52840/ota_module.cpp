@@ -61,6 +61,10 @@ int get_module_crc_suffix(const module_bounds_t* bounds, const module_info_t* in
 }
 
 bool verify_crc32(const module_bounds_t* bounds, const module_info_t* info) {
+    const int r = check_received_module_crc32(bounds, info);
+    if (r >= 0) {
+        return r == 1;
+    }
     if (bounds->location == MODULE_BOUNDS_LOC_INTERNAL_FLASH) {
         return FLASH_VerifyCRC32(FLASH_INTERNAL, bounds->start_address, module_length(info));
     } else if (bounds->location == MODULE_BOUNDS_LOC_EXTERNAL_FLASH) {
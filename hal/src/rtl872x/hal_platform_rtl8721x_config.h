@@ -61,6 +61,8 @@
 
 #define HAL_PLATFORM_USB_CONTROL_INTERFACE (1)
 
+#define HAL_PLATFORM_USB_CONTROL_RING_BUFFER_SIZE (16 * 1024)
+
 #define HAL_PLATFORM_RNG (1)
 
 #define HAL_PLATFORM_SPI_DMA_SOURCE_RAM_ONLY (1)
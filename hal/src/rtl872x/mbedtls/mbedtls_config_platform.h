@@ -273,6 +273,11 @@
 //#define MBEDTLS_SHA1_PROCESS_ALT
 //#define MBEDTLS_SHA256_PROCESS_ALT
 //#define MBEDTLS_SHA512_PROCESS_ALT
+
+/* Ephemeral ECDH keys can be generated ahead of time (see crypto/src/ecdh_precompute.cpp).
+ * Disabled until the override has been built against mbedTLS and the handshake time has been
+ * measured */
+//#define MBEDTLS_ECDH_GEN_PUBLIC_ALT
 //#define MBEDTLS_DES_SETKEY_ALT
 //#define MBEDTLS_DES_CRYPT_ECB_ALT
 //#define MBEDTLS_DES3_CRYPT_ECB_ALT
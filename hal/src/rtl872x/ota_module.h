@@ -35,6 +35,15 @@ const module_bounds_t* find_module_bounds(uint8_t module_function, uint8_t modul
 bool fetch_module(hal_module_t* target, const module_bounds_t* bounds, bool userDepsOptional, uint16_t check_flags);
 int locate_module(const module_bounds_t* bounds, module_info_t* infoOut);
 
+/**
+ * Checks the integrity of a module stored in the OTA region using the CRC-32 that was computed
+ * while the module was being received. The checksum is computed over the data read back from
+ * flash after each chunk is written.
+ * @return 1 if the CRC-32 is valid, 0 if it's invalid, or SYSTEM_ERROR_NOT_FOUND if the module
+ *         wasn't received sequentially and needs to be read back from flash.
+ */
+int check_received_module_crc32(const module_bounds_t* bounds, const module_info_t* info);
+
 inline uint8_t module_mcu_target(const module_info_t* info) {
 	return info->reserved;
 }
@@ -49,6 +49,10 @@
 #define DIAG_NAME_ALT_NETWORK_SIGNAL_QUALITY "net:alt:sigqual"
 #define DIAG_NAME_ALT_NETWORK_SIGNAL_QUALITY_VALUE "net:alt:sigqualv"
 #define DIAG_NAME_ALT_NETWORK_ACCESS_TECNHOLOGY "net:alt:at"
+#define DIAG_NAME_NETWORK_LINK_ROUND_TRIP "net:link:rtt"
+#define DIAG_NAME_NETWORK_LINK_LOSS "net:link:loss"
+#define DIAG_NAME_ALT_NETWORK_LINK_ROUND_TRIP "net:alt:link:rtt"
+#define DIAG_NAME_ALT_NETWORK_LINK_LOSS "net:alt:link:loss"
 #define DIAG_NAME_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_MOBILE_COUNTRY_CODE "net:cell:cgi:mcc"
 #define DIAG_NAME_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_MOBILE_NETWORK_CODE "net:cell:cgi:mnc"
 #define DIAG_NAME_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_LOCATION_AREA_CODE "net:cell:cgi:lac"
@@ -63,6 +67,12 @@
 #define DIAG_NAME_CLOUD_UNACKNOWLEDGED_MESSAGES "coap:unack"
 #define DIAG_NAME_CLOUD_TRANSMITTED_MESSAGES "coap:transmit"
 #define DIAG_NAME_CLOUD_COAP_ROUND_TRIP "coap:roundtrip"
+#define DIAG_NAME_CLOUD_COAP_ROUND_TRIP_HISTOGRAM "coap:roundtrip:hist"
+#define DIAG_NAME_CLOUD_COAP_ROUND_TRIP_SERIES "coap:roundtrip:series"
+#define DIAG_NAME_NETWORK_AT_COMMAND_LATENCY_HISTOGRAM "net:at:lat:hist"
+#define DIAG_NAME_SYSTEM_LOOP_LATENCY_HISTOGRAM "sys:loop:lat:hist"
+#define DIAG_NAME_SYSTEM_MESSAGE_POOL_MAX_USED "sys:mpool:max"
+#define DIAG_NAME_SYSTEM_MESSAGE_POOL_HEAP_ALLOCATIONS "sys:mpool:heap"
 #define DIAG_NAME_CLOUD_RATE_LIMITED_EVENTS "pub:limit"
 #define DIAG_NAME_SYSTEM_TOTAL_RAM "sys:tram"
 #define DIAG_NAME_SYSTEM_USED_RAM "sys:uram"
@@ -121,15 +131,33 @@ typedef enum diag_id {
     DIAG_ID_ALT_NETWORK_SIGNAL_QUALITY = 47, // net:alt:sigqual
     DIAG_ID_ALT_NETWORK_SIGNAL_QUALITY_VALUE = 48, // net:alt:sigqualv
     DIAG_ID_ALT_NETWORK_ACCESS_TECNHOLOGY = 49, // net:alt:at
+    DIAG_ID_NETWORK_LINK_ROUND_TRIP = 50, // net:link:rtt
+    DIAG_ID_NETWORK_LINK_LOSS = 51, // net:link:loss
+    DIAG_ID_ALT_NETWORK_LINK_ROUND_TRIP = 52, // net:alt:link:rtt
+    DIAG_ID_ALT_NETWORK_LINK_LOSS = 53, // net:alt:link:loss
+    DIAG_ID_CLOUD_COAP_ROUND_TRIP_HISTOGRAM = 54, // coap:roundtrip:hist
+    DIAG_ID_CLOUD_COAP_ROUND_TRIP_SERIES = 55, // coap:roundtrip:series
+    DIAG_ID_NETWORK_AT_COMMAND_LATENCY_HISTOGRAM = 56, // net:at:lat:hist
+    DIAG_ID_SYSTEM_LOOP_LATENCY_HISTOGRAM = 57, // sys:loop:lat:hist
+    DIAG_ID_SYSTEM_MESSAGE_POOL_MAX_USED = 58, // sys:mpool:max
+    DIAG_ID_SYSTEM_MESSAGE_POOL_HEAP_ALLOCATIONS = 59, // sys:mpool:heap
     DIAG_ID_USER = 32768 // Base value for application-specific source IDs
 } diag_id;
 
 // Data types
 typedef enum diag_type {
     DIAG_TYPE_INT = 1, // 32-bit signed integer
-    DIAG_TYPE_UINT = 2 // 32-bit unsigned integer
+    DIAG_TYPE_UINT = 2, // 32-bit unsigned integer
+    DIAG_TYPE_HISTOGRAM = 3, // Log-linear histogram (diag_histogram)
+    DIAG_TYPE_TIME_SERIES = 4 // Most recent samples of a value (diag_time_series)
 } diag_type;
 
+// Maximum number of buckets in a histogram
+#define DIAG_HISTOGRAM_MAX_BUCKETS 64
+
+// Maximum number of samples in a time series
+#define DIAG_TIME_SERIES_MAX_SAMPLES 32
+
 // Data source commands
 typedef enum diag_source_cmd {
     DIAG_SOURCE_CMD_GET = 1 // Get current data
@@ -163,6 +191,34 @@ typedef struct diag_source_get_cmd_data {
     size_t data_size; // Buffer size
 } diag_source_get_cmd_data;
 
+// Histogram data. This structure is followed by `bucket_count` 32-bit bucket counters.
+//
+// Values below 2^sub_bucket_bits are counted in individual buckets. Each following power of two
+// range of values is split into 2^sub_bucket_bits buckets of equal width. The last bucket also
+// counts all values that are greater than the range of the histogram
+typedef struct diag_histogram {
+    uint16_t size; // Size of this structure
+    uint8_t sub_bucket_bits; // Number of linear sub-buckets per power of two, log2
+    uint8_t bucket_count; // Number of buckets
+    uint32_t count; // Number of recorded values
+    uint32_t sum; // Sum of the recorded values (wraps around)
+    uint32_t min; // Minimum recorded value
+    uint32_t max; // Maximum recorded value
+} diag_histogram;
+
+// Time series sample
+typedef struct diag_time_series_sample {
+    uint32_t time; // Time of the sample in milliseconds
+    int32_t value; // Sample value
+} diag_time_series_sample;
+
+// Time series data. This structure is followed by `sample_count` samples, oldest first
+typedef struct diag_time_series {
+    uint16_t size; // Size of this structure
+    uint16_t sample_count; // Number of samples
+    uint32_t total_count; // Total number of recorded samples
+} diag_time_series;
+
 // Registers a new data source. Note that in order for the data source to be registered, the service
 // needs to be in its initial stopped state
 int diag_register_source(const diag_source* src, void* reserved);
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "spark_wiring_vector.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+/**
+ * An index of the names stored in a table.
+ *
+ * The index keeps the hashes of the names sorted so that a lookup is a binary search followed,
+ * in the common case, by a single string comparison. The table itself is not owned by the index:
+ * entries are referred to by their position in the table, and the caller provides a function
+ * that compares a name with the name of the entry at a given position.
+ */
+class NameIndex {
+public:
+    /**
+     * Construct an index.
+     *
+     * @param maxNameLen Maximum number of characters in a name. Longer names are compared by
+     *        their first `maxNameLen` characters, same as with `strncmp()`.
+     */
+    explicit NameIndex(size_t maxNameLen) :
+            maxNameLen_(maxNameLen) {
+    }
+
+    /**
+     * Add a name to the index.
+     *
+     * @param name Name.
+     * @param index Position of the entry in the table.
+     * @return `true` on success, or `false` if a memory allocation error occurred.
+     */
+    bool insert(const char* name, size_t index) {
+        const Entry e = { hash(name), (uint16_t)index };
+        const auto it = std::upper_bound(entries_.begin(), entries_.end(), e, [](const Entry& e1, const Entry& e2) {
+            return e1.hash < e2.hash;
+        });
+        return entries_.insert(it - entries_.begin(), e);
+    }
+
+    /**
+     * Find a name in the index.
+     *
+     * @param name Name.
+     * @param equals Function that takes a position in the table and returns `true` if the name
+     *        of the entry at that position matches `name`.
+     * @return Position of the entry in the table, or -1 if the name is not found.
+     */
+    template<typename EqualsFn>
+    int find(const char* name, EqualsFn&& equals) const {
+        const uint32_t h = hash(name);
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), h, [](const Entry& e, uint32_t h) {
+            return e.hash < h;
+        });
+        for (; it != entries_.end() && it->hash == h; ++it) {
+            if (equals((size_t)it->index)) {
+                return it->index;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Remove all names from the index.
+     */
+    void clear() {
+        entries_.clear();
+    }
+
+    /**
+     * Get the number of names in the index.
+     */
+    size_t size() const {
+        return entries_.size();
+    }
+
+    /**
+     * Compute the hash of a name (32-bit FNV-1a).
+     */
+    uint32_t hash(const char* name) const {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < maxNameLen_ && name[i] != '\0'; ++i) {
+            h = (h ^ (uint8_t)name[i]) * 16777619u;
+        }
+        return h;
+    }
+
+private:
+    struct Entry {
+        uint32_t hash;
+        uint16_t index;
+    };
+
+    Vector<Entry> entries_;
+    size_t maxNameLen_;
+};
+
+} // namespace particle
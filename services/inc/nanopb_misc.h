@@ -22,6 +22,7 @@
 #include "pb_encode.h"
 #include "pb_decode.h"
 #include "hal_platform.h"
+#include "appender.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,11 @@ extern "C" {
 typedef struct lfs_file lfs_file_t;
 typedef struct coap_message coap_message;
 
+typedef struct pb_appender {
+    appender_fn fn;
+    void* data;
+} pb_appender;
+
 pb_ostream_t* pb_ostream_init(void* reserved);
 bool pb_ostream_free(pb_ostream_t* stream, void* reserved);
 
@@ -48,6 +54,9 @@ int pb_istream_from_file(pb_istream_t* stream, lfs_file_t* file, int size, void*
 int pb_istream_from_coap_message(pb_istream_t* stream, coap_message* msg, void* reserved);
 int pb_ostream_from_coap_message(pb_ostream_t* stream, coap_message* msg, void* reserved);
 
+// The appender structure must remain valid for as long as the stream is in use
+int pb_ostream_from_appender(pb_ostream_t* stream, pb_appender* appender, void* reserved);
+
 #ifdef SERVICES_NO_NANOPB_LIB
 #pragma weak pb_ostream_init
 #pragma weak pb_ostream_free
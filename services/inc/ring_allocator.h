@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle { namespace services {
+
+/**
+ * Allocator handing out contiguous blocks of a fixed buffer in a circular manner.
+ *
+ * Blocks are allocated in FIFO order and can be freed in any order. The memory of a freed block
+ * is reclaimed once all blocks allocated before it have been freed as well. This makes allocations
+ * cheap and free of fragmentation as long as the blocks have a similar lifetime, e.g. when they
+ * store the data of requests that are processed in the order of their arrival.
+ *
+ * The class is not thread-safe.
+ */
+class RingAllocator {
+public:
+    RingAllocator();
+    RingAllocator(void* buf, size_t size);
+
+    /**
+     * Set the buffer to allocate the blocks from.
+     *
+     * All previously allocated blocks are discarded.
+     */
+    void init(void* buf, size_t size);
+
+    /**
+     * Allocate a block.
+     *
+     * @param size Block size.
+     * @return Pointer to the block, or `nullptr` if there's not enough contiguous space in the buffer.
+     */
+    void* alloc(size_t size);
+
+    /**
+     * Free a block.
+     */
+    void free(void* ptr);
+
+    /**
+     * Check if a block was allocated by this allocator.
+     */
+    bool owns(const void* ptr) const;
+
+    /**
+     * Discard all allocated blocks.
+     */
+    void reset();
+
+    /**
+     * Get the number of allocated blocks, including the blocks that are freed but not yet reclaimed.
+     */
+    size_t count() const;
+
+    /**
+     * Get the buffer size.
+     */
+    size_t size() const;
+
+private:
+    typedef uint32_t Header;
+
+    static const Header FREE_FLAG = 0x80000000;
+    static const Header WRAP_MARKER = 0xffffffff; // Marks the unused space at the end of the buffer
+
+    char* buf_;
+    size_t size_;
+    size_t head_; // Offset of the next block
+    size_t tail_; // Offset of the oldest block
+    size_t count_;
+
+    Header& header(size_t offs);
+    void reclaim();
+
+    static size_t blockSize(size_t size);
+};
+
+inline RingAllocator::RingAllocator() :
+        RingAllocator(nullptr, 0) {
+}
+
+inline RingAllocator::RingAllocator(void* buf, size_t size) {
+    init(buf, size);
+}
+
+inline void RingAllocator::init(void* buf, size_t size) {
+    // Align the buffer to the size of a block header
+    const auto addr = (uintptr_t)buf;
+    const auto alignedAddr = (addr + sizeof(Header) - 1) & ~(uintptr_t)(sizeof(Header) - 1);
+    if (!buf || size < alignedAddr - addr + sizeof(Header)) {
+        buf_ = nullptr;
+        size_ = 0;
+    } else {
+        buf_ = (char*)alignedAddr;
+        size_ = (size - (alignedAddr - addr)) & ~(sizeof(Header) - 1);
+    }
+    reset();
+}
+
+inline void* RingAllocator::alloc(size_t size) {
+    if (!size || size > size_) {
+        return nullptr;
+    }
+    const size_t n = blockSize(size);
+    size_t offs = head_;
+    if (!count_) {
+        offs = 0;
+        tail_ = 0;
+        if (n > size_) {
+            return nullptr;
+        }
+    } else if (head_ > tail_) {
+        if (n > size_ - head_) {
+            // Wrap around to the beginning of the buffer
+            if (n > tail_) {
+                return nullptr;
+            }
+            if (size_ - head_ >= sizeof(Header)) {
+                header(head_) = WRAP_MARKER;
+            }
+            offs = 0;
+        }
+    } else if (n > tail_ - head_) { // head_ <= tail_
+        return nullptr;
+    }
+    header(offs) = n - sizeof(Header);
+    head_ = offs + n;
+    ++count_;
+    return buf_ + offs + sizeof(Header);
+}
+
+inline void RingAllocator::free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    header((char*)ptr - buf_ - sizeof(Header)) |= FREE_FLAG;
+    reclaim();
+}
+
+inline bool RingAllocator::owns(const void* ptr) const {
+    return ptr >= buf_ && ptr < buf_ + size_;
+}
+
+inline void RingAllocator::reset() {
+    head_ = 0;
+    tail_ = 0;
+    count_ = 0;
+}
+
+inline size_t RingAllocator::count() const {
+    return count_;
+}
+
+inline size_t RingAllocator::size() const {
+    return size_;
+}
+
+inline RingAllocator::Header& RingAllocator::header(size_t offs) {
+    return *(Header*)(buf_ + offs);
+}
+
+inline void RingAllocator::reclaim() {
+    while (count_) {
+        if (size_ - tail_ < sizeof(Header) || header(tail_) == WRAP_MARKER) {
+            tail_ = 0;
+        }
+        const Header h = header(tail_);
+        if (!(h & FREE_FLAG)) {
+            break;
+        }
+        tail_ += (h & ~FREE_FLAG) + sizeof(Header);
+        --count_;
+    }
+    if (!count_) {
+        reset();
+    }
+}
+
+inline size_t RingAllocator::blockSize(size_t size) {
+    return sizeof(Header) + ((size + sizeof(Header) - 1) & ~(sizeof(Header) - 1));
+}
+
+} } // particle::services
@@ -229,6 +229,32 @@ private:
 #if HAL_PLATFORM_COMPRESSED_OTA
 class InflatorStream: public InputStream {
 public:
+    /**
+     * Seek index of the compressed data.
+     *
+     * The compressed data must have been produced with a full flush after every `interval` bytes of
+     * the inflated data. `offsets` contains the offsets of the resulting restart points in the
+     * compressed data. The index must stay valid for the lifetime of the stream.
+     */
+    struct Index {
+        const uint32_t* offsets;
+        size_t count;
+        size_t interval;
+    };
+
+    /**
+     * Number of inflated blocks cached for random access when the compressed data has a seek index.
+     *
+     * The blocks are only allocated when the stream is seeked backwards or past the current block.
+     * Sequential reads are served directly by the decompressor.
+     */
+    static constexpr unsigned BLOCK_CACHE_SIZE = 2;
+
+    /**
+     * Maximum supported distance between restart points.
+     */
+    static constexpr size_t MAX_INDEX_INTERVAL = 16 * 1024;
+
     InflatorStream(InputStream* compressedStream, size_t inflatedSize)
             : compressedStream_(compressedStream),
               inflatedSize_(inflatedSize),
@@ -236,10 +262,28 @@ public:
               inflatedChunk_(nullptr),
               inflatedChunkSize_(0),
               posInChunk_(0),
-              offset_(0) {
-    }
-
-    int init() {
+              offset_(0),
+              index_(),
+              blocks_(),
+              curBlock_(nullptr),
+              inflatedBlock_(nullptr),
+              blockUseCount_(0),
+              randomAccess_(false) {
+    }
+
+    /**
+     * Initialize the stream.
+     *
+     * If the seek index doesn't match the inflated data, it's ignored and the data is inflated
+     * sequentially.
+     *
+     * @param index Seek index.
+     * @return 0 on success, or a negative result code in case of an error.
+     */
+    int init(const Index* index = nullptr) {
+        if (index && index->offsets && isValidIndex(*index, inflatedSize_)) {
+            index_ = *index;
+        }
         // inflate_ will stay nullptr in case something goes wrong in inflate_create
         return inflate_create(&inflate_, nullptr, [](const char* data, size_t size, void* ctx) -> int {
             auto self = static_cast<InflatorStream*>(ctx);
@@ -247,6 +291,18 @@ public:
         }, this);
     }
 
+    /**
+     * Check if the layout of a seek index matches inflated data of the given size.
+     *
+     * @param index Seek index. The offsets are not checked.
+     * @param inflatedSize Size of the inflated data.
+     * @return `true` if the index is valid, or `false` otherwise.
+     */
+    static bool isValidIndex(const Index& index, size_t inflatedSize) {
+        return index.count > 0 && index.interval > 0 && index.interval <= MAX_INDEX_INTERVAL &&
+                inflatedSize > 0 && index.count == (inflatedSize - 1) / index.interval;
+    }
+
     virtual ~InflatorStream() {
         if (inflate_) {
             inflate_destroy(inflate_);
@@ -281,6 +337,26 @@ public:
     }
 
     int seek(size_t offset) override {
+        if (hasIndex()) {
+            CHECK_TRUE(offset <= inflatedSize_, SYSTEM_ERROR_NOT_ALLOWED);
+            const size_t chunkOffset = offset_ - posInChunk_;
+            if (inflatedChunk_ && offset >= chunkOffset && offset - chunkOffset <= inflatedChunkSize_) {
+                // The data is in the current chunk
+                posInChunk_ = offset - chunkOffset;
+                offset_ = offset;
+                return offset_;
+            }
+            if (!randomAccess_ && !curBlock_ && offset >= offset_ && offset / index_.interval == offset_ / index_.interval) {
+                // The data is further in the block that is being inflated sequentially
+                CHECK(skip(offset - offset_));
+                return offset_;
+            }
+            // The block will be loaded on the next read
+            setChunk(nullptr, 0, 0);
+            offset_ = offset;
+            randomAccess_ = true;
+            return offset_;
+        }
         CHECK_TRUE(offset == 0 || (offset >= offset_ && offset <= inflatedSize_) || (offset < offset_ && (offset_ - offset) <= posInChunk_), SYSTEM_ERROR_NOT_ALLOWED);
         if (offset == 0) {
             return rewind();
@@ -309,16 +385,148 @@ public:
             return SYSTEM_ERROR_END_OF_STREAM;
         }
         if (CHECK(availForRead()) == 0) {
-            CHECK(inflateUntilNextChunk());   
+            if (hasIndex() && randomAccess_) {
+                randomAccess_ = false;
+                CHECK(loadRandomAccessBlock());
+            } else if (hasIndex() && curBlock_) {
+                // The end of a cached block has been reached, continue inflating the data sequentially
+                // from the next restart point
+                CHECK(restart(offset_ / index_.interval));
+            }
+            if (availForRead() == 0) {
+                CHECK(inflateUntilNextChunk());
+            }
         }
         return InputStream::READABLE;
     }
 
 private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t index;
+        size_t size;
+        unsigned lastUsed;
+        bool valid;
+    };
+
     size_t toInflate() {
         return inflatedSize_ - offset_;
     }
 
+    bool hasIndex() const {
+        return index_.count > 0;
+    }
+
+    size_t blockOffset(size_t index) const {
+        return index * index_.interval;
+    }
+
+    void setChunk(const char* data, size_t size, size_t pos) {
+        inflatedChunk_ = data;
+        inflatedChunkSize_ = size;
+        posInChunk_ = pos;
+        if (!data) {
+            curBlock_ = nullptr;
+        }
+    }
+
+    int loadRandomAccessBlock() {
+        const size_t index = offset_ / index_.interval;
+        const int r = loadBlock(index);
+        if (r != SYSTEM_ERROR_NO_MEMORY) {
+            return r;
+        }
+        // Not enough memory for the block cache, inflate the block sequentially
+        const size_t offset = offset_;
+        CHECK(restart(index));
+        if (offset > offset_) {
+            CHECK(skip(offset - offset_));
+        }
+        return availForRead();
+    }
+
+    // Restarts the decompression at the beginning of the given block
+    int restart(size_t index) {
+        CHECK_TRUE(inflate_ && compressedStream_ && index <= index_.count, SYSTEM_ERROR_INVALID_STATE);
+        CHECK(inflate_reset(inflate_));
+        CHECK(compressedStream_->seek(index ? index_.offsets[index - 1] : 0));
+        setChunk(nullptr, 0, 0);
+        offset_ = blockOffset(index);
+        return 0;
+    }
+
+    int loadBlock(size_t index) {
+        Block* block = nullptr;
+        for (auto& b: blocks_) {
+            if (b.valid && b.index == index) {
+                block = &b;
+                break;
+            }
+        }
+        if (!block) {
+            // Evict the least recently used block
+            block = &blocks_[0];
+            for (auto& b: blocks_) {
+                if (!b.valid || b.lastUsed < block->lastUsed) {
+                    block = &b;
+                    if (!b.valid) {
+                        break;
+                    }
+                }
+            }
+            CHECK(inflateBlock(index, block));
+        }
+        block->lastUsed = ++blockUseCount_;
+        curBlock_ = block;
+        inflatedChunk_ = block->data.get();
+        inflatedChunkSize_ = block->size;
+        posInChunk_ = offset_ - blockOffset(index);
+        return availForRead();
+    }
+
+    int inflateBlock(size_t index, Block* block) {
+        CHECK_TRUE(inflate_ && compressedStream_ && index <= index_.count, SYSTEM_ERROR_INVALID_STATE);
+        if (curBlock_ == block) {
+            setChunk(nullptr, 0, 0);
+        }
+        block->valid = false;
+        if (!block->data) {
+            block->data.reset(new(std::nothrow) char[index_.interval]);
+            CHECK_TRUE(block->data, SYSTEM_ERROR_NO_MEMORY);
+        }
+        // Restart the decompression at the nearest restart point
+        const size_t start = index ? index_.offsets[index - 1] : 0;
+        size_t compressedSize = (index < index_.count) ? index_.offsets[index] - start : (size_t)-1;
+        CHECK(inflate_reset(inflate_));
+        CHECK(compressedStream_->seek(start));
+        const size_t blockSize = std::min(index_.interval, inflatedSize_ - blockOffset(index));
+        block->size = 0;
+        inflatedBlock_ = block;
+        SCOPE_GUARD({
+            inflatedBlock_ = nullptr;
+        });
+        char tmp[256];
+        while (block->size < blockSize) {
+            CHECK_TRUE(compressedSize > 0, SYSTEM_ERROR_BAD_DATA);
+            const size_t n = CHECK(compressedStream_->read(tmp, std::min(sizeof(tmp), compressedSize)));
+            compressedSize -= n;
+            size_t pos = 0;
+            int r = INFLATE_NEEDS_MORE_INPUT;
+            while (pos < n && r != INFLATE_DONE) {
+                size_t size = n - pos;
+                r = CHECK(inflate_input(inflate_, tmp + pos, &size, INFLATE_HAS_MORE_INPUT));
+                pos += size;
+            }
+            if (r == INFLATE_DONE) {
+                break;
+            }
+        }
+        CHECK_TRUE(block->size == blockSize, SYSTEM_ERROR_BAD_DATA);
+        block->index = index;
+        block->valid = true;
+        return 0;
+    }
+
     int rewind() {
         CHECK_TRUE(inflate_ && compressedStream_, SYSTEM_ERROR_INVALID_STATE);
         CHECK(inflate_reset(inflate_));
@@ -360,6 +568,13 @@ private:
     }
 
     int inflatedChunk(const char* data, size_t size) {
+        if (inflatedBlock_) {
+            auto block = inflatedBlock_;
+            CHECK_TRUE(size <= index_.interval - block->size, SYSTEM_ERROR_BAD_DATA);
+            memcpy(block->data.get() + block->size, data, size);
+            block->size += size;
+            return size;
+        }
         if (availForRead() == 0 && inflatedChunk_ && posInChunk_ > 0 && posInChunk_ == size) {
             // Acknowledge inflated chunk as consumed
             inflatedChunk_ = nullptr;
@@ -381,6 +596,12 @@ private:
     size_t inflatedChunkSize_;
     size_t posInChunk_;
     size_t offset_;
+    Index index_;
+    Block blocks_[BLOCK_CACHE_SIZE];
+    Block* curBlock_;
+    Block* inflatedBlock_; // Block being inflated
+    unsigned blockUseCount_;
+    bool randomAccess_; // Whether the next read should be served from the block cache
 };
 
 #endif // HAL_PLATFORM_COMPRESSED_OTA
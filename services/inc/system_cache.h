@@ -17,7 +17,26 @@
 
 #pragma once
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Write the pending modifications of the system cache to the filesystem.
+ *
+ * This function is called by the HAL before a reset.
+ *
+ * @return 0 on success or a negative result code in case of an error.
+ */
+int system_cache_flush(void);
+
+#ifdef __cplusplus
+} // extern "C"
+
 #include "tlv_file.h"
+#include "write_behind_cache.h"
+
+#include <atomic>
 
 namespace particle { namespace services {
 
@@ -31,16 +50,21 @@ enum class SystemCacheKey : uint16_t {
     ASSET_MANAGER_CONSUMER_STATE = 0x0010,
 };
 
-class SystemCache {
+// Modifications are cached in RAM and written to the file in batches, see WriteBehindCache
+class SystemCache: private WriteBehindCache::Storage {
 public:
     static SystemCache& instance();
 
-    // Just straight up proxying to TlvFile
     // TODO: add support for multiple values for a key?
     int get(SystemCacheKey key, void* value, size_t length);
     int set(SystemCacheKey key, const void* value, size_t length);
     int del(SystemCacheKey key);
 
+    // Write the pending modifications to the file if the flush delay has elapsed
+    static void process();
+    // Write all pending modifications to the file. Called before a reset or entering a sleep mode
+    static int flush();
+
     SystemCache(SystemCache const&) = delete;
     SystemCache(SystemCache&&) = delete;
     SystemCache& operator=(SystemCache const&) = delete;
@@ -51,6 +75,14 @@ protected:
 
 private:
     settings::TlvFile tlv_;
+    WriteBehindCache cache_;
+    std::atomic<bool> pendingWrites_;
+
+    int read(uint16_t key, void* data, size_t size) override;
+    int write(uint16_t key, const void* data, size_t size) override;
+    int remove(uint16_t key) override;
 };
 
 } } // particle::service
+
+#endif // __cplusplus
@@ -19,6 +19,7 @@
 #define SERVICES_TLV_FILE_H
 
 #include "filesystem.h"
+#include "spark_wiring_vector.h"
 #include <stdio.h>
 
 namespace particle { namespace services { namespace settings {
@@ -65,6 +66,13 @@ private:
     } __attribute__((__packed__));
     static_assert(sizeof(TlvHeader) == sizeof(uint32_t) * 2, "sizeof(TlvHeader) != 8");
 
+    /* In-memory copy of a TLV header */
+    struct IndexEntry {
+        uint32_t offset;
+        uint16_t key;
+        uint16_t length;
+    };
+
 private:
     lfs_t* lfs();
 
@@ -74,7 +82,9 @@ private:
 
     int mkdir(char* dir);
 
-    ssize_t find(uint16_t key, int index, uint16_t* dataSize);
+    ssize_t find(uint16_t key, int index, uint16_t* dataSize, int* entryIndex = nullptr);
+    ssize_t scan(uint16_t key, int index, uint16_t* dataSize);
+    int buildIndex();
     int readFooter(FileFooter& footer);
 
     ssize_t seek(ssize_t offset, int whence = SEEK_SET);
@@ -87,6 +97,12 @@ private:
     bool open_ = false;
     filesystem_t* fs_ = nullptr;
     lfs_file_t file_ = {};
+
+    /* Offsets of the TLV entries in the order they are stored in the file. If the index couldn't
+     * be built, e.g. due to insufficient memory, the file is scanned on every lookup
+     */
+    Vector<IndexEntry> index_;
+    bool indexValid_ = false;
 };
 
 } } } /* namespace particle::services::settings */
@@ -22,6 +22,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <type_traits>
 
 namespace particle {
 
@@ -111,4 +112,32 @@ constexpr size_t maxUnsignedVarintSize() {
     return (sizeof(T) * 8 + 6) / 7;
 }
 
+/**
+ * Map a signed integer to an unsigned integer using the ZigZag encoding.
+ *
+ * Values with a small absolute value are mapped to small unsigned values so that they can be
+ * efficiently encoded as varints. The ZigZag encoding is described here:
+ * https://developers.google.com/protocol-buffers/docs/encoding#signed-ints
+ *
+ * @param val A value.
+ * @return Encoded value.
+ */
+template<typename T>
+constexpr typename std::make_unsigned<T>::type encodeZigZag(T val) {
+    using U = typename std::make_unsigned<T>::type;
+    return ((U)val << 1) ^ (U)(val >> (sizeof(T) * 8 - 1));
+}
+
+/**
+ * Decode a ZigZag-encoded integer.
+ *
+ * @param val Encoded value.
+ * @return Decoded value.
+ */
+template<typename T>
+constexpr typename std::make_signed<T>::type decodeZigZag(T val) {
+    using S = typename std::make_signed<T>::type;
+    return (S)((val >> 1) ^ (T)-(S)(val & 1));
+}
+
 } // particle
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_tick_hal.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle { namespace services {
+
+/**
+ * Write-behind cache for small keyed records stored in flash.
+ *
+ * Modifications are kept in RAM and written to the underlying storage in batches. Repeated
+ * writes to the same key are coalesced, and writes that don't change the stored value are
+ * discarded. Pending modifications are written to the storage no later than `flushDelay`
+ * milliseconds after the first of them was made, or earlier if `flush()` is called explicitly.
+ *
+ * The class is not thread-safe.
+ */
+class WriteBehindCache {
+public:
+    /**
+     * Underlying storage.
+     */
+    class Storage {
+    public:
+        virtual ~Storage() = default;
+
+        /**
+         * Read a record.
+         *
+         * @return Number of bytes read, or `SYSTEM_ERROR_NOT_FOUND` if the record doesn't exist.
+         */
+        virtual int read(uint16_t key, void* data, size_t size) = 0;
+        /**
+         * Write a record.
+         *
+         * @return 0 on success, otherwise an error code defined by `system_error_t`.
+         */
+        virtual int write(uint16_t key, const void* data, size_t size) = 0;
+        /**
+         * Remove a record.
+         *
+         * @return 0 on success, or `SYSTEM_ERROR_NOT_FOUND` if the record doesn't exist.
+         */
+        virtual int remove(uint16_t key) = 0;
+    };
+
+    /**
+     * Maximum number of records cached in RAM.
+     */
+    static constexpr unsigned MAX_ENTRIES = 8;
+
+    /**
+     * Default maximum time a modification can be kept in RAM.
+     */
+    static constexpr system_tick_t DEFAULT_FLUSH_DELAY = 10000;
+
+    explicit WriteBehindCache(Storage* storage, system_tick_t flushDelay = DEFAULT_FLUSH_DELAY);
+    ~WriteBehindCache();
+
+    /**
+     * Read a record.
+     *
+     * @return Number of bytes read, or `SYSTEM_ERROR_NOT_FOUND` if the record doesn't exist.
+     */
+    int get(uint16_t key, void* data, size_t size);
+
+    /**
+     * Write a record.
+     *
+     * The record is written to the underlying storage when the cache is flushed. If all entries
+     * of the cache are occupied by pending modifications, the cache is flushed synchronously.
+     *
+     * @param key Key.
+     * @param data Record data.
+     * @param size Record size.
+     * @param now Current time.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int set(uint16_t key, const void* data, size_t size, system_tick_t now);
+
+    /**
+     * Remove a record.
+     *
+     * @param key Key.
+     * @param now Current time.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int del(uint16_t key, system_tick_t now);
+
+    /**
+     * Write the pending modifications to the underlying storage if the flush delay has elapsed.
+     *
+     * @param now Current time.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int process(system_tick_t now);
+
+    /**
+     * Write all pending modifications to the underlying storage.
+     *
+     * Modifications that couldn't be written are kept in the cache and retried on the next flush.
+     *
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int flush();
+
+    /**
+     * Check if there are pending modifications.
+     */
+    bool hasPendingWrites() const;
+
+    /**
+     * Discard all cached records, including the pending modifications.
+     */
+    void clear();
+
+private:
+    struct Entry {
+        uint8_t* data; // Record data
+        uint16_t key;
+        uint16_t size; // Record size
+        uint16_t capacity; // Size of the allocated buffer
+        bool used; // Whether the entry is in use
+        bool dirty; // Whether the entry needs to be written to the storage
+        bool deleted; // Whether the record doesn't exist
+    };
+
+    Entry entries_[MAX_ENTRIES];
+    Storage* storage_;
+    system_tick_t flushDelay_;
+    system_tick_t flushTime_; // Time when the first pending modification was made
+    unsigned dirtyCount_;
+
+    Entry* entry(uint16_t key);
+    int allocEntry(uint16_t key, Entry** entry);
+    int update(Entry* entry, const void* data, size_t size, bool deleted, system_tick_t now);
+    void markDirty(Entry* entry, system_tick_t now);
+    void freeEntry(Entry* entry);
+};
+
+inline bool WriteBehindCache::hasPendingWrites() const {
+    return dirtyCount_ > 0;
+}
+
+} } // particle::services
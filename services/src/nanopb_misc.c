@@ -73,6 +73,11 @@ static bool write_coap_message_callback(pb_ostream_t* strm, const uint8_t* data,
     return true;
 }
 
+static bool write_appender_callback(pb_ostream_t* strm, const uint8_t* data, size_t size) {
+    pb_appender* const appender = (pb_appender*)strm->state;
+    return appender->fn(appender->data, data, size);
+}
+
 pb_ostream_t* pb_ostream_init(void* reserved) {
     return (pb_ostream_t*)calloc(sizeof(pb_ostream_t), 1);
 }
@@ -183,3 +188,14 @@ int pb_ostream_from_coap_message(pb_ostream_t* stream, coap_message* msg, void*
     stream->max_size = COAP_BLOCK_SIZE;
     return 0;
 }
+
+int pb_ostream_from_appender(pb_ostream_t* stream, pb_appender* appender, void* reserved) {
+    if (!stream || !appender || !appender->fn) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    memset(stream, 0, sizeof(*stream));
+    stream->callback = write_appender_callback;
+    stream->state = appender;
+    stream->max_size = SIZE_MAX;
+    return 0;
+}
@@ -21,13 +21,29 @@
 #if HAL_PLATFORM_FILESYSTEM
 
 #include "system_cache.h"
+#include "timer_hal.h"
 #include "enumclass.h"
 #include "check.h"
 
 namespace particle { namespace services {
 
+using fs::FsLock;
+
+namespace {
+
+std::atomic<SystemCache*> g_cache(nullptr);
+
+filesystem_t* filesystem() {
+    return filesystem_get_instance(FILESYSTEM_INSTANCE_DEFAULT, nullptr);
+}
+
+} // namespace
+
 SystemCache::SystemCache()
-        : tlv_("/sys/cache.dat") {
+        : tlv_("/sys/cache.dat"),
+          cache_(this),
+          pendingWrites_(false) {
+    g_cache.store(this, std::memory_order_release);
 }
 
 SystemCache& SystemCache::instance() {
@@ -37,18 +53,66 @@ SystemCache& SystemCache::instance() {
 }
 
 int SystemCache::get(SystemCacheKey key, void* value, size_t length) {
-    return tlv_.get(to_underlying(key), (uint8_t*)value, length);
+    FsLock lock(filesystem());
+    return cache_.get(to_underlying(key), value, length);
 }
 
 int SystemCache::set(SystemCacheKey key, const void* value, size_t length) {
     CHECK_TRUE(length <= std::numeric_limits<uint16_t>::max(), SYSTEM_ERROR_TOO_LARGE);
-    return tlv_.set(to_underlying(key), (const uint8_t*)value, length, 0);
+    FsLock lock(filesystem());
+    const int r = cache_.set(to_underlying(key), value, length, HAL_Timer_Get_Milli_Seconds());
+    pendingWrites_.store(cache_.hasPendingWrites(), std::memory_order_relaxed);
+    return r;
 }
 
 int SystemCache::del(SystemCacheKey key) {
-    return tlv_.del(to_underlying(key));
+    FsLock lock(filesystem());
+    const int r = cache_.del(to_underlying(key), HAL_Timer_Get_Milli_Seconds());
+    pendingWrites_.store(cache_.hasPendingWrites(), std::memory_order_relaxed);
+    return r;
+}
+
+void SystemCache::process() {
+    const auto cache = g_cache.load(std::memory_order_acquire);
+    // Avoid acquiring the filesystem lock on every iteration of the system loop
+    if (!cache || !cache->pendingWrites_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    FsLock lock(filesystem());
+    const int r = cache->cache_.process(HAL_Timer_Get_Milli_Seconds());
+    if (r < 0) {
+        LOG(ERROR, "Failed to update system cache: %d", r);
+    }
+    cache->pendingWrites_.store(cache->cache_.hasPendingWrites(), std::memory_order_relaxed);
+}
+
+int SystemCache::flush() {
+    const auto cache = g_cache.load(std::memory_order_acquire);
+    if (!cache || !cache->pendingWrites_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    FsLock lock(filesystem());
+    const int r = cache->cache_.flush();
+    cache->pendingWrites_.store(cache->cache_.hasPendingWrites(), std::memory_order_relaxed);
+    return r;
+}
+
+int SystemCache::read(uint16_t key, void* data, size_t size) {
+    return tlv_.get(key, (uint8_t*)data, size);
+}
+
+int SystemCache::write(uint16_t key, const void* data, size_t size) {
+    return tlv_.set(key, (const uint8_t*)data, size, 0);
+}
+
+int SystemCache::remove(uint16_t key) {
+    return tlv_.del(key);
 }
 
 } } // particle::services
 
+int system_cache_flush(void) {
+    return particle::services::SystemCache::flush();
+}
+
 #endif // HAL_PLATFORM_FILESYSTEM
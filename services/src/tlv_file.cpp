@@ -32,6 +32,13 @@
 using namespace particle::services::settings;
 using namespace particle::fs;
 
+namespace {
+
+/* Size of the buffer used to move the entries when an entry is deleted */
+const size_t COPY_BUFFER_SIZE = 128;
+
+} // namespace
+
 TlvFile::TlvFile(const char* path) {
     SPARK_ASSERT(path != nullptr);
     path_ = strdup(path);
@@ -183,11 +190,13 @@ int TlvFile::add(uint16_t key, const uint8_t* value, uint16_t length) {
     /* Write entry header */
     ret = write((const uint8_t*)&header, sizeof(header));
     if (ret < 0) {
+        indexValid_ = false;
         return ret;
     }
     /* Write data */
     ret = write((const uint8_t*)value, length);
     if (ret < 0) {
+        indexValid_ = false;
         return ret;
     }
     /* Write file footer */
@@ -195,10 +204,21 @@ int TlvFile::add(uint16_t key, const uint8_t* value, uint16_t length) {
     footer.size += sizeof(header) + length;
     ret = write((const uint8_t*)&footer, sizeof(footer));
     if (ret < 0) {
+        indexValid_ = false;
         return ret;
     }
 
-    return sync();
+    ret = sync();
+    if (ret < 0) {
+        indexValid_ = false;
+        return ret;
+    }
+
+    if (indexValid_ && !index_.append(IndexEntry{(uint32_t)pos, key, length})) {
+        indexValid_ = false;
+    }
+
+    return 0;
 }
 
 int TlvFile::del(uint16_t key, int index) {
@@ -214,7 +234,8 @@ int TlvFile::del(uint16_t key, int index) {
 
     for (;;) {
         uint16_t dataSize = 0;
-        ssize_t pos = find(key, index, &dataSize);
+        int entryIndex = -1;
+        ssize_t pos = find(key, index, &dataSize, &entryIndex);
         if (pos < 0) {
             if (index < 0 && deleted) {
                 return ret;
@@ -251,17 +272,25 @@ int TlvFile::del(uint16_t key, int index) {
                 break;
             }
 
-            for (; rpos < footer.size && ret > 0; ++wpos, ++rpos) {
-                uint8_t tmp;
-                ret = lfs_file_read(lfs(), &f, &tmp, sizeof(tmp));
-                if (ret < 0) {
+            uint8_t buf[COPY_BUFFER_SIZE];
+            while (rpos < footer.size && ret > 0) {
+                const size_t n = std::min(footer.size - rpos, sizeof(buf));
+                ret = lfs_file_read(lfs(), &f, buf, n);
+                if (ret <= 0) {
+                    if (ret == 0) {
+                        ret = SYSTEM_ERROR_BAD_DATA;
+                    }
                     break;
                 }
 
-                ret = write(&tmp, sizeof(tmp));
+                const size_t rd = ret;
+                ret = write(buf, rd);
                 if (ret < 0) {
                     break;
                 }
+
+                wpos += rd;
+                rpos += rd;
             }
 
             if (ret > 0) {
@@ -286,6 +315,16 @@ int TlvFile::del(uint16_t key, int index) {
 
         if (!ret) {
             deleted = true;
+            if (indexValid_ && entryIndex >= 0) {
+                const uint32_t entrySize = sizeof(TlvHeader) + dataSize;
+                for (int i = entryIndex + 1; i < index_.size(); ++i) {
+                    index_[i].offset -= entrySize;
+                }
+                index_.removeAt(entryIndex);
+            }
+        } else {
+            /* The file may have been modified partially */
+            indexValid_ = false;
         }
 
         if (ret || index >= 0) {
@@ -318,9 +357,13 @@ int TlvFile::open() {
     FileFooter footer = {};
 
     if (!validate()) {
+        buildIndex();
         goto open_done;
     }
 
+    index_.clear();
+    indexValid_ = true;
+
     footer.magick = TLV_FILE_MAGICK;
     footer.size = 0;
 
@@ -346,6 +389,8 @@ open_done:
     if (r) {
         lfs_file_close(lfs(), &file_);
         open_ = false;
+        index_.clear();
+        indexValid_ = false;
     }
     return r;
 }
@@ -372,6 +417,8 @@ int TlvFile::close() {
     /* Close */
 
     open_ = false;
+    index_.clear();
+    indexValid_ = false;
 
     return lfs_file_close(lfs(), &file_);
 }
@@ -449,7 +496,80 @@ int TlvFile::readFooter(FileFooter& footer) {
     return SYSTEM_ERROR_BAD_DATA;
 }
 
-ssize_t TlvFile::find(uint16_t key, int index, uint16_t* dataSize) {
+int TlvFile::buildIndex() {
+    index_.clear();
+    indexValid_ = false;
+
+    FileFooter footer;
+    int r = readFooter(footer);
+    if (r) {
+        return r;
+    }
+
+    TlvHeader header;
+    for (ssize_t pos = 0; pos >= 0 && (pos + sizeof(TlvHeader)) <= footer.size;) {
+        r = seek(pos);
+        if (r < 0) {
+            return r;
+        }
+
+        ssize_t rd = read((uint8_t*)&header, sizeof(header));
+        if (rd < (ssize_t)sizeof(TlvHeader)) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+
+        if (header.magick != TLV_HEADER_MAGICK) {
+            /* Attempt to recover */
+            pos += sizeof(uint16_t);
+            continue;
+        }
+
+        if (!index_.append(IndexEntry{(uint32_t)pos, header.key, header.length})) {
+            index_.clear();
+            return SYSTEM_ERROR_NO_MEMORY;
+        }
+
+        pos += sizeof(TlvHeader) + header.length;
+    }
+
+    indexValid_ = true;
+    return 0;
+}
+
+ssize_t TlvFile::find(uint16_t key, int index, uint16_t* dataSize, int* entryIndex) {
+    if (!indexValid_) {
+        buildIndex();
+    }
+    if (!indexValid_) {
+        return scan(key, index, dataSize);
+    }
+
+    int candidate = -1;
+    int candidateIdx = -1;
+    for (int i = 0; i < index_.size(); ++i) {
+        if (index_[i].key == key) {
+            candidate = i;
+            ++candidateIdx;
+            if (index >= 0 && candidateIdx >= index) {
+                break;
+            }
+        }
+    }
+
+    if ((index >= 0 && candidateIdx == index) || (index < 0 && candidateIdx >= 0)) {
+        if (dataSize) {
+            *dataSize = index_[candidate].length;
+        }
+        if (entryIndex) {
+            *entryIndex = candidate;
+        }
+        return index_[candidate].offset;
+    }
+
+    return SYSTEM_ERROR_NOT_FOUND;
+}
+
+ssize_t TlvFile::scan(uint16_t key, int index, uint16_t* dataSize) {
     FileFooter footer;
     int r = readFooter(footer);
     if (r) {
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "write_behind_cache.h"
+
+#include "check.h"
+#include "system_error.h"
+
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+
+namespace particle { namespace services {
+
+WriteBehindCache::WriteBehindCache(Storage* storage, system_tick_t flushDelay) :
+        entries_(),
+        storage_(storage),
+        flushDelay_(flushDelay),
+        flushTime_(0),
+        dirtyCount_(0) {
+}
+
+WriteBehindCache::~WriteBehindCache() {
+    flush();
+    clear();
+}
+
+int WriteBehindCache::get(uint16_t key, void* data, size_t size) {
+    const auto e = entry(key);
+    if (!e) {
+        return storage_->read(key, data, size);
+    }
+    if (e->deleted) {
+        return SYSTEM_ERROR_NOT_FOUND;
+    }
+    size = std::min<size_t>(size, e->size);
+    if (size) {
+        memcpy(data, e->data, size);
+    }
+    return size;
+}
+
+int WriteBehindCache::set(uint16_t key, const void* data, size_t size, system_tick_t now) {
+    CHECK_TRUE(size <= std::numeric_limits<uint16_t>::max(), SYSTEM_ERROR_TOO_LARGE);
+    auto e = entry(key);
+    if (e) {
+        if (!e->deleted && e->size == size && (!size || memcmp(e->data, data, size) == 0)) {
+            return 0; // The record is unchanged
+        }
+    } else {
+        CHECK(allocEntry(key, &e));
+    }
+    CHECK(update(e, data, size, false /* deleted */, now));
+    return 0;
+}
+
+int WriteBehindCache::del(uint16_t key, system_tick_t now) {
+    auto e = entry(key);
+    if (e) {
+        if (e->deleted) {
+            return 0;
+        }
+    } else {
+        CHECK(allocEntry(key, &e));
+    }
+    CHECK(update(e, nullptr, 0, true /* deleted */, now));
+    return 0;
+}
+
+int WriteBehindCache::process(system_tick_t now) {
+    if (!dirtyCount_ || now - flushTime_ < flushDelay_) {
+        return 0;
+    }
+    const int r = flush();
+    if (r < 0) {
+        // Retry after another delay
+        flushTime_ = now;
+        return r;
+    }
+    return 0;
+}
+
+int WriteBehindCache::flush() {
+    int result = 0;
+    for (auto& e: entries_) {
+        if (!e.used || !e.dirty) {
+            continue;
+        }
+        int r = 0;
+        if (e.deleted) {
+            r = storage_->remove(e.key);
+            if (r == SYSTEM_ERROR_NOT_FOUND) {
+                r = 0;
+            }
+        } else {
+            r = storage_->write(e.key, e.data, e.size);
+        }
+        if (r < 0) {
+            result = r;
+            continue;
+        }
+        e.dirty = false;
+        --dirtyCount_;
+        if (e.deleted) {
+            freeEntry(&e);
+        }
+    }
+    return result;
+}
+
+void WriteBehindCache::clear() {
+    for (auto& e: entries_) {
+        freeEntry(&e);
+    }
+    dirtyCount_ = 0;
+}
+
+WriteBehindCache::Entry* WriteBehindCache::entry(uint16_t key) {
+    for (auto& e: entries_) {
+        if (e.used && e.key == key) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+int WriteBehindCache::allocEntry(uint16_t key, Entry** entry) {
+    Entry* unused = nullptr;
+    Entry* clean = nullptr;
+    for (auto& e: entries_) {
+        if (!e.used) {
+            unused = &e;
+            break;
+        }
+        if (!e.dirty && !clean) {
+            clean = &e;
+        }
+    }
+    auto e = unused;
+    if (!e) {
+        if (!clean) {
+            // All entries have pending modifications
+            CHECK(flush());
+            clean = &entries_[0];
+        }
+        // Evict a record that has already been written to the storage
+        freeEntry(clean);
+        e = clean;
+    }
+    e->key = key;
+    e->used = true;
+    *entry = e;
+    return 0;
+}
+
+int WriteBehindCache::update(Entry* entry, const void* data, size_t size, bool deleted, system_tick_t now) {
+    if (size > entry->capacity) {
+        const auto buf = (uint8_t*)malloc(size);
+        if (!buf) {
+            if (!entry->dirty && !entry->size && !entry->deleted) {
+                freeEntry(entry); // Don't leave a newly allocated entry in the cache
+            }
+            return SYSTEM_ERROR_NO_MEMORY;
+        }
+        free(entry->data);
+        entry->data = buf;
+        entry->capacity = size;
+    }
+    if (size) {
+        memcpy(entry->data, data, size);
+    }
+    entry->size = size;
+    entry->deleted = deleted;
+    markDirty(entry, now);
+    return 0;
+}
+
+void WriteBehindCache::markDirty(Entry* entry, system_tick_t now) {
+    if (entry->dirty) {
+        return;
+    }
+    entry->dirty = true;
+    if (dirtyCount_++ == 0) {
+        // The delay is not extended by subsequent modifications
+        flushTime_ = now;
+    }
+}
+
+void WriteBehindCache::freeEntry(Entry* entry) {
+    free(entry->data);
+    *entry = Entry();
+}
+
+} } // particle::services
@@ -20,6 +20,10 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+#include "message_pool.h"
 
 #if PLATFORM_THREADING
 
@@ -254,6 +258,55 @@ public:
     }
 };
 
+/**
+ * An asynchronous task that stores the function object inline and is allocated from the message
+ * pool. Disposes itself when complete.
+ */
+template<typename F>
+class PooledAsyncTask : public Message, public particle::PooledObject
+{
+    F fn;
+
+public:
+    explicit PooledAsyncTask(F&& fn_) : fn(std::move(fn_)) {}
+
+    void operator()() override
+    {
+        fn();
+        delete this;
+    }
+};
+
+/**
+ * A promise for a synchronous call. The caller waits for the completion of the call so the
+ * promise and the function object can reside on the caller's stack.
+ */
+template<typename F>
+class InlinePromise : public Message
+{
+public:
+    typedef decltype(std::declval<F&>()()) ResultType;
+
+    InlinePromise(F& fn_, os_semaphore_t complete_) : fn(fn_), complete(complete_), result() {}
+
+    void operator()() override
+    {
+        result = fn();
+        // The promise may be destroyed by the waiting thread as soon as the semaphore is given
+        os_semaphore_give(complete, false);
+    }
+
+    ResultType get()
+    {
+        os_semaphore_take(complete, CONCURRENT_WAIT_FOREVER, false);
+        return result;
+    }
+
+private:
+    F& fn;
+    os_semaphore_t complete;
+    ResultType result;
+};
 
 class ActiveObjectBase
 {
@@ -273,6 +326,11 @@ protected:
 
     volatile bool started;
 
+    /**
+     * Loop profiler stage accounting the processed messages, or -1.
+     */
+    int profilerStage;
+
     /**
      * The main run loop for an active object.
      */
@@ -285,6 +343,13 @@ protected:
     virtual bool take(Item& item)=0;
     virtual bool put(Item& item, bool dontBlock = false)=0;
 
+    /**
+     * Semaphores used to wait for the completion of synchronous calls are created on demand and
+     * reused.
+     */
+    static os_semaphore_t acquire_completion_semaphore();
+    static void release_completion_semaphore(os_semaphore_t semaphore);
+
     /**
      * Static thread entrypoint to run this active object loop.
      * @param obj
@@ -298,7 +363,8 @@ public:
     ActiveObjectBase(const ActiveObjectConfiguration& config) :
             configuration(config),
             _thread(OS_THREAD_INVALID_HANDLE),
-            started(false) {
+            started(false),
+            profilerStage(-1) {
     }
 
     bool process();
@@ -315,6 +381,13 @@ public:
         return started;
     }
 
+    /**
+     * Account the messages processed by this active object as a stage of the loop profiler.
+     */
+    void setProfilerStage(int stage) {
+        profilerStage = stage;
+    }
+
     template<typename R> bool invoke_async(const std::function<R(void)>& work, bool dontBlock = false)
     {
         auto task = new AsyncTask<R>(work);
@@ -329,6 +402,47 @@ public:
         return true;
     }
 
+    /**
+     * Asynchronously invoke a function object. The function object is stored in a message
+     * allocated from the message pool.
+     */
+    template<typename F> bool invoke_async_pooled(F&& work, bool dontBlock = false)
+    {
+        auto task = new PooledAsyncTask<typename std::decay<F>::type>(std::forward<F>(work));
+        if (!task) {
+            return false;
+        }
+        Item message = task;
+        if (!put(message, dontBlock)) {
+            delete task;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Invoke a function object and wait for the result without allocating memory.
+     *
+     * @return Result of the function, or a value-initialized result if the call could not be
+     *         scheduled.
+     */
+    template<typename F> typename InlinePromise<F>::ResultType invoke_sync(F& work)
+    {
+        typedef typename InlinePromise<F>::ResultType R;
+        const auto complete = acquire_completion_semaphore();
+        if (!complete) {
+            return R();
+        }
+        R result = R();
+        InlinePromise<F> promise(work, complete);
+        Item message = &promise;
+        if (put(message)) {
+            result = promise.get();
+        }
+        release_completion_semaphore(complete);
+        return result;
+    }
+
     template<typename R> SystemPromise<R>* invoke_future(const std::function<R(void)>& work)
     {
         auto promise = new SystemPromise<R>(work);
@@ -457,6 +571,11 @@ public:
 /**
  * This class implements a queue of asynchronous calls that can be scheduled from an ISR and then
  * invoked from an event loop running in a regular thread.
+ *
+ * The queue supports multiple producers and a single consumer. Adding a task object to the queue
+ * is lock-free and doesn't disable interrupts: the producers push the task objects to an atomic
+ * list of pending tasks, which the consumer moves to its own list when processing the queue.
+ * The `process()` and `remove()` methods must only be called by the consumer thread.
  */
 class ISRTaskQueue {
 public:
@@ -467,11 +586,13 @@ public:
         TaskFunc func;
         Task* next; // Next element in the queue
         Task* prev; // Previous element in the queue
+        std::atomic<uint8_t> state; // Queueing state (see ISRTaskQueue::TaskState)
 
         explicit Task(TaskFunc func = nullptr) :
                 func(func),
                 next(nullptr),
-                prev(nullptr) {
+                prev(nullptr),
+                state(0 /* TaskState::IDLE */) {
         }
 
         virtual ~Task() = default;
@@ -482,6 +603,7 @@ public:
     };
 
     ISRTaskQueue() :
+            pendingTasks_(nullptr),
             firstTask_(nullptr),
             lastTask_(nullptr) {
     }
@@ -489,14 +611,18 @@ public:
     /**
      * Add a task object to the queue.
      *
-     * Calling this method is a no-op if the task object is already in the queue.
+     * Calling this method is a no-op if the task object is already in the queue. This method can
+     * be called from any thread or ISR.
      */
     void enqueue(Task* task);
 
     /**
      * Remove a task object from the queue.
      *
-     * Calling this method is a no-op if the task object is not in the queue.
+     * Calling this method is a no-op if the task object is not in the queue. If a producer is in
+     * the middle of adding the task object to the queue, this method waits for it to finish, so
+     * the task object can be destroyed once this method returns, provided that it's not added to
+     * the queue again.
      */
     void remove(Task* task);
 
@@ -508,6 +634,16 @@ public:
     bool process();
 
 private:
-    Task* volatile firstTask_;
+    enum TaskState: uint8_t {
+        IDLE = 0, // Not in the queue
+        PENDING = 1, // In the list of pending tasks
+        QUEUED = 2 // In the consumer's list
+    };
+
+    std::atomic<Task*> pendingTasks_; // Most recently added pending task
+    Task* firstTask_;
     Task* lastTask_;
+
+    void takePendingTasks();
+    void unlink(Task* task);
 };
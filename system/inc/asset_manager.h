@@ -105,6 +105,7 @@ public:
 
 private:
     int calculateCrc(uint32_t* crc);
+    int readSeekIndex(const compressed_module_header& header);
 
 private:
     InputStream* stream_;
@@ -120,6 +121,10 @@ private:
 
     size_t dataOffset_;
     size_t dataSize_;
+
+    std::unique_ptr<uint32_t[]> seekIndex_; // Offsets of the restart points in the compressed data
+    size_t seekIndexCount_;
+    size_t seekIndexInterval_;
 };
 
 class AssetManager {
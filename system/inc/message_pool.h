@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#ifndef SYSTEM_MESSAGE_POOL_BLOCK_COUNT
+#define SYSTEM_MESSAGE_POOL_BLOCK_COUNT 16
+#endif
+
+#ifndef SYSTEM_MESSAGE_POOL_BLOCK_SIZE
+#define SYSTEM_MESSAGE_POOL_BLOCK_SIZE (sizeof(void*) * 12)
+#endif
+
+namespace particle {
+
+/**
+ * Fixed-size pool of memory blocks for the messages passed between the system and application
+ * threads.
+ *
+ * Allocating and freeing a block is lock-free and can be done from any thread. If the pool is
+ * exhausted or the requested size is larger than the block size, the memory is allocated on the
+ * heap.
+ */
+class MessagePool {
+public:
+    /**
+     * Number of blocks in the pool.
+     */
+    static constexpr unsigned BLOCK_COUNT = SYSTEM_MESSAGE_POOL_BLOCK_COUNT;
+
+    /**
+     * Size of a block.
+     */
+    static constexpr size_t BLOCK_SIZE = SYSTEM_MESSAGE_POOL_BLOCK_SIZE;
+
+    static_assert(BLOCK_COUNT > 0 && BLOCK_COUNT <= 32, "Invalid number of blocks");
+
+    constexpr MessagePool() :
+            blocks_(),
+            freeMask_((BLOCK_COUNT < 32) ? ((uint32_t)1 << BLOCK_COUNT) - 1 : 0xffffffff),
+            used_(0),
+            maxUsed_(0),
+            heapAllocs_(0) {
+    }
+
+    /**
+     * Allocate memory.
+     *
+     * @param size Size of the memory.
+     * @return Pointer to the allocated memory, or `nullptr` if the memory could not be allocated.
+     */
+    void* alloc(size_t size);
+
+    /**
+     * Free memory.
+     *
+     * @param ptr Pointer to the memory allocated with `alloc()`.
+     */
+    void free(void* ptr);
+
+    /**
+     * Get the number of blocks currently in use.
+     */
+    unsigned usedBlocks() const {
+        return used_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the maximum number of blocks that have been in use at the same time.
+     */
+    unsigned maxUsedBlocks() const {
+        return maxUsed_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the number of allocations that could not be served by the pool.
+     */
+    unsigned heapAllocations() const {
+        return heapAllocs_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the global instance of the pool.
+     */
+    static MessagePool* instance();
+
+private:
+    alignas(std::max_align_t) uint8_t blocks_[BLOCK_COUNT][BLOCK_SIZE];
+    std::atomic<uint32_t> freeMask_;
+    std::atomic<unsigned> used_;
+    std::atomic<unsigned> maxUsed_;
+    std::atomic<unsigned> heapAllocs_;
+};
+
+/**
+ * Base class for objects allocated from the global message pool.
+ */
+struct PooledObject {
+    static void* operator new(size_t size) noexcept {
+        return MessagePool::instance()->alloc(size);
+    }
+
+    static void* operator new(size_t size, const std::nothrow_t&) noexcept {
+        return MessagePool::instance()->alloc(size);
+    }
+
+    static void operator delete(void* ptr) {
+        MessagePool::instance()->free(ptr);
+    }
+};
+
+} // namespace particle
@@ -238,6 +238,21 @@ typedef struct spark_variable_t
      * @return 0 on success or a negative result code in case of an error.
      */
     int (*copy)(const void* var, void** data, size_t* size);
+
+    /**
+     * Read a portion of variable data.
+     *
+     * If this callback is set, the variable data is generated on demand in blocks and is not
+     * required to be fully stored in RAM.
+     *
+     * @param var Variable object.
+     * @param offset Offset in the variable data.
+     * @param data Output buffer.
+     * @param size Size of the output buffer.
+     * @return Number of bytes written to the buffer, or a negative result code in case of an error.
+     *         A value smaller than `size` indicates the end of the variable data.
+     */
+    int (*read)(const void* var, size_t offset, char* data, size_t size);
 } spark_variable_t;
 
 /**
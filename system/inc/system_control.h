@@ -66,6 +66,7 @@ typedef enum ctrl_request_type {
     CTRL_REQUEST_GET_MODULE_INFO = 90,
     CTRL_REQUEST_GET_ASSET_INFO = 91,
     CTRL_REQUEST_DIAGNOSTIC_INFO = 100,
+    CTRL_REQUEST_LOOP_PROFILER = 101,
     // CTRL_REQUEST_WIFI_SET_ANTENNA = 110,
     // CTRL_REQUEST_WIFI_GET_ANTENNA = 111,
     // CTRL_REQUEST_WIFI_SCAN = 112,
@@ -121,12 +121,21 @@ int system_info_get_unstable(hal_system_info_t* info, uint32_t flags, void* rese
 int system_info_free_unstable(hal_system_info_t* info, void* reserved);
 #endif // !defined(PARTICLE_USER_MODULE) || defined(PARTICLE_USE_UNSTABLE_API)
 
+/**
+ * Flags for `system_format_diag_data()`.
+ */
+typedef enum system_format_diag_data_flag {
+    SYSTEM_FORMAT_DIAG_DATA_BINARY = 0x01, ///< Use the binary format.
+    SYSTEM_FORMAT_DIAG_DATA_DELTA = 0x02, ///< Use the compact format that only contains the changed values.
+    SYSTEM_FORMAT_DIAG_DATA_AGGREGATES = 0x04 ///< Include histograms and time series in the output.
+} system_format_diag_data_flag;
+
 /**
  * Formats the diagnostic data using an appender function.
  *
  * @param id Array of data source IDs. This argument can be set to NULL to format all registered data sources.
  * @param count Number of data source IDs in the array.
- * @param flags Formatting flags.
+ * @param flags Formatting flags (a combination of the flags defined by `system_format_diag_data_flag`).
  * @param append Appender function.
  * @param append_data Opaque data passed to the appender function.
  * @param reserved Reserved argument (should be set to NULL).
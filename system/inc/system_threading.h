@@ -74,36 +74,30 @@ os_mutex_recursive_t mutex_usb_serial();
 
 #define _THREAD_CONTEXT_ASYNC_RESULT(thread, fn, result) \
     if (thread.isStarted() && !thread.isCurrentThread()) { \
-        auto lambda = [=]() { (fn); }; \
-        thread.invoke_async(particle::FFL(lambda)); \
+        thread.invoke_async_pooled([=]() { (fn); }); \
         return result; \
     }
 
 #define _THREAD_CONTEXT_ASYNC(thread, fn) \
     if (thread.isStarted() && !thread.isCurrentThread()) { \
-        auto lambda = [=]() { (fn); }; \
-        thread.invoke_async(particle::FFL(lambda)); \
+        thread.invoke_async_pooled([=]() { (fn); }); \
         return; \
     }
 
 #define _THREAD_CONTEXT_ASYNC_TRY(thread, fn) \
     if (thread.isStarted() && !thread.isCurrentThread()) { \
-        auto lambda = [=]() { (fn); }; \
-        thread.invoke_async(particle::FFL(lambda), true /* dontBlock */); \
+        thread.invoke_async_pooled([=]() { (fn); }, true /* dontBlock */); \
         return; \
     }
 
 // execute synchronously on the system thread. Since the parameter lifetime is
 // assumed to be bound by the caller, the parameters don't need marshalling
 // fn: the function call to perform. This is textually substitued into a lambda, with the
-// parameters passed by copy.
+// parameters passed by copy. The call doesn't allocate memory as the caller waits for its completion
 #define SYSTEM_THREAD_CONTEXT_SYNC(fn) \
     if (particle::SystemThread.isStarted() && !particle::SystemThread.isCurrentThread()) { \
-        auto callable = particle::FFL([=]() { return (fn); }); \
-        auto future = particle::SystemThread.invoke_future(callable); \
-        auto result = future ? future->get() : 0;  \
-        delete future; \
-        return result; \
+        auto callable = [=]() { return (fn); }; \
+        return particle::SystemThread.invoke_sync(callable); \
     }
 
 #define SYSTEM_THREAD_CURRENT() (particle::SystemThread.isCurrentThread())
@@ -145,7 +139,7 @@ namespace particle {
 
 namespace detail {
 
-struct CallableTaskBase: ISRTaskQueue::Task {
+struct CallableTaskBase: ISRTaskQueue::Task, PooledObject {
     virtual void call() = 0;
 };
 
@@ -168,7 +162,7 @@ extern ISRTaskQueue SystemISRTaskQueue;
 /**
  * Asynchronously invokes a function in the context of the system thread via the ISR task queue.
  *
- * @note This function allocates memory and thus it cannot be called from an ISR.
+ * @note This function may allocate memory and thus it cannot be called from an ISR.
  */
 template<typename F>
 int invokeAsync(F&& fn) {
@@ -19,16 +19,19 @@
 
 #include "active_object.h"
 #include "system_threading.h"
-#include "spark_wiring_interrupts.h"
+#include "system_loop_profiler.h"
 #include "debug.h"
 
 using namespace particle;
+using particle::system::LoopProfiler;
+using particle::system::LoopProfilerScope;
 
 #if PLATFORM_THREADING
 
 #include <string.h>
 #include "concurrent_hal.h"
 #include "timer_hal.h"
+#include "delay_hal.h"
 #include "rng_hal.h"
 
 void ActiveObjectBase::start_thread()
@@ -82,7 +85,12 @@ bool ActiveObjectBase::process()
     if (take(item) && item)
     {
         Message& msg = *item;
-        msg();
+        if (profilerStage >= 0) {
+            LoopProfilerScope scope((LoopProfiler::Stage)profilerStage);
+            msg();
+        } else {
+            msg();
+        }
         result = true;
     }
     return result;
@@ -94,23 +102,68 @@ void ActiveObjectBase::run_active_object(void* data)
     that->run();
 }
 
-#endif // PLATFORM_THREADING
+namespace {
 
-void ISRTaskQueue::enqueue(Task* task) {
-    ATOMIC_BLOCK() {
-        if (task->next || task->prev || lastTask_ == task) {
-            return; // Task object is already in the queue
+// Maximum number of synchronous calls that can be waited for without creating a semaphore
+const unsigned COMPLETION_SEMAPHORE_COUNT = 4;
+
+std::atomic<os_semaphore_t> g_completionSemaphores[COMPLETION_SEMAPHORE_COUNT] = {};
+std::atomic<uint32_t> g_freeCompletionSemaphores((1 << COMPLETION_SEMAPHORE_COUNT) - 1);
+
+} // namespace
+
+os_semaphore_t ActiveObjectBase::acquire_completion_semaphore()
+{
+    auto mask = g_freeCompletionSemaphores.load(std::memory_order_relaxed);
+    while (mask) {
+        const uint32_t bit = mask & ~(mask - 1);
+        if (!g_freeCompletionSemaphores.compare_exchange_weak(mask, mask & ~bit, std::memory_order_acquire,
+                std::memory_order_relaxed)) {
+            continue;
         }
-        // Add task object to the queue
-        if (lastTask_) {
-            lastTask_->next = task;
-        } else { // The queue is empty
-            firstTask_ = task;
+        auto& slot = g_completionSemaphores[__builtin_ctz(bit)];
+        auto semaphore = slot.load(std::memory_order_relaxed);
+        if (!semaphore) {
+            if (os_semaphore_create(&semaphore, 1, 0) != 0) {
+                g_freeCompletionSemaphores.fetch_or(bit, std::memory_order_release);
+                return nullptr;
+            }
+            slot.store(semaphore, std::memory_order_relaxed);
         }
-        task->next = nullptr;
-        task->prev = lastTask_;
-        lastTask_ = task;
+        return semaphore;
+    }
+    os_semaphore_t semaphore = nullptr;
+    if (os_semaphore_create(&semaphore, 1, 0) != 0) {
+        return nullptr;
+    }
+    return semaphore;
+}
+
+void ActiveObjectBase::release_completion_semaphore(os_semaphore_t semaphore)
+{
+    for (unsigned i = 0; i < COMPLETION_SEMAPHORE_COUNT; ++i) {
+        if (g_completionSemaphores[i].load(std::memory_order_relaxed) == semaphore) {
+            g_freeCompletionSemaphores.fetch_or((uint32_t)1 << i, std::memory_order_release);
+            return;
+        }
+    }
+    os_semaphore_destroy(semaphore);
+}
+
+#endif // PLATFORM_THREADING
+
+void ISRTaskQueue::enqueue(Task* task) {
+    uint8_t state = TaskState::IDLE;
+    if (!task->state.compare_exchange_strong(state, TaskState::PENDING, std::memory_order_acq_rel,
+            std::memory_order_relaxed)) {
+        return; // Task object is already in the queue
     }
+    // Add task object to the list of pending tasks
+    auto next = pendingTasks_.load(std::memory_order_relaxed);
+    do {
+        task->next = next;
+    } while (!pendingTasks_.compare_exchange_weak(next, task, std::memory_order_release,
+            std::memory_order_relaxed));
 // FIXME: some other feature flag?
 #if HAL_PLATFORM_SOCKET_IOCTL_NOTIFY
     SystemThread.notify();
@@ -118,44 +171,88 @@ void ISRTaskQueue::enqueue(Task* task) {
 }
 
 void ISRTaskQueue::remove(Task* task) {
-    ATOMIC_BLOCK() {
-        auto next = task->next;
-        auto prev = task->prev;
-        if (next) {
-            next->prev = prev;
-            task->next = nullptr;
-        } else if (lastTask_ == task) {
-            lastTask_ = prev;
+    for (;;) {
+        auto state = task->state.load(std::memory_order_acquire);
+        if (state == TaskState::PENDING) {
+            takePendingTasks();
+            state = task->state.load(std::memory_order_acquire);
+        }
+        if (state == TaskState::QUEUED) {
+            // Only the consumer can change the state of a queued task object
+            unlink(task);
+            task->state.store(TaskState::IDLE, std::memory_order_release);
+            return;
         }
-        if (prev) {
-            prev->next = next;
-            task->prev = nullptr;
-        } else if (firstTask_ == task) {
-            firstTask_ = next;
+        if (state != TaskState::PENDING) {
+            return; // Task object is not in the queue
         }
+        // The task object is still being added to the list of pending tasks by a producer that was
+        // preempted. Let the producer finish so that the caller can safely destroy the task object
+#if PLATFORM_THREADING
+        HAL_Delay_Milliseconds(1);
+#endif
     }
 }
 
 bool ISRTaskQueue::process() {
     if (!firstTask_) {
-        return false;
-    }
-    Task* task = nullptr;
-    ATOMIC_BLOCK() {
-        if (!firstTask_) {
+        if (!pendingTasks_.load(std::memory_order_relaxed)) {
             return false;
         }
-        // Take task object from the queue
-        task = firstTask_;
-        firstTask_ = task->next;
-        if (firstTask_) {
-            firstTask_->prev = nullptr;
-            task->next = nullptr;
-        } else {
-            lastTask_ = nullptr;
+        takePendingTasks();
+        if (!firstTask_) {
+            return false;
         }
     }
+    // Take task object from the queue
+    const auto task = firstTask_;
+    const auto func = task->func;
+    unlink(task);
+    // The task object can be added to the queue again from this point
+    task->state.store(TaskState::IDLE, std::memory_order_release);
     // Invoke task function
-    task->func(task);
+    func(task);
     return true;
 }
+
+void ISRTaskQueue::takePendingTasks() {
+    auto task = pendingTasks_.exchange(nullptr, std::memory_order_acquire);
+    // Restore the order in which the task objects were added
+    Task* first = nullptr;
+    while (task) {
+        const auto next = task->next;
+        task->next = first;
+        first = task;
+        task = next;
+    }
+    while (first) {
+        task = first;
+        first = task->next;
+        // Only the consumer can change the state of a pending task object
+        task->state.store(TaskState::QUEUED, std::memory_order_release);
+        // Add task object to the consumer's list
+        task->next = nullptr;
+        task->prev = lastTask_;
+        if (lastTask_) {
+            lastTask_->next = task;
+        } else {
+            firstTask_ = task;
+        }
+        lastTask_ = task;
+    }
+}
+
+void ISRTaskQueue::unlink(Task* task) {
+    if (task->prev) {
+        task->prev->next = task->next;
+    } else {
+        firstTask_ = task->next;
+    }
+    if (task->next) {
+        task->next->prev = task->prev;
+    } else {
+        lastTask_ = task->prev;
+    }
+    task->next = nullptr;
+    task->prev = nullptr;
+}
@@ -30,6 +30,7 @@
 #include "endian_util.h"
 #include "scope_guard.h"
 #include "system_cache.h"
+#include "system_describe_cache.h"
 #include "system_defs.h"
 #include "ota_module.h"
 
@@ -240,6 +241,7 @@ int AssetManager::parseRequiredAssets() {
     }
 
     requiredAssets_ = std::move(assets);
+    system::DescribeCache::instance()->invalidate(system::DescribeCache::SYSTEM);
     return 0;
 }
 
@@ -283,6 +285,7 @@ int AssetManager::parseAvailableAssets() {
     }
     
     availableAssets_ = assets;
+    system::DescribeCache::instance()->invalidate(system::DescribeCache::SYSTEM);
     return 0;
 }
 
@@ -415,7 +418,9 @@ AssetReader::AssetReader()
           size_(0),
           originalSize_(0),
           dataOffset_(0),
-          dataSize_(0) {
+          dataSize_(0),
+          seekIndexCount_(0),
+          seekIndexInterval_(0) {
 }
 
 int AssetReader::init(const char* filename) {
@@ -456,6 +461,7 @@ int AssetReader::validate(bool full) {
         CHECK_TRUE(compHeader.size >= sizeof(compHeader), SYSTEM_ERROR_BAD_DATA);
         CHECK_TRUE(compHeader.method == 0, SYSTEM_ERROR_BAD_DATA);
         origSize = compHeader.original_size;
+        CHECK(readSeekIndex(compHeader));
     }
     // Base suffix
     CHECK(stream_->seek(0));
@@ -491,6 +497,40 @@ int AssetReader::validate(bool full) {
     return 0;
 }
 
+int AssetReader::readSeekIndex(const compressed_module_header& header) {
+    seekIndex_.reset();
+    seekIndexCount_ = 0;
+    seekIndexInterval_ = 0;
+    if (header.size < sizeof(header) + sizeof(compressed_module_index)) {
+        return 0; // No index
+    }
+    CHECK(stream_->seek(sizeof(module_info_t) + sizeof(header)));
+    compressed_module_index index = {};
+    CHECK(stream_->read((char*)&index, sizeof(index)));
+    if (index.magic != COMPRESSED_MODULE_INDEX_MAGIC) {
+        return 0;
+    }
+    // The index is only an optimization: if it doesn't match the header or the size of the
+    // inflated data, ignore it and fall back to the sequential decompression
+    InflatorStream::Index idx = {};
+    idx.count = index.count;
+    idx.interval = index.interval;
+    if (!InflatorStream::isValidIndex(idx, header.original_size) ||
+            header.size < sizeof(header) + sizeof(index) + index.count * sizeof(uint32_t)) {
+        return 0;
+    }
+    std::unique_ptr<uint32_t[]> offsets(new(std::nothrow) uint32_t[index.count]);
+    if (!offsets) {
+        LOG(WARN, "Not enough memory for the seek index");
+        return 0;
+    }
+    CHECK(stream_->read((char*)offsets.get(), index.count * sizeof(uint32_t)));
+    seekIndex_ = std::move(offsets);
+    seekIndexCount_ = index.count;
+    seekIndexInterval_ = index.interval;
+    return 0;
+}
+
 int AssetReader::calculateCrc(uint32_t* crc) {
     size_t toRead = stream_->availForRead() - sizeof(uint32_t);
     char tmp[256];
@@ -541,7 +581,11 @@ int AssetReader::assetStream(InputStream*& stream) {
     if (!decompressorStream_) {
         auto stream = std::make_unique<InflatorStream>(proxyStream_.get(), originalSize_);
         CHECK_TRUE(stream, SYSTEM_ERROR_NO_MEMORY);
-        CHECK(stream->init());
+        InflatorStream::Index index = {};
+        index.offsets = seekIndex_.get();
+        index.count = seekIndexCount_;
+        index.interval = seekIndexInterval_;
+        CHECK(stream->init(&index));
         decompressorStream_ = std::move(stream);
     }
 
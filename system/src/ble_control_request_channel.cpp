@@ -28,21 +28,26 @@ LOG_SOURCE_CATEGORY("system.ctrl.ble")
 #include "timer_hal.h"
 #include "deviceid_hal.h"
 
-#include "sha256.h"
 #include "scope_guard.h"
 #include "endian_util.h"
 #include "check.h"
 #include "debug.h"
 
+#if BLE_CHANNEL_SECURITY_ENABLED
+#include "sha256.h"
+
 #include "mbedtls/ecjpake.h"
 #include "mbedtls/ccm.h"
 #include "mbedtls/md.h"
 
 #include "mbedtls_util.h"
+#endif // BLE_CHANNEL_SECURITY_ENABLED
 
 #include "ble_provisioning_mode_handler.h"
 #include "system_event.h"
 
+#include <algorithm>
+
 #undef DEBUG // Legacy logging macro
 
 #if BLE_CHANNEL_DEBUG_ENABLED
@@ -123,8 +128,15 @@ const hal_ble_uuid_t RECV_CHAR_UUID = {
     .reserved = {0}
 };
 
-// Size of the buffer pool
-const size_t BUFFER_POOL_SIZE = 1024;
+// Size of the buffer pool. Incoming packets are buffered in the pool until they are processed by
+// the system thread, so the pool needs to fit a number of packets of the maximum size
+const size_t BUFFER_POOL_SIZE = std::max<size_t>(BLE_MAX_ATTR_VALUE_PACKET_SIZE * 8, 1024);
+
+// Maximum number of notification packets sent in one iteration of the system loop
+const unsigned MAX_PACKETS_PER_RUN = 16;
+
+// Maximum time spent sending notification packets in one iteration of the system loop
+const system_tick_t MAX_SEND_TIME = 50;
 
 // Size of the message header
 const size_t MESSAGE_HEADER_SIZE = sizeof(MessageHeader);
@@ -186,6 +198,8 @@ const size_t MESSAGE_FOOTER_SIZE = 0;
 
 } // particle::system::
 
+#if BLE_CHANNEL_SECURITY_ENABLED
+
 class BleControlRequestChannel::HandshakeHandler {
 public:
     enum Result {
@@ -559,6 +573,8 @@ private:
     }
 };
 
+#endif // BLE_CHANNEL_SECURITY_ENABLED
+
 BleControlRequestChannel::BleControlRequestChannel(ControlRequestHandler* handler) :
         ControlRequestChannel(handler),
 #if BLE_CHANNEL_DEBUG_ENABLED
@@ -659,22 +675,25 @@ void BleControlRequestChannel::run() {
             }
         } else {
 #endif
-            // Serialize next reply and enqueue it for sending
-            ret = sendReply();
-            if (ret != 0) {
+            // Serialize all completed replies and enqueue them for sending
+            while ((ret = sendReply()) > 0) {
+            }
+            if (ret < 0) {
                 goto error;
             }
-            // Receive next request
-            ret = receiveRequest();
-            if (ret != 0) {
+            // Receive all complete requests. The client doesn't need to wait for a reply before
+            // sending the next request
+            while ((ret = receiveRequest()) > 0) {
+            }
+            if (ret < 0) {
                 goto error;
             }
 #if BLE_CHANNEL_SECURITY_ENABLED
         }
 #endif
-        // Send BLE notification packet
-        ret = sendPacket();
-        if (ret != 0) {
+        // Send BLE notification packets
+        ret = sendPackets();
+        if (ret < 0) {
             goto error;
         }
     }
@@ -742,7 +761,6 @@ void BleControlRequestChannel::setResult(ctrl_request* ctrlReq, int result, ctrl
     req->result = result;
     req->handler = handler;
     req->handlerData = data;
-    const std::lock_guard<Mutex> lock(readyReqsLock_);
     readyReqs_.pushBack(req);
 }
 
@@ -766,11 +784,9 @@ void BleControlRequestChannel::resetChannel() {
     aesCcm_.reset();
 #endif
     packetBuf_.reset();
-    std::unique_lock<Mutex> lock(readyReqsLock_);
     while (Request* req = readyReqs_.popFront()) {
         freeRequest(req);
     }
-    lock.unlock();
     while (Request* req = pendingReps_.popFront()) {
         freeRequest(req);
     }
@@ -825,11 +841,10 @@ int BleControlRequestChannel::receiveRequest() {
     curReq_ = nullptr;
     reqBufSize_ = 0;
     reqBufOffs_ = 0;
-    return 0;
+    return 1;
 }
 
 int BleControlRequestChannel::sendReply() {
-    std::unique_lock<Mutex> lock(readyReqsLock_);
     Request* req = nullptr;
     while ((req = readyReqs_.popFront())) {
         if (req->connId == connId_) {
@@ -837,7 +852,6 @@ int BleControlRequestChannel::sendReply() {
         }
         freeRequest(req);
     }
-    lock.unlock();
     if (!req) {
         return 0; // Nothing to send
     }
@@ -878,6 +892,17 @@ int BleControlRequestChannel::sendReply() {
         pendingReps_.pushBack(req);
         reqGuard.dismiss();
     }
+    return 1;
+}
+
+int BleControlRequestChannel::sendPackets() {
+    const auto t = hal_timer_millis(nullptr);
+    for (unsigned i = 0; i < MAX_PACKETS_PER_RUN; ++i) {
+        const int ret = CHECK(sendPacket());
+        if (ret == 0 || hal_timer_millis(nullptr) - t >= MAX_SEND_TIME) {
+            break;
+        }
+    }
     return 0;
 }
 
@@ -885,10 +910,27 @@ int BleControlRequestChannel::sendPacket() {
     if (!writable_) {
         return 0; // Can't send now
     }
-    // Prepare a BLE packet
     SPARK_ASSERT(packetBuf_);
     const size_t maxSize = maxPacketSize_;
-    Buffer* buf = nullptr;
+    Buffer* buf = outBufs_.front();
+    if (packetSize_ == 0 && buf && buf->size >= maxSize) {
+        // Send a full-size packet directly from the output buffer
+        const int ret = hal_ble_gatt_server_notify_characteristic_value(sendCharHandle_, (const uint8_t*)buf->data, maxSize, nullptr);
+        if (ret != (int)maxSize) {
+            LOG(ERROR, "hal_ble_gatt_server_notify_characteristic_value() failed: %d", ret);
+            return (ret < 0) ? ret : SYSTEM_ERROR_IO;
+        }
+        DEBUG("Sent BLE packet");
+        DEBUG_DUMP(buf->data, maxSize);
+        buf->data += maxSize;
+        buf->size -= maxSize;
+        if (buf->size == 0) {
+            outBufs_.popFront();
+            freeBuffer(buf);
+        }
+        return 1;
+    }
+    // Coalesce the remaining data of the output buffers into a single packet
     while (packetSize_ < maxSize && (buf = outBufs_.front())) {
         const size_t n = std::min(maxSize - packetSize_, buf->size);
         memcpy(packetBuf_.get() + packetSize_, buf->data, n);
@@ -915,12 +957,12 @@ int BleControlRequestChannel::sendPacket() {
     const int ret = hal_ble_gatt_server_notify_characteristic_value(sendCharHandle_, (const uint8_t*)packetBuf_.get(), packetSize_, nullptr);
     if (ret != (int)packetSize_) {
         LOG(ERROR, "hal_ble_gatt_server_notify_characteristic_value() failed: %d", ret);
-        return ret;
+        return (ret < 0) ? ret : SYSTEM_ERROR_IO;
     }
     DEBUG("Sent BLE packet");
     DEBUG_DUMP(packetBuf_.get(), packetSize_);
     packetSize_ = 0;
-    return 0;
+    return 1;
 }
 
 bool BleControlRequestChannel::readAll(char* data, size_t size) {
@@ -1000,7 +1042,8 @@ int BleControlRequestChannel::disconnected(const hal_ble_link_evt_t& event) {
 
 int BleControlRequestChannel::gattParamChanged(const hal_ble_link_evt_t& event) {
     if (event.conn_handle == curConnHandle_) {
-        maxPacketSize_ = event.params.att_mtu_updated.att_mtu_size - BLE_ATT_OPCODE_SIZE - BLE_ATT_HANDLE_SIZE;
+        maxPacketSize_ = std::min<size_t>(event.params.att_mtu_updated.att_mtu_size - BLE_ATT_OPCODE_SIZE - BLE_ATT_HANDLE_SIZE,
+                BLE_MAX_ATTR_VALUE_PACKET_SIZE);
         DEBUG("maxPacketSize_: %d", maxPacketSize_);
     }
     return 0;
@@ -29,8 +29,6 @@
 
 #include "ble_hal.h"
 
-#include "spark_wiring_thread.h"
-
 #include <memory>
 #include <atomic>
 
@@ -98,9 +96,8 @@ private:
     std::atomic<unsigned> heapBufCount_;
     std::atomic<unsigned> poolBufCount_;
 #endif
-    IntrusiveQueue<Request> readyReqs_; // Completed requests
+    AtomicIntrusiveQueue<Request> readyReqs_; // Completed requests
     IntrusiveQueue<Request> pendingReps_; // Pending completion handlers
-    Mutex readyReqsLock_;
 
     AtomicIntrusiveQueue<Buffer> inBufs_; // Packets received from the client (input buffers)
     IntrusiveQueue<Buffer> outBufs_; // Packets to be sent to the client (output buffers)
@@ -146,6 +143,7 @@ private:
 
     int receiveRequest();
     int sendReply();
+    int sendPackets();
     int sendPacket();
 
     bool readAll(char* data, size_t size);
@@ -24,6 +24,7 @@ LOG_SOURCE_CATEGORY("system.ota");
 #include "system_task.h"
 #include "system_event.h"
 #include "system_led_signal.h"
+#include "system_describe_cache.h"
 
 #include "ota_flash_hal.h"
 
@@ -216,6 +217,8 @@ int FirmwareUpdate::finishUpdate(FirmwareUpdateFlags flags) {
             if (r >= 0) {
                 // TODO: Cache the validation result so that it's not performed twice
                 r = HAL_FLASH_End(nullptr /* reserved */);
+                // The update may have replaced firmware modules or assets
+                DescribeCache::instance()->invalidate(DescribeCache::SYSTEM);
             }
             endUpdate(r >= 0);
             if (r < 0) {
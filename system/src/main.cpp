@@ -32,6 +32,7 @@
 #define NO_STATIC_ASSERT
 
 #include <cmath>
+#include <limits>
 
 #include "debug.h"
 #include "system_event.h"
@@ -45,6 +46,8 @@
 #include "system_threading.h"
 #include "system_user.h"
 #include "system_update.h"
+#include "system_loop_profiler.h"
+#include "message_pool.h"
 #include "core_hal.h"
 #include "delay_hal.h"
 #include "syshealth_hal.h"
@@ -110,6 +113,8 @@
 
 using namespace spark;
 using namespace particle;
+using particle::system::LoopProfiler;
+using particle::system::LoopProfilerScope;
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -501,7 +506,10 @@ void app_loop(bool threaded)
             //Execute user application loop
             DECLARE_SYS_HEALTH(ENTERED_Loop);
             if (system_mode()!=SAFE_MODE) {
-                loop();
+                {
+                    LoopProfilerScope scope(LoopProfiler::APP_LOOP);
+                    loop();
+                }
                 DECLARE_SYS_HEALTH(RAN_Loop);
 #if !(defined(MODULAR_FIRMWARE) && MODULAR_FIRMWARE)
                 _post_loop();
@@ -627,6 +635,45 @@ public:
     }
 };
 
+class LoopLatencyDiagnosticData: public AbstractHistogramDiagnosticData {
+public:
+    LoopLatencyDiagnosticData() :
+            AbstractHistogramDiagnosticData(DIAG_ID_SYSTEM_LOOP_LATENCY_HISTOGRAM, DIAG_NAME_SYSTEM_LOOP_LATENCY_HISTOGRAM) {
+    }
+
+    virtual int get(DiagnosticHistogram& hist) override {
+        // The histogram is empty unless the loop profiler is enabled
+        const auto profiler = LoopProfiler::instance();
+        LoopProfiler::Stats stats = {};
+        profiler->getStats(LoopProfiler::SYSTEM_LOOP, &stats);
+        hist.info.size = sizeof(diag_histogram);
+        hist.info.sub_bucket_bits = LoopProfiler::SUB_BUCKET_BITS;
+        hist.info.bucket_count = LoopProfiler::BUCKET_COUNT;
+        hist.info.count = profiler->getHistogram(LoopProfiler::SYSTEM_LOOP, hist.buckets);
+        hist.info.sum = stats.total;
+        hist.info.min = stats.count ? stats.min : std::numeric_limits<uint32_t>::max();
+        hist.info.max = stats.max;
+        return 0; // OK
+    }
+};
+
+class MessagePoolDiagnosticData: public AbstractUnsignedIntegerDiagnosticData {
+public:
+    typedef IntType(*func_t)(const MessagePool&);
+    MessagePoolDiagnosticData(uint16_t id, const char* name, func_t f) :
+            AbstractUnsignedIntegerDiagnosticData(id, name),
+            f_(f) {
+    }
+
+    virtual int get(IntType& val) override {
+        val = f_(*MessagePool::instance());
+        return 0; // OK
+    }
+
+private:
+    func_t f_;
+};
+
 class RunTimeInfoDiagnosticData: public AbstractIntegerDiagnosticData {
 public:
     typedef IntType(*func_t)(const runtime_info_t&);
@@ -699,6 +746,22 @@ HALEventHandler g_halEventHandler;
 
 UptimeDiagnosticData g_uptimeDiagData;
 
+LoopLatencyDiagnosticData g_loopLatencyDiagData;
+
+MessagePoolDiagnosticData g_messagePoolMaxUsedDiagData(DIAG_ID_SYSTEM_MESSAGE_POOL_MAX_USED,
+    DIAG_NAME_SYSTEM_MESSAGE_POOL_MAX_USED,
+    [](const MessagePool& pool) -> MessagePoolDiagnosticData::IntType {
+        return pool.maxUsedBlocks();
+    }
+);
+
+MessagePoolDiagnosticData g_messagePoolHeapAllocsDiagData(DIAG_ID_SYSTEM_MESSAGE_POOL_HEAP_ALLOCATIONS,
+    DIAG_NAME_SYSTEM_MESSAGE_POOL_HEAP_ALLOCATIONS,
+    [](const MessagePool& pool) -> MessagePoolDiagnosticData::IntType {
+        return pool.heapAllocations();
+    }
+);
+
 RunTimeInfoDiagnosticData g_totalRamDiagData(DIAG_ID_SYSTEM_TOTAL_RAM, DIAG_NAME_SYSTEM_TOTAL_RAM,
     [](const runtime_info_t& info) -> RunTimeInfoDiagnosticData::IntType {
         return info.total_init_heap;
@@ -843,6 +906,8 @@ void app_setup_and_loop(void)
 #endif // HAL_PLATFORM_LEDGER
 
 #if PLATFORM_THREADING
+    SystemThread.setProfilerStage(LoopProfiler::SYSTEM_TASK);
+    ApplicationThread.setProfilerStage(LoopProfiler::APP_TASK);
     if (threaded)
     {
         SystemThread.start();
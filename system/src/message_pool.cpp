@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "message_pool.h"
+
+#include <new>
+
+namespace particle {
+
+namespace {
+
+// Constant-initialized so that it can be used by global constructors
+MessagePool g_messagePool;
+
+} // namespace
+
+void* MessagePool::alloc(size_t size) {
+    if (size <= BLOCK_SIZE) {
+        // Take the first free block
+        auto mask = freeMask_.load(std::memory_order_relaxed);
+        while (mask) {
+            const uint32_t bit = mask & ~(mask - 1);
+            if (freeMask_.compare_exchange_weak(mask, mask & ~bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                const auto used = used_.fetch_add(1, std::memory_order_relaxed) + 1;
+                auto maxUsed = maxUsed_.load(std::memory_order_relaxed);
+                while (used > maxUsed && !maxUsed_.compare_exchange_weak(maxUsed, used, std::memory_order_relaxed)) {
+                }
+                return blocks_[__builtin_ctz(bit)];
+            }
+        }
+    }
+    heapAllocs_.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(size, std::nothrow);
+}
+
+void MessagePool::free(void* ptr) {
+    const auto p = static_cast<uint8_t*>(ptr);
+    if (p >= blocks_[0] && p < blocks_[0] + sizeof(blocks_)) {
+        const unsigned index = (p - blocks_[0]) / BLOCK_SIZE;
+        used_.fetch_sub(1, std::memory_order_relaxed);
+        freeMask_.fetch_or((uint32_t)1 << index, std::memory_order_release);
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+MessagePool* MessagePool::instance() {
+    return &g_messagePool;
+}
+
+} // namespace particle
@@ -38,6 +38,15 @@ namespace {
 
 uint16_t cloud_udp_port = PORT_COAPS; // default Particle Cloud UDP port
 
+// Server address and connection data loaded ahead of a connection attempt
+struct PreparedConnection {
+    ServerAddress server_addr;
+    bool udp;
+    bool valid;
+};
+
+PreparedConnection s_prepared = {};
+
 } /* anonymous */
 
 /* FIXME: */
@@ -128,11 +137,11 @@ int SessionConnection::save(const ServerAddress& addr)
 
 #endif /* HAL_PLATFORM_CLOUD_UDP */
 
-// Same return value as connect(), -1 on error
-int spark_cloud_socket_connect()
-{
-    system_cloud_disconnect(false);
+namespace {
 
+// Returns true if the cloud connection uses UDP
+bool read_server_address(ServerAddress* server_addr, bool log)
+{
 #if HAL_PLATFORM_CLOUD_UDP
     const bool udp = HAL_Feature_Get(FEATURE_CLOUD_UDP);
 #else
@@ -144,29 +153,74 @@ int spark_cloud_socket_connect()
         port = cloud_udp_port;
     }
 
-    ServerAddress server_addr = {};
-    HAL_FLASH_Read_ServerAddress(&server_addr);
-    switch (server_addr.addr_type)
-    {
-        case IP_ADDRESS:
-            LOG(INFO,"Read Server Address = type:%d,domain:%s,ip: %d.%d.%d.%d, port: %d", server_addr.addr_type, server_addr.domain, IPNUM(server_addr.ip), server_addr.port);
-            break;
-
-        case DOMAIN_NAME:
-            LOG(INFO,"Read Server Address = type:%d,domain:%s", server_addr.addr_type, server_addr.domain);
-            break;
+    *server_addr = {};
+    HAL_FLASH_Read_ServerAddress(server_addr);
+    if (log) {
+        switch (server_addr->addr_type)
+        {
+            case IP_ADDRESS:
+                LOG(INFO,"Read Server Address = type:%d,domain:%s,ip: %d.%d.%d.%d, port: %d", server_addr->addr_type, server_addr->domain, IPNUM(server_addr->ip), server_addr->port);
+                break;
+
+            case DOMAIN_NAME:
+                LOG(INFO,"Read Server Address = type:%d,domain:%s", server_addr->addr_type, server_addr->domain);
+                break;
+
+            default:
+                LOG(WARN,"Read Server Address = type:%d,defaulting to device.spark.io", server_addr->addr_type);
+        }
+    }
 
-        default:
-            LOG(WARN,"Read Server Address = type:%d,defaulting to device.spark.io", server_addr.addr_type);
+    if (server_addr->port == 0 || server_addr->port == 0xffff || (udp && port != server_addr->port)) {
+        server_addr->port = port;
     }
+    return udp;
+}
+
+} /* anonymous */
 
-    if (server_addr.port == 0 || server_addr.port == 0xffff || (udp && port != server_addr.port)) {
-        server_addr.port = port;
+int spark_cloud_socket_prepare()
+{
+    if (!s_prepared.valid) {
+        s_prepared.udp = read_server_address(&s_prepared.server_addr, false /* log */);
+#if HAL_PLATFORM_CLOUD_UDP
+        g_system_cloud_session_data.load(s_prepared.server_addr);
+#endif /* HAL_PLATFORM_CLOUD_UDP */
+        s_prepared.valid = true;
     }
 
+    return system_cloud_prepare(s_prepared.udp ? IPPROTO_UDP : IPPROTO_TCP, &s_prepared.server_addr,
+#if HAL_PLATFORM_CLOUD_UDP
+                                (sockaddr*)&g_system_cloud_session_data.address);
+#else
+                                nullptr);
+#endif /* HAL_PLATFORM_CLOUD_UDP */
+}
+
+void spark_cloud_socket_discard_prepared()
+{
+    s_prepared.valid = false;
+    system_cloud_discard_prepared();
+}
+
+// Same return value as connect(), -1 on error
+int spark_cloud_socket_connect()
+{
+    system_cloud_disconnect(false);
+
+    // The server settings may have changed since the connection was prepared, e.g. via a control
+    // request or spark_cloud_udp_port_set(), so they are always read again. The prepared session
+    // data is only reused if it was loaded for the same settings
+    ServerAddress server_addr = {};
+    const bool udp = read_server_address(&server_addr, true /* log */);
+    if (!s_prepared.valid || s_prepared.udp != udp ||
+            memcmp(&s_prepared.server_addr, &server_addr, sizeof(server_addr)) != 0) {
 #if HAL_PLATFORM_CLOUD_UDP
-    g_system_cloud_session_data.load(server_addr);
+        g_system_cloud_session_data.load(server_addr);
 #endif /* HAL_PLATFORM_CLOUD_UDP */
+    }
+    // The prepared data is only used for a single connection attempt
+    s_prepared.valid = false;
 
     int r = system_cloud_connect(udp ? IPPROTO_UDP : IPPROTO_TCP, &server_addr,
 #if HAL_PLATFORM_CLOUD_UDP
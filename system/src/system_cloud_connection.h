@@ -43,6 +43,14 @@ typedef enum CloudServerAddressType {
     CLOUD_SERVER_ADDRESS_TYPE_NEW_ADDRINFO    = 3
 } CloudServerAddressType;
 
+/**
+ * Resolve the server address and create the cloud socket ahead of a connection attempt.
+ *
+ * Does nothing until the network is ready. The prepared data is used by the next call to
+ * `system_cloud_connect()` with the same arguments.
+ */
+int system_cloud_prepare(int protocol, const ServerAddress* address, sockaddr* saddrCache);
+void system_cloud_discard_prepared(void);
 int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* saddrCache);
 int system_cloud_disconnect(int flags);
 int system_cloud_send(const uint8_t* buf, size_t buflen, int flags);
@@ -68,6 +76,18 @@ int system_cloud_resolv_address(int protocol, const ServerAddress* address, sock
  */
 void spark_cloud_udp_port_set(uint16_t port);
 uint16_t spark_cloud_udp_port_get();
+/**
+ * Load the server address and the cached connection data ahead of a connection attempt, and
+ * resolve the server address and create the socket once the network is ready.
+ *
+ * The data is prepared once and used by the next call to `spark_cloud_socket_connect()`, unless
+ * the server settings have changed in the meantime.
+ */
+int spark_cloud_socket_prepare(void);
+/**
+ * Discard the data prepared by `spark_cloud_socket_prepare()`.
+ */
+void spark_cloud_socket_discard_prepared(void);
 int spark_cloud_socket_connect(void);
 int spark_cloud_socket_disconnect(bool graceful=true);
 uint8_t spark_cloud_socket_closed();
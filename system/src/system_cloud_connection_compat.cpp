@@ -33,6 +33,7 @@
 #include "system_string_interpolate.h"
 #include "endian_util.h"
 #include "simple_ntp_client.h"
+#include "system_cloud_connection_timer.h"
 
 namespace {
 
@@ -63,6 +64,16 @@ const unsigned CLOUD_DOMAIN_RESOLVE_ATTEMPTS = 3;
 
 } /* anonymous */
 
+int system_cloud_prepare(int protocol, const ServerAddress* address, sockaddr* saddrCache)
+{
+    /* The server address is resolved when connecting */
+    return 0;
+}
+
+void system_cloud_discard_prepared()
+{
+}
+
 int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* saddrCache)
 {
     sockaddr_t saddr = {};
@@ -109,6 +120,8 @@ int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* s
         LOG(ERROR, "Failed to determine server address");
         return SYSTEM_ERROR_NETWORK;
     }
+    particle::system::CloudConnectionTimer::instance()->phaseDone(particle::system::CloudConnectionTimer::RESOLVE,
+            HAL_Timer_Get_Milli_Seconds());
 
     uint16_t dport = particle::bigEndianToNative(*((uint16_t*)saddr.sa_data));
 
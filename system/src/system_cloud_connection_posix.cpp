@@ -32,6 +32,9 @@
 #include "system_mode.h"
 #endif // HAL_PLATFORM_SOCKET_IOCTL_NOTIFY
 #include "simple_ntp_client.h"
+#include "system_cloud_connection_timer.h"
+#include "system_network.h"
+#include "timer_hal.h"
 
 namespace {
 
@@ -41,12 +44,75 @@ struct SystemCloudState {
     struct addrinfo* next = nullptr;
 };
 
+// Server address resolved and socket created ahead of a connection attempt
+struct PreparedConnection {
+    ServerAddress address = {};
+    sockaddr_storage saddrCache = {};
+    struct addrinfo* info = nullptr;
+    CloudServerAddressType type = CLOUD_SERVER_ADDRESS_TYPE_NONE;
+    int protocol = 0;
+    int socket = -1;
+    bool done = false;
+};
+
 SystemCloudState s_state;
+PreparedConnection s_prepared;
 
 const unsigned CLOUD_SOCKET_HALF_CLOSED_WAIT_TIMEOUT = 5000;
 
+void discardPreparedConnection() {
+    if (s_prepared.socket >= 0) {
+        sock_close(s_prepared.socket);
+    }
+    /* The cached addrinfo list is owned by s_state */
+    if (s_prepared.info && s_prepared.type != CLOUD_SERVER_ADDRESS_TYPE_CACHED_ADDRINFO) {
+        netdb_freeaddrinfo(s_prepared.info);
+    }
+    s_prepared = PreparedConnection();
+}
+
+bool isPreparedConnection(int protocol, const ServerAddress* address, const sockaddr* saddrCache) {
+    sockaddr_storage cache = {};
+    if (saddrCache) {
+        memcpy(&cache, saddrCache, sizeof(cache));
+    }
+    return s_prepared.done && s_prepared.protocol == protocol && address &&
+            !memcmp(&s_prepared.address, address, sizeof(ServerAddress)) &&
+            !memcmp(&s_prepared.saddrCache, &cache, sizeof(cache));
+}
+
 } /* anonymous */
 
+int system_cloud_prepare(int protocol, const ServerAddress* address, sockaddr* saddrCache)
+{
+    if (!network_ready(0, 0, nullptr)) {
+        /* The resolved addresses and the socket may not be usable with the next network connection */
+        system_cloud_discard_prepared();
+        return 0;
+    }
+    if (s_state.socket >= 0 || isPreparedConnection(protocol, address, saddrCache)) {
+        return 0;
+    }
+    discardPreparedConnection();
+    /* Resolution is attempted only once per connection attempt, even if it fails */
+    s_prepared.done = true;
+    s_prepared.protocol = protocol;
+    s_prepared.address = *address;
+    if (saddrCache) {
+        memcpy(&s_prepared.saddrCache, saddrCache, sizeof(s_prepared.saddrCache));
+    }
+    CHECK(system_cloud_resolv_address(protocol, address, saddrCache, &s_prepared.info, &s_prepared.type,
+            true /* useCachedAddrInfo */));
+    particle::system::CloudConnectionTimer::instance()->phaseDone(particle::system::CloudConnectionTimer::RESOLVE,
+            HAL_Timer_Get_Milli_Seconds());
+    const auto a = s_prepared.info;
+    s_prepared.socket = sock_socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (s_prepared.socket < 0) {
+        LOG(WARN, "Cloud socket failed, family=%d, type=%d, protocol=%d, errno=%d", a->ai_family, a->ai_socktype, a->ai_protocol, errno);
+    }
+    return 0;
+}
+
 int system_cloud_resolv_address(int protocol, const ServerAddress* address, sockaddr* saddrCache, addrinfo** info, CloudServerAddressType* type, bool useCachedAddrInfo) {
     CHECK_TRUE(info, SYSTEM_ERROR_INVALID_ARGUMENT);
 
@@ -133,13 +199,34 @@ int system_cloud_resolv_address(int protocol, const ServerAddress* address, sock
     return 0;
 }
 
+void system_cloud_discard_prepared()
+{
+    if (s_prepared.done) {
+        discardPreparedConnection();
+    }
+}
+
 int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* saddrCache)
 {
     struct addrinfo* info = nullptr;
     CloudServerAddressType type = CLOUD_SERVER_ADDRESS_TYPE_NONE;
     bool clean = true;
-
-    system_cloud_resolv_address(protocol, address, saddrCache, &info, &type, true /* useCachedAddrInfo */);
+    int preparedSocket = -1;
+
+    if (isPreparedConnection(protocol, address, saddrCache) && s_prepared.info) {
+        /* Use the address resolved and the socket created ahead of time */
+        info = s_prepared.info;
+        type = s_prepared.type;
+        preparedSocket = s_prepared.socket;
+        s_prepared.info = nullptr;
+        s_prepared.socket = -1;
+    } else {
+        system_cloud_resolv_address(protocol, address, saddrCache, &info, &type, true /* useCachedAddrInfo */);
+    }
+    /* The prepared data is only used for a single connection attempt */
+    discardPreparedConnection();
+    particle::system::CloudConnectionTimer::instance()->phaseDone(particle::system::CloudConnectionTimer::RESOLVE,
+            HAL_Timer_Get_Milli_Seconds());
 
     int r = SYSTEM_ERROR_NETWORK;
 
@@ -148,7 +235,11 @@ int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* s
     for (struct addrinfo* a = info; a != nullptr; a = a->ai_next) {
         /* Iterate over all the addresses and attempt to connect */
 
-        int s = sock_socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        int s = preparedSocket;
+        preparedSocket = -1;
+        if (s < 0) {
+            s = sock_socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        }
         if (s < 0) {
             LOG(ERROR, "Cloud socket failed, family=%d, type=%d, protocol=%d, errno=%d", a->ai_family, a->ai_socktype, a->ai_protocol, errno);
             continue;
@@ -332,6 +423,7 @@ int system_cloud_send(const uint8_t* buf, size_t buflen, int flags)
             r = 0;
         } else {
             LOG(ERROR, "sock_send returned %d %d", r, errno);
+            particle::system::ConnectionManager::instance()->reportCloudSocketError();
         }
     }
 
@@ -351,6 +443,7 @@ int system_cloud_recv(uint8_t* buf, size_t buflen, int flags)
             recvd = 0;
         } else {
             LOG(ERROR, "sock_recv returned %d %d", recvd, errno);
+            particle::system::ConnectionManager::instance()->reportCloudSocketError();
         }
     }
 
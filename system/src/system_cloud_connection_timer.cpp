@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_cloud_connection_timer.h"
+
+#include "system_error.h"
+
+#include <cstdio>
+
+namespace particle { namespace system {
+
+namespace {
+
+const char* const PHASE_NAMES[] = {
+    "network",
+    "resolve",
+    "socket",
+    "handshake",
+    "session"
+};
+
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == CloudConnectionTimer::PHASE_COUNT,
+        "Invalid number of phase names");
+
+} // namespace
+
+CloudConnectionTimer::CloudConnectionTimer() :
+        startTime_(0),
+        phaseTime_(),
+        duration_(),
+        totalDuration_(0),
+        donePhases_(0),
+        running_(false) {
+}
+
+void CloudConnectionTimer::start(system_tick_t now) {
+    if (running_) {
+        return;
+    }
+    startTime_ = now;
+    donePhases_ = 0;
+    running_ = true;
+}
+
+void CloudConnectionTimer::phaseDone(Phase phase, system_tick_t now) {
+    if (!running_ || (donePhases_ & (1 << phase))) {
+        return;
+    }
+    phaseTime_[phase] = now;
+    donePhases_ |= (1 << phase);
+}
+
+bool CloudConnectionTimer::finish(system_tick_t now) {
+    if (!running_) {
+        return false;
+    }
+    phaseDone(SESSION, now);
+    // Phases that were not reached, or were reached out of order, are accounted as having taken no time.
+    // The times are compared relative to the start time to handle the wrap-around of the tick counter
+    system_tick_t prevTime = startTime_;
+    for (unsigned i = 0; i < PHASE_COUNT; ++i) {
+        duration_[i] = 0;
+        if ((donePhases_ & (1 << i)) && phaseTime_[i] - startTime_ >= prevTime - startTime_) {
+            duration_[i] = phaseTime_[i] - prevTime;
+            prevTime = phaseTime_[i];
+        }
+    }
+    totalDuration_ = now - startTime_;
+    running_ = false;
+    return true;
+}
+
+void CloudConnectionTimer::cancel() {
+    running_ = false;
+}
+
+int CloudConnectionTimer::format(char* buf, size_t size) const {
+    size_t len = 0;
+    for (unsigned i = 0; i < PHASE_COUNT; ++i) {
+        const int n = snprintf((len < size) ? buf + len : nullptr, (len < size) ? size - len : 0, "%s%s: %u ms", i ? ", " : "",
+                PHASE_NAMES[i], (unsigned)duration_[i]);
+        if (n < 0) {
+            return SYSTEM_ERROR_INTERNAL;
+        }
+        len += n;
+    }
+    return len;
+}
+
+const char* CloudConnectionTimer::phaseName(Phase phase) {
+    if (phase < 0 || phase >= PHASE_COUNT) {
+        return nullptr;
+    }
+    return PHASE_NAMES[phase];
+}
+
+CloudConnectionTimer* CloudConnectionTimer::instance() {
+    static CloudConnectionTimer timer;
+    return &timer;
+}
+
+} } /* particle::system */
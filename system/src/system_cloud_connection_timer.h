@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_tick_hal.h"
+
+#include <cstddef>
+
+namespace particle { namespace system {
+
+/**
+ * Measures the time it takes to connect to the cloud, broken down by the phases of the connection
+ * bring-up.
+ *
+ * A measurement starts when the cloud connection is requested and ends when the device is
+ * connected to the cloud. The end of each phase is recorded as it is reached. Phases that were
+ * not reached, e.g. because the network was already up, are reported as having taken no time.
+ *
+ * The class is not thread-safe.
+ */
+class CloudConnectionTimer {
+public:
+    /**
+     * Connection phase.
+     */
+    enum Phase {
+        NETWORK = 0, ///< Waiting for the network to come up.
+        RESOLVE = 1, ///< Determining the server address.
+        SOCKET = 2, ///< Connecting the socket.
+        HANDSHAKE = 3, ///< Performing the DTLS handshake and sending the Hello message.
+        SESSION = 4, ///< Waiting for the server to confirm the session.
+        PHASE_COUNT = 5
+    };
+
+    CloudConnectionTimer();
+
+    /**
+     * Start a measurement.
+     *
+     * Does nothing if a measurement is already in progress.
+     *
+     * @param now Current time.
+     */
+    void start(system_tick_t now);
+
+    /**
+     * Record the end of a phase.
+     *
+     * Does nothing if no measurement is in progress or the end of the phase has already been
+     * recorded.
+     *
+     * @param phase Phase.
+     * @param now Current time.
+     */
+    void phaseDone(Phase phase, system_tick_t now);
+
+    /**
+     * Finish the measurement.
+     *
+     * The results of the measurement are available until a new measurement is started.
+     *
+     * @param now Current time.
+     * @return `true` if a measurement was in progress, otherwise `false`.
+     */
+    bool finish(system_tick_t now);
+
+    /**
+     * Cancel the measurement.
+     */
+    void cancel();
+
+    /**
+     * Check if a measurement is in progress.
+     */
+    bool isRunning() const;
+
+    /**
+     * Get the duration of a phase of the last finished measurement.
+     *
+     * @param phase Phase.
+     * @return Duration in milliseconds.
+     */
+    system_tick_t duration(Phase phase) const;
+
+    /**
+     * Get the total duration of the last finished measurement.
+     *
+     * @return Duration in milliseconds.
+     */
+    system_tick_t totalDuration() const;
+
+    /**
+     * Format the results of the last finished measurement as a string.
+     *
+     * @param buf Destination buffer.
+     * @param size Buffer size.
+     * @return Length of the formatted string, or a negative result code defined by `system_error_t`.
+     */
+    int format(char* buf, size_t size) const;
+
+    /**
+     * Get the name of a phase.
+     */
+    static const char* phaseName(Phase phase);
+
+    static CloudConnectionTimer* instance();
+
+private:
+    system_tick_t startTime_; // Time when the measurement started
+    system_tick_t phaseTime_[PHASE_COUNT]; // Time when each phase ended
+    system_tick_t duration_[PHASE_COUNT]; // Durations of the phases of the last measurement
+    system_tick_t totalDuration_; // Total duration of the last measurement
+    unsigned donePhases_; // Bitmask of the phases that have ended
+    bool running_;
+};
+
+inline bool CloudConnectionTimer::isRunning() const {
+    return running_;
+}
+
+inline system_tick_t CloudConnectionTimer::duration(Phase phase) const {
+    return duration_[phase];
+}
+
+inline system_tick_t CloudConnectionTimer::totalDuration() const {
+    return totalDuration_;
+}
+
+} } /* particle::system */
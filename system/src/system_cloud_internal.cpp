@@ -24,6 +24,7 @@
 #include "spark_wiring_ipaddress.h"
 #include "spark_wiring_led.h"
 #include "spark_wiring_vector.h"
+#include "name_index.h"
 #include "system_cloud_internal.h"
 #include "system_mode.h"
 #include "system_task.h"
@@ -59,6 +60,8 @@
 #endif // HAL_PLATFORM_MUXER_MAY_NEED_DELAY_IN_TX
 #include "system_version.h"
 #include "firmware_update.h"
+#include "system_diag_delta.h"
+#include "system_describe_cache.h"
 #include "server_config.h"
 
 #if HAL_PLATFORM_ASSETS
@@ -102,6 +105,10 @@ constexpr const char UPDATES_PENDING_EVENT[] = "pending";
 Vector<User_Var_Lookup_Table_t> g_cloudVars;
 Vector<User_Func_Lookup_Table_t> g_cloudFuncs;
 
+// Name indices for the registered variables and functions
+NameIndex g_cloudVarIndex(USER_VAR_KEY_LENGTH);
+NameIndex g_cloudFuncIndex(USER_FUNC_KEY_LENGTH);
+
 inline bool isSuffix(const char* eventName, const char* prefix, const char* suffix) {
     // todo - sanity check parameters?
     return !strncmp(eventName+strlen(prefix), suffix, strlen(eventName)-strlen(prefix));
@@ -291,12 +298,13 @@ ProtocolFacade* system_cloud_protocol_instance(void)
 
 User_Var_Lookup_Table_t* find_var_by_key(const char* varKey)
 {
-    for (auto& var: g_cloudVars) {
-        if (strncmp(var.userVarKey, varKey, USER_VAR_KEY_LENGTH) == 0) {
-            return &var;
-        }
+    const int index = g_cloudVarIndex.find(varKey, [varKey](size_t i) {
+        return strncmp(g_cloudVars.at(i).userVarKey, varKey, USER_VAR_KEY_LENGTH) == 0;
+    });
+    if (index < 0) {
+        return nullptr;
     }
-    return nullptr;
+    return &g_cloudVars.at(index);
 }
 
 User_Var_Lookup_Table_t* find_var_by_key_or_add(const char* varKey, const void* userVar, Spark_Data_TypeDef userVarType, spark_variable_t* extra)
@@ -309,15 +317,24 @@ User_Var_Lookup_Table_t* find_var_by_key_or_add(const char* varKey, const void*
         if (offsetof(spark_variable_t, copy) + sizeof(spark_variable_t::copy) <= extra->size) {
             item.copy = extra->copy;
         }
+        if (offsetof(spark_variable_t, read) + sizeof(spark_variable_t::read) <= extra->size) {
+            item.read = extra->read;
+        }
     }
     memcpy(item.userVarKey, varKey, std::min<size_t>(strlen(varKey), USER_VAR_KEY_LENGTH));
 
     User_Var_Lookup_Table_t* result = find_var_by_key(varKey);
     if (result) {
+        if (result->userVarType != item.userVarType) {
+            DescribeCache::instance()->invalidate(DescribeCache::APP);
+        }
         *result = item;
     } else if ((size_t)g_cloudVars.size() < USER_VAR_MAX_COUNT) {
-        if (g_cloudVars.append(std::move(item))) {
+        // Reserve the table entry first so that the index never refers to a missing entry
+        if (g_cloudVars.reserve(g_cloudVars.size() + 1) && g_cloudVarIndex.insert(varKey, g_cloudVars.size())) {
+            g_cloudVars.append(std::move(item));
             result = &g_cloudVars.last();
+            DescribeCache::instance()->invalidate(DescribeCache::APP);
         } else {
             LOG(ERROR, "Memory allocation error");
         }
@@ -329,12 +346,13 @@ User_Var_Lookup_Table_t* find_var_by_key_or_add(const char* varKey, const void*
 
 User_Func_Lookup_Table_t* find_func_by_key(const char* funcKey)
 {
-    for (auto& func: g_cloudFuncs) {
-        if (strncmp(func.userFuncKey, funcKey, USER_FUNC_KEY_LENGTH) == 0) {
-            return &func;
-        }
+    const int index = g_cloudFuncIndex.find(funcKey, [funcKey](size_t i) {
+        return strncmp(g_cloudFuncs.at(i).userFuncKey, funcKey, USER_FUNC_KEY_LENGTH) == 0;
+    });
+    if (index < 0) {
+        return nullptr;
     }
-    return nullptr;
+    return &g_cloudFuncs.at(index);
 }
 
 User_Func_Lookup_Table_t* find_func_by_key_or_add(const char* funcKey, const cloud_function_descriptor* desc)
@@ -348,8 +366,11 @@ User_Func_Lookup_Table_t* find_func_by_key_or_add(const char* funcKey, const clo
     if (result) {
         *result = item;
     } else if ((size_t)g_cloudFuncs.size() < USER_FUNC_MAX_COUNT) {
-        if (g_cloudFuncs.append(std::move(item))) {
+        // Reserve the table entry first so that the index never refers to a missing entry
+        if (g_cloudFuncs.reserve(g_cloudFuncs.size() + 1) && g_cloudFuncIndex.insert(funcKey, g_cloudFuncs.size())) {
+            g_cloudFuncs.append(std::move(item));
             result = &g_cloudFuncs.last();
+            DescribeCache::instance()->invalidate(DescribeCache::APP);
         } else {
             LOG(ERROR, "Memory allocation error");
         }
@@ -435,6 +456,26 @@ uint32_t compute_describe_system_checksum()
     return checksum;
 }
 
+uint32_t cached_describe_app_checksum()
+{
+    return DescribeCache::instance()->checksum(DescribeCache::APP, compute_describe_app_checksum);
+}
+
+uint32_t cached_describe_system_checksum()
+{
+    return DescribeCache::instance()->checksum(DescribeCache::SYSTEM, compute_describe_system_checksum);
+}
+
+bool cached_app_info(appender_fn appender, void* append_data, void* reserved)
+{
+    return DescribeCache::instance()->append(DescribeCache::APP, system_app_info, appender, append_data);
+}
+
+bool cached_module_info_pb(appender_fn appender, void* append_data, void* reserved)
+{
+    return DescribeCache::instance()->append(DescribeCache::SYSTEM, system_module_info_pb, appender, append_data);
+}
+
 
 /**
  * Register a function.
@@ -546,13 +587,13 @@ uint32_t compute_cloud_state_checksum(SparkAppStateSelector::Enum stateSelector,
 		{
 		case SparkAppStateSelector::DESCRIBE_APP:
 			update_persisted_state([](SessionPersistData& data){
-				data.describe_app_crc = compute_describe_app_checksum();
+				data.describe_app_crc = cached_describe_app_checksum();
 				data.app_state_flags |= AppStateDescriptor::APP_DESCRIBE_CRC;
 			});
 			break;
 		case SparkAppStateSelector::DESCRIBE_SYSTEM:
 			update_persisted_state([](SessionPersistData& data){
-				data.describe_system_crc = compute_describe_system_checksum();
+				data.describe_system_crc = cached_describe_system_checksum();
 				data.app_state_flags |= AppStateDescriptor::SYSTEM_DESCRIBE_CRC;
 			});
 			break;
@@ -603,6 +644,10 @@ uint32_t compute_cloud_state_checksum(SparkAppStateSelector::Enum stateSelector,
 			});
 			break;
 		}
+		case SparkAppStateSelector::DESCRIBE_METRICS: {
+			DiagnosticsDeltaEncoder::instance()->acknowledge();
+			break;
+		}
 		default:
 			break;
 		}
@@ -612,12 +657,16 @@ uint32_t compute_cloud_state_checksum(SparkAppStateSelector::Enum stateSelector,
 		switch (stateSelector)
 		{
 		case SparkAppStateSelector::DESCRIBE_APP:
-			return compute_describe_app_checksum();
+			return cached_describe_app_checksum();
 
 		case SparkAppStateSelector::DESCRIBE_SYSTEM:
-			return compute_describe_system_checksum();
+			return cached_describe_system_checksum();
 		}
 	}
+	else if (operation == SparkAppStateUpdate::RESET && stateSelector == SparkAppStateSelector::DESCRIBE_METRICS)
+	{
+		DiagnosticsDeltaEncoder::instance()->reset();
+	}
 	else if (operation == SparkAppStateUpdate::RESET && stateSelector == SparkAppStateSelector::ALL)
 	{
 		update_persisted_state([](SessionPersistData& data) {
@@ -900,6 +949,40 @@ void getUserVar(const char* varKey, SparkDescriptor::GetVariableCallback callbac
     }
 }
 
+void readUserVarImpl(User_Var_Lookup_Table_t* item, size_t offset, size_t size, SparkDescriptor::GetVariableCallback callback,
+        void* context)
+{
+    APPLICATION_THREAD_CONTEXT_ASYNC(readUserVarImpl(item, offset, size, callback, context));
+    // Let the application generate only the requested portion of the value
+    void* data = malloc(size);
+    if (!data) {
+        getUserVarResult(ProtocolError::NO_MEMORY, 0 /* type */, nullptr /* data */, 0 /* size */, callback, context);
+        return;
+    }
+    const int r = item->read(item->userVar, offset, (char*)data, size);
+    if (r < 0) {
+        free(data);
+        getUserVarResult(ProtocolError::INTERNAL, 0, nullptr, 0, callback, context);
+        return;
+    }
+    const auto type = protocolVariableType(item->userVarType);
+    getUserVarResult(ProtocolError::NO_ERROR, type, data, std::min<size_t>(r, size), callback, context);
+}
+
+bool readUserVar(const char* varKey, size_t offset, size_t size, SparkDescriptor::GetVariableCallback callback, void* context)
+{
+    const auto item = find_var_by_key(varKey);
+    if (!item) {
+        callback(ProtocolError::NOT_FOUND, 0 /* type */, nullptr /* data */, 0 /* size */, context);
+        return true;
+    }
+    if (!item->read) {
+        return false; // Not a streaming variable
+    }
+    readUserVarImpl(item, offset, size, callback, context);
+    return true;
+}
+
 void userFuncScheduleImpl(User_Func_Lookup_Table_t* item, const char* paramString, bool freeParamString, SparkDescriptor::FunctionResultCallback callback)
 {
     int result = item->pUserFunc(item->pUserFuncData, paramString, NULL);
@@ -1135,10 +1218,11 @@ void Spark_Protocol_Init(void)
         descriptor.size = sizeof(descriptor);
         descriptor.call_function = userFuncSchedule;
         descriptor.get_variable_async = getUserVar;
+        descriptor.read_variable_async = readUserVar;
         descriptor.was_ota_upgrade_successful = HAL_OTA_Flashed_GetStatus;
         descriptor.ota_upgrade_status_sent = HAL_OTA_Flashed_ResetStatus;
-        descriptor.append_system_info = system_module_info_pb;
-        descriptor.append_app_info = system_app_info;
+        descriptor.append_system_info = cached_module_info_pb;
+        descriptor.append_app_info = cached_app_info;
         descriptor.append_metrics = system_metrics;
         descriptor.call_event_handler = invokeEventHandler;
 #if HAL_PLATFORM_CLOUD_UDP
@@ -1188,6 +1272,9 @@ void Spark_Protocol_Init(void)
                 nullptr, nullptr);
         spark_protocol_set_connection_property(sp, protocol::Connection::OTA_CHUNK_SIZE, HAL_OTA_ChunkSize(),
                 nullptr, nullptr);
+        // Delay acknowledgements so that responses can be sent in the ACK messages
+        spark_protocol_set_connection_property(sp, protocol::Connection::ACK_DELAY, protocol::DEFAULT_ACK_DELAY,
+                nullptr, nullptr);
 
         CommunicationsHandlers handlers;
         handlers.size = sizeof(handlers);
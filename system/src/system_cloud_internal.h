@@ -54,6 +54,7 @@ struct User_Var_Lookup_Table_t
 
     const void* (*update)(const char* name, Spark_Data_TypeDef varType, const void* var, void* reserved);
     int (*copy)(const void* var, void** data, size_t* size);
+    int (*read)(const void* var, size_t offset, char* data, size_t size);
 };
 
 
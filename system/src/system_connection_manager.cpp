@@ -31,6 +31,7 @@ LOG_SOURCE_CATEGORY("system.cm")
 #include "spark_wiring_network.h"
 #include "spark_wiring_vector.h"
 #include "spark_wiring_random.h"
+#include "spark_wiring_diagnostics.h"
 #include "endian_util.h"
 #include "netdb_hal.h"
 #include "ifapi.h"
@@ -207,6 +208,7 @@ int ConnectionManager::testConnections(bool background) {
         }
     }
     if (r == 0) {
+        updateLinkQuality(metrics);
         bestNetworks_.clear();
         for (auto& i: metrics) {
             bestNetworks_.append(std::make_pair(i.interface, i.resultingScore));
@@ -245,7 +247,95 @@ bool ConnectionManager::testIsAllowed() const {
     return spark_cloud_flag_connected() && !resetPending && !SPARK_FLASH_UPDATE;
 }
 
+void ConnectionManager::reportCloudSocketError() {
+    const auto network = getCloudConnectionNetwork();
+    if (network != NETWORK_INTERFACE_ALL) {
+        linkQuality_.addSocketError(network, HAL_Timer_Get_Milli_Seconds());
+    }
+}
+
+int ConnectionManager::getLinkQualityEstimate(network_handle_t network, LinkQualityEstimator::Estimate* estimate) const {
+    return linkQuality_.getEstimate(network, estimate);
+}
+
+void ConnectionManager::sampleCloudConnectionQuality() {
+    uint32_t transmitted = 0;
+    uint32_t retransmitted = 0;
+    uint32_t roundTrip = 0;
+    if (AbstractUnsignedIntegerDiagnosticData::get(DIAG_ID_CLOUD_TRANSMITTED_MESSAGES, transmitted) != 0 ||
+            AbstractUnsignedIntegerDiagnosticData::get(DIAG_ID_CLOUD_RETRANSMITTED_MESSAGES, retransmitted) != 0 ||
+            AbstractUnsignedIntegerDiagnosticData::get(DIAG_ID_CLOUD_COAP_ROUND_TRIP, roundTrip) != 0) {
+        return;
+    }
+    const auto network = getCloudConnectionNetwork();
+    if (network != NETWORK_INTERFACE_ALL && network == sampledNetwork_) {
+        // Every retransmission means that either the message or its acknowledgement was lost
+        const uint32_t sent = transmitted - lastTransmittedMessages_;
+        const uint32_t lost = retransmitted - lastRetransmittedMessages_;
+        const auto now = HAL_Timer_Get_Milli_Seconds();
+        if (sent > 0 && roundTrip > 0) {
+            linkQuality_.addRoundTrip(network, roundTrip, now);
+        }
+        linkQuality_.addDeliveries(network, sent, lost, now);
+    }
+    sampledNetwork_ = network;
+    lastTransmittedMessages_ = transmitted;
+    lastRetransmittedMessages_ = retransmitted;
+}
+
+void ConnectionManager::updateLinkQuality(const Vector<ConnectionMetrics>& metrics) {
+    const auto now = HAL_Timer_Get_Milli_Seconds();
+    for (const auto& i: metrics) {
+        if (!i.txPacketCount) {
+            continue;
+        }
+        // The test only reports the average, account for it once per received packet
+        for (unsigned j = 0; j < i.rxPacketCount; ++j) {
+            linkQuality_.addRoundTrip(i.interface, i.avgPacketRoundTripTime, now);
+        }
+        linkQuality_.addDeliveries(i.interface, i.rxPacketCount, i.txPacketCount - std::min(i.rxPacketCount, i.txPacketCount), now);
+    }
+}
+
+bool ConnectionManager::selectNetworkByLinkQuality(network_handle_t* network) {
+    if (preferredNetwork_ != NETWORK_INTERFACE_ALL) {
+        // Leave it to the reachability test to decide whether the preferred network is usable
+        return false;
+    }
+    const auto now = HAL_Timer_Get_Milli_Seconds();
+    const auto current = getCloudConnectionNetwork();
+    if (!linkQuality_.isValid(current, now)) {
+        return false;
+    }
+    network_handle_t best = current;
+    for (auto& i: bestNetworks_) {
+        if (!network_ready(i.first, 0, nullptr)) {
+            continue;
+        }
+        if (!linkQuality_.isValid(i.first, now)) {
+            // Not enough information about one of the candidates
+            return false;
+        }
+        i.second = linkQuality_.score(i.first, now);
+        if (i.first != best && linkQuality_.isBetter(i.first, best, now)) {
+            best = i.first;
+        }
+    }
+    // Move the selected interface to the front of the list so that the cloud socket is bound to it
+    // when reconnecting
+    for (auto it = bestNetworks_.begin(); it != bestNetworks_.end(); ++it) {
+        if (it->first == best) {
+            std::rotate(bestNetworks_.begin(), it, it + 1);
+            break;
+        }
+    }
+    *network = best;
+    return true;
+}
+
 int ConnectionManager::checkCloudConnectionNetwork() {
+    sampleCloudConnectionQuality();
+
     bool finishedBackgroundTest = false;
     if (backgroundTestInProgress_) {
         int r = testConnections(true /* background */);
@@ -269,6 +359,17 @@ int ConnectionManager::checkCloudConnectionNetwork() {
         handlePeriodicCheck();
     }
 
+    if (!checkScheduled_ && !backgroundTestInProgress_ && spark_cloud_flag_connected() &&
+            HAL_Timer_Get_Milli_Seconds() >= nextLinkQualityCheck_) {
+        // Move the cloud connection if the link currently in use got noticeably worse than another one
+        nextLinkQualityCheck_ = HAL_Timer_Get_Milli_Seconds() + LINK_QUALITY_CHECK_PERIOD_MS;
+        network_handle_t best = NETWORK_INTERFACE_ALL;
+        if (selectNetworkByLinkQuality(&best) && best != getCloudConnectionNetwork()) {
+            LOG(TRACE, "%s link quality is better than %s", netifToName(best), netifToName(getCloudConnectionNetwork()));
+            scheduleCloudConnectionNetworkCheck();
+        }
+    }
+
     if (!checkScheduled_ && !finishedBackgroundTest) {
         return 0;
     }
@@ -303,7 +404,14 @@ int ConnectionManager::checkCloudConnectionNetwork() {
         return 0;
     }
     if (countReady > 1) {
-        if (!finishedBackgroundTest) {
+        if (!finishedBackgroundTest && selectNetworkByLinkQuality(&best)) {
+            // The passive estimates are recent enough, no need to send test packets
+            if (best == getCloudConnectionNetwork()) {
+                spark_protocol_command(system_cloud_protocol_instance(), ProtocolCommands::PING, 0, nullptr);
+                LOG_DEBUG(TRACE, "Link quality of the current network interface (%s) is still the best - perform a cloud ping", netifToName(best));
+                return 0;
+            }
+        } else if (!finishedBackgroundTest) {
             // Re-test connections
             backgroundTestInProgress_ = false;
             return testConnections(true /* background */);
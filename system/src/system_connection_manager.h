@@ -23,6 +23,7 @@
 #if HAL_PLATFORM_IFAPI
 
 #include "system_network.h"
+#include "system_link_quality.h"
 #include "spark_wiring_vector.h"
 #include <memory>
 
@@ -69,9 +70,15 @@ public:
     int scheduleCloudConnectionNetworkCheck();
     int checkCloudConnectionNetwork();
 
+    void reportCloudSocketError();
+    int getLinkQualityEstimate(network_handle_t network, LinkQualityEstimator::Estimate* estimate) const;
+
 private:
     void handlePeriodicCheck();
     bool testIsAllowed() const;
+    void sampleCloudConnectionQuality();
+    void updateLinkQuality(const Vector<ConnectionMetrics>& metrics);
+    bool selectNetworkByLinkQuality(network_handle_t* network);
 
 private:
     network_handle_t preferredNetwork_;
@@ -82,6 +89,12 @@ private:
     std::unique_ptr<ConnectionTester> backgroundTester_;
     static constexpr system_tick_t PERIODIC_CHECK_PERIOD_MS = 5 * 60 * 1000;
     system_tick_t nextPeriodicCheck_ = 0;
+    static constexpr system_tick_t LINK_QUALITY_CHECK_PERIOD_MS = 10 * 1000;
+    system_tick_t nextLinkQualityCheck_ = 0;
+    LinkQualityEstimator linkQuality_;
+    network_handle_t sampledNetwork_ = NETWORK_INTERFACE_ALL;
+    uint32_t lastTransmittedMessages_ = 0;
+    uint32_t lastRetransmittedMessages_ = 0;
 };
 
 class ConnectionTester {
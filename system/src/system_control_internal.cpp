@@ -25,10 +25,12 @@
 #include "system_update.h"
 #include "spark_wiring_system.h"
 #include "appender.h"
+#include "check.h"
 #include "debug.h"
 #include "delay_hal.h"
 #include "hal_platform.h"
 #include "security_mode.h"
+#include "system_loop_profiler.h"
 
 #include "control/network.h"
 #include "control/wifi_new.h"
@@ -75,13 +77,47 @@ int formatReplyData(ctrl_request* req, ReplyFormatterCallback callback, void* da
     }
 }
 
+// The request data is an optional command byte. The reply data contains the statistics of the
+// profiled stages in JSON format
+int handleLoopProfilerRequest(ctrl_request* req) {
+    enum Command {
+        GET_STATS = 0,
+        ENABLE = 1,
+        DISABLE = 2,
+        RESET = 3
+    };
+    const auto profiler = LoopProfiler::instance();
+    const auto cmd = (req->request_size > 0) ? (uint8_t)req->request_data[0] : (uint8_t)GET_STATS;
+    switch (cmd) {
+    case GET_STATS:
+        break;
+    case ENABLE:
+        CHECK(profiler->enable());
+        break;
+    case DISABLE:
+        profiler->disable();
+        break;
+    case RESET:
+        profiler->reset();
+        break;
+    default:
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    struct Formatter {
+        static int callback(Appender* appender, void* data) {
+            return static_cast<LoopProfiler*>(data)->format(appender);
+        }
+    };
+    return formatReplyData(req, Formatter::callback, profiler);
+}
+
 SystemControl g_systemControl;
 
 } // particle::system::
 
 SystemControl::SystemControl() :
 #ifdef USB_VENDOR_REQUEST_ENABLE
-        usbChannel_(this),
+        usbChannel_(this, HAL_PLATFORM_USB_CONTROL_RING_BUFFER_SIZE),
 #endif
 #if HAL_PLATFORM_BLE_SETUP
         bleChannel_(this),
@@ -261,6 +297,10 @@ void SystemControl::processRequest(ctrl_request* req, ControlRequestChannel* cha
         }
         break;
     }
+    case CTRL_REQUEST_LOOP_PROFILER: {
+        setResult(req, handleLoopProfilerRequest(req));
+        break;
+    }
     /* config requests */
     case CTRL_REQUEST_SET_CLAIM_CODE: {
         setResult(req, control::config::handleSetClaimCodeRequest(req));
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_describe_cache.h"
+
+#include <algorithm>
+
+namespace particle { namespace system {
+
+namespace {
+
+// Initial size of the buffer for the encoded data
+const size_t INITIAL_BUFFER_SIZE = 256;
+
+// Collects the encoded data into a dynamically allocated buffer
+class VectorAppender {
+public:
+    explicit VectorAppender(Vector<char>* vec) :
+            vec_(vec),
+            ok_(true) {
+    }
+
+    static bool callback(void* appender, const uint8_t* data, size_t size) {
+        const auto self = static_cast<VectorAppender*>(appender);
+        if (self->ok_ && size) {
+            self->ok_ = self->reserve(self->vec_->size() + size) && self->vec_->append((const char*)data, size);
+        }
+        return true; // Keep encoding even if the data couldn't be cached
+    }
+
+    bool ok() const {
+        return ok_;
+    }
+
+private:
+    Vector<char>* vec_;
+    bool ok_;
+
+    bool reserve(size_t size) {
+        if ((size_t)vec_->capacity() >= size) {
+            return true;
+        }
+        const size_t newCapacity = std::max(std::max((size_t)vec_->capacity() * 3 / 2, size), INITIAL_BUFFER_SIZE);
+        return vec_->reserve(newCapacity);
+    }
+};
+
+} // namespace
+
+DescribeCache::DescribeCache() :
+        entries_(),
+        gen_() {
+}
+
+bool DescribeCache::append(Type type, EncodeFn encode, appender_fn appender, void* appendData) {
+    auto& e = entries_[type];
+    const unsigned gen = generation(type);
+    if (!e.hasData || e.dataGen != gen) {
+        e.data.clear();
+        e.hasData = false;
+        VectorAppender vecAppender(&e.data);
+        if (!encode(VectorAppender::callback, &vecAppender, nullptr /* reserved */)) {
+            e.data.clear();
+            e.data.trimToSize();
+            return false;
+        }
+        if (!vecAppender.ok()) {
+            // Not enough memory to cache the data
+            e.data.clear();
+            e.data.trimToSize();
+            return encode(appender, appendData, nullptr /* reserved */);
+        }
+        e.data.trimToSize(); // Ignore error
+        e.dataGen = gen;
+        e.hasData = true;
+    }
+    if (e.data.isEmpty()) {
+        return true;
+    }
+    return appender(appendData, (const uint8_t*)e.data.data(), e.data.size());
+}
+
+uint32_t DescribeCache::checksum(Type type, ChecksumFn compute) {
+    auto& e = entries_[type];
+    const unsigned gen = generation(type);
+    if (!e.hasChecksum || e.checksumGen != gen) {
+        e.checksum = compute();
+        e.checksumGen = gen;
+        e.hasChecksum = true;
+    }
+    return e.checksum;
+}
+
+void DescribeCache::clear() {
+    for (auto& e: entries_) {
+        e = Entry();
+    }
+}
+
+DescribeCache* DescribeCache::instance() {
+    static DescribeCache cache;
+    return &cache;
+}
+
+} } /* particle::system */
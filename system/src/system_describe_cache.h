@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "appender.h"
+
+#include "spark_wiring_vector.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace particle { namespace system {
+
+/**
+ * Cache of the encoded Describe documents and their checksums.
+ *
+ * Encoding the system Describe requires enumerating and validating all firmware modules, which
+ * is expensive. The cache keeps the encoded data and the checksum of each Describe type until the
+ * data it was generated from changes. The owners of that data call `invalidate()` to increment
+ * the generation counter of the affected Describe type.
+ *
+ * `invalidate()` can be called from any thread. Other methods are meant to be called from the
+ * system thread.
+ */
+class DescribeCache {
+public:
+    /**
+     * Describe type.
+     */
+    enum Type {
+        SYSTEM = 0, ///< System Describe (firmware modules and assets).
+        APP = 1, ///< Application Describe (cloud functions and variables).
+        TYPE_COUNT = 2
+    };
+
+    /**
+     * Function encoding a Describe document.
+     */
+    typedef bool (*EncodeFn)(appender_fn appender, void* appendData, void* reserved);
+
+    /**
+     * Function computing the checksum of a Describe document.
+     */
+    typedef uint32_t (*ChecksumFn)();
+
+    DescribeCache();
+
+    /**
+     * Append the encoded Describe data.
+     *
+     * The data is encoded with `encode` if it's not cached or the cached data is outdated. If
+     * there's not enough memory to cache the data, it's encoded directly to `appender`.
+     *
+     * @param type Describe type.
+     * @param encode Function encoding the Describe data.
+     * @param appender Appender function.
+     * @param appendData Appender data.
+     * @return `true` on success, otherwise `false`.
+     */
+    bool append(Type type, EncodeFn encode, appender_fn appender, void* appendData);
+
+    /**
+     * Get the checksum of the Describe data.
+     *
+     * The checksum is computed with `compute` if it's not cached or the cached checksum is outdated.
+     *
+     * @param type Describe type.
+     * @param compute Function computing the checksum.
+     * @return Checksum.
+     */
+    uint32_t checksum(Type type, ChecksumFn compute);
+
+    /**
+     * Mark the cached data of the given Describe type as outdated.
+     *
+     * @param type Describe type.
+     */
+    void invalidate(Type type);
+
+    /**
+     * Get the generation counter of the given Describe type.
+     */
+    unsigned generation(Type type) const;
+
+    /**
+     * Discard all cached data.
+     */
+    void clear();
+
+    static DescribeCache* instance();
+
+private:
+    struct Entry {
+        Vector<char> data; // Encoded Describe data
+        uint32_t checksum; // Checksum
+        unsigned dataGen; // Generation of the encoded data
+        unsigned checksumGen; // Generation of the checksum
+        bool hasData; // Whether the encoded data is cached
+        bool hasChecksum; // Whether the checksum is cached
+    };
+
+    Entry entries_[TYPE_COUNT];
+    std::atomic<unsigned> gen_[TYPE_COUNT];
+};
+
+inline void DescribeCache::invalidate(Type type) {
+    gen_[type].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline unsigned DescribeCache::generation(Type type) const {
+    return gen_[type].load(std::memory_order_relaxed);
+}
+
+} } /* particle::system */
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_diag_delta.h"
+
+#include "appender.h"
+#include "varint.h"
+#include "system_error.h"
+
+#include <utility>
+
+namespace particle {
+
+namespace system {
+
+namespace {
+
+bool appendValue(Appender* appender, int32_t value) {
+    char buf[maxUnsignedVarintSize<uint32_t>()] = {};
+    const size_t n = encodeUnsignedVarint(buf, sizeof(buf), encodeZigZag(value));
+    return appender->append((const uint8_t*)buf, n);
+}
+
+bool appendKey(Appender* appender, uint16_t id, bool error) {
+    return appender->appendUnsignedVarint(((unsigned)id << 1) | (error ? 1 : 0));
+}
+
+} // namespace
+
+DiagnosticsDeltaEncoder::DiagnosticsDeltaEncoder() :
+        appender_(nullptr),
+        seq_(0),
+        baseSeq_(0),
+        pendingSeq_(0),
+        deltaCount_(0),
+        baseIndex_(0),
+        baseMatched_(0),
+        hasBase_(false),
+        keyframe_(false),
+        awaitingAck_(false),
+        ambiguousAck_(false) {
+}
+
+int DiagnosticsDeltaEncoder::begin(Appender* appender) {
+    if (awaitingAck_) {
+        // The previous message hasn't been acknowledged yet. The next acknowledgement may be
+        // for either of the messages
+        ambiguousAck_ = true;
+        awaitingAck_ = false;
+    }
+    appender_ = appender;
+    pending_.clear();
+    baseIndex_ = 0;
+    baseMatched_ = 0;
+    keyframe_ = !hasBase_ || deltaCount_ >= KEYFRAME_INTERVAL;
+    ++seq_;
+    if (!appender_->appendUInt16LE(0) || // Marker
+            !appender_->appendUnsignedVarint(VERSION) ||
+            !appender_->appendUInt8(keyframe_ ? Flag::KEYFRAME : 0) ||
+            !appender_->appendUnsignedVarint(seq_) ||
+            (!keyframe_ && !appender_->appendUnsignedVarint(baseSeq_))) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    return 0;
+}
+
+int DiagnosticsDeltaEncoder::add(uint16_t id, int32_t value, bool error) {
+    if (!pending_.append(Entry{ id, error, value })) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    if (!keyframe_) {
+        const auto base = findBaseEntry(id);
+        if (base && base->error == error) {
+            if (base->value == value) {
+                return 0; // Unchanged
+            }
+            value = (int32_t)((uint32_t)value - (uint32_t)base->value);
+        }
+    }
+    if (!appendKey(appender_, id, error) || !appendValue(appender_, value)) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    return 0;
+}
+
+int DiagnosticsDeltaEncoder::end() {
+    if (keyframe_) {
+        deltaCount_ = 0;
+    } else {
+        ++deltaCount_;
+        if (baseMatched_ != (unsigned)base_.size()) {
+            // Some of the data sources are no longer available. A delta message cannot express
+            // that, so make sure the next message is a keyframe
+            deltaCount_ = KEYFRAME_INTERVAL;
+        }
+    }
+    pendingSeq_ = seq_;
+    awaitingAck_ = true;
+    appender_ = nullptr;
+    return 0;
+}
+
+void DiagnosticsDeltaEncoder::acknowledge() {
+    if (!awaitingAck_) {
+        return;
+    }
+    awaitingAck_ = false;
+    if (ambiguousAck_) {
+        ambiguousAck_ = false;
+        return;
+    }
+    base_ = std::move(pending_);
+    baseSeq_ = pendingSeq_;
+    hasBase_ = true;
+}
+
+void DiagnosticsDeltaEncoder::reset() {
+    base_.clear();
+    pending_.clear();
+    deltaCount_ = 0;
+    hasBase_ = false;
+    awaitingAck_ = false;
+    ambiguousAck_ = false;
+}
+
+DiagnosticsDeltaEncoder* DiagnosticsDeltaEncoder::instance() {
+    static DiagnosticsDeltaEncoder encoder;
+    return &encoder;
+}
+
+const DiagnosticsDeltaEncoder::Entry* DiagnosticsDeltaEncoder::findBaseEntry(uint16_t id) {
+    // The data sources are normally enumerated in the same order, so the search starts where
+    // the previous one has stopped
+    const unsigned size = base_.size();
+    for (unsigned i = 0; i < size; ++i) {
+        const unsigned index = (baseIndex_ + i) % size;
+        const auto& e = base_.at(index);
+        if (e.id == id) {
+            baseIndex_ = index + 1;
+            ++baseMatched_;
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace system
+
+} // namespace particle
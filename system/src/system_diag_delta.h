@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "spark_wiring_vector.h"
+
+#include <cstdint>
+
+namespace particle {
+
+class Appender;
+
+namespace system {
+
+/**
+ * Encoder of the compact, change-only representation of the diagnostic data.
+ *
+ * An encoded message has the following format:
+ *
+ * - Marker (uint16, always 0). In the legacy binary format, this field contains the size of a
+ *   data source ID, which is never 0.
+ * - Format version (varint).
+ * - Flags (uint8). See `Flag`.
+ * - Sequence number of the message (varint).
+ * - Sequence number of the base message (varint). Present only in delta messages.
+ * - Any number of records:
+ *   - Key (varint): `(source_id << 1) | is_error`.
+ *   - Value (ZigZag varint). In a delta message, if the base message contains a value for the same
+ *     key, this is the difference between the current and base values, otherwise the value itself.
+ *
+ * A keyframe message contains all data sources. A delta message contains only the data sources
+ * whose value has changed since the base message, which is the last message acknowledged by the
+ * server. Keyframes are sent periodically and whenever there's no acknowledged base message.
+ */
+class DiagnosticsDeltaEncoder {
+public:
+    /**
+     * Message flags.
+     */
+    enum Flag {
+        KEYFRAME = 0x01 ///< Keyframe message.
+    };
+
+    /**
+     * Format version.
+     */
+    static const unsigned VERSION = 1;
+
+    /**
+     * Maximum number of delta messages sent between two keyframes.
+     */
+    static const unsigned KEYFRAME_INTERVAL = 10;
+
+    DiagnosticsDeltaEncoder();
+
+    /**
+     * Start encoding a message.
+     *
+     * @param appender Appender.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int begin(Appender* appender);
+
+    /**
+     * Encode the value of a data source.
+     *
+     * @param id Data source ID.
+     * @param value Value, or an error code if `error` is `true`.
+     * @param error Whether `value` is an error code.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int add(uint16_t id, int32_t value, bool error);
+
+    /**
+     * Finish encoding the message.
+     *
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int end();
+
+    /**
+     * Notify the encoder that the last encoded message has been acknowledged by the server.
+     *
+     * Acknowledgements that cannot be matched to a single message are ignored.
+     */
+    void acknowledge();
+
+    /**
+     * Discard the acknowledged state. The next message will be a keyframe.
+     */
+    void reset();
+
+    /**
+     * Sequence number of the last encoded message.
+     */
+    uint32_t sequenceNumber() const {
+        return seq_;
+    }
+
+    static DiagnosticsDeltaEncoder* instance();
+
+private:
+    struct Entry {
+        uint16_t id;
+        bool error;
+        int32_t value;
+    };
+
+    Vector<Entry> base_; // Values of the acknowledged message
+    Vector<Entry> pending_; // Values of the last encoded message
+    Appender* appender_;
+    uint32_t seq_;
+    uint32_t baseSeq_;
+    uint32_t pendingSeq_;
+    unsigned deltaCount_; // Number of delta messages sent since the last keyframe
+    unsigned baseIndex_; // Search hint
+    unsigned baseMatched_; // Number of base entries matched in the current message
+    bool hasBase_;
+    bool keyframe_;
+    bool awaitingAck_;
+    bool ambiguousAck_;
+
+    const Entry* findBaseEntry(uint16_t id);
+};
+
+} // namespace system
+
+} // namespace particle
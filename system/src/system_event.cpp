@@ -20,6 +20,7 @@
 #define NO_STATIC_ASSERT
 
 #include "system_event.h"
+#include "system_event_coalescer.h"
 #include "system_threading.h"
 #include "interrupts_hal.h"
 #include "system_task.h"
@@ -81,6 +82,33 @@ spark::Vector<SystemEventSubscription> subscriptions;
 StaticRecursiveMutex sSubscriptionsMutex;
 #endif // PLATFORM_THREADING
 
+// Combined mask of the events that have at least one subscriber. Modified together with the
+// subscriptions so that notifications can be dropped early without acquiring the mutex.
+// The mask is 64-bit and can't be accessed atomically on 32-bit MCUs, so both the reads and
+// the writes are done inside an atomic block
+system_event_t sSubscribedEvents = 0;
+
+#if PLATFORM_THREADING
+SystemEventCoalescer sCoalescer;
+StaticRecursiveMutex sCoalescerMutex;
+#endif // PLATFORM_THREADING
+
+system_event_t subscribedEventsMask() {
+    system_event_t events = 0;
+    ATOMIC_BLOCK() {
+        events = sSubscribedEvents;
+    }
+    return events;
+}
+
+system_event_t subscribedEvents(const spark::Vector<SystemEventSubscription>& subs) {
+    system_event_t events = 0;
+    for (const auto& sub: subs) {
+        events |= sub.events;
+    }
+    return events;
+}
+
 void system_notify_event_impl(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata, bool isIsr) {
 #if PLATFORM_THREADING
     if (!isIsr) {
@@ -100,7 +128,58 @@ void system_notify_event_impl(system_event_t event, uint32_t data, void* pointer
     }
 }
 
+#if PLATFORM_THREADING
+
+void system_notify_coalesced_event(unsigned slot) {
+    system_event_t event = 0;
+    uint32_t data = 0;
+    void* pointer = nullptr;
+    {
+        std::lock_guard lk(sCoalescerMutex);
+        sCoalescer.take(slot, &event, &data, &pointer);
+    }
+    system_notify_event_impl(event, data, pointer, nullptr /* fn */, nullptr /* fndata */, false /* isIsr */);
+}
+
+/**
+ * Enqueue a notification for a state-type event, or update a notification for the same event
+ * that is already in the queue of the application thread.
+ *
+ * @return `true` if the notification was handled, or `false` if it needs to be enqueued as is.
+ */
+bool system_notify_event_coalesced(system_event_t event, uint32_t data, void* pointer, bool dontBlock) {
+    unsigned slot = 0;
+    SystemEventCoalescer::Result r = SystemEventCoalescer::NOT_COALESCED;
+    {
+        std::lock_guard lk(sCoalescerMutex);
+        r = sCoalescer.add(event, data, pointer, &slot);
+    }
+    if (r == SystemEventCoalescer::NOT_COALESCED) {
+        return false;
+    }
+    if (r == SystemEventCoalescer::QUEUED) {
+        // The mutex is not held here as enqueueing may block until the application thread
+        // processes some of the queued notifications
+        auto lambda = [slot]() {
+            system_notify_coalesced_event(slot);
+        };
+        if (!ApplicationThread.invoke_async(FFL(lambda), dontBlock)) {
+            std::lock_guard lk(sCoalescerMutex);
+            sCoalescer.cancel(slot);
+        }
+    }
+    return true;
+}
+
+#endif // PLATFORM_THREADING
+
 void system_notify_event_async(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata, bool dontBlock = false) {
+#if PLATFORM_THREADING
+    if (!fn && ApplicationThread.isStarted() && !ApplicationThread.isCurrentThread() &&
+            system_notify_event_coalesced(event, data, pointer, dontBlock)) {
+        return;
+    }
+#endif // PLATFORM_THREADING
     // run event notifications on the application thread
     if (dontBlock) {
         APPLICATION_THREAD_CONTEXT_ASYNC_TRY(system_notify_event_async(event, data, pointer, fn, fndata, dontBlock));
@@ -169,6 +248,7 @@ int system_subscribe_event(system_event_t events, system_event_handler_t* handle
         // FIXME: see the comment above. This is safe because of the current swap() overload implementation for Vector
         // which simply swaps data/size/capacity inside.
         std::swap(subsCopy, subscriptions);
+        sSubscribedEvents |= events;
     }
     return r;
 }
@@ -207,6 +287,7 @@ void system_unsubscribe_event(system_event_t events, system_event_handler_t* han
                 }
             }
             subscriptions.removeAt(it - subscriptions.begin(), subscriptions.end() - it);
+            sSubscribedEvents = subscribedEvents(subscriptions);
         }
     }
 }
@@ -215,6 +296,10 @@ void system_notify_event(system_event_t event, uint32_t data, void* pointer, voi
         unsigned flags) {
     // TODO: Add an API that would allow user applications to control which event handlers can be
     // executed synchronously, possibly in the context of an ISR
+    if (!fn && !(event & subscribedEventsMask())) {
+        // No one is interested in this event
+        return;
+    }
     bool isIsr = hal_interrupt_is_isr();
     if (flags & NOTIFY_SYNCHRONOUSLY) {
         system_notify_event_impl(event, data, pointer, fn, fndata, isIsr);
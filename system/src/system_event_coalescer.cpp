@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_event_coalescer.h"
+
+namespace particle {
+
+namespace system {
+
+namespace {
+
+const uint32_t ANY_DATA = 0xffffffff;
+
+struct CoalescibleEvent {
+    system_event_t event;
+    uint32_t data;
+};
+
+// Events that report a state rather than a transition. Status events such as network_status
+// and cloud_status are not coalesced since the application may rely on seeing every transition
+const CoalescibleEvent COALESCIBLE_EVENTS[] = {
+    { battery_state, ANY_DATA },
+    { power_source, ANY_DATA },
+    { aux_power_state, ANY_DATA },
+    { firmware_update, firmware_update_progress }
+};
+
+static_assert(sizeof(COALESCIBLE_EVENTS) / sizeof(COALESCIBLE_EVENTS[0]) == SystemEventCoalescer::SLOT_COUNT,
+        "Invalid number of coalescible events");
+
+int findSlot(system_event_t event, uint32_t data) {
+    for (unsigned i = 0; i < SystemEventCoalescer::SLOT_COUNT; ++i) {
+        const auto& e = COALESCIBLE_EVENTS[i];
+        if (e.event == event && (e.data == ANY_DATA || e.data == data)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+SystemEventCoalescer::SystemEventCoalescer() :
+        slots_() {
+}
+
+SystemEventCoalescer::Result SystemEventCoalescer::add(system_event_t event, uint32_t data, void* pointer, unsigned* slot) {
+    const int i = findSlot(event, data);
+    if (i < 0) {
+        // Make sure a pending notification for the same event is not updated with data that
+        // the application would otherwise receive after this notification
+        for (unsigned j = 0; j < SLOT_COUNT; ++j) {
+            if (COALESCIBLE_EVENTS[j].event == event && slots_[j].queued) {
+                slots_[j].sealed = true;
+            }
+        }
+        return NOT_COALESCED;
+    }
+    auto& s = slots_[i];
+    if (s.queued) {
+        if (s.sealed) {
+            return NOT_COALESCED;
+        }
+        s.data = data;
+        s.pointer = pointer;
+        return MERGED;
+    }
+    s.data = data;
+    s.pointer = pointer;
+    s.queued = true;
+    s.sealed = false;
+    *slot = i;
+    return QUEUED;
+}
+
+void SystemEventCoalescer::take(unsigned slot, system_event_t* event, uint32_t* data, void** pointer) {
+    auto& s = slots_[slot];
+    *event = COALESCIBLE_EVENTS[slot].event;
+    *data = s.data;
+    *pointer = s.pointer;
+    s.queued = false;
+    s.sealed = false;
+}
+
+void SystemEventCoalescer::cancel(unsigned slot) {
+    auto& s = slots_[slot];
+    s.queued = false;
+    s.sealed = false;
+}
+
+bool SystemEventCoalescer::isCoalescible(system_event_t event, uint32_t data) {
+    return findSlot(event, data) >= 0;
+}
+
+} // namespace system
+
+} // namespace particle
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_event.h"
+
+namespace particle {
+
+namespace system {
+
+/**
+ * Tracks the pending notifications for state-type system events.
+ *
+ * For events such as `battery_state` or the firmware update progress, only the most recent
+ * notification is of interest to the application. While a notification for such an event is
+ * waiting in the application queue, a new notification for the same event updates the pending
+ * one instead of being enqueued separately.
+ *
+ * The class is not thread-safe.
+ */
+class SystemEventCoalescer {
+public:
+    /**
+     * Result of `add()`.
+     */
+    enum Result {
+        NOT_COALESCED, ///< The notification needs to be enqueued as is.
+        QUEUED, ///< The notification needs to be enqueued. The task should obtain its data via `take()`.
+        MERGED ///< The notification was merged into a pending notification.
+    };
+
+    SystemEventCoalescer();
+
+    /**
+     * Register a notification that is about to be enqueued.
+     *
+     * @param event Event.
+     * @param data Event data.
+     * @param pointer Event pointer.
+     * @param[out] slot Slot of the pending notification. Set if `QUEUED` is returned.
+     * @return Result.
+     */
+    Result add(system_event_t event, uint32_t data, void* pointer, unsigned* slot);
+
+    /**
+     * Get the data of a pending notification and mark it as delivered.
+     *
+     * @param slot Slot of the pending notification.
+     * @param[out] event Event.
+     * @param[out] data Event data.
+     * @param[out] pointer Event pointer.
+     */
+    void take(unsigned slot, system_event_t* event, uint32_t* data, void** pointer);
+
+    /**
+     * Discard a pending notification that could not be enqueued.
+     *
+     * @param slot Slot of the pending notification.
+     */
+    void cancel(unsigned slot);
+
+    /**
+     * Check if a notification can be coalesced with other notifications for the same event.
+     */
+    static bool isCoalescible(system_event_t event, uint32_t data);
+
+    /**
+     * Maximum number of pending notifications tracked by the coalescer.
+     */
+    static const unsigned SLOT_COUNT = 4;
+
+private:
+    struct Slot {
+        uint32_t data;
+        void* pointer;
+        bool queued; // A notification is waiting in the queue
+        bool sealed; // Another notification for the same event was enqueued after the pending one
+    };
+
+    Slot slots_[SLOT_COUNT];
+};
+
+} // namespace system
+
+} // namespace particle
@@ -18,6 +18,7 @@
 #include "system_info.h"
 #include "system_cloud_internal.h"
 #include "system_info_encoding.h"
+#include "system_diag_delta.h"
 #include "check.h"
 #include "scope_guard.h"
 #include "bytes2hexbuf.h"
@@ -31,6 +32,7 @@
 #if HAL_PLATFORM_PROTOBUF
 #include "security_mode.h"
 #include "cloud/describe.pb.h"
+#include "nanopb_misc.h"
 using particle::control::common::EncodedString;
 #endif // HAL_PLATFORM_PROTOBUF
 
@@ -168,12 +170,32 @@ protected:
 			}
 			break;
 		}
+		case DIAG_TYPE_HISTOGRAM: {
+			DiagnosticHistogram hist = {};
+			const int ret = AbstractHistogramDiagnosticData::get(src, hist);
+			if ((ret == 0 && !fmt.formatSourceHistogram(src, hist)) || (ret != 0 && !fmt.formatSourceError(src, ret))) {
+				return SYSTEM_ERROR_TOO_LARGE;
+			}
+			break;
+		}
+		case DIAG_TYPE_TIME_SERIES: {
+			DiagnosticTimeSeries series = {};
+			const int ret = AbstractTimeSeriesDiagnosticData::get(src, series);
+			if ((ret == 0 && !fmt.formatSourceTimeSeries(src, series)) || (ret != 0 && !fmt.formatSourceError(src, ret))) {
+				return SYSTEM_ERROR_TOO_LARGE;
+			}
+			break;
+		}
 		default:
 			return SYSTEM_ERROR_NOT_SUPPORTED;
 		}
 		return 0;
 	}
 
+	static bool isScalarSource(const diag_source* src) {
+		return src->type == DIAG_TYPE_INT || src->type == DIAG_TYPE_UINT;
+	}
+
 	static int formatSources(T& formatter, const uint16_t* id, size_t count, unsigned flags) {
 	    if (!formatter.openDocument()) {
 			return SYSTEM_ERROR_TOO_LARGE;
@@ -215,9 +237,10 @@ public:
 class JsonDiagnosticsFormatter : public AbstractDiagnosticsFormatter<JsonDiagnosticsFormatter> {
 
 	AppendJson& json;
+	unsigned flags;
 
 public:
-	JsonDiagnosticsFormatter(AppendJson& appender_) : json(appender_) {}
+	JsonDiagnosticsFormatter(AppendJson& appender_, unsigned flags_ = 0) : json(appender_), flags(flags_) {}
 
 	inline bool openDocument() {
 		json.beginObject();
@@ -238,7 +261,8 @@ public:
 	}
 
 	inline bool isSourceOk(const diag_source* src) {
-	    return (src->name);
+	    // Existing consumers of the JSON output expect a numeric value for every source
+	    return (src->name) && (isScalarSource(src) || (flags & SYSTEM_FORMAT_DIAG_DATA_AGGREGATES));
 	}
 
 	inline bool formatSourceInt(const diag_source* src, AbstractIntegerDiagnosticData::IntType val) {
@@ -250,19 +274,80 @@ public:
 		json.name(src->name).value(val);
 		return json.isOk();
 	}
+
+	bool formatSourceHistogram(const diag_source* src, const DiagnosticHistogram& hist) {
+		json.name(src->name);
+		json.beginObject();
+		json.name("n").value((unsigned)hist.info.count);
+		json.name("sum").value((unsigned)hist.info.sum);
+		if (hist.info.count) {
+			json.name("min").value((unsigned)hist.info.min);
+			json.name("max").value((unsigned)hist.info.max);
+		}
+		json.name("sb").value((unsigned)hist.info.sub_bucket_bits);
+		// Trailing empty buckets are omitted
+		unsigned count = hist.info.bucket_count;
+		while (count > 0 && !hist.buckets[count - 1]) {
+			--count;
+		}
+		json.name("b");
+		json.beginArray();
+		for (unsigned i = 0; i < count; ++i) {
+			json.value((unsigned)hist.buckets[i]);
+		}
+		json.endArray();
+		json.endObject();
+		return json.isOk();
+	}
+
+	bool formatSourceTimeSeries(const diag_source* src, const DiagnosticTimeSeries& series) {
+		json.name(src->name);
+		json.beginObject();
+		json.name("n").value((unsigned)series.info.total_count);
+		json.name("s");
+		json.beginArray();
+		for (unsigned i = 0; i < series.info.sample_count; ++i) {
+			json.beginArray();
+			json.value((unsigned)series.samples[i].time);
+			json.value((int)series.samples[i].value);
+			json.endArray();
+		}
+		json.endArray();
+		json.endObject();
+		return json.isOk();
+	}
 };
 
 
 class BinaryDiagnosticsFormatter : public AbstractDiagnosticsFormatter<BinaryDiagnosticsFormatter> {
 
 	AppendData& data;
+	unsigned flags;
 
 	// FIXME: single size for all the diagnostics is just plain wrong
 	using value = AbstractIntegerDiagnosticData::IntType;
 	using id = typeof(diag_source::id);
 
+	// Records of the non-scalar data sources have this bit set in the ID field. Their value field
+	// contains the size of the data that follows the record
+	static const uint16_t VARIABLE_SIZE_RECORD = 1 << 14;
+
+	bool formatVariableSizeRecord(const diag_source* src, const void* d, size_t size) {
+		static_assert(sizeof(src->id)==2, "expected diagnostic id to be 16-bits");
+		if (!data.write(decltype(src->id)(src->id | VARIABLE_SIZE_RECORD)) || !data.write(int32_t(size))) {
+			return false;
+		}
+		const auto p = (const char*)d;
+		for (size_t i = 0; i < size; ++i) {
+			if (!data.write(p[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
 public:
-	BinaryDiagnosticsFormatter(AppendData& appender_) : data(appender_) {}
+	BinaryDiagnosticsFormatter(AppendData& appender_, unsigned flags_ = 0) : data(appender_), flags(flags_) {}
 
 
 	inline bool openDocument() {
@@ -282,7 +367,8 @@ public:
 	}
 
 	inline bool isSourceOk(const diag_source* src) {
-	    return true;
+	    // Parsers of the original format expect a fixed-size value in every record
+	    return isScalarSource(src) || (flags & SYSTEM_FORMAT_DIAG_DATA_AGGREGATES);
 	}
 
 	inline bool formatSourceInt(const diag_source* src, AbstractIntegerDiagnosticData::IntType val) {
@@ -293,29 +379,78 @@ public:
 		return data.write(src->id) && data.write(val);
 	}
 
+	bool formatSourceHistogram(const diag_source* src, const DiagnosticHistogram& hist) {
+		return formatVariableSizeRecord(src, &hist, sizeof(hist.info) + hist.info.bucket_count * sizeof(hist.buckets[0]));
+	}
+
+	bool formatSourceTimeSeries(const diag_source* src, const DiagnosticTimeSeries& series) {
+		return formatVariableSizeRecord(src, &series, sizeof(series.info) + series.info.sample_count * sizeof(series.samples[0]));
+	}
+
 };
 
-#if HAL_PLATFORM_PROTOBUF
-class PbAppenderStream: public pb_ostream_t {
+class CallbackAppender: public Appender {
 public:
-    PbAppenderStream(appender_fn append, void* ctx) :
-            pb_ostream_t(),
-            append_(append),
-            ctx_(ctx) {
-        pb_ostream_t::state = this;
-        pb_ostream_t::max_size = SIZE_MAX;
-        pb_ostream_t::callback = [](pb_ostream_t* strm, const pb_byte_t* buf, size_t size) {
-            auto self = (PbAppenderStream*)strm->state;
-            return self->append_(self->ctx_, buf, size);
-        };
+    CallbackAppender(appender_fn fn, void* data) :
+            fn_(fn),
+            data_(data) {
+    }
+
+    bool append(const uint8_t* data, size_t size) override {
+        return fn_(data_, data, size);
     }
 
 private:
-    appender_fn append_;
-    void* ctx_;
+    appender_fn fn_;
+    void* data_;
 };
 
-#endif // HAL_PLATFORM_PROTOBUF
+
+/**
+ * Formats the diagnostic data as a delta against the last acknowledged message.
+ *
+ * @see DiagnosticsDeltaEncoder
+ */
+class DeltaDiagnosticsFormatter : public AbstractDiagnosticsFormatter<DeltaDiagnosticsFormatter> {
+
+	Appender& appender;
+	DiagnosticsDeltaEncoder& encoder;
+
+public:
+	DeltaDiagnosticsFormatter(Appender& appender_, DiagnosticsDeltaEncoder& encoder_) : appender(appender_), encoder(encoder_) {}
+
+	inline bool openDocument() {
+		return encoder.begin(&appender) == 0;
+	}
+
+	inline bool closeDocument() {
+		return encoder.end() == 0;
+	}
+
+	bool formatSourceError(const diag_source* src, int error) {
+		return encoder.add(src->id, error, true /* error */) == 0;
+	}
+
+	inline bool isSourceOk(const diag_source* src) {
+	    return isScalarSource(src);
+	}
+
+	inline bool formatSourceInt(const diag_source* src, AbstractIntegerDiagnosticData::IntType val) {
+		return encoder.add(src->id, val, false /* error */) == 0;
+	}
+
+	inline bool formatSourceUnsignedInt(const diag_source* src, AbstractUnsignedIntegerDiagnosticData::IntType val) {
+		return encoder.add(src->id, (int32_t)val, false /* error */) == 0;
+	}
+
+	bool formatSourceHistogram(const diag_source* src, const DiagnosticHistogram& hist) {
+		return false;
+	}
+
+	bool formatSourceTimeSeries(const diag_source* src, const DiagnosticTimeSeries& series) {
+		return false;
+	}
+};
 
 } // anonymous
 
@@ -425,14 +560,21 @@ bool append_system_version_info(Appender* appender)
 
 int system_format_diag_data(const uint16_t* id, size_t count, unsigned flags, appender_fn append, void* append_data,
         void* reserved) {
-	if (flags & 1) {
+	if (flags & SYSTEM_FORMAT_DIAG_DATA_DELTA) {
+		// Deltas are computed against the values of all data sources
+		CHECK_TRUE(!id, SYSTEM_ERROR_NOT_SUPPORTED);
+		CallbackAppender appender(append, append_data);
+		DeltaDiagnosticsFormatter fmt(appender, *DiagnosticsDeltaEncoder::instance());
+		return fmt.format(id, count, flags);
+	}
+	if (flags & SYSTEM_FORMAT_DIAG_DATA_BINARY) {
 		AppendData data(append, append_data);
-		BinaryDiagnosticsFormatter fmt(data);
+		BinaryDiagnosticsFormatter fmt(data, flags);
 	    return fmt.format(id, count, flags);
 	}
 	else {
 	    AppendJson json(append, append_data);
-	    JsonDiagnosticsFormatter fmt(json);
+	    JsonDiagnosticsFormatter fmt(json, flags);
 	    return fmt.format(id, count, flags);
 	}
 }
@@ -499,7 +641,11 @@ bool system_module_info_pb(appender_fn appender, void* append_data, void* reserv
 #if HAL_PLATFORM_ASSETS
     EncodeAssets assets(&pbDesc.assets, AssetManager::instance().availableAssets());
 #endif // HAL_PLATFORM_ASSETS
-    PbAppenderStream strm(appender, append_data);
+    pb_appender app = { appender, append_data };
+    pb_ostream_t strm = {};
+    if (pb_ostream_from_appender(&strm, &app, nullptr) < 0) {
+        return false;
+    }
     return pb_encode(&strm, &PB(SystemDescribe_msg), &pbDesc);
 }
 
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_link_quality.h"
+
+#include "system_error.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace particle { namespace system {
+
+namespace {
+
+// Smoothing factor of the moving averages: 1/8, same as for the SRTT in RFC 6298
+const unsigned EWMA_SHIFT = 3;
+
+const uint32_t LOSS_SCALE = 65536;
+
+// Loss rate at which the score stops growing, in 1/1000 units
+const unsigned MAX_SCORED_LOSS = 950;
+
+// Updating the averages with a large number of identical samples at once would be pointless
+const unsigned MAX_DELIVERY_SAMPLES = 32;
+
+uint32_t ewma(uint32_t avg, uint32_t sample) {
+    return (uint32_t)((int64_t)avg + (((int64_t)sample - (int64_t)avg) >> EWMA_SHIFT));
+}
+
+} // namespace
+
+LinkQualityEstimator::LinkQualityEstimator() :
+        links_() {
+}
+
+void LinkQualityEstimator::addRoundTrip(network_interface_t iface, system_tick_t rtt, system_tick_t now) {
+    const auto l = link(iface, true /* create */);
+    const uint32_t sample = std::min<uint32_t>(rtt, std::numeric_limits<uint32_t>::max() >> EWMA_SHIFT) << EWMA_SHIFT;
+    l->rtt = l->rttSamples ? ewma(l->rtt, sample) : sample;
+    ++l->rttSamples;
+    l->lastUpdate = now;
+}
+
+void LinkQualityEstimator::addDeliveries(network_interface_t iface, unsigned delivered, unsigned lost, system_tick_t now) {
+    const unsigned total = delivered + lost;
+    if (!total) {
+        return;
+    }
+    const auto l = link(iface, true /* create */);
+    // Interleave the outcomes so that the order of the samples doesn't affect the result much
+    const unsigned n = std::min(total, MAX_DELIVERY_SAMPLES);
+    const unsigned lostSamples = (uint64_t)lost * n / total;
+    for (unsigned i = 0; i < n; ++i) {
+        const bool isLost = (uint64_t)(i + 1) * lostSamples / n != (uint64_t)i * lostSamples / n;
+        const uint32_t sample = isLost ? LOSS_SCALE : 0;
+        l->loss = l->lossSamples ? ewma(l->loss, sample) : sample;
+        ++l->lossSamples;
+    }
+    l->lastUpdate = now;
+}
+
+void LinkQualityEstimator::addSocketError(network_interface_t iface, system_tick_t now) {
+    addDeliveries(iface, 0 /* delivered */, 1 /* lost */, now);
+}
+
+int LinkQualityEstimator::getEstimate(network_interface_t iface, Estimate* estimate) const {
+    const auto l = link(iface);
+    if (!l) {
+        return SYSTEM_ERROR_NOT_FOUND;
+    }
+    estimate->rtt = l->rtt >> EWMA_SHIFT;
+    estimate->loss = (uint64_t)l->loss * 1000 / LOSS_SCALE;
+    estimate->samples = l->rttSamples;
+    estimate->lastUpdate = l->lastUpdate;
+    return 0;
+}
+
+bool LinkQualityEstimator::isValid(network_interface_t iface, system_tick_t now) const {
+    const auto l = link(iface);
+    return l && l->rttSamples >= MIN_SAMPLES && now - l->lastUpdate <= MAX_ESTIMATE_AGE;
+}
+
+uint32_t LinkQualityEstimator::score(network_interface_t iface, system_tick_t now) const {
+    if (!isValid(iface, now)) {
+        return std::numeric_limits<uint32_t>::max();
+    }
+    Estimate e = {};
+    getEstimate(iface, &e);
+    // Expected number of transmission attempts is 1 / (1 - loss)
+    const unsigned loss = std::min(e.loss, MAX_SCORED_LOSS);
+    const uint64_t s = (uint64_t)std::max<system_tick_t>(e.rtt, 1) * 1000 / (1000 - loss);
+    return std::min<uint64_t>(s, std::numeric_limits<uint32_t>::max() - 1);
+}
+
+bool LinkQualityEstimator::isBetter(network_interface_t candidate, network_interface_t current, system_tick_t now) const {
+    if (candidate == current || !isValid(candidate, now) || !isValid(current, now)) {
+        return false;
+    }
+    return (uint64_t)score(candidate, now) * (100 + HYSTERESIS_PERCENT) < (uint64_t)score(current, now) * 100;
+}
+
+void LinkQualityEstimator::reset(network_interface_t iface) {
+    const auto l = link(iface, false /* create */);
+    if (l) {
+        *l = Link();
+    }
+}
+
+LinkQualityEstimator::Link* LinkQualityEstimator::link(network_interface_t iface, bool create) {
+    Link* oldest = nullptr;
+    for (auto& l: links_) {
+        if (l.used && l.iface == iface) {
+            return &l;
+        }
+        if (!oldest || (oldest->used && (!l.used || l.lastUpdate < oldest->lastUpdate))) {
+            oldest = &l;
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+    *oldest = Link();
+    oldest->iface = iface;
+    oldest->used = true;
+    return oldest;
+}
+
+const LinkQualityEstimator::Link* LinkQualityEstimator::link(network_interface_t iface) const {
+    for (auto& l: links_) {
+        if (l.used && l.iface == iface) {
+            return &l;
+        }
+    }
+    return nullptr;
+}
+
+} } /* particle::system */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "inet_hal_compat.h"
+#include "system_tick_hal.h"
+
+#include <cstdint>
+
+namespace particle { namespace system {
+
+/**
+ * Passive estimator of the quality of the network links.
+ *
+ * The estimator maintains an exponentially weighted moving average of the round-trip time and
+ * loss rate of each network interface. It is fed with the observations of the regular traffic
+ * (CoAP round trips, retransmissions, socket errors) and with the results of the reachability
+ * tests, and does not generate any traffic itself.
+ */
+class LinkQualityEstimator {
+public:
+    /**
+     * Link quality estimate.
+     */
+    struct Estimate {
+        system_tick_t rtt; ///< Smoothed round-trip time in milliseconds.
+        unsigned loss; ///< Smoothed loss rate in 1/1000 units.
+        unsigned samples; ///< Number of samples.
+        system_tick_t lastUpdate; ///< Time of the last update.
+    };
+
+    /**
+     * Maximum number of network interfaces tracked by the estimator.
+     */
+    static const unsigned MAX_LINKS = 4;
+
+    /**
+     * Minimum number of samples required for an estimate to be considered valid.
+     */
+    static const unsigned MIN_SAMPLES = 4;
+
+    /**
+     * Time after which an estimate is no longer considered valid.
+     */
+    static const system_tick_t MAX_ESTIMATE_AGE = 10 * 60 * 1000;
+
+    /**
+     * How much better a link needs to be, in percent, before switching to it is recommended.
+     */
+    static const unsigned HYSTERESIS_PERCENT = 25;
+
+    LinkQualityEstimator();
+
+    /**
+     * Add a round-trip time sample.
+     *
+     * @param iface Network interface.
+     * @param rtt Round-trip time in milliseconds.
+     * @param now Current time.
+     */
+    void addRoundTrip(network_interface_t iface, system_tick_t rtt, system_tick_t now);
+
+    /**
+     * Add delivery outcome samples.
+     *
+     * @param iface Network interface.
+     * @param delivered Number of delivered messages.
+     * @param lost Number of lost messages.
+     * @param now Current time.
+     */
+    void addDeliveries(network_interface_t iface, unsigned delivered, unsigned lost, system_tick_t now);
+
+    /**
+     * Record a socket error. The error is accounted as a lost message.
+     *
+     * @param iface Network interface.
+     * @param now Current time.
+     */
+    void addSocketError(network_interface_t iface, system_tick_t now);
+
+    /**
+     * Get the estimate for a network interface.
+     *
+     * @param iface Network interface.
+     * @param[out] estimate Estimate.
+     * @return 0 on success, or `SYSTEM_ERROR_NOT_FOUND` if there are no samples for the interface.
+     */
+    int getEstimate(network_interface_t iface, Estimate* estimate) const;
+
+    /**
+     * Check if the estimate for a network interface is valid.
+     */
+    bool isValid(network_interface_t iface, system_tick_t now) const;
+
+    /**
+     * Get the score of a network interface. Lower is better.
+     *
+     * The score is the round-trip time adjusted by the expected number of transmission attempts.
+     *
+     * @return Score, or `UINT32_MAX` if the estimate for the interface is not valid.
+     */
+    uint32_t score(network_interface_t iface, system_tick_t now) const;
+
+    /**
+     * Check if switching from one network interface to another is recommended.
+     *
+     * @param candidate Candidate network interface.
+     * @param current Current network interface.
+     * @param now Current time.
+     * @return `true` if both estimates are valid and the candidate is better than the current
+     *         interface by more than `HYSTERESIS_PERCENT`.
+     */
+    bool isBetter(network_interface_t candidate, network_interface_t current, system_tick_t now) const;
+
+    /**
+     * Discard the samples for a network interface.
+     */
+    void reset(network_interface_t iface);
+
+private:
+    struct Link {
+        network_interface_t iface;
+        uint32_t rtt; // Smoothed RTT scaled by 8
+        uint32_t loss; // Smoothed loss rate scaled by 65536
+        unsigned rttSamples;
+        unsigned lossSamples;
+        system_tick_t lastUpdate;
+        bool used;
+    };
+
+    Link links_[MAX_LINKS];
+
+    Link* link(network_interface_t iface, bool create);
+    const Link* link(network_interface_t iface) const;
+};
+
+} } /* particle::system */
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_loop_profiler.h"
+
+#include "spark_wiring_json.h"
+#include "spark_wiring_diagnostics.h"
+#include "timer_hal.h"
+#include "hal_platform.h"
+#include "system_error.h"
+#include "atomic_section.h"
+#include "check.h"
+
+#if HAL_PLATFORM_SYSTEM_HW_TICKS
+#include "hw_ticks.h"
+#endif
+
+#include <algorithm>
+#include <limits>
+#include <new>
+
+namespace particle { namespace system {
+
+namespace {
+
+const char* const STAGE_NAMES[] = {
+    "isr_task_queue",
+    "button",
+    "network",
+    "smart_config",
+    "ip_config",
+    "cloud",
+    "firmware_update",
+    "listening_mode",
+    "backup_ram",
+    "system_cache",
+    "control",
+    "ble_prov_mode",
+    "shutdown",
+    "system_loop",
+    "app_loop",
+    "system_task",
+    "app_task"
+};
+
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == LoopProfiler::STAGE_COUNT,
+        "Invalid number of stage names");
+
+uint32_t hardwareTicks() {
+#if HAL_PLATFORM_SYSTEM_HW_TICKS
+    return SYSTEM_TICK_COUNTER;
+#else
+    return HAL_Timer_Get_Micro_Seconds();
+#endif
+}
+
+uint32_t hardwareTicksPerMicrosecond() {
+#if HAL_PLATFORM_SYSTEM_HW_TICKS
+    return SYSTEM_US_TICKS;
+#else
+    return 1;
+#endif
+}
+
+class AppenderJsonWriter: public spark::JSONWriter {
+public:
+    explicit AppenderJsonWriter(Appender* appender) :
+            appender_(appender),
+            ok_(true) {
+    }
+
+    bool isOk() const {
+        return ok_;
+    }
+
+protected:
+    void write(const char* data, size_t size) override {
+        ok_ = ok_ && appender_->append((const uint8_t*)data, size);
+    }
+
+private:
+    Appender* appender_;
+    bool ok_;
+};
+
+} // namespace
+
+struct LoopProfiler::StageData {
+    uint64_t total;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    // The bucket counts are halved when one of them would overflow, which preserves the shape
+    // of the distribution
+    uint16_t buckets[BUCKET_COUNT];
+};
+
+LoopProfiler::LoopProfiler(ClockFn clock, uint32_t ticksPerMicrosecond) :
+        clock_(clock ? clock : hardwareTicks),
+        ticksPerUs_(ticksPerMicrosecond ? ticksPerMicrosecond : (clock ? 1 : hardwareTicksPerMicrosecond())),
+        enabled_(false) {
+}
+
+LoopProfiler::~LoopProfiler() {
+}
+
+int LoopProfiler::enable() {
+    if (!stages_) {
+        stages_.reset(new(std::nothrow) StageData[STAGE_COUNT]);
+        CHECK_TRUE(stages_, SYSTEM_ERROR_NO_MEMORY);
+        reset();
+    }
+    enabled_.store(true, std::memory_order_release);
+    return 0;
+}
+
+void LoopProfiler::disable() {
+    enabled_.store(false, std::memory_order_release);
+}
+
+void LoopProfiler::end(Stage stage, uint32_t startTicks) {
+    // The tick counter is expected to wrap around, e.g. the cycle counter of a 64 MHz CPU wraps
+    // around every 67 seconds, which is much longer than any loop stage is expected to take
+    add(stage, (clock_() - startTicks) / ticksPerUs_);
+}
+
+void LoopProfiler::add(Stage stage, uint32_t duration) {
+    const auto d = stageData(stage);
+    if (!d) {
+        return;
+    }
+    const auto bucket = AbstractHistogramDiagnosticData::bucketIndex(duration, SUB_BUCKET_BITS, BUCKET_COUNT);
+    // The statistics of the application stages are updated by the application thread while they
+    // can be read or reset by the system thread at any time
+    AtomicSection lk;
+    d->total += duration;
+    ++d->count;
+    d->min = std::min(d->min, duration);
+    d->max = std::max(d->max, duration);
+    auto& b = d->buckets[bucket];
+    if (b == std::numeric_limits<uint16_t>::max()) {
+        for (auto& v: d->buckets) {
+            v = (v + 1) / 2;
+        }
+    }
+    ++b;
+}
+
+int LoopProfiler::getStats(Stage stage, Stats* stats) const {
+    StageData data;
+    if (!snapshot(stage, &data)) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    const auto d = &data;
+    *stats = Stats();
+    stats->count = d->count;
+    if (!stats->count) {
+        return 0;
+    }
+    stats->total = d->total;
+    stats->min = d->min;
+    stats->max = d->max;
+    stats->avg = d->total / stats->count;
+    // Find the bucket containing the 99th percentile and use its upper bound as the estimate
+    uint32_t n = 0;
+    for (const auto b: d->buckets) {
+        n += b;
+    }
+    const uint32_t rank = n - n / 100;
+    uint32_t sum = 0;
+    unsigned i = 0;
+    for (; i < BUCKET_COUNT - 1; ++i) {
+        sum += d->buckets[i];
+        if (sum >= rank) {
+            break;
+        }
+    }
+    uint32_t p99 = stats->max;
+    if (i < BUCKET_COUNT - 1) {
+        p99 = std::min(p99, AbstractHistogramDiagnosticData::bucketLowerBound(i + 1, SUB_BUCKET_BITS) - 1);
+    }
+    stats->p99 = std::max(p99, stats->min);
+    return 0;
+}
+
+uint32_t LoopProfiler::getHistogram(Stage stage, uint32_t* counts) const {
+    StageData d;
+    if (!snapshot(stage, &d)) {
+        std::fill(counts, counts + BUCKET_COUNT, 0);
+        return 0;
+    }
+    std::copy(d.buckets, d.buckets + BUCKET_COUNT, counts);
+    return d.count;
+}
+
+void LoopProfiler::reset() {
+    if (!stages_) {
+        return;
+    }
+    StageData empty = StageData();
+    empty.min = std::numeric_limits<uint32_t>::max();
+    for (unsigned i = 0; i < STAGE_COUNT; ++i) {
+        AtomicSection lk;
+        stages_[i] = empty;
+    }
+}
+
+int LoopProfiler::format(Appender* appender) const {
+    AppenderJsonWriter json(appender);
+    json.beginObject();
+    json.name("enabled").value(isEnabled());
+    json.name("stages").beginArray();
+    for (unsigned i = 0; i < STAGE_COUNT; ++i) {
+        const auto stage = (Stage)i;
+        Stats s = {};
+        if (getStats(stage, &s) < 0 || !s.count) {
+            continue;
+        }
+        json.beginObject();
+        json.name("name").value(stageName(stage));
+        json.name("n").value((unsigned)s.count);
+        json.name("min").value((unsigned)s.min);
+        json.name("avg").value((unsigned)s.avg);
+        json.name("max").value((unsigned)s.max);
+        json.name("p99").value((unsigned)s.p99);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    return json.isOk() ? 0 : SYSTEM_ERROR_TOO_LARGE;
+}
+
+const char* LoopProfiler::stageName(Stage stage) {
+    if ((unsigned)stage >= STAGE_COUNT) {
+        return nullptr;
+    }
+    return STAGE_NAMES[stage];
+}
+
+LoopProfiler* LoopProfiler::instance() {
+    static LoopProfiler profiler;
+    return &profiler;
+}
+
+LoopProfiler::StageData* LoopProfiler::stageData(Stage stage) const {
+    if ((unsigned)stage >= STAGE_COUNT || !stages_) {
+        return nullptr;
+    }
+    return &stages_[stage];
+}
+
+bool LoopProfiler::snapshot(Stage stage, StageData* data) const {
+    const auto d = stageData(stage);
+    if (!d) {
+        return false;
+    }
+    AtomicSection lk;
+    *data = *d;
+    return true;
+}
+
+} } /* particle::system */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "appender.h"
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace particle { namespace system {
+
+/**
+ * Profiler of the system loop and of the tasks executed by the system and application threads.
+ *
+ * The profiler measures how long each stage of the loop takes and keeps the minimum, average
+ * and maximum duration of each stage, as well as a log-linear histogram of the durations used to
+ * estimate the 99th percentile. The profiler is disabled by default: while it's disabled, the
+ * instrumented code only checks a flag and doesn't read the clock.
+ */
+class LoopProfiler {
+public:
+    /**
+     * Profiled stage.
+     */
+    enum Stage {
+        ISR_TASK_QUEUE, ///< `process_isr_task_queue()`.
+        BUTTON, ///< `system_handle_button_clicks()`.
+        NETWORK, ///< `manage_network_connection()`.
+        SMART_CONFIG, ///< `manage_smart_config()`.
+        IP_CONFIG, ///< `manage_ip_config()`.
+        CLOUD, ///< `manage_cloud_connection()`.
+        FIRMWARE_UPDATE, ///< `FirmwareUpdate::process()`.
+        LISTENING_MODE, ///< `manage_listening_mode_flag()`.
+        BACKUP_RAM, ///< `hal_backup_ram_routine()`.
+        SYSTEM_CACHE, ///< `SystemCache::process()`.
+        CONTROL, ///< `SystemControl::run()`.
+        BLE_PROV_MODE, ///< `manage_ble_prov_mode()`.
+        SHUTDOWN, ///< `system_shutdown_if_needed()`.
+        SYSTEM_LOOP, ///< Whole iteration of the system loop (`Spark_Idle_Events()`).
+        APP_LOOP, ///< Application's `loop()`.
+        SYSTEM_TASK, ///< Task executed by the system thread.
+        APP_TASK, ///< Task executed by the application thread.
+        STAGE_COUNT ///< Number of stages.
+    };
+
+    /**
+     * Stage statistics. All durations are in microseconds.
+     */
+    struct Stats {
+        uint32_t count; ///< Number of times the stage was executed.
+        uint32_t min; ///< Minimum duration.
+        uint32_t avg; ///< Average duration.
+        uint32_t max; ///< Maximum duration.
+        uint32_t p99; ///< Estimated 99th percentile of the duration.
+        uint64_t total; ///< Total duration.
+    };
+
+    /**
+     * Clock function. Returns the current value of a free-running tick counter.
+     */
+    typedef uint32_t (*ClockFn)();
+
+    /**
+     * Number of histogram buckets per stage.
+     */
+    static const unsigned BUCKET_COUNT = 40;
+
+    /**
+     * Number of linear sub-buckets per power of two, log2.
+     *
+     * With 40 buckets and 2 sub-buckets the histogram covers durations of up to 786 ms with a
+     * relative error of the percentile estimate of at most 50%.
+     */
+    static const unsigned SUB_BUCKET_BITS = 1;
+
+    /**
+     * Construct a profiler.
+     *
+     * @param clock Clock function. If not specified, the CPU cycle counter is used on platforms
+     *        that have one, and the microsecond timer is used otherwise.
+     * @param ticksPerMicrosecond Number of clock ticks per microsecond.
+     */
+    explicit LoopProfiler(ClockFn clock = nullptr, uint32_t ticksPerMicrosecond = 0);
+    ~LoopProfiler();
+
+    /**
+     * Enable the profiler.
+     *
+     * The memory for the statistics is allocated when the profiler is enabled for the first time
+     * and is never released so that a stage that is being measured concurrently can be safely
+     * accounted.
+     *
+     * @return 0 on success, or `SYSTEM_ERROR_NO_MEMORY`.
+     */
+    int enable();
+
+    /**
+     * Disable the profiler. The collected statistics are retained.
+     */
+    void disable();
+
+    /**
+     * Check if the profiler is enabled.
+     */
+    bool isEnabled() const {
+        return enabled_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Get the current value of the tick counter.
+     */
+    uint32_t ticks() const {
+        return clock_();
+    }
+
+    /**
+     * Account a stage that started at a given tick count and ends now.
+     *
+     * @param stage Stage.
+     * @param startTicks Value of the tick counter when the stage started.
+     */
+    void end(Stage stage, uint32_t startTicks);
+
+    /**
+     * Account a stage of a given duration.
+     *
+     * @param stage Stage.
+     * @param duration Duration in microseconds.
+     */
+    void add(Stage stage, uint32_t duration);
+
+    /**
+     * Get the statistics for a stage.
+     *
+     * @param stage Stage.
+     * @param[out] stats Statistics.
+     * @return 0 on success, or `SYSTEM_ERROR_INVALID_STATE` if the profiler has never been enabled.
+     */
+    int getStats(Stage stage, Stats* stats) const;
+
+    /**
+     * Get the histogram of the durations of a stage.
+     *
+     * @param stage Stage.
+     * @param[out] counts Bucket counts. The array must have `BUCKET_COUNT` elements.
+     * @return Number of recorded durations.
+     */
+    uint32_t getHistogram(Stage stage, uint32_t* counts) const;
+
+    /**
+     * Discard the collected statistics.
+     */
+    void reset();
+
+    /**
+     * Format the statistics of the executed stages as JSON.
+     *
+     * @param appender Appender.
+     * @return 0 on success, or a negative result code in case of an error.
+     */
+    int format(Appender* appender) const;
+
+    /**
+     * Get the name of a stage.
+     */
+    static const char* stageName(Stage stage);
+
+    /**
+     * Get the global instance of the profiler.
+     */
+    static LoopProfiler* instance();
+
+private:
+    struct StageData;
+
+    std::unique_ptr<StageData[]> stages_;
+    ClockFn clock_;
+    uint32_t ticksPerUs_;
+    std::atomic<bool> enabled_;
+
+    StageData* stageData(Stage stage) const;
+    bool snapshot(Stage stage, StageData* data) const;
+};
+
+/**
+ * Accounts the enclosing scope as a stage of the profiled loop.
+ */
+class LoopProfilerScope {
+public:
+    LoopProfilerScope(LoopProfiler* profiler, LoopProfiler::Stage stage) :
+            profiler_(profiler->isEnabled() ? profiler : nullptr),
+            start_(profiler_ ? profiler_->ticks() : 0),
+            stage_(stage) {
+    }
+
+    explicit LoopProfilerScope(LoopProfiler::Stage stage) :
+            LoopProfilerScope(LoopProfiler::instance(), stage) {
+    }
+
+    ~LoopProfilerScope() {
+        if (profiler_) {
+            profiler_->end(stage_, start_);
+        }
+    }
+
+    LoopProfilerScope(const LoopProfilerScope&) = delete;
+    LoopProfilerScope& operator=(const LoopProfilerScope&) = delete;
+
+private:
+    LoopProfiler* profiler_;
+    uint32_t start_;
+    LoopProfiler::Stage stage_;
+};
+
+} } /* particle::system */
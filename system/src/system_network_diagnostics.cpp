@@ -580,6 +580,57 @@ public:
         return SYSTEM_ERROR_NONE;
     }
 } g_altNetworkAccessTechnologyDiagData;
+
+// Passive link quality estimates maintained by the connection manager
+class LinkQualityDiagnosticData : public AbstractUnsignedIntegerDiagnosticData
+{
+public:
+    enum Field {
+        ROUND_TRIP, // Milliseconds
+        LOSS // 1/1000 units
+    };
+
+    LinkQualityDiagnosticData(DiagnosticDataId id, const char* name, bool primary, Field field)
+        : AbstractUnsignedIntegerDiagnosticData(id, name),
+          primary_(primary),
+          field_(field)
+    {
+    }
+
+    virtual int get(IntType& val)
+    {
+        const auto manager = system::ConnectionManager::instance();
+        const auto cloudNetwork = manager->getCloudConnectionNetwork();
+        system::LinkQualityEstimator::Estimate estimate = {};
+        int r = SYSTEM_ERROR_NOT_FOUND;
+        for (const auto& i: system::ConnectionTester::getSupportedInterfaces()) {
+            if ((i.first == cloudNetwork) == primary_) {
+                r = manager->getLinkQualityEstimate(i.first, &estimate);
+                if (r == 0) {
+                    break;
+                }
+            }
+        }
+        CHECK(r);
+
+        val = (field_ == ROUND_TRIP) ? estimate.rtt : estimate.loss;
+
+        return SYSTEM_ERROR_NONE;
+    }
+
+private:
+    bool primary_;
+    Field field_;
+};
+
+LinkQualityDiagnosticData g_linkRoundTripDiagData(DIAG_ID_NETWORK_LINK_ROUND_TRIP, DIAG_NAME_NETWORK_LINK_ROUND_TRIP,
+        true /* primary */, LinkQualityDiagnosticData::ROUND_TRIP);
+LinkQualityDiagnosticData g_linkLossDiagData(DIAG_ID_NETWORK_LINK_LOSS, DIAG_NAME_NETWORK_LINK_LOSS,
+        true /* primary */, LinkQualityDiagnosticData::LOSS);
+LinkQualityDiagnosticData g_altLinkRoundTripDiagData(DIAG_ID_ALT_NETWORK_LINK_ROUND_TRIP, DIAG_NAME_ALT_NETWORK_LINK_ROUND_TRIP,
+        false /* primary */, LinkQualityDiagnosticData::ROUND_TRIP);
+LinkQualityDiagnosticData g_altLinkLossDiagData(DIAG_ID_ALT_NETWORK_LINK_LOSS, DIAG_NAME_ALT_NETWORK_LINK_LOSS,
+        false /* primary */, LinkQualityDiagnosticData::LOSS);
 #endif // HAL_PLATFORM_AUTOMATIC_CONNECTION_MANAGEMENT
 
 } // namespace
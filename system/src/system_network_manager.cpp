@@ -29,6 +29,7 @@ LOG_SOURCE_CATEGORY("system.nm")
 #include "system_error.h"
 #include <mutex>
 #include "system_led_signal.h"
+#include "system_describe_cache.h"
 #include "enumclass.h"
 #if HAL_PLATFORM_WIFI && HAL_PLATFORM_NCP
 #include "network/ncp/wifi/ncp.h"
@@ -678,6 +679,10 @@ void NetworkManager::handleIfPowerState(if_t iface, const struct if_event* ev) {
         uint8_t index;
         if_get_index(iface, &index);
         LOG(TRACE, "Interface %d power state changed: %s", index, powerStateToName(state->pwrState.load()));
+        if (state->pwrState == IF_POWER_STATE_UP) {
+            // The system Describe includes the modem information that is only available when it's on
+            DescribeCache::instance()->invalidate(DescribeCache::SYSTEM);
+        }
     }
 }
 
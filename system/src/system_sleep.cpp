@@ -40,6 +40,9 @@ LOG_SOURCE_CATEGORY("system.sleep");
 #endif // HAL_PLATFORM_CELLULAR
 #include "check.h"
 #include "system_network_manager.h"
+#if HAL_PLATFORM_FILESYSTEM
+#include "system_cache.h"
+#endif // HAL_PLATFORM_FILESYSTEM
 
 using namespace particle;
 using namespace particle::system;
@@ -190,6 +193,11 @@ int system_sleep_ext_impl(const hal_sleep_config_t* config, hal_wakeup_source_ba
     led_set_update_enabled(0, nullptr); // Disable background LED updates
     LED_Off(PARTICLE_LED_RGB);
 
+#if HAL_PLATFORM_FILESYSTEM
+    // Write the pending modifications of the system cache to the filesystem
+    services::SystemCache::flush();
+#endif // HAL_PLATFORM_FILESYSTEM
+
     system_power_management_sleep(configHelper.wakeupByFuelGauge() ? false : true);
 
     // Now enter sleep mode
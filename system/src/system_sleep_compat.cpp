@@ -31,6 +31,9 @@
 #include "spark_wiring_system.h"
 #include "system_sleep_configuration.h"
 #include "check.h"
+#if HAL_PLATFORM_FILESYSTEM
+#include "system_cache.h"
+#endif // HAL_PLATFORM_FILESYSTEM
 
 using namespace particle;
 
@@ -103,6 +106,11 @@ int system_sleep_enter_standby_compat(long seconds, uint32_t param) {
         config.gpio(WKP, RISING);
     }
 
+#if HAL_PLATFORM_FILESYSTEM
+    // Write the pending modifications of the system cache to the filesystem
+    services::SystemCache::flush();
+#endif // HAL_PLATFORM_FILESYSTEM
+
     SystemSleepConfigurationHelper configHelper(config.halConfig());
     system_power_management_sleep(configHelper.wakeupByFuelGauge() ? false : true);
 
@@ -125,6 +133,11 @@ int system_sleep_enter_stop_compat(const uint16_t* pins, size_t pins_count, cons
         config.gpio(pins[i], ((i < modes_count) ? modes[i] : modes[modes_count - 1]));
     }
 
+#if HAL_PLATFORM_FILESYSTEM
+    // Write the pending modifications of the system cache to the filesystem
+    services::SystemCache::flush();
+#endif // HAL_PLATFORM_FILESYSTEM
+
     SystemSleepConfigurationHelper configHelper(config.halConfig());
     system_power_management_sleep(configHelper.wakeupByFuelGauge() ? false : true);
 
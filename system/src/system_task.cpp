@@ -48,6 +48,8 @@
 #include "system_power.h"
 #include "simple_pool_allocator.h"
 #include "system_ble_prov.h"
+#include "system_loop_profiler.h"
+#include "system_cloud_connection_timer.h"
 
 #include "spark_wiring_network.h"
 #include "spark_wiring_constants.h"
@@ -67,6 +69,10 @@
 
 #include "backup_ram_hal.h"
 
+#if HAL_PLATFORM_FILESYSTEM
+#include "system_cache.h"
+#endif
+
 using namespace particle;
 using namespace particle::system;
 using spark::Network;
@@ -309,6 +315,7 @@ void establish_cloud_connection()
         int connect_result = spark_cloud_socket_connect();
         if (connect_result >= 0)
         {
+            CloudConnectionTimer::instance()->phaseDone(CloudConnectionTimer::SOCKET, HAL_Timer_Get_Milli_Seconds());
             SPARK_CLOUD_SOCKETED = 1;
             INFO("Cloud socket connected");
             // "Connected" event is generated only after a successful handshake
@@ -372,6 +379,13 @@ void handle_cloud_connection(bool force_events)
                     err = protocol::MESSAGE_TIMEOUT;
                 } else {
                     INFO("Cloud connected");
+                    const auto timer = CloudConnectionTimer::instance();
+                    if (timer->finish(HAL_Timer_Get_Milli_Seconds())) {
+                        char buf[128] = {};
+                        if (timer->format(buf, sizeof(buf)) >= 0) {
+                            INFO("Connected in %u ms (%s)", (unsigned)timer->totalDuration(), buf);
+                        }
+                    }
                     SPARK_CLOUD_CONNECTED = 1;
                     SPARK_CLOUD_HANDSHAKE_NOTIFY_DONE = 0;
                     cloud_failed_connection_attempts = 0;
@@ -400,6 +414,9 @@ void handle_cloud_connection(bool force_events)
             } else { // !SPARK_CLOUD_HANDSHAKE_NOTIFY_DONE
                 LED_SIGNAL_START(CLOUD_HANDSHAKE, NORMAL);
                 err = cloud_handshake();
+                if (!err) {
+                    CloudConnectionTimer::instance()->phaseDone(CloudConnectionTimer::HANDSHAKE, HAL_Timer_Get_Milli_Seconds());
+                }
             }
             if (err)
             {
@@ -439,6 +456,9 @@ void manage_cloud_connection(bool force_events)
 {
     if (spark_cloud_flag_auto_connect() == 0)
     {
+        CloudConnectionTimer::instance()->cancel();
+        // Release the socket created ahead of a connection attempt
+        spark_cloud_socket_discard_prepared();
         cloud_disconnect(CLOUD_DISCONNECT_GRACEFULLY, CLOUD_DISCONNECT_REASON_USER);
     }
     else // cloud connection is wanted
@@ -447,6 +467,22 @@ void manage_cloud_connection(bool force_events)
         ConnectionManager::instance()->checkCloudConnectionNetwork();
 #endif // HAL_PLATFORM_IFAPI
 
+        if (!SPARK_CLOUD_SOCKETED && !SPARK_WLAN_SLEEP) {
+            const auto timer = CloudConnectionTimer::instance();
+            const auto now = HAL_Timer_Get_Milli_Seconds();
+            if (!SPARK_CLOUD_CONNECTED) {
+                timer->start(now);
+            }
+            if (network_ready(0, 0, 0)) {
+                timer->phaseDone(CloudConnectionTimer::NETWORK, now);
+            }
+            // Do the work that doesn't depend on the network while the network is still connecting,
+            // and resolve the server address and create the socket as soon as the network is ready,
+            // including while the connection attempt is delayed by the backoff period
+            spark_cloud_socket_prepare();
+            spark_protocol_command(spark_protocol_instance(), ProtocolCommands::PRECOMPUTE_KEYS, 0, nullptr);
+        }
+
         establish_cloud_connection();
 
         handle_cloud_connection(force_events);
@@ -509,30 +545,65 @@ void Spark_Idle_Events(bool force_events/*=false*/)
     ON_EVENT_DELTA();
     spark_loop_total_millis = 0;
 
-    process_isr_task_queue();
+    const auto profiler = LoopProfiler::instance();
+    LoopProfilerScope loopScope(profiler, LoopProfiler::SYSTEM_LOOP);
+
+    {
+        LoopProfilerScope scope(profiler, LoopProfiler::ISR_TASK_QUEUE);
+        process_isr_task_queue();
+    }
 
     if (!SYSTEM_POWEROFF) {
 
 #if HAL_PLATFORM_SETUP_BUTTON_UX
-        system_handle_button_clicks(false /* isIsr */);
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::BUTTON);
+            system_handle_button_clicks(false /* isIsr */);
+        }
 #endif
 
-        manage_network_connection();
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::NETWORK);
+            manage_network_connection();
+        }
 
-        manage_smart_config();
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::SMART_CONFIG);
+            manage_smart_config();
+        }
 
-        manage_ip_config();
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::IP_CONFIG);
+            manage_ip_config();
+        }
 
-        manage_cloud_connection(force_events);
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::CLOUD);
+            manage_cloud_connection(force_events);
+        }
 
-        system::FirmwareUpdate::instance()->process();
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::FIRMWARE_UPDATE);
+            system::FirmwareUpdate::instance()->process();
+        }
 
         if (system_mode() != SAFE_MODE) {
+            LoopProfilerScope scope(profiler, LoopProfiler::LISTENING_MODE);
             manage_listening_mode_flag();
         }
 
 #if HAL_PLATFORM_BACKUP_RAM_NEED_SYNC
-        hal_backup_ram_routine();
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::BACKUP_RAM);
+            hal_backup_ram_routine();
+        }
+#endif
+
+#if HAL_PLATFORM_FILESYSTEM
+        {
+            LoopProfilerScope scope(profiler, LoopProfiler::SYSTEM_CACHE);
+            services::SystemCache::process();
+        }
 #endif
     }
     else
@@ -540,13 +611,20 @@ void Spark_Idle_Events(bool force_events/*=false*/)
         system_pending_shutdown(RESET_REASON_USER);
     }
 #if HAL_PLATFORM_BLE_SETUP
-    // TODO: Process BLE channel events in a separate thread
-    system::SystemControl::instance()->run();
+    {
+        // TODO: Process BLE channel events in a separate thread
+        LoopProfilerScope scope(profiler, LoopProfiler::CONTROL);
+        system::SystemControl::instance()->run();
+    }
     if (system_mode() != SAFE_MODE) {
+        LoopProfilerScope scope(profiler, LoopProfiler::BLE_PROV_MODE);
         manage_ble_prov_mode();
     }
 #endif
-    system_shutdown_if_needed();
+    {
+        LoopProfilerScope scope(profiler, LoopProfiler::SHUTDOWN);
+        system_shutdown_if_needed();
+    }
 }
 
 namespace {
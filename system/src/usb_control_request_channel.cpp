@@ -206,12 +206,19 @@ void cancelNetworkConnectionIfNeeded(uint16_t type) {
 
 } // namespace
 
-particle::UsbControlRequestChannel::UsbControlRequestChannel(ControlRequestHandler* handler) :
+particle::UsbControlRequestChannel::UsbControlRequestChannel(ControlRequestHandler* handler, size_t ringBufferSize) :
         ControlRequestChannel(handler),
         activeReqs_(nullptr),
         curReq_(nullptr),
         activeReqCount_(0),
         lastReqId_(USB_REQUEST_INVALID_ID) {
+    if (ringBufferSize > 0) {
+        // Fall back to the regular mode if the buffer cannot be allocated
+        ringBuf_.reset(new(std::nothrow) char[ringBufferSize]);
+        if (ringBuf_) {
+            ringAlloc_.init(ringBuf_.get(), ringBufferSize);
+        }
+    }
     // Set HAL callbacks
     ATOMIC_BLOCK() {
         HAL_USB_Set_Vendor_Request_Callback(halVendorRequestCallback, this);
@@ -248,6 +255,12 @@ void particle::UsbControlRequestChannel::freeRequestData(ctrl_request* ctrlReq)
         // Release a pooled buffer
         system_pool_free(req->request_data, nullptr);
         req->flags &= ~RequestFlag::POOLED_REQ_DATA;
+    } else if (req->flags & RequestFlag::RING_REQ_DATA) {
+        // Release a buffer allocated from the ring buffer
+        ATOMIC_BLOCK() {
+            freeRingBuffer(req->request_data);
+        }
+        req->flags &= ~RequestFlag::RING_REQ_DATA;
     } else {
         // Free a dynamically allocated buffer
         t_free(req->request_data);
@@ -299,7 +312,8 @@ bool particle::UsbControlRequestChannel::processInitRequest(HAL_USB_SetupRequest
     if (halReq->wLength < MIN_WLENGTH || !halReq->data) {
         return false; // Unexpected length of the data stage
     }
-    if (activeReqCount_ >= USB_REQUEST_MAX_ACTIVE_COUNT) {
+    const size_t maxActiveCount = isPipelined() ? USB_REQUEST_MAX_PIPELINED_COUNT : USB_REQUEST_MAX_ACTIVE_COUNT;
+    if (activeReqCount_ >= maxActiveCount) {
         return ServiceReply().status(ServiceReply::BUSY).encode(halReq); // Too many active requests
     }
     // Allocate a request object from the pool
@@ -332,6 +346,12 @@ bool particle::UsbControlRequestChannel::processInitRequest(HAL_USB_SetupRequest
         // Depending on the request type, we may need to abort the network connection in order to
         // unblock the system thread and process the request as quickly as possible
         cancelNetworkConnectionIfNeeded(req->type);
+    } else if ((req->request_data = allocRingBuffer(req->request_size))) {
+        // The host sends the payload data directly to the ring buffer and the request handler
+        // gets a pointer to the same buffer
+        req->flags |= RequestFlag::RING_REQ_DATA;
+        req->state = RequestState::RECV_PAYLOAD; // TODO: Start a timer
+        status = ServiceReply::OK;
     } else if (req->request_size <= USB_REQUEST_MAX_POOLED_BUFFER_SIZE &&
             (req->request_data = (char*)system_pool_alloc(req->request_size, nullptr))) {
         // Device is ready to receive payload data
@@ -555,6 +575,19 @@ bool particle::UsbControlRequestChannel::processVendorRequest(HAL_USB_SetupReque
     return true;
 }
 
+// Note: This method is called from an ISR
+char* particle::UsbControlRequestChannel::allocRingBuffer(size_t size) {
+    if (!isPipelined()) {
+        return nullptr;
+    }
+    return (char*)ringAlloc_.alloc(size);
+}
+
+// Note: This method needs to be called with interrupts disabled
+void particle::UsbControlRequestChannel::freeRingBuffer(char* data) {
+    ringAlloc_.free(data);
+}
+
 // Note: This method is called from an ISR
 void particle::UsbControlRequestChannel::finishActiveRequest(Request* req) {
     // Update list of active requests
@@ -575,6 +608,9 @@ void particle::UsbControlRequestChannel::finishActiveRequest(Request* req) {
         if (req->request_data && (req->flags & RequestFlag::POOLED_REQ_DATA)) {
             system_pool_free(req->request_data, nullptr);
             req->request_data = nullptr;
+        } else if (req->request_data && (req->flags & RequestFlag::RING_REQ_DATA)) {
+            freeRingBuffer(req->request_data);
+            req->request_data = nullptr;
         }
         if (!req->request_data && !req->reply_data && !req->handler) {
             systemPoolDelete(req);
@@ -24,12 +24,18 @@
 #include "system_control.h"
 #include "control_request_handler.h"
 #include "active_object.h"
+#include "ring_allocator.h"
+
+#include <memory>
 
 namespace particle {
 
 // Maximum number of asynchronous requests that can be active at the same time
 const size_t USB_REQUEST_MAX_ACTIVE_COUNT = 4;
 
+// Maximum number of asynchronous requests that can be active at the same time in the pipelined mode
+const size_t USB_REQUEST_MAX_PIPELINED_COUNT = 16;
+
 // Maximum size of the payload data
 const size_t USB_REQUEST_MAX_PAYLOAD_SIZE = 65535;
 
@@ -42,9 +48,13 @@ const uint16_t USB_REQUEST_INVALID_ID = 0;
 // Class implementing the asynchronous USB request protocol
 class UsbControlRequestChannel: public ControlRequestChannel {
 public:
-    explicit UsbControlRequestChannel(ControlRequestHandler* handler);
+    // If `ringBufferSize` is not 0, the channel operates in the pipelined mode: request data is
+    // stored in a preallocated ring buffer and more requests can be active at the same time
+    explicit UsbControlRequestChannel(ControlRequestHandler* handler, size_t ringBufferSize = 0);
     ~UsbControlRequestChannel();
 
+    bool isPipelined() const;
+
     // ControlRequestChannel
     virtual int allocReplyData(ctrl_request* ctrlReq, size_t size) override;
     virtual void freeRequestData(ctrl_request* ctrlReq) override;
@@ -62,7 +72,8 @@ private:
 
     // Request flags
     enum RequestFlag {
-        POOLED_REQ_DATA = 0x01 // Request buffer is allocated from the pool
+        POOLED_REQ_DATA = 0x01, // Request buffer is allocated from the pool
+        RING_REQ_DATA = 0x02 // Request buffer is allocated from the ring buffer
     };
 
     struct Request;
@@ -86,6 +97,8 @@ private:
         uint8_t flags; // Request flags
     };
 
+    std::unique_ptr<char[]> ringBuf_; // Ring buffer for request data
+    services::RingAllocator ringAlloc_; // Allocator for the ring buffer
     Request* activeReqs_; // List of active requests
     Request* curReq_; // A request currently being processed by the USB subsystem
     uint16_t activeReqCount_; // Number of active requests
@@ -99,6 +112,9 @@ private:
     bool processResetRequest(HAL_USB_SetupRequest* halReq);
     bool processVendorRequest(HAL_USB_SetupRequest* halReq);
 
+    char* allocRingBuffer(size_t size);
+    void freeRingBuffer(char* data);
+
     void finishActiveRequest(Request* req);
     void finishRequest(Request* req);
 
@@ -110,6 +126,10 @@ private:
     static uint8_t halVendorRequestStateCallback(HAL_USB_VendorRequestState state, void* data);
 };
 
+inline bool UsbControlRequestChannel::isPipelined() const {
+    return (bool)ringBuf_;
+}
+
 } // namespace particle
 
 #endif // defined(USB_VENDOR_REQUEST_ENABLE)
@@ -26,6 +26,16 @@
 
 #include "mock/mock_types.h"
 #include "system_publish_vitals.h"
+#include "system_diag_delta.h"
+#include "system_error.h"
+#include "appender.h"
+#include "varint.h"
+
+#include "util/random.h"
+
+#include <map>
+#include <random>
+#include <string>
 
 bool spark_cloud_flag_connected_called;
 int spark_cloud_flag_connected_result;
@@ -382,3 +392,325 @@ TEST_CASE("Publishing vitals", "[VitalsPublisher::publish]")
         }
     }
 }
+
+namespace {
+
+using particle::system::DiagnosticsDeltaEncoder;
+
+#define CHECK_DECODE(_expr) \
+        do { \
+            const int _r = _expr; \
+            if (_r < 0) { \
+                return _r; \
+            } \
+        } while (false)
+
+typedef std::map<std::pair<uint16_t, bool>, int32_t> Snapshot; // (id, is_error) -> value
+
+class StringAppender: public particle::Appender {
+public:
+    bool append(const uint8_t* data, size_t size) override {
+        str.append((const char*)data, size);
+        return true;
+    }
+
+    std::string str;
+};
+
+// Emulates the decoding of the metrics on the server side
+class MetricsDecoder {
+public:
+    MetricsDecoder() :
+            lastKeyframe(false) {
+    }
+
+    // Decode a message and return the reconstructed values of all data sources
+    int decode(const std::string& data, Snapshot* values) {
+        const char* p = data.data();
+        const char* end = p + data.size();
+        if (end - p < 2 || p[0] != 0 || p[1] != 0) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+        p += 2;
+        uint32_t version = 0, flags = 0, seq = 0, baseSeq = 0;
+        CHECK_DECODE(readVarint(&p, end, &version));
+        if (version != DiagnosticsDeltaEncoder::VERSION || p == end) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+        flags = (uint8_t)*p++;
+        lastKeyframe = flags & DiagnosticsDeltaEncoder::KEYFRAME;
+        CHECK_DECODE(readVarint(&p, end, &seq));
+        Snapshot v;
+        if (!lastKeyframe) {
+            CHECK_DECODE(readVarint(&p, end, &baseSeq));
+            const auto it = acked.find(baseSeq);
+            if (it == acked.end()) {
+                return SYSTEM_ERROR_NOT_FOUND;
+            }
+            v = it->second;
+        }
+        while (p != end) {
+            uint32_t key = 0, zz = 0;
+            CHECK_DECODE(readVarint(&p, end, &key));
+            CHECK_DECODE(readVarint(&p, end, &zz));
+            const uint16_t id = key >> 1;
+            const bool error = key & 1;
+            int32_t value = particle::decodeZigZag(zz);
+            // A data source has either a value or an error
+            const auto other = v.find(std::make_pair(id, !error));
+            if (other != v.end()) {
+                v.erase(other);
+            }
+            const auto k = std::make_pair(id, error);
+            const auto it = v.find(k);
+            if (it != v.end()) {
+                value = (int32_t)((uint32_t)it->second + (uint32_t)value);
+            }
+            v[k] = value;
+        }
+        received[seq] = v;
+        *values = v;
+        return 0;
+    }
+
+    // Acknowledge a received message
+    void acknowledge(uint32_t seq) {
+        acked[seq] = received.at(seq);
+    }
+
+    bool lastKeyframe;
+
+private:
+    std::map<uint32_t, Snapshot> received;
+    std::map<uint32_t, Snapshot> acked;
+
+    static int readVarint(const char** p, const char* end, uint32_t* val) {
+        const int r = particle::decodeUnsignedVarint(*p, end - *p, val);
+        if (r < 0) {
+            return r;
+        }
+        *p += r;
+        return 0;
+    }
+};
+
+std::string encode(DiagnosticsDeltaEncoder* enc, const Snapshot& values) {
+    StringAppender appender;
+    REQUIRE(enc->begin(&appender) == 0);
+    for (const auto& v: values) {
+        REQUIRE(enc->add(v.first.first, v.second, v.first.second) == 0);
+    }
+    REQUIRE(enc->end() == 0);
+    return appender.str;
+}
+
+size_t recordCount(const std::string& data) {
+    // Skip the header
+    const bool keyframe = data[3] & DiagnosticsDeltaEncoder::KEYFRAME;
+    size_t offs = 4;
+    offs += particle::decodeUnsignedVarint(data.data() + offs, data.size() - offs, (uint32_t*)nullptr);
+    if (!keyframe) {
+        offs += particle::decodeUnsignedVarint(data.data() + offs, data.size() - offs, (uint32_t*)nullptr);
+    }
+    size_t count = 0;
+    while (offs < data.size()) {
+        offs += particle::decodeUnsignedVarint(data.data() + offs, data.size() - offs, (uint32_t*)nullptr);
+        offs += particle::decodeUnsignedVarint(data.data() + offs, data.size() - offs, (uint32_t*)nullptr);
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+SCENARIO("Delta-encoded vitals can be reconstructed by the server")
+{
+    DiagnosticsDeltaEncoder enc;
+    MetricsDecoder dec;
+    Snapshot values = {
+        { { 1, false }, 100 },
+        { { 2, false }, -5 },
+        { { 3, false }, 0 },
+        { { 4, true }, SYSTEM_ERROR_NOT_SUPPORTED },
+        { { 5, false }, std::numeric_limits<int32_t>::max() }
+    };
+
+    GIVEN("An encoder without an acknowledged message")
+    {
+        WHEN("The vitals are encoded")
+        {
+            const auto data = encode(&enc, values);
+            Snapshot decoded;
+            REQUIRE(dec.decode(data, &decoded) == 0);
+
+            THEN("A keyframe containing all data sources is sent")
+            {
+                CHECK(dec.lastKeyframe);
+                CHECK(recordCount(data) == values.size());
+                CHECK(decoded == values);
+            }
+        }
+    }
+
+    GIVEN("An encoder with an acknowledged message")
+    {
+        Snapshot base;
+        REQUIRE(dec.decode(encode(&enc, values), &base) == 0);
+        dec.acknowledge(enc.sequenceNumber());
+        enc.acknowledge();
+
+        WHEN("Some of the values change")
+        {
+            values[{ 1, false }] = 90;
+            values[{ 5, false }] = std::numeric_limits<int32_t>::min(); // Wraps around
+            const auto data = encode(&enc, values);
+            Snapshot decoded;
+            REQUIRE(dec.decode(data, &decoded) == 0);
+
+            THEN("Only the changed values are sent")
+            {
+                CHECK_FALSE(dec.lastKeyframe);
+                CHECK(recordCount(data) == 2);
+                CHECK(decoded == values);
+            }
+        }
+
+        WHEN("Nothing changes")
+        {
+            const auto data = encode(&enc, values);
+            Snapshot decoded;
+            REQUIRE(dec.decode(data, &decoded) == 0);
+
+            THEN("An empty delta is sent")
+            {
+                CHECK_FALSE(dec.lastKeyframe);
+                CHECK(recordCount(data) == 0);
+                CHECK(decoded == values);
+            }
+        }
+
+        WHEN("A data source switches between an error and a value")
+        {
+            values.erase({ 4, true });
+            values[{ 4, false }] = 42;
+            values.erase({ 2, false });
+            values[{ 2, true }] = SYSTEM_ERROR_BUSY;
+            Snapshot decoded;
+            REQUIRE(dec.decode(encode(&enc, values), &decoded) == 0);
+
+            THEN("The reconstructed values match")
+            {
+                CHECK(decoded == values);
+            }
+        }
+
+        WHEN("A message is not acknowledged")
+        {
+            values[{ 1, false }] = 1;
+            Snapshot unacked;
+            REQUIRE(dec.decode(encode(&enc, values), &unacked) == 0);
+            values[{ 3, false }] = 3;
+            const auto data = encode(&enc, values);
+            Snapshot decoded;
+            REQUIRE(dec.decode(data, &decoded) == 0);
+
+            THEN("The next delta is relative to the last acknowledged message")
+            {
+                CHECK(recordCount(data) == 2);
+                CHECK(decoded == values);
+            }
+        }
+
+        WHEN("The acknowledgement cannot be matched to a single message")
+        {
+            values[{ 1, false }] = 1;
+            encode(&enc, values); // Lost
+            values[{ 1, false }] = 2;
+            encode(&enc, values);
+            enc.acknowledge(); // Could be for either of the messages
+            values[{ 1, false }] = 3;
+            const auto data = encode(&enc, values);
+            Snapshot decoded;
+            REQUIRE(dec.decode(data, &decoded) == 0);
+
+            THEN("The acknowledgement is ignored")
+            {
+                CHECK(decoded == values);
+            }
+        }
+
+        WHEN("The encoder is reset")
+        {
+            enc.reset();
+            const auto data = encode(&enc, values);
+
+            THEN("A keyframe is sent")
+            {
+                Snapshot decoded;
+                REQUIRE(dec.decode(data, &decoded) == 0);
+                CHECK(dec.lastKeyframe);
+                CHECK(decoded == values);
+            }
+        }
+
+        WHEN("More than KEYFRAME_INTERVAL deltas are sent")
+        {
+            unsigned keyframes = 0;
+            for (unsigned i = 0; i < DiagnosticsDeltaEncoder::KEYFRAME_INTERVAL * 3; ++i) {
+                Snapshot decoded;
+                REQUIRE(dec.decode(encode(&enc, values), &decoded) == 0);
+                dec.acknowledge(enc.sequenceNumber());
+                enc.acknowledge();
+                if (dec.lastKeyframe) {
+                    ++keyframes;
+                }
+            }
+
+            THEN("A keyframe is sent periodically")
+            {
+                CHECK(keyframes == 2);
+            }
+        }
+    }
+
+    GIVEN("A device publishing randomly changing vitals over a lossy link")
+    {
+        // Typical vitals: most values are counters or slowly changing gauges
+        auto& gen = particle::test::randGen();
+        std::uniform_int_distribution<int32_t> initial(0, 1000000);
+        values.clear();
+        for (uint16_t id = 1; id <= 40; ++id) {
+            values[{ id, false }] = initial(gen);
+        }
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_int_distribution<int> step(-100, 100);
+        size_t deltaSize = 0;
+        size_t legacySize = 0;
+        for (unsigned i = 0; i < 1000; ++i) {
+            for (auto& v: values) {
+                if (percent(gen) < 20) {
+                    v.second += step(gen);
+                }
+            }
+            const auto data = encode(&enc, values);
+            deltaSize += data.size();
+            legacySize += 4 + values.size() * 6; // See BinaryDiagnosticsFormatter
+            if (percent(gen) < 10) {
+                continue; // The message is lost
+            }
+            Snapshot decoded;
+            REQUIRE(dec.decode(data, &decoded) == 0);
+            REQUIRE(decoded == values);
+            dec.acknowledge(enc.sequenceNumber());
+            if (percent(gen) < 10) {
+                continue; // The acknowledgement is lost
+            }
+            enc.acknowledge();
+        }
+
+        THEN("The encoded vitals are considerably smaller than in the legacy format")
+        {
+            CHECK(deltaSize * 2 < legacySize);
+        }
+    }
+}
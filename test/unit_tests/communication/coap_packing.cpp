@@ -0,0 +1,301 @@
+#include "coap_packing.h"
+#include "coap_channel.h"
+#include "publisher.h"
+
+#include "util/coap_message_channel.h"
+#include "util/protocol_stub.h"
+#include "util/bench.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace particle::protocol;
+
+using particle::CompletionHandler;
+
+namespace {
+
+system_tick_t g_millis = 0;
+
+system_tick_t currentMillis() {
+    return g_millis;
+}
+
+// Size of the IPv4, UDP and DTLS record headers, and the AES-CCM-8 explicit nonce and tag
+const size_t DATAGRAM_OVERHEAD = 20 + 8 + 13 + 8 + 8;
+
+struct Record {
+    std::string data;
+    system_tick_t time;
+};
+
+// Stores the records sent by the device as is
+class RecordingChannel: public test::CoapMessageChannel {
+public:
+    ProtocolError send(Message& msg) override {
+        records_.push_back({ std::string((const char*)msg.buf(), msg.length()), g_millis });
+        return ProtocolError::NO_ERROR;
+    }
+
+    // Returns the messages contained in the sent records
+    std::vector<test::CoapMessage> messages() const {
+        std::vector<test::CoapMessage> msgs;
+        for (const auto& r: records_) {
+            CoapPackedRecordReader reader((const uint8_t*)r.data.data(), r.data.size());
+            while (reader.next()) {
+                msgs.push_back(test::CoapMessage::decode((const char*)reader.data(), reader.size()));
+            }
+            REQUIRE_FALSE(reader.hasError());
+        }
+        return msgs;
+    }
+
+    std::vector<Record>& records() {
+        return records_;
+    }
+
+private:
+    std::vector<Record> records_;
+};
+
+typedef CoAPChannel<CoAPReliableChannel<CoAPPackingChannel<RecordingChannel, system_tick_t(*)()>, system_tick_t(*)()>> PackingChannel;
+
+class TestChannel: public PackingChannel {
+public:
+    TestChannel() {
+        set_millis(currentMillis);
+        set_packing_millis(currentMillis);
+        g_millis = 1000;
+    }
+
+    ProtocolError sendMessage(test::CoapMessage m) {
+        const auto s = m.encode();
+        Message msg;
+        create(msg);
+        memcpy(msg.buf(), s.data(), s.size());
+        msg.set_length(s.size());
+        return send(msg);
+    }
+
+    ProtocolError poll() {
+        Message msg;
+        create(msg);
+        return receive(msg);
+    }
+};
+
+test::CoapMessage nonEvent(const std::string& name) {
+    return test::CoapMessage().type(CoapType::NON).code(CoapCode::POST).id(0).option(CoapOption::URI_PATH, "E")
+            .option(CoapOption::URI_PATH, name);
+}
+
+} // namespace
+
+TEST_CASE("CoapMessagePacker") {
+    CoapMessagePacker p;
+
+    SECTION("doesn't accept messages when not initialized") {
+        CHECK_FALSE(p.append((const uint8_t*)"abcd", 4));
+        CHECK(p.count() == 0);
+        CHECK(p.size() == 0);
+    }
+
+    SECTION("sends a single message without the framing") {
+        REQUIRE(p.init() == 0);
+        REQUIRE(p.append((const uint8_t*)"abcd", 4));
+        CHECK(p.count() == 1);
+        CHECK(std::string((const char*)p.data(), p.size()) == "abcd");
+    }
+
+    SECTION("frames multiple messages") {
+        REQUIRE(p.init() == 0);
+        REQUIRE(p.append((const uint8_t*)"abcd", 4));
+        REQUIRE(p.append((const uint8_t*)"efghi", 5));
+        CHECK(p.count() == 2);
+        CHECK(std::string((const char*)p.data(), p.size()) == std::string("\x00\x00\x04" "abcd" "\x00\x05" "efghi", 14));
+        p.clear();
+        CHECK(p.count() == 0);
+        CHECK(p.size() == 0);
+    }
+
+    SECTION("limits the size of the record") {
+        REQUIRE(p.init(16) == 0);
+        const std::string s(16, 'a');
+        CHECK_FALSE(p.append((const uint8_t*)s.data(), 17));
+        REQUIRE(p.append((const uint8_t*)s.data(), 16)); // A single message is sent without the framing
+        CHECK_FALSE(p.append((const uint8_t*)s.data(), 1));
+        p.clear();
+        REQUIRE(p.append((const uint8_t*)s.data(), 6)); // 1 + 2 + 6
+        CHECK_FALSE(p.append((const uint8_t*)s.data(), 6)); // 9 + 2 + 6
+        REQUIRE(p.append((const uint8_t*)s.data(), 5));
+        CHECK(p.size() == 16);
+    }
+}
+
+TEST_CASE("CoapPackedRecordReader") {
+    SECTION("reads a packed record") {
+        const std::string r("\x00\x00\x04" "abcd" "\x00\x01" "e", 10);
+        CoapPackedRecordReader reader((const uint8_t*)r.data(), r.size());
+        REQUIRE(reader.next());
+        CHECK(std::string((const char*)reader.data(), reader.size()) == "abcd");
+        REQUIRE(reader.next());
+        CHECK(std::string((const char*)reader.data(), reader.size()) == "e");
+        CHECK_FALSE(reader.next());
+        CHECK_FALSE(reader.hasError());
+    }
+
+    SECTION("reads a regular CoAP message") {
+        const std::string r("\x50\x02\x00\x01", 4);
+        CoapPackedRecordReader reader((const uint8_t*)r.data(), r.size());
+        REQUIRE(reader.next());
+        CHECK(std::string((const char*)reader.data(), reader.size()) == r);
+        CHECK_FALSE(reader.next());
+        CHECK_FALSE(reader.hasError());
+    }
+
+    SECTION("detects a truncated record") {
+        const std::string r("\x00\x00\x04" "abcd" "\x00\x05" "e", 10);
+        CoapPackedRecordReader reader((const uint8_t*)r.data(), r.size());
+        REQUIRE(reader.next());
+        CHECK_FALSE(reader.next());
+        CHECK(reader.hasError());
+    }
+}
+
+TEST_CASE("CoAPPackingChannel") {
+    TestChannel c;
+
+    SECTION("sends messages immediately when packing is disabled") {
+        REQUIRE(c.sendMessage(nonEvent("a")) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(nonEvent("b")) == ProtocolError::NO_ERROR);
+        CHECK(c.records().size() == 2);
+    }
+
+    SECTION("packs messages sent within the delay") {
+        REQUIRE(c.set_packing_delay(50) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(nonEvent("a")) == ProtocolError::NO_ERROR);
+        g_millis += 10;
+        REQUIRE(c.sendMessage(nonEvent("b")) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(test::CoapMessage().type(CoapType::CON).code(CoapCode::POST).id(0)) == ProtocolError::NO_ERROR);
+        REQUIRE(c.poll() == ProtocolError::NO_ERROR);
+        CHECK(c.records().empty());
+        g_millis += 40;
+        REQUIRE(c.poll() == ProtocolError::NO_ERROR);
+        REQUIRE(c.records().size() == 1);
+        CHECK(c.records()[0].data[0] == COAP_PACKED_RECORD_MARKER);
+        const auto msgs = c.messages();
+        REQUIRE(msgs.size() == 3);
+        CHECK(msgs[0].id() == 1);
+        CHECK(msgs[1].id() == 2);
+        CHECK(msgs[2].id() == 3);
+        CHECK(msgs[2].type() == CoapType::CON);
+    }
+
+    SECTION("sends a single pending message without the framing") {
+        REQUIRE(c.set_packing_delay(50) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(nonEvent("a")) == ProtocolError::NO_ERROR);
+        g_millis += 50;
+        REQUIRE(c.poll() == ProtocolError::NO_ERROR);
+        REQUIRE(c.records().size() == 1);
+        CHECK(c.records()[0].data[0] != COAP_PACKED_RECORD_MARKER);
+    }
+
+    SECTION("sends the pending record when the next message doesn't fit in it") {
+        REQUIRE(c.set_packing_delay(50) == ProtocolError::NO_ERROR);
+        const std::string payload(COAP_MAX_PACKED_RECORD_SIZE / 2, 'a');
+        REQUIRE(c.sendMessage(nonEvent("a").payload(payload)) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(nonEvent("b").payload(payload)) == ProtocolError::NO_ERROR);
+        CHECK(c.records().size() == 1);
+        g_millis += 50;
+        REQUIRE(c.poll() == ProtocolError::NO_ERROR);
+        CHECK(c.records().size() == 2);
+        CHECK(c.messages().size() == 2);
+    }
+
+    SECTION("preserves the order of the messages sent directly") {
+        REQUIRE(c.set_packing_delay(50) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(nonEvent("a")) == ProtocolError::NO_ERROR);
+        Message msg;
+        c.create(msg);
+        memcpy(msg.buf(), "\x01\x02", 2);
+        msg.set_length(2);
+        REQUIRE(msg.send_direct());
+        REQUIRE(c.send(msg) == ProtocolError::NO_ERROR);
+        REQUIRE(c.records().size() == 2);
+        CHECK(c.records()[0].data[0] != COAP_PACKED_RECORD_MARKER);
+        CHECK(c.records()[1].data == "\x01\x02");
+    }
+
+    SECTION("discards the pending messages when the channel is reset") {
+        REQUIRE(c.set_packing_delay(50) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(nonEvent("a")) == ProtocolError::NO_ERROR);
+        c.reset();
+        g_millis += 50;
+        REQUIRE(c.poll() == ProtocolError::NO_ERROR);
+        CHECK(c.records().empty());
+    }
+
+    SECTION("sends the pending messages when packing gets disabled") {
+        REQUIRE(c.set_packing_delay(50) == ProtocolError::NO_ERROR);
+        REQUIRE(c.sendMessage(nonEvent("a")) == ProtocolError::NO_ERROR);
+        REQUIRE(c.set_packing_delay(0) == ProtocolError::NO_ERROR);
+        CHECK(c.records().size() == 1);
+        REQUIRE(c.sendMessage(nonEvent("b")) == ProtocolError::NO_ERROR);
+        CHECK(c.records().size() == 2);
+    }
+
+    SECTION("limits the packing delay") {
+        REQUIRE(c.set_packing_delay(MAX_COAP_PACKING_DELAY * 10) == ProtocolError::NO_ERROR);
+        CHECK(c.get_packing_delay() == MAX_COAP_PACKING_DELAY);
+    }
+}
+
+TEST_CASE("CoAPPackingChannel benchmark", "[.][benchmark]") {
+    const unsigned burstCount = 1000;
+    const unsigned burstSize = 4; // Maximum number of application events per second
+    const system_tick_t pollInterval = 5;
+    const std::string data = "{\"t\":23.5,\"h\":41}";
+
+    for (system_tick_t delay: { 0, 10, 25, 50 }) {
+        TestChannel c;
+        test::ProtocolStub p(&c);
+        Publisher publisher(&p);
+        REQUIRE(c.set_packing_delay(delay) == ProtocolError::NO_ERROR);
+        std::vector<system_tick_t> sendTimes;
+        for (unsigned i = 0; i < burstCount; ++i) {
+            const system_tick_t burstStart = g_millis;
+            for (unsigned j = 0; j < burstSize; ++j) {
+                char name[16] = {};
+                snprintf(name, sizeof(name), "sensor/%u", j);
+                REQUIRE(publisher.send_event(c, name, data.data(), data.size(), (int)CoapContentFormat::TEXT_PLAIN, 60,
+                        EventType::NO_ACK, g_millis, CompletionHandler()) == ProtocolError::NO_ERROR);
+                sendTimes.push_back(g_millis);
+                g_millis += 1;
+            }
+            while (g_millis - burstStart < 1000) {
+                REQUIRE(c.poll() == ProtocolError::NO_ERROR);
+                g_millis += pollInterval;
+            }
+        }
+        size_t bytesOnAir = 0;
+        uint64_t latency = 0;
+        size_t msgIndex = 0;
+        for (const auto& r: c.records()) {
+            bytesOnAir += r.data.size() + DATAGRAM_OVERHEAD;
+            CoapPackedRecordReader reader((const uint8_t*)r.data.data(), r.data.size());
+            while (reader.next()) {
+                latency += r.time - sendTimes.at(msgIndex++);
+            }
+        }
+        REQUIRE(msgIndex == sendTimes.size());
+        char name[64] = {};
+        snprintf(name, sizeof(name), "Packing delay %u ms: on-air size", (unsigned)delay);
+        particle::test::printBenchmark(name, (double)bytesOnAir / sendTimes.size(), "bytes/event");
+        snprintf(name, sizeof(name), "Packing delay %u ms: datagrams", (unsigned)delay);
+        particle::test::printBenchmark(name, (double)c.records().size() / sendTimes.size(), "datagrams/event");
+        snprintf(name, sizeof(name), "Packing delay %u ms: added latency", (unsigned)delay);
+        particle::test::printBenchmark(name, (double)latency / sendTimes.size(), "ms/event");
+    }
+}
@@ -18,6 +18,7 @@
 #include "firmware_update.h"
 #include "messages.h"
 #include "sha256.h"
+#include "ota_integrity_tracker.h"
 
 #include "util/coap_message_channel.h"
 #include "util/protocol_callbacks.h"
@@ -25,6 +26,8 @@
 #include <catch2/catch.hpp>
 #include <fakeit.hpp>
 
+#include <zlib.h>
+
 #include <random>
 #include <regex>
 
@@ -247,6 +250,93 @@ bool hasStatsPayload(const CoapMessage& msg) {
     return msg.hasPayload() && std::regex_match(msg.payload(), rx);
 }
 
+// OTA region backed by a string. Mimics the OTA HAL: the chunks are written to flash, read back and
+// passed to the integrity tracker, and the modules that couldn't be checked are read back in full
+class OtaFlash {
+public:
+    explicit OtaFlash(size_t size) :
+            tracker_(moduleInfoOffset, crc32Fn),
+            data_(size, '\xff'),
+            corruptOffset_(size),
+            readBack_(false) {
+        instance_ = this;
+    }
+
+    ~OtaFlash() {
+        instance_ = nullptr;
+    }
+
+    int write(const char* data, size_t size, size_t offset) {
+        REQUIRE(offset + size <= data_.size());
+        memcpy(&data_[offset], data, size);
+        if (corruptOffset_ >= offset && corruptOffset_ < offset + size) {
+            data_[corruptOffset_] ^= 0x01;
+        }
+        return tracker_.updateFromFlash((const uint8_t*)data, size, offset, offset /* address */, read);
+    }
+
+    int validate(size_t moduleSize) {
+        int r = tracker_.moduleStatus(0, moduleSize);
+        if (r < 0) {
+            readBack_ = true;
+            const uint32_t crc = crc32(0, (const uint8_t*)data_.data(), moduleSize);
+            uint32_t expected = 0;
+            for (size_t i = 0; i < 4; ++i) {
+                expected = (expected << 8) | (uint8_t)data_.at(moduleSize + i);
+            }
+            r = (crc == expected);
+        }
+        return (r == 1) ? 0 : SYSTEM_ERROR_OTA_INTEGRITY_CHECK_FAILED;
+    }
+
+    void corruptOnWrite(size_t offset) {
+        corruptOffset_ = offset;
+    }
+
+    bool wasReadBack() const {
+        return readBack_;
+    }
+
+private:
+    OtaIntegrityTracker tracker_;
+    std::string data_;
+    size_t corruptOffset_;
+    bool readBack_;
+
+    static OtaFlash* instance_;
+
+    static int read(uintptr_t address, uint8_t* data, size_t size) {
+        REQUIRE(address + size <= instance_->data_.size());
+        memcpy(data, instance_->data_.data() + address, size);
+        return 0;
+    }
+
+    static size_t moduleInfoOffset(const uint8_t* header) {
+        return 0;
+    }
+
+    static uint32_t crc32Fn(const uint8_t* data, uint32_t size, const uint32_t* crc) {
+        return crc32(crc ? *crc : 0, data, size);
+    }
+};
+
+OtaFlash* OtaFlash::instance_ = nullptr;
+
+// Generates a module with a valid CRC-32
+std::string genModule(size_t size) {
+    std::string d = genString(size);
+    module_info_t info = {};
+    info.module_start_address = (const void*)0x1000;
+    info.module_end_address = (const void*)(0x1000 + size);
+    memcpy(&d[0], &info, sizeof(info));
+    const uint32_t crc = crc32(0, (const uint8_t*)d.data(), d.size());
+    d += (char)(crc >> 24);
+    d += (char)(crc >> 16);
+    d += (char)(crc >> 8);
+    d += (char)crc;
+    return d;
+}
+
 } // namespace
 
 TEST_CASE("FirmwareUpdate") {
@@ -914,3 +1004,62 @@ TEST_CASE("FirmwareUpdate") {
         CHECK(!w.isRunning());
     }
 }
+
+TEST_CASE("FirmwareUpdate with the OTA integrity tracker") {
+    FirmwareUpdateWrapper w;
+    const size_t moduleSize = 1996;
+    const auto module = genModule(moduleSize);
+    OtaFlash flash(module.size());
+    auto cb = w.callbacksMock();
+    When(Method(cb, saveFirmwareChunk)).AlwaysDo([&](const char* chunkData, size_t chunkSize, size_t chunkOffset,
+            size_t partialSize) {
+        return flash.write(chunkData, chunkSize, chunkOffset);
+    });
+    When(Method(cb, finishFirmwareUpdate)).AlwaysDo([&](unsigned flags) {
+        if (FirmwareUpdateFlags::fromUnderlying(flags) == FirmwareUpdateFlag::VALIDATE_ONLY) {
+            return flash.validate(moduleSize);
+        }
+        return 0;
+    });
+    w.sendStart(module.size() /* fileSize */, std::string() /* fileHash */, 512 /* chunkSize */, false /* discardData */);
+    w.skipMessages(2); // Skip the ACK and response
+    SECTION("validates an update received in order without reading it back in full") {
+        for (unsigned i = 0; i < 4; ++i) {
+            w.sendChunk(i + 1 /* index */, module.substr(i * 512, 512) /* data */);
+        }
+        while (w.hasMessages()) {
+            w.receiveMessage(); // Skip the UpdateAcks
+        }
+        w.sendFinish(false /* cancelUpdate */, false /* discardData */);
+        w.skipMessages(1); // Skip the ACK
+        auto m = w.receiveMessage();
+        CHECK((isCoapResponseCode(m.code()) && isCoapSuccessCode(m.code())));
+        CHECK(!flash.wasReadBack());
+    }
+    SECTION("reads back an update received out of order") {
+        for (unsigned i: { 0, 2, 1, 3 }) {
+            w.sendChunk(i + 1 /* index */, module.substr(i * 512, 512) /* data */);
+        }
+        while (w.hasMessages()) {
+            w.receiveMessage(); // Skip the UpdateAcks
+        }
+        w.sendFinish(false /* cancelUpdate */, false /* discardData */);
+        w.skipMessages(1); // Skip the ACK
+        auto m = w.receiveMessage();
+        CHECK((isCoapResponseCode(m.code()) && isCoapSuccessCode(m.code())));
+        CHECK(flash.wasReadBack());
+    }
+    SECTION("fails the update if the data written to flash doesn't match the received data") {
+        flash.corruptOnWrite(700);
+        w.sendChunk(1 /* index */, module.substr(0, 512) /* data */);
+        while (w.hasMessages()) {
+            w.receiveMessage(); // Skip the UpdateAck
+        }
+        CHECK(w.isRunning());
+        w.sendChunk(2 /* index */, module.substr(512, 512) /* data */);
+        auto resp = w.receiveMessage();
+        CHECK(resp.type() == CoapType::RST);
+        CHECK(resp.id() == w.lastMessageId());
+        CHECK(!w.isRunning());
+    }
+}
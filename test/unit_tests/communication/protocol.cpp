@@ -19,6 +19,8 @@
 
 #include "protocol.h"
 #include "util/coap_message.h"
+#include "util/coap_message_channel.h"
+#include "util/protocol_stub.h"
 
 #include <catch2/catch.hpp>
 #include "fakeit.hpp"
@@ -78,6 +80,30 @@ size_t encodeEvent(uint8_t* buf, size_t buf_size, uint16_t msg_id, const char *e
 	return s.size();
 }
 
+test::CoapMessage confirmableEvent(uint16_t msg_id)
+{
+	test::CoapMessage m;
+	m.type(CoapType::CON);
+	m.code(CoapCode::POST);
+	m.id(msg_id);
+	m.option(CoapOption::URI_PATH, "e");
+	m.option(CoapOption::URI_PATH, "abc");
+	return m;
+}
+
+test::CoapMessage functionCall(uint16_t msg_id, const char* name, const char* arg)
+{
+	test::CoapMessage m;
+	m.type(CoapType::CON);
+	m.code(CoapCode::POST);
+	m.id(msg_id);
+	m.token("a");
+	m.option(CoapOption::URI_PATH, "f");
+	m.option(CoapOption::URI_PATH, name);
+	m.option(CoapOption::URI_QUERY, arg);
+	return m;
+}
+
 } // namespace
 
 SCENARIO("default product co-ordinates are set")
@@ -265,3 +291,186 @@ SCENARIO("Events are non-confirmable over an unreliable channel with the NO_ACK
 {
 	verify_event_type_with_flags(EventType::NO_ACK, CoAPType::NON);
 }
+
+SCENARIO("confirmable events are acknowledged immediately if delayed acknowledgements are enabled")
+{
+	test::CoapMessageChannel channel;
+	test::ProtocolStub p(&channel);
+	p.set_ack_delay(200);
+
+	channel.sendMessage(confirmableEvent(0x1234));
+	REQUIRE(p.event_loop());
+	auto m = channel.receiveMessage();
+	REQUIRE(m.type() == CoapType::ACK);
+	REQUIRE(m.code() == (unsigned)CoapCode::EMPTY);
+	REQUIRE(m.id() == 0x1234);
+	REQUIRE(!channel.hasMessages());
+	REQUIRE(p.get_ack_scheduler().stats().delayedAcks == 0);
+}
+
+SCENARIO("a function call is acknowledged after the ACK delay")
+{
+	test::CoapMessageChannel channel;
+	test::ProtocolStub p(&channel);
+	p.set_ack_delay(200);
+
+	Mock<test::DescriptorCallbacks> desc(*p.descriptor());
+	When(Method(desc, callFunction)).Return(0);
+
+	channel.sendMessage(functionCall(0x1234, "fn", "arg"));
+	REQUIRE(p.event_loop());
+	REQUIRE(!channel.hasMessages());
+
+	p.callbacks()->addMillis(199);
+	REQUIRE(p.event_loop());
+	REQUIRE(!channel.hasMessages());
+
+	p.callbacks()->addMillis(1);
+	REQUIRE(p.event_loop());
+	auto m = channel.receiveMessage();
+	REQUIRE(m.type() == CoapType::ACK);
+	REQUIRE(m.code() == (unsigned)CoapCode::EMPTY);
+	REQUIRE(m.id() == 0x1234);
+	REQUIRE(!channel.hasMessages());
+
+	const auto& stats = p.get_ack_scheduler().stats();
+	REQUIRE(stats.delayedAcks == 1);
+	REQUIRE(stats.sentAcks == 1);
+	REQUIRE(stats.savedDatagrams == 0);
+}
+
+SCENARIO("a retransmitted function call doesn't count as a saved datagram")
+{
+	test::CoapMessageChannel channel;
+	test::ProtocolStub p(&channel);
+	p.set_ack_delay(200);
+
+	Mock<test::DescriptorCallbacks> desc(*p.descriptor());
+	When(Method(desc, callFunction)).AlwaysReturn(0);
+
+	channel.sendMessage(functionCall(0x1234, "fn", "arg"));
+	REQUIRE(p.event_loop());
+	channel.sendMessage(functionCall(0x1234, "fn", "arg"));
+	REQUIRE(p.event_loop());
+	REQUIRE(!channel.hasMessages());
+
+	p.callbacks()->addMillis(200);
+	REQUIRE(p.event_loop());
+	auto m = channel.receiveMessage();
+	REQUIRE(m.type() == CoapType::ACK);
+	REQUIRE(m.id() == 0x1234);
+	REQUIRE(!channel.hasMessages());
+
+	const auto& stats = p.get_ack_scheduler().stats();
+	REQUIRE(stats.delayedAcks == 1);
+	REQUIRE(stats.savedDatagrams == 0);
+}
+
+SCENARIO("delayed acknowledgements are sent in a batch when the maximum number of pending acknowledgements is reached")
+{
+	test::CoapMessageChannel channel;
+	test::ProtocolStub p(&channel);
+	p.set_ack_delay(200);
+
+	Mock<test::DescriptorCallbacks> desc(*p.descriptor());
+	When(Method(desc, callFunction)).AlwaysReturn(0);
+
+	for (unsigned i = 0; i < ACK_BATCH_SIZE; ++i) {
+		channel.sendMessage(functionCall(0x1000 + i, "fn", "arg"));
+		REQUIRE(p.event_loop());
+	}
+	REQUIRE(!channel.hasMessages());
+
+	REQUIRE(p.event_loop());
+	for (unsigned i = 0; i < ACK_BATCH_SIZE; ++i) {
+		auto m = channel.receiveMessage();
+		REQUIRE(m.type() == CoapType::ACK);
+		REQUIRE(m.id() == 0x1000 + i);
+	}
+	REQUIRE(!channel.hasMessages());
+	REQUIRE(p.get_ack_scheduler().stats().sentAcks == ACK_BATCH_SIZE);
+}
+
+SCENARIO("a function result is sent in the ACK if the acknowledgement is still pending")
+{
+	test::CoapMessageChannel channel;
+	test::ProtocolStub p(&channel);
+	p.set_ack_delay(200);
+
+	Mock<test::DescriptorCallbacks> desc(*p.descriptor());
+	When(Method(desc, callFunction)).Do([](const char* key, const char* arg, SparkDescriptor::FunctionResultCallback callback, void* reserved) {
+		REQUIRE(strcmp(key, "fn") == 0);
+		REQUIRE(strcmp(arg, "arg") == 0);
+		callback((const void*)42, SparkReturnType::INT);
+		return 0;
+	});
+
+	channel.sendMessage(functionCall(0x1234, "fn", "arg"));
+	REQUIRE(p.event_loop());
+	auto m = channel.receiveMessage();
+	REQUIRE(m.type() == CoapType::ACK);
+	REQUIRE(m.code() == (unsigned)CoapCode::CHANGED);
+	REQUIRE(m.id() == 0x1234);
+	REQUIRE(m.token() == "a");
+	REQUIRE(m.payload() == std::string("\x00\x00\x00\x2a", 4));
+
+	// No empty ACK is sent after the delay
+	p.callbacks()->addMillis(200);
+	REQUIRE(p.event_loop());
+	REQUIRE(!channel.hasMessages());
+
+	const auto& stats = p.get_ack_scheduler().stats();
+	REQUIRE(stats.piggybackedAcks == 1);
+	REQUIRE(stats.savedDatagrams == 1);
+	REQUIRE(stats.sentAcks == 0);
+}
+
+SCENARIO("a function result is sent in a separate response if the acknowledgement has already been sent")
+{
+	test::CoapMessageChannel channel;
+	test::ProtocolStub p(&channel);
+	p.set_ack_delay(200);
+
+	SparkDescriptor::FunctionResultCallback resultCallback;
+	Mock<test::DescriptorCallbacks> desc(*p.descriptor());
+	When(Method(desc, callFunction)).Do([&](const char* key, const char* arg, SparkDescriptor::FunctionResultCallback callback, void* reserved) {
+		resultCallback = callback;
+		return 0;
+	});
+
+	channel.sendMessage(functionCall(0x1234, "fn", "arg"));
+	REQUIRE(p.event_loop());
+	REQUIRE(!channel.hasMessages());
+
+	p.callbacks()->addMillis(200);
+	REQUIRE(p.event_loop());
+	auto m = channel.receiveMessage();
+	REQUIRE(m.type() == CoapType::ACK);
+	REQUIRE(m.code() == (unsigned)CoapCode::EMPTY);
+	REQUIRE(m.id() == 0x1234);
+
+	REQUIRE(static_cast<bool>(resultCallback));
+	resultCallback((const void*)42, SparkReturnType::INT);
+	m = channel.receiveMessage();
+	REQUIRE(m.type() == CoapType::CON);
+	REQUIRE(m.code() == (unsigned)CoapCode::CHANGED);
+	REQUIRE(m.token() == "a");
+	REQUIRE(p.get_ack_scheduler().stats().piggybackedAcks == 0);
+}
+
+SCENARIO("a function call is acknowledged immediately if delayed acknowledgements are disabled")
+{
+	test::CoapMessageChannel channel;
+	test::ProtocolStub p(&channel);
+
+	Mock<test::DescriptorCallbacks> desc(*p.descriptor());
+	When(Method(desc, callFunction)).Return(0);
+
+	channel.sendMessage(functionCall(0x1234, "fn", "arg"));
+	REQUIRE(p.event_loop());
+	auto m = channel.receiveMessage();
+	REQUIRE(m.type() == CoapType::ACK);
+	REQUIRE(m.code() == (unsigned)CoapCode::EMPTY);
+	REQUIRE(m.id() == 0x1234);
+	REQUIRE(p.get_ack_scheduler().stats().delayedAcks == 0);
+}
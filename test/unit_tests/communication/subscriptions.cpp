@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "protocol.h"
+
+#include "util/coap_message_channel.h"
+#include "util/protocol_stub.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace particle::protocol;
+using namespace particle::protocol::test;
+
+void eventHandler(const char* name, const char* data) {
+}
+
+struct Subscription {
+    std::string filter;
+    int flags;
+
+    bool operator==(const Subscription& s) const {
+        return filter == s.filter && flags == s.flags;
+    }
+};
+
+// Stand-in for the server side of the subscription exchange
+class Server {
+public:
+    explicit Server(bool batchedSubscriptions) :
+            batched_(batchedSubscriptions),
+            requests_(0) {
+    }
+
+    // Processes the subscription requests sent by the device and replies to them
+    void process(CoapMessageChannel* channel, Protocol* proto) {
+        std::vector<CoapMessage> replies;
+        while (channel->hasMessages()) {
+            const auto m = channel->receiveMessage();
+            REQUIRE(m.type() == CoapType::CON);
+            ++requests_;
+            REQUIRE(m.hasOption(CoapOption::URI_PATH));
+            const auto path = m.options(CoapOption::URI_PATH);
+            auto reply = CoapMessage().type(CoapType::ACK).id(m.id());
+            if (path[0].toString() == "e" && path.size() == 2) {
+                int flags = 0;
+                if (m.hasOption(CoapOption::URI_QUERY)) {
+                    const auto q = m.option(CoapOption::URI_QUERY).toString();
+                    if (q == "b") {
+                        flags = SubscriptionFlag::BINARY_DATA;
+                    } else if (q == "c") {
+                        flags = SubscriptionFlag::CBOR_DATA;
+                    }
+                }
+                subscriptions_.push_back({ path[1].toString(), flags });
+                reply.code(CoapCode::CONTENT);
+            } else if (path[0].toString() == "b" && batched_) {
+                const auto& p = m.payload();
+                for (size_t i = 0; i < p.size();) {
+                    REQUIRE(i + 2 <= p.size());
+                    const int flags = (uint8_t)p[i];
+                    const size_t len = (uint8_t)p[i + 1];
+                    REQUIRE(i + 2 + len <= p.size());
+                    subscriptions_.push_back({ p.substr(i + 2, len), flags });
+                    i += 2 + len;
+                }
+                reply.code(CoapCode::CHANGED);
+            } else {
+                // Unknown resource
+                reply.code(CoapCode::NOT_FOUND);
+            }
+            replies.push_back(std::move(reply));
+        }
+        for (auto& r: replies) {
+            channel->sendMessage(std::move(r));
+            CoAPMessageType::Enum type;
+            REQUIRE(proto->event_loop(type) == ProtocolError::NO_ERROR);
+        }
+    }
+
+    const std::vector<Subscription>& subscriptions() const {
+        return subscriptions_;
+    }
+
+    unsigned requests() const {
+        return requests_;
+    }
+
+private:
+    std::vector<Subscription> subscriptions_;
+    bool batched_;
+    unsigned requests_;
+};
+
+} // namespace
+
+TEST_CASE("Subscriptions") {
+    CoapMessageChannel channel;
+    ProtocolStub proto(&channel);
+    REQUIRE(proto.add_event_handler("abc", eventHandler, nullptr, 0));
+    REQUIRE(proto.add_event_handler("def", eventHandler, nullptr, SubscriptionFlag::BINARY_DATA));
+    REQUIRE(proto.add_event_handler("ghi", eventHandler, nullptr, SubscriptionFlag::CBOR_DATA));
+    const std::vector<Subscription> expected = {
+        { "abc", 0 },
+        { "def", SubscriptionFlag::BINARY_DATA },
+        { "ghi", SubscriptionFlag::CBOR_DATA }
+    };
+
+    SECTION("sends each subscription in a separate request by default") {
+        Server server(true /* batchedSubscriptions */);
+        REQUIRE(proto.send_subscriptions(true /* force */) == ProtocolError::NO_ERROR);
+        server.process(&channel, &proto);
+        CHECK(server.requests() == 3);
+        CHECK(server.subscriptions() == expected);
+    }
+
+    SECTION("sends all subscriptions in one request if batching is enabled") {
+        Server server(true /* batchedSubscriptions */);
+        proto.set_batched_subscriptions_enabled(true);
+        REQUIRE(proto.send_subscriptions(true /* force */) == ProtocolError::NO_ERROR);
+        server.process(&channel, &proto);
+        CHECK(server.requests() == 1);
+        CHECK(server.subscriptions() == expected);
+        CHECK(proto.is_batched_subscriptions_enabled());
+    }
+
+    SECTION("falls back to separate requests if the server doesn't support batching") {
+        Server server(false /* batchedSubscriptions */);
+        proto.set_batched_subscriptions_enabled(true);
+        REQUIRE(proto.send_subscriptions(true /* force */) == ProtocolError::NO_ERROR);
+        server.process(&channel, &proto); // Rejects the batched request
+        CHECK(server.requests() == 1);
+        CHECK(server.subscriptions().empty());
+        CHECK_FALSE(proto.is_batched_subscriptions_enabled());
+        server.process(&channel, &proto);
+        CHECK(server.requests() == 4);
+        CHECK(server.subscriptions() == expected);
+    }
+}
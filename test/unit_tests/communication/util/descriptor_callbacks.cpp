@@ -50,6 +50,28 @@ bool appendMetricsCallback(appender_fn append, void* arg, uint32_t flags, uint32
     return false;
 }
 
+int callFunctionCallback(const char* key, const char* arg, SparkDescriptor::FunctionResultCallback callback, void* reserved) {
+    if (g_callbacks) {
+        return g_callbacks->callFunction(key, arg, callback, reserved);
+    }
+    return 0;
+}
+
+void getVariableCallback(const char* key, SparkDescriptor::GetVariableCallback callback, void* context) {
+    if (g_callbacks) {
+        g_callbacks->getVariable(key, callback, context);
+    } else {
+        callback(ProtocolError::NOT_FOUND, 0 /* type */, nullptr /* data */, 0 /* size */, context);
+    }
+}
+
+bool readVariableCallback(const char* key, size_t offset, size_t size, SparkDescriptor::GetVariableCallback callback, void* context) {
+    if (g_callbacks) {
+        return g_callbacks->readVariable(key, offset, size, callback, context);
+    }
+    return false;
+}
+
 } // namespace
 
 DescriptorCallbacks::DescriptorCallbacks() :
@@ -58,6 +80,9 @@ DescriptorCallbacks::DescriptorCallbacks() :
     desc_.append_system_info = appendSystemInfoCallback;
     desc_.append_app_info = appendAppInfoCallback;
     desc_.append_metrics = appendMetricsCallback;
+    desc_.call_function = callFunctionCallback;
+    desc_.get_variable_async = getVariableCallback;
+    desc_.read_variable_async = readVariableCallback;
     g_callbacks = this;
 }
 
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "spark_descriptor.h"
+#include "protocol_defs.h"
 
 namespace particle {
 
@@ -36,6 +37,9 @@ public:
     virtual bool appendSystemInfo(appender_fn append, void* arg, void* reserved);
     virtual bool appendAppInfo(appender_fn append, void* arg, void* reserved);
     virtual bool appendMetrics(appender_fn append, void* arg, uint32_t flags, uint32_t page, void* reserved);
+    virtual int callFunction(const char* key, const char* arg, SparkDescriptor::FunctionResultCallback callback, void* reserved);
+    virtual void getVariable(const char* key, SparkDescriptor::GetVariableCallback callback, void* context);
+    virtual bool readVariable(const char* key, size_t offset, size_t size, SparkDescriptor::GetVariableCallback callback, void* context);
 
 private:
     SparkDescriptor desc_;
@@ -57,6 +61,19 @@ inline bool DescriptorCallbacks::appendMetrics(appender_fn append, void* arg, ui
     return false;
 }
 
+inline int DescriptorCallbacks::callFunction(const char* key, const char* arg, SparkDescriptor::FunctionResultCallback callback, void* reserved) {
+    return 0;
+}
+
+inline void DescriptorCallbacks::getVariable(const char* key, SparkDescriptor::GetVariableCallback callback, void* context) {
+    callback(ProtocolError::NOT_FOUND, 0 /* type */, nullptr /* data */, 0 /* size */, context);
+}
+
+inline bool DescriptorCallbacks::readVariable(const char* key, size_t offset, size_t size, SparkDescriptor::GetVariableCallback callback,
+        void* context) {
+    return false;
+}
+
 } // namespace test
 
 } // namespace protocol
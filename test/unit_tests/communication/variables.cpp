@@ -0,0 +1,225 @@
+#include "variables.h"
+
+#include "util/coap_message_channel.h"
+#include "util/protocol_stub.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+using namespace particle::protocol;
+
+namespace {
+
+// Generates the value of a string variable on demand
+class StreamingVariable: public test::DescriptorCallbacks {
+public:
+    explicit StreamingVariable(std::string value, SparkReturnType::Enum type = SparkReturnType::STRING) :
+            value_(std::move(value)),
+            type_(type),
+            maxReadSize_(0) {
+    }
+
+    bool readVariable(const char* key, size_t offset, size_t size, SparkDescriptor::GetVariableCallback callback,
+            void* context) override {
+        if (strcmp(key, "var") != 0) {
+            callback(ProtocolError::NOT_FOUND, 0, nullptr, 0, context);
+            return true;
+        }
+        reads_.push_back(offset);
+        maxReadSize_ = std::max(maxReadSize_, size);
+        size = (offset < value_.size()) ? std::min(size, value_.size() - offset) : 0;
+        void* data = malloc(std::max<size_t>(size, 1));
+        REQUIRE(data);
+        memcpy(data, value_.data() + std::min(offset, value_.size()), size);
+        callback(ProtocolError::NO_ERROR, type_, data, size, context);
+        return true;
+    }
+
+    const std::vector<size_t>& reads() const {
+        return reads_;
+    }
+
+    size_t maxReadSize() const {
+        return maxReadSize_;
+    }
+
+private:
+    std::string value_;
+    std::vector<size_t> reads_;
+    SparkReturnType::Enum type_;
+    size_t maxReadSize_;
+};
+
+// Provides the entire value of a string variable
+class RegularVariable: public test::DescriptorCallbacks {
+public:
+    explicit RegularVariable(std::string value) :
+            value_(std::move(value)) {
+    }
+
+    void getVariable(const char* key, SparkDescriptor::GetVariableCallback callback, void* context) override {
+        void* data = malloc(std::max<size_t>(value_.size(), 1));
+        REQUIRE(data);
+        memcpy(data, value_.data(), value_.size());
+        callback(ProtocolError::NO_ERROR, SparkReturnType::STRING, data, value_.size(), context);
+    }
+
+private:
+    std::string value_;
+};
+
+test::CoapMessage variableRequest(uint16_t msgId, const char* name, int block2 = -1) {
+    test::CoapMessage m;
+    m.type(CoapType::CON);
+    m.code(CoapCode::GET);
+    m.id(msgId);
+    m.token("a");
+    m.option(CoapOption::URI_PATH, "v");
+    m.option(CoapOption::URI_PATH, name);
+    if (block2 >= 0) {
+        m.option(CoapOption::BLOCK2, (unsigned)block2);
+    }
+    return m;
+}
+
+unsigned blockOption(unsigned num, unsigned szx, bool m) {
+    return (num << 4) | (m ? 0x08 : 0) | szx;
+}
+
+std::string makeValue(size_t size) {
+    std::string s;
+    for (size_t i = 0; i < size; ++i) {
+        s += (char)('a' + i % 26);
+    }
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("Variables") {
+    test::CoapMessageChannel channel;
+    test::ProtocolStub p(&channel);
+
+    SECTION("sends a small value in a single message") {
+        StreamingVariable v("abc");
+        channel.sendMessage(variableRequest(0x1234, "var"));
+        REQUIRE(p.event_loop());
+        auto m = channel.receiveMessage();
+        CHECK(m.type() == CoapType::ACK);
+        CHECK(m.id() == 0x1234);
+        m = channel.receiveMessage();
+        CHECK(m.code() == (unsigned)CoapCode::CONTENT);
+        CHECK(m.token() == "a");
+        CHECK_FALSE(m.hasOption(CoapOption::BLOCK2));
+        CHECK(m.payload() == "abc");
+        CHECK_FALSE(channel.hasMessages());
+    }
+
+    SECTION("sends a large value in blocks") {
+        const auto value = makeValue(2500);
+        StreamingVariable v(value);
+        std::string data;
+        for (unsigned i = 0; i < 3; ++i) {
+            channel.sendMessage(variableRequest(0x1000 + i, "var", (i > 0) ? blockOption(i, 6, false) : -1));
+            REQUIRE(p.event_loop());
+            auto m = channel.receiveMessage(); // Empty ACK
+            CHECK(m.id() == 0x1000 + i);
+            m = channel.receiveMessage();
+            CHECK(m.code() == (unsigned)CoapCode::CONTENT);
+            const auto opt = m.option(CoapOption::BLOCK2).toUInt();
+            CHECK((opt >> 4) == i); // NUM
+            CHECK((opt & 0x07) == 6); // SZX (1024 bytes)
+            CHECK((bool)(opt & 0x08) == (i < 2)); // M
+            data += m.payload();
+        }
+        CHECK(data == value);
+        CHECK(v.reads() == std::vector<size_t>({ 0, 1024, 2048 }));
+        // The application never needs to provide more than one block at a time
+        CHECK(v.maxReadSize() == 1025);
+    }
+
+    SECTION("uses the block size requested by the server") {
+        const auto value = makeValue(600);
+        StreamingVariable v(value);
+        channel.sendMessage(variableRequest(0x1000, "var", blockOption(1, 5, false)));
+        REQUIRE(p.event_loop());
+        channel.skipMessages(1); // Empty ACK
+        auto m = channel.receiveMessage();
+        CHECK(m.option(CoapOption::BLOCK2).toUInt() == blockOption(1, 5, false));
+        CHECK(m.payload() == value.substr(512));
+        CHECK(v.reads() == std::vector<size_t>({ 512 }));
+    }
+
+    SECTION("adjusts the block number if the server requests larger blocks") {
+        p.set_max_transmit_message_size(700); // Limits the block size to 512 bytes
+        const auto value = makeValue(2000);
+        StreamingVariable v(value);
+        channel.sendMessage(variableRequest(0x1000, "var", blockOption(1, 6, false)));
+        REQUIRE(p.event_loop());
+        channel.skipMessages(1); // Empty ACK
+        auto m = channel.receiveMessage();
+        CHECK(m.option(CoapOption::BLOCK2).toUInt() == blockOption(2, 5, true));
+        CHECK(m.payload() == value.substr(1024, 512));
+        CHECK(v.reads() == std::vector<size_t>({ 1024 }));
+    }
+
+    SECTION("replies with an error if the requested block is past the end of the value") {
+        StreamingVariable v(makeValue(1024));
+        channel.sendMessage(variableRequest(0x1000, "var", blockOption(1, 6, false)));
+        REQUIRE(p.event_loop());
+        channel.skipMessages(1); // Empty ACK
+        auto m = channel.receiveMessage();
+        CHECK(m.code() == (unsigned)CoapCode::NOT_FOUND);
+    }
+
+    SECTION("sends the value in the ACK if the acknowledgement is still pending") {
+        p.set_ack_delay(200);
+        StreamingVariable v(makeValue(2000));
+        channel.sendMessage(variableRequest(0x1234, "var"));
+        REQUIRE(p.event_loop());
+        auto m = channel.receiveMessage();
+        CHECK(m.type() == CoapType::ACK);
+        CHECK(m.id() == 0x1234);
+        CHECK(m.code() == (unsigned)CoapCode::CONTENT);
+        CHECK(m.option(CoapOption::BLOCK2).toUInt() == blockOption(0, 6, true));
+        CHECK(m.payload().size() == 1024);
+        CHECK_FALSE(channel.hasMessages());
+    }
+
+    SECTION("sends non-string values as is") {
+        const uint32_t n = 42;
+        StreamingVariable v(std::string((const char*)&n, sizeof(n)), SparkReturnType::INT);
+        channel.sendMessage(variableRequest(0x1234, "var"));
+        REQUIRE(p.event_loop());
+        channel.skipMessages(1); // Empty ACK
+        auto m = channel.receiveMessage();
+        CHECK_FALSE(m.hasOption(CoapOption::BLOCK2));
+        CHECK(m.payload() == std::string("\x00\x00\x00\x2a", 4));
+    }
+
+    SECTION("sends the value of a non-streaming variable in a single message") {
+        const auto value = makeValue(2000);
+        RegularVariable v(value);
+        channel.sendMessage(variableRequest(0x1234, "var"));
+        REQUIRE(p.event_loop());
+        channel.skipMessages(1); // Empty ACK
+        auto m = channel.receiveMessage();
+        CHECK(m.code() == (unsigned)CoapCode::CONTENT);
+        CHECK_FALSE(m.hasOption(CoapOption::BLOCK2));
+        CHECK(m.payload() == value.substr(0, p.get_max_variable_value_size()));
+        CHECK_FALSE(channel.hasMessages());
+    }
+
+    SECTION("replies with an error if the variable is not found") {
+        StreamingVariable v("abc");
+        channel.sendMessage(variableRequest(0x1234, "foo"));
+        REQUIRE(p.event_loop());
+        channel.skipMessages(1); // Empty ACK
+        auto m = channel.receiveMessage();
+        CHECK(m.code() == (unsigned)CoapCode::NOT_FOUND);
+    }
+}
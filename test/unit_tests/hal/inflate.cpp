@@ -1,11 +1,17 @@
 #include "inflate.h"
 #include "system_error.h"
 
+#include "miniz.h"
+#include "miniz_tinfl.h"
+
+#include "util/bench.h"
+
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/copy.hpp>
 
 #include <functional>
+#include <memory>
 #include <random>
 #include <string>
 #include <vector>
@@ -22,6 +28,8 @@ class Options {
 public:
     Options() :
             windowBits_(DEFAULT_WINDOW_BITS),
+            level_(boost::iostreams::zlib::default_compression),
+            strategy_(boost::iostreams::zlib::default_strategy),
             hasMoreInput_(false) {
     }
 
@@ -43,8 +51,28 @@ public:
         return windowBits_;
     }
 
+    Options& level(int level) {
+        level_ = level;
+        return *this;
+    }
+
+    int level() const {
+        return level_;
+    }
+
+    Options& strategy(int strategy) {
+        strategy_ = strategy;
+        return *this;
+    }
+
+    int strategy() const {
+        return strategy_;
+    }
+
 private:
     unsigned windowBits_;
+    int level_;
+    int strategy_;
     bool hasMoreInput_;
 };
 
@@ -143,6 +171,8 @@ std::string deflate(const std::string& data, const Options& opts = Options()) {
     filtering_ostreambuf filter;
     zlib_params params;
     params.window_bits = opts.windowBits();
+    params.level = opts.level();
+    params.strategy = opts.strategy();
     params.noheader = true; // Do not add a zlib header
     filter.push(zlib_compressor(params));
     filter.push(dest);
@@ -417,6 +447,38 @@ TEST_CASE("inflate_input()") {
         CHECK(infl.output() == decomp);
     }
 
+    SECTION("can decompress stored blocks") {
+        auto decomp = genCompressibleData();
+        auto comp = deflate(decomp, Options().level(boost::iostreams::zlib::no_compression));
+        size_t offs = 0;
+        int r = 0;
+        do {
+            size_t size = std::min(randomSize(50, 500), comp.size() - offs);
+            r = infl.input(comp.data() + offs, &size, Options().hasMoreInput(offs + size < comp.size()));
+            offs += size;
+        } while (r == INFLATE_NEEDS_MORE_INPUT);
+        CHECK(r == INFLATE_DONE);
+        CHECK(infl.output() == decomp);
+    }
+
+    SECTION("can decompress blocks compressed with the fixed Huffman codes") {
+        auto decomp = genCompressibleData();
+        auto comp = deflate(decomp, Options().strategy(4 /* Z_FIXED */));
+        size_t size = comp.size();
+        int r = infl.input(comp.data(), &size);
+        CHECK(r == INFLATE_DONE);
+        CHECK(size == comp.size());
+        CHECK(infl.output() == decomp);
+    }
+
+    SECTION("fails if a match refers to data before the start of the stream") {
+        // Fixed Huffman block: length code 257 (length 3) with distance code 0 (distance 1)
+        // as the very first symbol
+        const char comp[] = { 0x03, 0x02, 0x00 };
+        int r = infl.input(comp, sizeof(comp));
+        CHECK(r == SYSTEM_ERROR_BAD_DATA);
+    }
+
     SECTION("stress test") {
         for (unsigned i = 0; i < 500; ++i) {
             auto decomp = genCompressibleData(10000, 100000);
@@ -437,3 +499,48 @@ TEST_CASE("inflate_input()") {
         }
     }
 }
+
+TEST_CASE("inflate benchmark", "[.][benchmark]") {
+    // The bootloader decompresses the firmware in chunks of 256 bytes
+    const size_t chunkSize = 256;
+    const auto decomp = genCompressibleData(1024 * 1024);
+    const auto comp = deflate(decomp);
+    const unsigned iterations = 10;
+
+    const double t1 = particle::test::benchmark(iterations, [&](unsigned) {
+        Inflate infl;
+        infl.outputFn([](const char* data, size_t size, Output* out) {
+            return size;
+        });
+        int r = 0;
+        size_t offs = 0;
+        do {
+            size_t size = std::min(chunkSize, comp.size() - offs);
+            r = infl.input(comp.data() + offs, &size, Options().hasMoreInput());
+            offs += size;
+        } while (r == INFLATE_NEEDS_MORE_INPUT || r == INFLATE_HAS_MORE_OUTPUT);
+        REQUIRE(r == INFLATE_DONE);
+    });
+    particle::test::printBenchmark("inflate_input(), 1 MB", t1 / 1000000, "ms");
+
+    // Reference: tinfl_decompress() with a circular output buffer
+    std::unique_ptr<tinfl_decompressor> decompPtr(new tinfl_decompressor);
+    std::unique_ptr<mz_uint8[]> buf(new mz_uint8[1 << INFLATE_MAX_WINDOW_BITS]);
+    const size_t bufSize = 1 << INFLATE_MAX_WINDOW_BITS;
+    const double t2 = particle::test::benchmark(iterations, [&](unsigned) {
+        tinfl_init(decompPtr.get());
+        size_t bufOffs = 0;
+        size_t offs = 0;
+        int status = TINFL_STATUS_NEEDS_MORE_INPUT;
+        while (status != TINFL_STATUS_DONE) {
+            size_t srcSize = std::min(chunkSize, comp.size() - offs);
+            size_t destSize = bufSize - bufOffs;
+            status = tinfl_decompress(decompPtr.get(), (const mz_uint8*)comp.data() + offs, &srcSize, buf.get(),
+                    buf.get() + bufOffs, &destSize, TINFL_FLAG_HAS_MORE_INPUT);
+            REQUIRE(status >= 0);
+            offs += srcSize;
+            bufOffs = (bufOffs + destSize) & (bufSize - 1);
+        }
+    });
+    particle::test::printBenchmark("tinfl_decompress(), 1 MB", t2 / 1000000, "ms");
+}
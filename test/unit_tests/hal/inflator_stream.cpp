@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ota_flash_hal.h" // For module_bounds_location_t
+#include "storage_streams.h"
+#include "system_error.h"
+
+#include "util/bench.h"
+
+#include <catch2/catch.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+const size_t INTERVAL = 4096;
+
+// Input stream backed by a string that counts the bytes read from it
+class StringInputStream: public InputStream {
+public:
+    explicit StringInputStream(std::string data) :
+            data_(std::move(data)),
+            offs_(0),
+            bytesRead_(0) {
+    }
+
+    int read(char* data, size_t size) override {
+        const int r = peek(data, size);
+        if (r < 0) {
+            return r;
+        }
+        return skip(r);
+    }
+
+    int peek(char* data, size_t size) override {
+        if (offs_ == data_.size()) {
+            return SYSTEM_ERROR_END_OF_STREAM;
+        }
+        size = std::min(size, data_.size() - offs_);
+        memcpy(data, data_.data() + offs_, size);
+        return size;
+    }
+
+    int skip(size_t size) override {
+        if (offs_ == data_.size()) {
+            return SYSTEM_ERROR_END_OF_STREAM;
+        }
+        size = std::min(size, data_.size() - offs_);
+        offs_ += size;
+        bytesRead_ += size;
+        return size;
+    }
+
+    int seek(size_t offset) override {
+        if (offset > data_.size()) {
+            return SYSTEM_ERROR_NOT_ENOUGH_DATA;
+        }
+        offs_ = offset;
+        return offs_;
+    }
+
+    int availForRead() override {
+        return data_.size() - offs_;
+    }
+
+    int waitEvent(unsigned flags, unsigned timeout = 0) override {
+        if (!flags) {
+            return 0;
+        }
+        if (offs_ == data_.size()) {
+            return SYSTEM_ERROR_END_OF_STREAM;
+        }
+        return InputStream::READABLE;
+    }
+
+    size_t bytesRead() const {
+        return bytesRead_;
+    }
+
+private:
+    std::string data_;
+    size_t offs_;
+    size_t bytesRead_;
+};
+
+// Compresses the data with a full flush after every `interval` bytes and returns the offsets
+// of the restart points
+std::string deflateIndexed(const std::string& data, size_t interval, std::vector<uint32_t>* offsets) {
+    z_stream z = {};
+    REQUIRE(deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15 /* Raw deflate */, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    std::string out(deflateBound(&z, data.size()) + data.size() / interval * 16 + 16, '\0');
+    z.next_out = (Bytef*)&out[0];
+    z.avail_out = out.size();
+    for (size_t offs = 0; offs < data.size(); offs += interval) {
+        const size_t n = std::min(interval, data.size() - offs);
+        z.next_in = (Bytef*)data.data() + offs;
+        z.avail_in = n;
+        const bool last = offs + n == data.size();
+        REQUIRE(deflate(&z, last ? Z_FINISH : Z_FULL_FLUSH) == (last ? Z_STREAM_END : Z_OK));
+        REQUIRE(z.avail_in == 0);
+        if (!last) {
+            offsets->push_back(z.total_out);
+        }
+    }
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+std::string genData(size_t size) {
+    // Somewhat compressible data
+    std::default_random_engine gen(size);
+    std::uniform_int_distribution<unsigned> dist(0, 15);
+    std::string d;
+    d.reserve(size);
+    while (d.size() < size) {
+        d += (char)('a' + dist(gen));
+    }
+    return d;
+}
+
+std::string readAt(InflatorStream& stream, size_t offset, size_t size) {
+    REQUIRE(stream.seek(offset) == (int)offset);
+    std::string d(size, '\0');
+    size_t pos = 0;
+    while (pos < size) {
+        const int r = stream.read(&d[pos], size - pos);
+        REQUIRE(r > 0);
+        pos += r;
+    }
+    return d;
+}
+
+} // namespace
+
+TEST_CASE("InflatorStream") {
+    const auto data = genData(10 * INTERVAL + 123);
+    std::vector<uint32_t> offsets;
+    const auto compData = deflateIndexed(data, INTERVAL, &offsets);
+    REQUIRE(offsets.size() == 10);
+    StringInputStream compStream(compData);
+    InflatorStream stream(&compStream, data.size());
+    InflatorStream::Index index = { offsets.data(), offsets.size(), INTERVAL };
+
+    SECTION("can read the data sequentially") {
+        REQUIRE(stream.init(&index) == 0);
+        std::string d;
+        char buf[1000];
+        int r = 0;
+        while ((r = stream.read(buf, sizeof(buf))) > 0) {
+            d.append(buf, r);
+        }
+        CHECK(r == SYSTEM_ERROR_END_OF_STREAM);
+        CHECK(d == data);
+    }
+
+    SECTION("can seek to an arbitrary offset") {
+        REQUIRE(stream.init(&index) == 0);
+        std::default_random_engine gen(1);
+        std::uniform_int_distribution<size_t> dist(0, data.size() - 1);
+        for (unsigned i = 0; i < 100; ++i) {
+            const size_t offs = dist(gen);
+            const size_t size = std::min<size_t>(500, data.size() - offs);
+            CHECK(readAt(stream, offs, size) == data.substr(offs, size));
+        }
+        CHECK(readAt(stream, 0, 10) == data.substr(0, 10));
+        REQUIRE(stream.seek(data.size()) == (int)data.size());
+        char c;
+        CHECK(stream.read(&c, 1) == SYSTEM_ERROR_END_OF_STREAM);
+    }
+
+    SECTION("decompresses only the block containing the requested offset") {
+        REQUIRE(stream.init(&index) == 0);
+        const size_t offs = 7 * INTERVAL + 100;
+        CHECK(readAt(stream, offs, 100) == data.substr(offs, 100));
+        CHECK(compStream.bytesRead() <= offsets[7] - offsets[6]);
+    }
+
+    SECTION("serves repeated reads from the cached blocks") {
+        REQUIRE(stream.init(&index) == 0);
+        CHECK(readAt(stream, 2 * INTERVAL + 10, 10) == data.substr(2 * INTERVAL + 10, 10));
+        CHECK(readAt(stream, 5 * INTERVAL + 10, 10) == data.substr(5 * INTERVAL + 10, 10));
+        const auto n = compStream.bytesRead();
+        for (unsigned i = 0; i < 10; ++i) {
+            CHECK(readAt(stream, 5 * INTERVAL + i * 100, 10) == data.substr(5 * INTERVAL + i * 100, 10));
+            CHECK(readAt(stream, 2 * INTERVAL + i * 100, 10) == data.substr(2 * INTERVAL + i * 100, 10));
+        }
+        CHECK(compStream.bytesRead() == n);
+    }
+
+    SECTION("can read the data across block boundaries") {
+        REQUIRE(stream.init(&index) == 0);
+        const size_t offs = 3 * INTERVAL - 50;
+        CHECK(readAt(stream, offs, 2 * INTERVAL + 100) == data.substr(offs, 2 * INTERVAL + 100));
+    }
+
+    SECTION("continues inflating sequentially after the end of a cached block") {
+        REQUIRE(stream.init(&index) == 0);
+        const size_t offs = 8 * INTERVAL - 10;
+        CHECK(readAt(stream, offs, data.size() - offs) == data.substr(offs));
+        // Only the compressed data starting at the restart point of the first requested block is read
+        CHECK(compStream.bytesRead() == compData.size() - offsets[6]);
+    }
+
+    SECTION("validates the index against the size of the data") {
+        CHECK(InflatorStream::isValidIndex(index, data.size()));
+        CHECK_FALSE(InflatorStream::isValidIndex(index, data.size() + INTERVAL));
+        index.count = offsets.size() - 1;
+        CHECK_FALSE(InflatorStream::isValidIndex(index, data.size()));
+        index.count = offsets.size();
+        index.interval = InflatorStream::MAX_INDEX_INTERVAL + 1;
+        CHECK_FALSE(InflatorStream::isValidIndex(index, data.size()));
+        index.interval = 0;
+        CHECK_FALSE(InflatorStream::isValidIndex(index, data.size()));
+    }
+
+    SECTION("ignores the index if it doesn't match the data") {
+        index.count = offsets.size() - 1;
+        REQUIRE(stream.init(&index) == 0);
+        const size_t offs = 7 * INTERVAL + 100;
+        CHECK(readAt(stream, offs, 100) == data.substr(offs, 100));
+        // The data preceding the requested offset had to be inflated
+        CHECK(compStream.bytesRead() > offsets[6]);
+        CHECK(readAt(stream, 0, data.size()) == data);
+    }
+
+    SECTION("can read the data without an index") {
+        REQUIRE(stream.init() == 0);
+        CHECK(readAt(stream, 0, data.size()) == data);
+    }
+}
+
+TEST_CASE("InflatorStream benchmark", "[.][benchmark]") {
+    const auto data = genData(64 * INTERVAL);
+    std::vector<uint32_t> offsets;
+    const auto compData = deflateIndexed(data, INTERVAL, &offsets);
+    std::default_random_engine gen(1);
+    std::uniform_int_distribution<size_t> dist(0, data.size() - 16);
+    std::vector<size_t> offs;
+    for (unsigned i = 0; i < 100; ++i) {
+        offs.push_back(dist(gen));
+    }
+
+    StringInputStream s1(compData);
+    InflatorStream indexed(&s1, data.size());
+    InflatorStream::Index index = { offsets.data(), offsets.size(), INTERVAL };
+    REQUIRE(indexed.init(&index) == 0);
+    test::printBenchmark("random read, seek index", test::benchmark(offs.size(), [&](unsigned i) {
+        readAt(indexed, offs[i], 16);
+    }));
+
+    StringInputStream s2(compData);
+    InflatorStream sequential(&s2, data.size());
+    REQUIRE(sequential.init() == 0);
+    test::printBenchmark("random read, no index", test::benchmark(offs.size(), [&](unsigned i) {
+        // Without an index, seeking backwards requires inflating the data from the beginning
+        REQUIRE(sequential.seek(0) == 0);
+        readAt(sequential, offs[i], 16);
+    }));
+}
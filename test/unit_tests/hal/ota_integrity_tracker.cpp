@@ -0,0 +1,168 @@
+#include "ota_integrity_tracker.h"
+#include "system_error.h"
+
+#include <catch2/catch.hpp>
+
+#include <zlib.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace particle;
+
+namespace {
+
+const uint32_t VECTOR_TABLE_MAGIC = 0x20001234;
+const size_t VECTOR_TABLE_SIZE = 0x200;
+
+size_t moduleInfoOffset(const uint8_t* header) {
+    uint32_t w = 0;
+    memcpy(&w, header, sizeof(w));
+    return (w == VECTOR_TABLE_MAGIC) ? VECTOR_TABLE_SIZE : 0;
+}
+
+uint32_t crc32Fn(const uint8_t* data, uint32_t size, const uint32_t* crc) {
+    return crc32(crc ? *crc : 0, data, size);
+}
+
+std::string randomData(size_t size) {
+    static std::mt19937 gen(1);
+    std::string d(size, '\0');
+    for (auto& c: d) {
+        c = (char)gen();
+    }
+    return d;
+}
+
+// Generates a module with a valid CRC-32
+std::string makeModule(size_t size, bool vectorTable, bool combined) {
+    std::string d = randomData(size);
+    const size_t infoOffs = vectorTable ? VECTOR_TABLE_SIZE : 0;
+    if (vectorTable) {
+        memcpy(&d[0], &VECTOR_TABLE_MAGIC, sizeof(VECTOR_TABLE_MAGIC));
+    }
+    module_info_t info = {};
+    info.module_start_address = (const void*)0x1000;
+    info.module_end_address = (const void*)(0x1000 + size);
+    info.flags = combined ? MODULE_INFO_FLAG_COMBINED : 0;
+    memcpy(&d[infoOffs], &info, sizeof(info));
+    const uint32_t crc = crc32(0, (const uint8_t*)d.data(), d.size());
+    d += (char)(crc >> 24);
+    d += (char)(crc >> 16);
+    d += (char)(crc >> 8);
+    d += (char)crc;
+    return d;
+}
+
+void feed(OtaIntegrityTracker& tracker, const std::string& data, size_t chunkSize, size_t offset = 0) {
+    for (size_t pos = 0; pos < data.size(); pos += chunkSize) {
+        const size_t n = std::min(chunkSize, data.size() - pos);
+        tracker.update((const uint8_t*)data.data() + pos, n, offset + pos);
+    }
+}
+
+std::string g_flash;
+
+int flashRead(uintptr_t address, uint8_t* data, size_t size) {
+    if (address + size > g_flash.size()) {
+        return SYSTEM_ERROR_OUT_OF_RANGE;
+    }
+    memcpy(data, g_flash.data() + address, size);
+    return 0;
+}
+
+} // namespace
+
+TEST_CASE("OtaIntegrityTracker") {
+    OtaIntegrityTracker tracker(moduleInfoOffset, crc32Fn);
+
+    SECTION("verifies combined modules received in chunks of any size") {
+        const auto m1 = makeModule(2000, true /* vectorTable */, true /* combined */);
+        const auto m2 = makeModule(1000, false /* vectorTable */, false /* combined */);
+        for (size_t chunkSize: { 1, 3, 7, 64, 512, 4096 }) {
+            tracker.reset();
+            feed(tracker, m1 + m2, chunkSize);
+            CHECK(tracker.isSequential());
+            CHECK(tracker.moduleStatus(0, 2000) == 1);
+            CHECK(tracker.moduleStatus(m1.size(), 1000) == 1);
+            CHECK(tracker.moduleStatus(0, 1999) == SYSTEM_ERROR_NOT_FOUND);
+        }
+    }
+
+    SECTION("detects corrupted data") {
+        auto m = makeModule(1000, true /* vectorTable */, false /* combined */);
+        m[700] ^= 0x01;
+        feed(tracker, m, 128);
+        CHECK(tracker.moduleStatus(0, 1000) == 0);
+    }
+
+    SECTION("detects an invalid checksum") {
+        auto m = makeModule(1000, false /* vectorTable */, false /* combined */);
+        m[m.size() - 1] ^= 0x01;
+        feed(tracker, m, 128);
+        CHECK(tracker.moduleStatus(0, 1000) == 0);
+    }
+
+    SECTION("stops tracking when the data is received out of order") {
+        const auto m1 = makeModule(1000, false /* vectorTable */, true /* combined */);
+        const auto m2 = makeModule(1000, false /* vectorTable */, false /* combined */);
+        const auto d = m1 + m2;
+        feed(tracker, d.substr(0, 1500), 100);
+        feed(tracker, d.substr(1600), 100, 1600);
+        feed(tracker, d.substr(1500, 100), 100, 1500);
+        CHECK_FALSE(tracker.isSequential());
+        CHECK(tracker.moduleStatus(0, 1000) == 1); // Received before the gap
+        CHECK(tracker.moduleStatus(m1.size(), 1000) == SYSTEM_ERROR_NOT_FOUND);
+    }
+
+    SECTION("forgets the results when the received data is overwritten") {
+        const auto m = makeModule(1000, false /* vectorTable */, false /* combined */);
+        feed(tracker, m, 100);
+        CHECK(tracker.moduleStatus(0, 1000) == 1);
+        feed(tracker, m.substr(0, 100), 100);
+        CHECK(tracker.moduleStatus(0, 1000) == SYSTEM_ERROR_NOT_FOUND);
+        tracker.reset();
+        feed(tracker, m, 100);
+        CHECK(tracker.moduleStatus(0, 1000) == 1);
+    }
+
+    SECTION("ignores modules with an invalid size") {
+        auto m = makeModule(1000, false /* vectorTable */, false /* combined */);
+        module_info_t info = {};
+        memcpy(&info, m.data(), sizeof(info));
+        info.module_end_address = (const void*)((uintptr_t)info.module_start_address + sizeof(info) - 1);
+        memcpy(&m[0], &info, sizeof(info));
+        feed(tracker, m, 100);
+        CHECK(tracker.moduleStatus(0, sizeof(info) - 1) == SYSTEM_ERROR_NOT_FOUND);
+    }
+
+    SECTION("computes the checksums over the data read back from flash") {
+        const auto m = makeModule(1000, true /* vectorTable */, false /* combined */);
+        const size_t addr = 0x100;
+        g_flash = std::string(addr, '\xff') + m;
+        for (size_t pos = 0; pos < m.size(); pos += 300) {
+            const size_t n = std::min((size_t)300, m.size() - pos);
+            CHECK(tracker.updateFromFlash((const uint8_t*)m.data() + pos, n, pos, addr + pos, flashRead) == 0);
+        }
+        CHECK(tracker.moduleStatus(0, 1000) == 1);
+    }
+
+    SECTION("fails if the data in flash doesn't match the source data") {
+        const auto m = makeModule(1000, false /* vectorTable */, false /* combined */);
+        g_flash = m;
+        g_flash[500] ^= 0x01;
+        CHECK(tracker.updateFromFlash((const uint8_t*)m.data(), 400, 0, 0, flashRead) == 0);
+        CHECK(tracker.updateFromFlash((const uint8_t*)m.data() + 400, 400, 400, 400, flashRead) == SYSTEM_ERROR_BAD_DATA);
+        CHECK_FALSE(tracker.isSequential());
+        CHECK(tracker.updateFromFlash((const uint8_t*)m.data() + 800, m.size() - 800, 800, 800, flashRead) == 0);
+        CHECK(tracker.moduleStatus(0, 1000) == SYSTEM_ERROR_NOT_FOUND);
+    }
+
+    SECTION("forwards flash read errors") {
+        const auto m = makeModule(1000, false /* vectorTable */, false /* combined */);
+        g_flash = m.substr(0, 500);
+        CHECK(tracker.updateFromFlash((const uint8_t*)m.data(), m.size(), 0, 0, flashRead) == SYSTEM_ERROR_OUT_OF_RANGE);
+        CHECK(tracker.moduleStatus(0, 1000) == SYSTEM_ERROR_NOT_FOUND);
+    }
+}
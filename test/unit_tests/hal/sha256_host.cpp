@@ -0,0 +1,122 @@
+#include "sha256_host.h"
+#include "system_error.h"
+
+#include "util/bench.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const uint32_t INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// Computes a SHA-256 hash using the currently selected block function
+std::string sha256(const std::string& data) {
+    uint32_t state[8];
+    memcpy(state, INITIAL_STATE, sizeof(state));
+    const size_t fullBlocks = data.size() / 64;
+    sha256_host_process(state, (const uint8_t*)data.data(), fullBlocks);
+    std::string tail = data.substr(fullBlocks * 64);
+    tail += '\x80';
+    tail.append((tail.size() <= 56 ? 56 : 120) - tail.size(), '\0');
+    const uint64_t bits = (uint64_t)data.size() * 8;
+    for (int i = 7; i >= 0; --i) {
+        tail += (char)(bits >> (i * 8));
+    }
+    sha256_host_process(state, (const uint8_t*)tail.data(), tail.size() / 64);
+    std::ostringstream s;
+    for (auto v: state) {
+        s << std::hex << std::setw(8) << std::setfill('0') << v;
+    }
+    return s.str();
+}
+
+std::string randomData(size_t size) {
+    static std::mt19937 gen(1);
+    std::string d(size, '\0');
+    for (auto& c: d) {
+        c = (char)gen();
+    }
+    return d;
+}
+
+class ImplGuard {
+public:
+    ImplGuard() :
+            impl_(sha256_host_get_impl()) {
+    }
+
+    ~ImplGuard() {
+        sha256_host_select_impl(impl_);
+    }
+
+private:
+    sha256_host_impl impl_;
+};
+
+} // namespace
+
+TEST_CASE("sha256_host") {
+    ImplGuard g;
+
+    SECTION("computes correct hashes with all supported implementations") {
+        for (auto impl: { SHA256_HOST_IMPL_PORTABLE, SHA256_HOST_IMPL_SHA_NI }) {
+            if (sha256_host_select_impl(impl) != 0) {
+                CHECK(impl != SHA256_HOST_IMPL_PORTABLE);
+                continue;
+            }
+            CHECK(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+            CHECK(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+            CHECK(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+                    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+            CHECK(sha256(std::string(1000000, 'a')) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+        }
+    }
+
+    SECTION("all supported implementations produce the same results") {
+        if (sha256_host_select_impl(SHA256_HOST_IMPL_SHA_NI) != 0) {
+            WARN("SHA extensions are not supported by the CPU");
+            return;
+        }
+        for (size_t size = 0; size < 1000; size += 7) {
+            const auto d = randomData(size);
+            REQUIRE(sha256_host_select_impl(SHA256_HOST_IMPL_SHA_NI) == 0);
+            const auto h1 = sha256(d);
+            REQUIRE(sha256_host_select_impl(SHA256_HOST_IMPL_PORTABLE) == 0);
+            const auto h2 = sha256(d);
+            CHECK(h1 == h2);
+        }
+    }
+
+    SECTION("selects the best implementation supported by the CPU by default") {
+        REQUIRE(sha256_host_select_impl(SHA256_HOST_IMPL_AUTO) == 0);
+        const auto impl = sha256_host_get_impl();
+        CHECK(impl != SHA256_HOST_IMPL_AUTO);
+        if (impl == SHA256_HOST_IMPL_PORTABLE) {
+            CHECK(sha256_host_select_impl(SHA256_HOST_IMPL_SHA_NI) == SYSTEM_ERROR_NOT_SUPPORTED);
+        }
+    }
+}
+
+TEST_CASE("sha256_host benchmark", "[.][benchmark]") {
+    ImplGuard g;
+    const auto d = randomData(64 * 1024);
+    for (auto impl: { SHA256_HOST_IMPL_PORTABLE, SHA256_HOST_IMPL_SHA_NI }) {
+        if (sha256_host_select_impl(impl) != 0) {
+            continue;
+        }
+        uint32_t state[8] = {};
+        const double ns = particle::test::benchmark(100, [&](unsigned) {
+            sha256_host_process(state, (const uint8_t*)d.data(), d.size() / 64);
+        });
+        const auto name = std::string("sha256_host_process (") + (impl == SHA256_HOST_IMPL_SHA_NI ? "SHA-NI" : "portable") + ")";
+        particle::test::printBenchmark(name, d.size() * 1000.0 / ns, "MB/s");
+    }
+}
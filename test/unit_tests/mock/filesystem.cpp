@@ -56,6 +56,8 @@ Filesystem::Filesystem(MockRepository* mocks) :
         root_(std::string(), EntryType::DIR, nullptr),
         mocks_(mocks),
         lastFd_(0),
+        writeCount_(0),
+        commitCount_(0),
         checkOpenFiles_(true) {
     mocks_->OnCallFunc(lfs_file_open).Do([this](lfs_t* lfs, lfs_file_t* file, const char* path, int flags) {
         return this->open(lfs, file, path, flags);
@@ -266,6 +268,9 @@ int Filesystem::close(lfs_t* lfs, lfs_file_t* file) {
             throw std::runtime_error("lfs_file_close() has been called for an already closed file");
         }
         const auto e = it->second;
+        if (file->flags & LFS_O_WRONLY) {
+            ++commitCount_;
+        }
         e->fds.erase(file->fd);
         fdMap_.erase(it);
         file->fd = 0;
@@ -326,6 +331,7 @@ lfs_ssize_t Filesystem::write(lfs_t* lfs, lfs_file_t* file, const void* buf, lfs
         }
         e->data.replace(pos, std::min<size_t>(size, e->data.size() - pos), std::string((const char*)buf, size));
         file->pos = pos + size;
+        ++writeCount_;
         return size;
     } catch (const FileError& e) {
         return e.code();
@@ -427,6 +433,7 @@ int Filesystem::sync(lfs_t* lfs, lfs_file_t* file) {
         if (it == fdMap_.end()) {
             throw std::runtime_error("lfs_file_sync() has been called for a closed file");
         }
+        ++commitCount_;
         return 0;
     } catch (const FileError& e) {
         return e.code();
@@ -446,6 +453,7 @@ int Filesystem::remove(lfs_t* lfs, const char* path) {
             return LFS_ERR_NOTEMPTY;
         }
         removeEntry(e);
+        ++commitCount_;
         return 0;
     } catch (const FileError& e) {
         return e.code();
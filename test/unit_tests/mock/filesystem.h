@@ -53,6 +53,12 @@ public:
 
     int lastFileDesc() const;
 
+    // Number of calls to lfs_file_write()
+    unsigned writeCount() const;
+    // Number of operations that commit file metadata: lfs_file_sync(), lfs_remove() and closing
+    // a file opened for writing
+    unsigned commitCount() const;
+
 private:
     enum EntryType {
         DIR,
@@ -78,6 +84,8 @@ private:
     std::unordered_map<int, Entry*> fdMap_;
     MockRepository* mocks_;
     int lastFd_;
+    unsigned writeCount_;
+    unsigned commitCount_;
     bool checkOpenFiles_;
 
     Entry* findEntry(const std::string& path);
@@ -112,6 +120,14 @@ inline int Filesystem::lastFileDesc() const {
     return lastFd_;
 }
 
+inline unsigned Filesystem::writeCount() const {
+    return writeCount_;
+}
+
+inline unsigned Filesystem::commitCount() const {
+    return commitCount_;
+}
+
 } // namespace test
 
 } // namespace particle
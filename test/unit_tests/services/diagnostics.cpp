@@ -4,7 +4,9 @@
 
 #include <functional>
 #include <unordered_set>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace {
 
@@ -666,4 +668,157 @@ TEST_CASE("Wiring API") {
         testPersistentEnumDiagnosticData<PersistentEnumDiagnosticData, NoConcurrency>(diag);
         // testPersistentEnumDiagnosticData<PersistentEnumDiagnosticData, AtomicConcurrency>(diag);
     }
+
+    SECTION("HistogramDiagnosticData") {
+        HistogramDiagnosticData<16, 1> d(1, "hist");
+        diag.start();
+
+        SECTION("is registered as a histogram data source") {
+            const diag_source* src = nullptr;
+            REQUIRE(diag_get_source(1, &src, nullptr) == 0);
+            CHECK(src->type == DIAG_TYPE_HISTOGRAM);
+            CHECK(strcmp(src->name, "hist") == 0);
+        }
+
+        SECTION("is empty initially") {
+            DiagnosticHistogram h = {};
+            REQUIRE(AbstractHistogramDiagnosticData::get(1, h) == 0);
+            CHECK(h.info.size == sizeof(diag_histogram));
+            CHECK(h.info.bucket_count == 16);
+            CHECK(h.info.sub_bucket_bits == 1);
+            CHECK(h.info.count == 0);
+            CHECK(h.info.sum == 0);
+            for (unsigned i = 0; i < 16; ++i) {
+                CHECK(h.buckets[i] == 0);
+            }
+        }
+
+        SECTION("record()") {
+            for (uint32_t v: { 0, 1, 3, 3, 100, 1000000 }) {
+                d.record(v);
+            }
+            DiagnosticHistogram h = {};
+            REQUIRE(AbstractHistogramDiagnosticData::get(1, h) == 0);
+            CHECK(h.info.count == 6);
+            CHECK(d.count() == 6);
+            CHECK(h.info.sum == 1000107);
+            CHECK(h.info.min == 0);
+            CHECK(h.info.max == 1000000);
+            CHECK(h.buckets[0] == 1);
+            CHECK(h.buckets[1] == 1);
+            CHECK(h.buckets[3] == 2);
+            CHECK(h.buckets[AbstractHistogramDiagnosticData::bucketIndex(100, 1, 16)] == 1);
+            CHECK(h.buckets[15] == 1); // Out of range values are counted in the last bucket
+            uint32_t total = 0;
+            for (unsigned i = 0; i < 16; ++i) {
+                total += h.buckets[i];
+            }
+            CHECK(total == 6);
+        }
+
+        SECTION("reset()") {
+            d.record(10);
+            d.reset();
+            DiagnosticHistogram h = {};
+            REQUIRE(AbstractHistogramDiagnosticData::get(1, h) == 0);
+            CHECK(h.info.count == 0);
+            CHECK(h.info.max == 0);
+            CHECK(h.buckets[AbstractHistogramDiagnosticData::bucketIndex(10, 1, 16)] == 0);
+        }
+    }
+
+    SECTION("TimeSeriesDiagnosticData") {
+        TimeSeriesDiagnosticData<4> d(1);
+        diag.start();
+
+        SECTION("is registered as a time series data source") {
+            const diag_source* src = nullptr;
+            REQUIRE(diag_get_source(1, &src, nullptr) == 0);
+            CHECK(src->type == DIAG_TYPE_TIME_SERIES);
+        }
+
+        SECTION("record()") {
+            DiagnosticTimeSeries t = {};
+            REQUIRE(AbstractTimeSeriesDiagnosticData::get(1, t) == 0);
+            CHECK(t.info.size == sizeof(diag_time_series));
+            CHECK(t.info.sample_count == 0);
+            CHECK(t.info.total_count == 0);
+            d.record(-1, 1000);
+            d.record(2, 2000);
+            REQUIRE(AbstractTimeSeriesDiagnosticData::get(1, t) == 0);
+            REQUIRE(t.info.sample_count == 2);
+            CHECK(t.info.total_count == 2);
+            CHECK(t.samples[0].time == 1000);
+            CHECK(t.samples[0].value == -1);
+            CHECK(t.samples[1].time == 2000);
+            CHECK(t.samples[1].value == 2);
+        }
+
+        SECTION("keeps the most recent samples, oldest first") {
+            for (int i = 0; i < 10; ++i) {
+                d.record(i, i * 10);
+            }
+            DiagnosticTimeSeries t = {};
+            REQUIRE(AbstractTimeSeriesDiagnosticData::get(1, t) == 0);
+            REQUIRE(t.info.sample_count == 4);
+            CHECK(t.info.total_count == 10);
+            for (int i = 0; i < 4; ++i) {
+                CHECK(t.samples[i].value == i + 6);
+                CHECK(t.samples[i].time == (uint32_t)(i + 6) * 10);
+            }
+        }
+    }
+}
+
+TEST_CASE("AbstractHistogramDiagnosticData") {
+    SECTION("bucketIndex()") {
+        SECTION("maps small values to individual buckets") {
+            for (unsigned v = 0; v < 4; ++v) {
+                CHECK(AbstractHistogramDiagnosticData::bucketIndex(v, 2, 64) == v);
+            }
+        }
+
+        SECTION("splits each power of two range into a fixed number of buckets") {
+            // 4 sub-buckets per power of two
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(4, 2, 64) == 4);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(7, 2, 64) == 7);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(8, 2, 64) == 8);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(9, 2, 64) == 8);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(10, 2, 64) == 9);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(15, 2, 64) == 11);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(16, 2, 64) == 12);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(1000, 2, 64) == 35);
+        }
+
+        SECTION("clamps the index to the last bucket") {
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(0xffffffff, 1, 32) == 31);
+            CHECK(AbstractHistogramDiagnosticData::bucketIndex(0xffffffff, 2, 64) == 63);
+        }
+    }
+
+    SECTION("bucketLowerBound()") {
+        SECTION("is consistent with bucketIndex()") {
+            for (unsigned bits = 0; bits < 4; ++bits) {
+                // Number of buckets needed to cover the entire range of 32-bit values
+                const unsigned count = std::min(64u, (33 - bits) << bits);
+                uint32_t prev = 0;
+                for (unsigned i = 1; i < count; ++i) {
+                    const auto v = AbstractHistogramDiagnosticData::bucketLowerBound(i, bits);
+                    CHECK(v > prev);
+                    CHECK(AbstractHistogramDiagnosticData::bucketIndex(v, bits, 64) == i);
+                    CHECK(AbstractHistogramDiagnosticData::bucketIndex(v - 1, bits, 64) == i - 1);
+                    prev = v;
+                }
+            }
+        }
+
+        SECTION("keeps the relative error bounded") {
+            // With 2 sub-bucket bits, the width of a bucket is at most 1/4 of its lower bound
+            for (unsigned i = 4; i < 63; ++i) {
+                const auto lo = AbstractHistogramDiagnosticData::bucketLowerBound(i, 2);
+                const auto hi = AbstractHistogramDiagnosticData::bucketLowerBound(i + 1, 2);
+                CHECK((hi - lo) * 4 <= lo);
+            }
+        }
+    }
 }
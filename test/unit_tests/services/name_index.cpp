@@ -0,0 +1,126 @@
+#include "name_index.h"
+
+#include "util/bench.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+using namespace particle;
+
+namespace {
+
+const size_t MAX_NAME_LEN = 64;
+
+class NameTable {
+public:
+    NameTable() :
+            index_(MAX_NAME_LEN) {
+    }
+
+    void add(const std::string& name) {
+        REQUIRE(index_.insert(name.c_str(), names_.size()));
+        names_.push_back(name.substr(0, MAX_NAME_LEN));
+    }
+
+    int find(const char* name) const {
+        return index_.find(name, [this, name](size_t i) {
+            return strncmp(names_.at(i).c_str(), name, MAX_NAME_LEN) == 0;
+        });
+    }
+
+    int findLinear(const char* name) const {
+        for (size_t i = 0; i < names_.size(); ++i) {
+            if (strncmp(names_[i].c_str(), name, MAX_NAME_LEN) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    const NameIndex& index() const {
+        return index_;
+    }
+
+private:
+    std::vector<std::string> names_;
+    NameIndex index_;
+};
+
+// Names that look like the ones used by applications: a shared prefix and a short suffix
+std::string makeName(unsigned n) {
+    return "sensor_" + std::to_string(n) + "_value";
+}
+
+} // namespace
+
+TEST_CASE("NameIndex") {
+    NameTable t;
+
+    SECTION("finds registered names") {
+        for (unsigned i = 0; i < 200; ++i) {
+            t.add(makeName(i));
+        }
+        CHECK(t.index().size() == 200);
+        for (unsigned i = 0; i < 200; ++i) {
+            CHECK(t.find(makeName(i).c_str()) == (int)i);
+        }
+    }
+
+    SECTION("returns -1 if a name is not found") {
+        CHECK(t.find("abc") == -1);
+        t.add("abc");
+        CHECK(t.find("abd") == -1);
+        CHECK(t.find("ab") == -1);
+        CHECK(t.find("") == -1);
+    }
+
+    SECTION("compares names by their first maxNameLen characters") {
+        const std::string name(MAX_NAME_LEN, 'a');
+        t.add(name);
+        CHECK(t.find((name + "bcd").c_str()) == 0);
+        CHECK(t.find(name.substr(1).c_str()) == -1);
+    }
+
+    SECTION("resolves hash collisions by comparing the names") {
+        // "costarring" and "liquid" have the same 32-bit FNV-1a hash
+        REQUIRE(t.index().hash("costarring") == t.index().hash("liquid"));
+        t.add("costarring");
+        t.add("liquid");
+        CHECK(t.find("costarring") == 0);
+        CHECK(t.find("liquid") == 1);
+    }
+
+    SECTION("can be cleared") {
+        t.add("abc");
+        NameIndex index(MAX_NAME_LEN);
+        REQUIRE(index.insert("abc", 0));
+        index.clear();
+        CHECK(index.size() == 0);
+        CHECK(index.find("abc", [](size_t) { return true; }) == -1);
+    }
+}
+
+TEST_CASE("NameIndex benchmark", "[.][benchmark]") {
+    for (unsigned count: { 5, 50, 200 }) {
+        NameTable t;
+        std::vector<std::string> names;
+        for (unsigned i = 0; i < count; ++i) {
+            names.push_back(makeName(i));
+            t.add(names.back());
+        }
+        const unsigned iterations = 1000000;
+        int sink = 0;
+        const auto linear = test::benchmark(iterations, [&](unsigned i) {
+            sink += t.findLinear(names[i % count].c_str());
+        });
+        const auto indexed = test::benchmark(iterations, [&](unsigned i) {
+            sink += t.find(names[i % count].c_str());
+        });
+        CHECK(sink > 0);
+        test::printBenchmark("Linear lookup, " + std::to_string(count) + " names", linear);
+        test::printBenchmark("Indexed lookup, " + std::to_string(count) + " names", indexed);
+    }
+}
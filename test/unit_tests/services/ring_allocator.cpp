@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ring_allocator.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <cstring>
+
+using namespace particle::services;
+
+namespace {
+
+struct Block {
+    char* data;
+    size_t size;
+    char fill;
+};
+
+} // namespace
+
+TEST_CASE("RingAllocator") {
+    alignas(4) char buf[1024] = {};
+    RingAllocator alloc(buf, sizeof(buf));
+
+    SECTION("allocates blocks in FIFO order") {
+        const auto p1 = (char*)alloc.alloc(100);
+        const auto p2 = (char*)alloc.alloc(100);
+        REQUIRE(p1);
+        REQUIRE(p2);
+        CHECK(p2 > p1);
+        CHECK(p2 - p1 >= 100);
+        CHECK(alloc.owns(p1));
+        CHECK(alloc.owns(p2));
+        CHECK(alloc.count() == 2);
+        alloc.free(p1);
+        alloc.free(p2);
+        CHECK(alloc.count() == 0);
+    }
+
+    SECTION("fails when there's not enough contiguous space") {
+        CHECK(alloc.alloc(sizeof(buf)) == nullptr);
+        const auto p1 = alloc.alloc(600);
+        REQUIRE(p1);
+        CHECK(alloc.alloc(600) == nullptr);
+        const auto p2 = alloc.alloc(300);
+        REQUIRE(p2);
+        // The space at the end of the buffer can't be used while the first block is allocated
+        CHECK(alloc.alloc(200) == nullptr);
+        alloc.free(p1);
+        const auto p3 = alloc.alloc(500);
+        REQUIRE(p3);
+        CHECK(p3 < p2); // Wrapped around
+        alloc.free(p2);
+        alloc.free(p3);
+        CHECK(alloc.alloc(sizeof(buf) - 4) != nullptr);
+    }
+
+    SECTION("reclaims the memory of blocks freed out of order") {
+        const auto p1 = alloc.alloc(400);
+        const auto p2 = alloc.alloc(400);
+        REQUIRE(p1);
+        REQUIRE(p2);
+        alloc.free(p2);
+        CHECK(alloc.count() == 2);
+        CHECK(alloc.alloc(400) == nullptr);
+        alloc.free(p1);
+        CHECK(alloc.count() == 0);
+        CHECK(alloc.alloc(800) != nullptr);
+    }
+
+    SECTION("preserves the data of allocated blocks (stress test)") {
+        std::deque<Block> blocks;
+        std::uniform_int_distribution<size_t> sizeDist(1, 300);
+        std::uniform_int_distribution<unsigned> opDist(0, 2);
+        // Use a fixed seed so that the number of successful allocations is reproducible
+        std::default_random_engine gen(1);
+        char fill = 0;
+        unsigned allocCount = 0;
+        for (unsigned i = 0; i < 10000; ++i) {
+            if (opDist(gen) != 0 || blocks.empty()) {
+                const size_t size = sizeDist(gen);
+                const auto p = (char*)alloc.alloc(size);
+                if (p) {
+                    REQUIRE(alloc.owns(p));
+                    REQUIRE(((uintptr_t)p & 3) == 0);
+                    ++fill;
+                    memset(p, fill, size);
+                    blocks.push_back({ p, size, fill });
+                    ++allocCount;
+                    continue;
+                }
+            }
+            // Free a random block, preferring the oldest ones
+            std::uniform_int_distribution<size_t> idxDist(0, std::min<size_t>(blocks.size() - 1, 3));
+            const auto it = blocks.begin() + idxDist(gen);
+            for (size_t j = 0; j < it->size; ++j) {
+                REQUIRE(it->data[j] == it->fill);
+            }
+            alloc.free(it->data);
+            blocks.erase(it);
+        }
+        CHECK(allocCount > 3000);
+        for (auto& b: blocks) {
+            for (size_t j = 0; j < b.size; ++j) {
+                REQUIRE(b.data[j] == b.fill);
+            }
+            alloc.free(b.data);
+        }
+        CHECK(alloc.count() == 0);
+    }
+}
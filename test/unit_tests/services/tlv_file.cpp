@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tlv_file.h"
+#include "system_error.h"
+
+#include "mock/filesystem.h"
+#include "util/bench.h"
+
+#include <catch2/catch.hpp>
+#include <hippomocks.h>
+
+#include <map>
+#include <string>
+
+using namespace particle;
+using namespace particle::services::settings;
+
+namespace {
+
+const char* const FILE_NAME = "/tlv.dat";
+
+std::string get(TlvFile& file, uint16_t key, int index = 0) {
+    char buf[64] = {};
+    const auto r = file.get(key, (uint8_t*)buf, sizeof(buf), index);
+    if (r < 0) {
+        return "error " + std::to_string(r);
+    }
+    return std::string(buf, r);
+}
+
+int set(TlvFile& file, uint16_t key, const std::string& data, int index = -1) {
+    return file.set(key, (const uint8_t*)data.data(), data.size(), index);
+}
+
+int add(TlvFile& file, uint16_t key, const std::string& data) {
+    return file.add(key, (const uint8_t*)data.data(), data.size());
+}
+
+const std::string NOT_FOUND = "error " + std::to_string(SYSTEM_ERROR_NOT_FOUND);
+
+} // namespace
+
+TEST_CASE("TlvFile") {
+    MockRepository mocks;
+    test::Filesystem fs(&mocks);
+    TlvFile file(FILE_NAME);
+    REQUIRE(file.init() == 0);
+
+    SECTION("stores and retrieves entries") {
+        CHECK(get(file, 1) == NOT_FOUND);
+        REQUIRE(set(file, 1, "abc") == 0);
+        REQUIRE(set(file, 2, "defgh") == 0);
+        CHECK(get(file, 1) == "abc");
+        CHECK(get(file, 2) == "defgh");
+        REQUIRE(set(file, 1, "ijklmn") == 0);
+        CHECK(get(file, 1) == "ijklmn");
+        CHECK(get(file, 2) == "defgh");
+        CHECK(get(file, 1, 1) == NOT_FOUND);
+    }
+
+    SECTION("supports multiple entries with the same key") {
+        REQUIRE(add(file, 1, "a") == 0);
+        REQUIRE(add(file, 2, "b") == 0);
+        REQUIRE(add(file, 1, "c") == 0);
+        REQUIRE(add(file, 1, "d") == 0);
+        CHECK(get(file, 1, 0) == "a");
+        CHECK(get(file, 1, 1) == "c");
+        CHECK(get(file, 1, 2) == "d");
+        CHECK(get(file, 1, -1) == "d");
+        CHECK(get(file, 1, 3) == NOT_FOUND);
+        REQUIRE(file.del(1, 1) == 0);
+        CHECK(get(file, 1, 0) == "a");
+        CHECK(get(file, 1, 1) == "d");
+        CHECK(get(file, 2) == "b");
+        REQUIRE(file.del(1) == 0); // Deletes all entries with the key
+        CHECK(get(file, 1) == NOT_FOUND);
+        CHECK(get(file, 2) == "b");
+        CHECK(file.del(1) == SYSTEM_ERROR_NOT_FOUND);
+    }
+
+    SECTION("moves the entries that follow a deleted entry") {
+        std::string large(1000, 'x');
+        REQUIRE(add(file, 1, "abc") == 0);
+        REQUIRE(add(file, 2, large) == 0);
+        REQUIRE(add(file, 3, "def") == 0);
+        const auto sz = file.size();
+        REQUIRE(file.del(1) == 0);
+        CHECK(file.size() == sz - 8 - 3);
+        char buf[1000] = {};
+        REQUIRE(file.get(2, (uint8_t*)buf, sizeof(buf)) == sizeof(buf));
+        CHECK(std::string(buf, sizeof(buf)) == large);
+        CHECK(get(file, 3) == "def");
+        REQUIRE(file.del(3) == 0);
+        REQUIRE(file.del(2) == 0);
+        CHECK(file.size() == sz - 8 * 3 - 1006);
+    }
+
+    SECTION("persists the entries across reopening") {
+        REQUIRE(set(file, 1, "abc") == 0);
+        REQUIRE(set(file, 2, "def") == 0);
+        REQUIRE(file.del(1) == 0);
+        REQUIRE(file.deInit() == 0);
+        TlvFile file2(FILE_NAME);
+        REQUIRE(file2.init() == 0);
+        CHECK(get(file2, 1) == NOT_FOUND);
+        CHECK(get(file2, 2) == "def");
+        REQUIRE(set(file2, 3, "ghi") == 0);
+        CHECK(get(file2, 3) == "ghi");
+        REQUIRE(file2.deInit() == 0);
+    }
+
+    SECTION("recreates a corrupted file") {
+        REQUIRE(set(file, 1, "abc") == 0);
+        REQUIRE(file.deInit() == 0);
+        auto d = fs.readFile(FILE_NAME);
+        d[d.size() - 1] ^= 0xff; // Footer magic
+        fs.writeFile(FILE_NAME, d);
+        TlvFile file2(FILE_NAME);
+        REQUIRE(file2.init() == 0);
+        CHECK(get(file2, 1) == NOT_FOUND);
+        REQUIRE(set(file2, 1, "def") == 0);
+        CHECK(get(file2, 1) == "def");
+        REQUIRE(file2.deInit() == 0);
+    }
+
+    SECTION("skips corrupted entry headers") {
+        REQUIRE(add(file, 1, "abcd") == 0);
+        REQUIRE(add(file, 2, "efgh") == 0);
+        REQUIRE(file.deInit() == 0);
+        auto d = fs.readFile(FILE_NAME);
+        d[0] ^= 0xff; // Header magic of the first entry
+        fs.writeFile(FILE_NAME, d);
+        TlvFile file2(FILE_NAME);
+        REQUIRE(file2.init() == 0);
+        CHECK(get(file2, 1) == NOT_FOUND);
+        CHECK(get(file2, 2) == "efgh");
+        REQUIRE(file2.deInit() == 0);
+    }
+
+    SECTION("stays consistent with the file contents after a sequence of modifications") {
+        std::map<uint16_t, std::string> model;
+        for (unsigned i = 0; i < 200; ++i) {
+            const uint16_t key = (i * 7) % 13;
+            if (i % 5 == 4) {
+                const int r = file.del(key);
+                CHECK(r == (model.count(key) ? 0 : SYSTEM_ERROR_NOT_FOUND));
+                model.erase(key);
+            } else {
+                const auto d = std::string(i % 17 + 1, 'a' + i % 26);
+                REQUIRE(set(file, key, d) == 0);
+                model[key] = d;
+            }
+        }
+        REQUIRE(file.deInit() == 0);
+        TlvFile file2(FILE_NAME);
+        REQUIRE(file2.init() == 0);
+        for (uint16_t key = 0; key < 13; ++key) {
+            const auto it = model.find(key);
+            CHECK(get(file2, key) == (it != model.end() ? it->second : NOT_FOUND));
+        }
+        REQUIRE(file2.deInit() == 0);
+    }
+
+    file.deInit();
+}
+
+TEST_CASE("TlvFile benchmark", "[.][benchmark]") {
+    MockRepository mocks;
+    test::Filesystem fs(&mocks);
+    TlvFile file(FILE_NAME);
+    REQUIRE(file.init() == 0);
+
+    // A few kilobytes of entries
+    const std::string data(60, 'x');
+    for (unsigned i = 0; i < 64; ++i) {
+        REQUIRE(add(file, i, data) == 0);
+    }
+
+    test::printBenchmark("TlvFile::get() (64 entries)", test::benchmark(10000, [&](unsigned i) {
+        get(file, i % 64);
+    }));
+
+    const unsigned writeCount = fs.writeCount();
+    test::printBenchmark("TlvFile::set() (64 entries)", test::benchmark(1000, [&](unsigned i) {
+        set(file, i % 64, data);
+    }));
+    test::printBenchmark("Writes per TlvFile::set()", (fs.writeCount() - writeCount) / 1000.0, "writes/op");
+
+    file.deInit();
+}
@@ -225,3 +225,28 @@ TEST_CASE("maxUnsignedVarintSize()") {
         CHECK(r == maxUnsignedVarintSize<uint64_t>());
     }
 }
+
+TEST_CASE("encodeZigZag()") {
+    SECTION("maps values with a small absolute value to small unsigned values") {
+        CHECK(encodeZigZag((int32_t)0) == 0);
+        CHECK(encodeZigZag((int32_t)-1) == 1);
+        CHECK(encodeZigZag((int32_t)1) == 2);
+        CHECK(encodeZigZag((int32_t)-2) == 3);
+        CHECK(encodeZigZag(std::numeric_limits<int32_t>::max()) == 0xfffffffe);
+        CHECK(encodeZigZag(std::numeric_limits<int32_t>::min()) == 0xffffffff);
+        CHECK(encodeZigZag(std::numeric_limits<int64_t>::min()) == 0xffffffffffffffffull);
+    }
+}
+
+TEST_CASE("decodeZigZag()") {
+    SECTION("decodes a ZigZag-encoded value") {
+        CHECK(decodeZigZag((uint32_t)0) == 0);
+        CHECK(decodeZigZag((uint32_t)1) == -1);
+        CHECK(decodeZigZag((uint32_t)2) == 1);
+        CHECK(decodeZigZag((uint32_t)0xfffffffe) == std::numeric_limits<int32_t>::max());
+        CHECK(decodeZigZag((uint32_t)0xffffffff) == std::numeric_limits<int32_t>::min());
+        for (int64_t v: { (int64_t)-123456789012, (int64_t)0, (int64_t)42, std::numeric_limits<int64_t>::max() }) {
+            CHECK(decodeZigZag(encodeZigZag(v)) == v);
+        }
+    }
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "write_behind_cache.h"
+#include "simple_file_storage.h"
+#include "system_error.h"
+
+#include "mock/filesystem.h"
+
+#include <catch2/catch.hpp>
+#include <hippomocks.h>
+
+#include <string>
+
+using namespace particle;
+using namespace particle::services;
+
+namespace {
+
+const system_tick_t FLUSH_DELAY = 1000;
+
+// Stores each record in a separate file
+class FileStorage: public WriteBehindCache::Storage {
+public:
+    explicit FileStorage(test::Filesystem* fs) :
+            fs_(fs),
+            failWrites_(false) {
+    }
+
+    int read(uint16_t key, void* data, size_t size) override {
+        return SimpleFileStorage::load(fileName(key).c_str(), data, size);
+    }
+
+    int write(uint16_t key, const void* data, size_t size) override {
+        if (failWrites_) {
+            return SYSTEM_ERROR_FILE;
+        }
+        const int r = SimpleFileStorage::save(fileName(key).c_str(), data, size);
+        if (r < 0) {
+            return r;
+        }
+        return 0;
+    }
+
+    int remove(uint16_t key) override {
+        const auto name = fileName(key);
+        if (!fs_->hasFile(name)) {
+            return SYSTEM_ERROR_NOT_FOUND;
+        }
+        SimpleFileStorage::clear(name.c_str());
+        return 0;
+    }
+
+    void failWrites(bool enabled) {
+        failWrites_ = enabled;
+    }
+
+    static std::string fileName(uint16_t key) {
+        return "record" + std::to_string(key);
+    }
+
+    static std::string fileData(const std::string& data) {
+        std::string h(4, '\0');
+        h[0] = data.size() & 0xff;
+        h[1] = (data.size() >> 8) & 0xff;
+        return h + data;
+    }
+
+private:
+    test::Filesystem* fs_;
+    bool failWrites_;
+};
+
+std::string get(WriteBehindCache& cache, uint16_t key) {
+    char buf[32] = {};
+    const int r = cache.get(key, buf, sizeof(buf));
+    if (r < 0) {
+        return "error " + std::to_string(r);
+    }
+    return std::string(buf, r);
+}
+
+} // namespace
+
+TEST_CASE("WriteBehindCache") {
+    MockRepository mocks;
+    test::Filesystem fs(&mocks);
+    FileStorage storage(&fs);
+    WriteBehindCache cache(&storage, FLUSH_DELAY);
+    system_tick_t now = 1000;
+
+    SECTION("coalesces repeated writes to the same key") {
+        for (unsigned i = 0; i < 100; ++i) {
+            const auto d = std::to_string(i);
+            REQUIRE(cache.set(1, d.data(), d.size(), now + i) == 0);
+        }
+        CHECK(cache.hasPendingWrites());
+        CHECK(fs.writeCount() == 0);
+        CHECK(fs.commitCount() == 0);
+        CHECK(get(cache, 1) == "99");
+        REQUIRE(cache.flush() == 0);
+        CHECK_FALSE(cache.hasPendingWrites());
+        CHECK(fs.commitCount() == 1);
+        CHECK(fs.readFile(FileStorage::fileName(1)) == FileStorage::fileData("99"));
+    }
+
+    SECTION("writes pending modifications once the flush delay has elapsed") {
+        REQUIRE(cache.set(1, "abc", 3, now) == 0);
+        REQUIRE(cache.set(2, "def", 3, now) == 0);
+        REQUIRE(cache.process(now + FLUSH_DELAY - 1) == 0);
+        CHECK(fs.commitCount() == 0);
+        REQUIRE(cache.process(now + FLUSH_DELAY) == 0);
+        CHECK(fs.commitCount() == 2);
+        CHECK(fs.readFile(FileStorage::fileName(1)) == FileStorage::fileData("abc"));
+        CHECK(fs.readFile(FileStorage::fileName(2)) == FileStorage::fileData("def"));
+    }
+
+    SECTION("doesn't extend the flush delay when a record is modified repeatedly") {
+        for (system_tick_t t = now; t < now + FLUSH_DELAY; t += 100) {
+            REQUIRE(cache.set(1, &t, sizeof(t), t) == 0);
+            REQUIRE(cache.process(t) == 0);
+        }
+        CHECK(fs.commitCount() == 0);
+        REQUIRE(cache.process(now + FLUSH_DELAY) == 0);
+        CHECK(fs.commitCount() == 1);
+    }
+
+    SECTION("discards writes that don't change the record") {
+        REQUIRE(cache.set(1, "abc", 3, now) == 0);
+        REQUIRE(cache.flush() == 0);
+        REQUIRE(cache.set(1, "abc", 3, now) == 0);
+        CHECK_FALSE(cache.hasPendingWrites());
+        REQUIRE(cache.flush() == 0);
+        CHECK(fs.commitCount() == 1);
+    }
+
+    SECTION("serves reads from the cache") {
+        fs.writeFile(FileStorage::fileName(1), FileStorage::fileData("abc"));
+        CHECK(get(cache, 1) == "abc");
+        REQUIRE(cache.set(2, "def", 3, now) == 0);
+        REQUIRE(cache.flush() == 0);
+        mocks.NeverCallFunc(lfs_file_read);
+        CHECK(get(cache, 2) == "def");
+        CHECK(get(cache, 3) == "error " + std::to_string(SYSTEM_ERROR_NOT_FOUND));
+    }
+
+    SECTION("defers removal of records") {
+        fs.writeFile(FileStorage::fileName(1), FileStorage::fileData("abc"));
+        REQUIRE(cache.del(1, now) == 0);
+        CHECK(get(cache, 1) == "error " + std::to_string(SYSTEM_ERROR_NOT_FOUND));
+        CHECK(fs.hasFile(FileStorage::fileName(1)));
+        // Recreating the record cancels the removal
+        REQUIRE(cache.set(1, "def", 3, now) == 0);
+        REQUIRE(cache.del(1, now) == 0);
+        REQUIRE(cache.del(2, now) == 0); // Doesn't exist
+        REQUIRE(cache.process(now + FLUSH_DELAY) == 0);
+        CHECK_FALSE(fs.hasFile(FileStorage::fileName(1)));
+        CHECK_FALSE(cache.hasPendingWrites());
+    }
+
+    SECTION("writes all records synchronously when the cache is full") {
+        for (unsigned i = 0; i < WriteBehindCache::MAX_ENTRIES; ++i) {
+            REQUIRE(cache.set(i, &i, sizeof(i), now) == 0);
+        }
+        CHECK(fs.commitCount() == 0);
+        const unsigned key = WriteBehindCache::MAX_ENTRIES;
+        REQUIRE(cache.set(key, &key, sizeof(key), now) == 0);
+        CHECK(fs.commitCount() == WriteBehindCache::MAX_ENTRIES);
+        CHECK(cache.hasPendingWrites());
+        // Records evicted from the cache are read from the storage
+        for (unsigned i = 0; i <= WriteBehindCache::MAX_ENTRIES; ++i) {
+            unsigned val = 0;
+            CHECK(cache.get(i, &val, sizeof(val)) == sizeof(val));
+            CHECK(val == i);
+        }
+    }
+
+    SECTION("keeps the modifications that couldn't be written to the storage") {
+        REQUIRE(cache.set(1, "abc", 3, now) == 0);
+        storage.failWrites(true);
+        CHECK(cache.process(now + FLUSH_DELAY) == SYSTEM_ERROR_FILE);
+        CHECK(cache.hasPendingWrites());
+        storage.failWrites(false);
+        // Retried after another delay
+        REQUIRE(cache.process(now + FLUSH_DELAY * 2 - 1) == 0);
+        CHECK(fs.commitCount() == 0);
+        REQUIRE(cache.process(now + FLUSH_DELAY * 2) == 0);
+        CHECK(fs.readFile(FileStorage::fileName(1)) == FileStorage::fileData("abc"));
+    }
+
+    SECTION("writes the pending modifications when destroyed") {
+        {
+            WriteBehindCache c(&storage, FLUSH_DELAY);
+            REQUIRE(c.set(1, "abc", 3, now) == 0);
+            CHECK(fs.commitCount() == 0);
+        }
+        CHECK(fs.readFile(FileStorage::fileName(1)) == FileStorage::fileData("abc"));
+    }
+
+    SECTION("fails if the record is too large") {
+        std::string d(0x10000, 'a');
+        CHECK(cache.set(1, d.data(), d.size(), now) == SYSTEM_ERROR_TOO_LARGE);
+        CHECK_FALSE(cache.hasPendingWrites());
+    }
+}
@@ -16,12 +16,17 @@
  */
 
 #include "filesystem.h"
+#include "system_error.h"
 
 filesystem_t* filesystem_get_instance(filesystem_instance_t index, void* reserved) {
     static filesystem_t fs;
     return &fs;
 }
 
+int filesystem_mount(filesystem_t* fs) {
+    return 0;
+}
+
 int filesystem_lock(filesystem_t* fs) {
     return 0;
 }
@@ -30,6 +35,10 @@ int filesystem_unlock(filesystem_t* fs) {
     return 0;
 }
 
+int filesystem_to_system_error(int error) {
+    return (error < 0) ? SYSTEM_ERROR_FILESYSTEM : SYSTEM_ERROR_NONE;
+}
+
 int lfs_file_open(lfs_t* lfs, lfs_file_t* file, const char* path, int flags) {
     return 0;
 }
@@ -69,3 +78,11 @@ int lfs_file_sync(lfs_t* lfs, lfs_file_t* file) {
 int lfs_remove(lfs_t* lfs, const char* path) {
     return 0;
 }
+
+int lfs_stat(lfs_t* lfs, const char* path, struct lfs_info* info) {
+    return LFS_ERR_NOENT;
+}
+
+int lfs_mkdir(lfs_t* lfs, const char* path) {
+    return 0;
+}
@@ -61,6 +61,11 @@ enum lfs_whence_flags {
     LFS_SEEK_END = 2
 };
 
+enum lfs_type {
+    LFS_TYPE_REG = 0x001,
+    LFS_TYPE_DIR = 0x002
+};
+
 typedef struct lfs {
 } lfs_t;
 
@@ -70,6 +75,12 @@ typedef struct lfs_file {
     int fd;
 } lfs_file_t;
 
+struct lfs_info {
+    uint8_t type;
+    lfs_size_t size;
+    char name[256];
+};
+
 typedef struct {
     lfs_t instance;
 } filesystem_t;
@@ -93,15 +104,29 @@ lfs_soff_t lfs_file_tell(lfs_t* lfs, lfs_file_t* file);
 int lfs_file_truncate(lfs_t* lfs, lfs_file_t* file, lfs_off_t size);
 int lfs_file_sync(lfs_t* lfs, lfs_file_t* file);
 int lfs_remove(lfs_t* lfs, const char* path);
+int lfs_stat(lfs_t* lfs, const char* path, struct lfs_info* info);
+int lfs_mkdir(lfs_t* lfs, const char* path);
 // TODO: Add stubs for remaining API functions
 
 filesystem_t* filesystem_get_instance(filesystem_instance_t index, void* reserved);
+int filesystem_mount(filesystem_t* fs);
 int filesystem_lock(filesystem_t* fs);
 int filesystem_unlock(filesystem_t* fs);
 
+int filesystem_to_system_error(int error);
+
 #ifdef __cplusplus
 } // extern "C"
 
+#define CHECK_FS(expr) \
+        ({ \
+            auto _r = expr; \
+            if (_r < 0) { \
+                return filesystem_to_system_error(_r); \
+            } \
+            _r; \
+        })
+
 namespace particle {
 
 namespace fs {
@@ -0,0 +1,440 @@
+#include "ble_control_request_channel.h"
+#include "system_event.h"
+#include "system_error.h"
+
+#include "util/bench.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstring>
+
+using namespace particle;
+using namespace particle::system;
+
+namespace {
+
+const hal_ble_conn_handle_t CONN_HANDLE = 1;
+
+const hal_ble_attr_handle_t SEND_CHAR_HANDLE = 10;
+const hal_ble_attr_handle_t SEND_CHAR_CCCD_HANDLE = 11;
+const hal_ble_attr_handle_t RECV_CHAR_HANDLE = 20;
+
+const size_t MESSAGE_HEADER_SIZE = 2;
+const size_t REQUEST_HEADER_SIZE = 6;
+const size_t REPLY_HEADER_SIZE = 6;
+
+const uint16_t TEST_REQ = 1234; // Application-specific request type
+
+// Fake BLE stack: captures the channel's callbacks and the notification packets
+class FakeBle {
+public:
+    FakeBle() :
+            charCallback_(nullptr),
+            charContext_(nullptr),
+            linkCallback_(nullptr),
+            linkContext_(nullptr),
+            charCount_(0),
+            notifyResult_(0),
+            disconnected_(false) {
+        instance_ = this;
+    }
+
+    ~FakeBle() {
+        instance_ = nullptr;
+    }
+
+    void connect(size_t attMtu = BLE_MIN_ATT_MTU_SIZE) {
+        hal_ble_link_evt_t e = {};
+        e.type = BLE_EVT_CONNECTED;
+        e.conn_handle = CONN_HANDLE;
+        linkCallback_(&e, linkContext_);
+        if (attMtu != BLE_MIN_ATT_MTU_SIZE) {
+            e = {};
+            e.type = BLE_EVT_ATT_MTU_UPDATED;
+            e.conn_handle = CONN_HANDLE;
+            e.params.att_mtu_updated.att_mtu_size = attMtu;
+            linkCallback_(&e, linkContext_);
+        }
+        hal_ble_char_evt_t c = {};
+        c.type = BLE_EVT_CHAR_CCCD_UPDATED;
+        c.conn_handle = CONN_HANDLE;
+        c.attr_handle = SEND_CHAR_CCCD_HANDLE;
+        c.params.cccd_config.value = BLE_SIG_CCCD_VAL_NOTIFICATION;
+        charCallback_(&c, charContext_);
+    }
+
+    // Writes data to the RX characteristic in packets of the given size
+    void write(const std::string& data, size_t packetSize) {
+        for (size_t offs = 0; offs < data.size(); offs += packetSize) {
+            std::string d = data.substr(offs, packetSize);
+            hal_ble_char_evt_t e = {};
+            e.type = BLE_EVT_DATA_WRITTEN;
+            e.conn_handle = CONN_HANDLE;
+            e.attr_handle = RECV_CHAR_HANDLE;
+            e.params.data_written.data = (uint8_t*)&d[0];
+            e.params.data_written.len = d.size();
+            charCallback_(&e, charContext_);
+        }
+    }
+
+    // Returns all data received from the channel and clears the packet log
+    std::string read() {
+        std::string d;
+        for (auto& p: packets_) {
+            d += p;
+        }
+        packets_.clear();
+        return d;
+    }
+
+    const std::vector<std::string>& packets() const {
+        return packets_;
+    }
+
+    void notifyResult(int result) {
+        notifyResult_ = result;
+    }
+
+    bool disconnected() const {
+        return disconnected_;
+    }
+
+    // Implementation of the HAL functions
+    void addCharacteristic(const hal_ble_char_init_t* charInit, hal_ble_char_handles_t* handles) {
+        *handles = {};
+        // The channel adds the version, TX and RX characteristics in that order
+        switch (charCount_++) {
+        case 1:
+            handles->value_handle = SEND_CHAR_HANDLE;
+            handles->cccd_handle = SEND_CHAR_CCCD_HANDLE;
+            break;
+        case 2:
+            handles->value_handle = RECV_CHAR_HANDLE;
+            break;
+        default:
+            handles->value_handle = 2;
+            break;
+        }
+        if (charInit->callback) {
+            charCallback_ = charInit->callback;
+            charContext_ = charInit->context;
+        }
+    }
+
+    int notify(hal_ble_attr_handle_t handle, const uint8_t* data, size_t size) {
+        REQUIRE(handle == SEND_CHAR_HANDLE);
+        if (notifyResult_ < 0) {
+            return notifyResult_;
+        }
+        packets_.push_back(std::string((const char*)data, size));
+        return size;
+    }
+
+    void setLinkCallback(hal_ble_on_link_evt_cb_t callback, void* context) {
+        linkCallback_ = callback;
+        linkContext_ = context;
+    }
+
+    void disconnect() {
+        disconnected_ = true;
+    }
+
+    static FakeBle* instance() {
+        REQUIRE(instance_);
+        return instance_;
+    }
+
+private:
+    std::vector<std::string> packets_;
+    hal_ble_on_char_evt_cb_t charCallback_;
+    void* charContext_;
+    hal_ble_on_link_evt_cb_t linkCallback_;
+    void* linkContext_;
+    unsigned charCount_;
+    int notifyResult_;
+    bool disconnected_;
+
+    static FakeBle* instance_;
+};
+
+FakeBle* FakeBle::instance_ = nullptr;
+
+// Request handler that either completes the requests immediately by echoing their data back to
+// the client or keeps them pending until complete() is called
+class Handler: public ControlRequestHandler {
+public:
+    Handler() :
+            echo_(true) {
+    }
+
+    void processRequest(ctrl_request* req, ControlRequestChannel* channel) override {
+        if (echo_) {
+            reply(req, channel);
+        } else {
+            pending_.push_back({ req, channel });
+        }
+    }
+
+    void complete(size_t index) {
+        REQUIRE(index < pending_.size());
+        reply(pending_.at(index).first, pending_.at(index).second);
+    }
+
+    size_t pendingCount() const {
+        return pending_.size();
+    }
+
+    void echo(bool enabled) {
+        echo_ = enabled;
+    }
+
+private:
+    std::vector<std::pair<ctrl_request*, ControlRequestChannel*>> pending_;
+    bool echo_;
+
+    static void reply(ctrl_request* req, ControlRequestChannel* channel) {
+        const std::string d((const char*)req->request_data, req->request_size);
+        REQUIRE(channel->allocReplyData(req, d.size()) == 0);
+        if (d.size()) {
+            memcpy(req->reply_data, d.data(), d.size());
+        }
+        channel->setResult(req, SYSTEM_ERROR_NONE);
+    }
+};
+
+struct Reply {
+    uint16_t id;
+    int32_t result;
+    std::string data;
+};
+
+std::string requestMessage(uint16_t id, const std::string& data) {
+    std::string m(MESSAGE_HEADER_SIZE + REQUEST_HEADER_SIZE, '\0');
+    m[0] = data.size() & 0xff;
+    m[1] = (data.size() >> 8) & 0xff;
+    m[2] = id & 0xff;
+    m[3] = (id >> 8) & 0xff;
+    m[4] = TEST_REQ & 0xff;
+    m[5] = (TEST_REQ >> 8) & 0xff;
+    return m + data;
+}
+
+std::vector<Reply> parseReplies(const std::string& data) {
+    std::vector<Reply> reps;
+    size_t offs = 0;
+    while (offs < data.size()) {
+        REQUIRE(data.size() - offs >= MESSAGE_HEADER_SIZE + REPLY_HEADER_SIZE);
+        const auto p = (const uint8_t*)data.data() + offs;
+        const size_t size = p[0] | (p[1] << 8);
+        Reply r = {};
+        r.id = p[2] | (p[3] << 8);
+        r.result = (int32_t)(p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24));
+        offs += MESSAGE_HEADER_SIZE + REPLY_HEADER_SIZE;
+        REQUIRE(data.size() - offs >= size);
+        r.data = data.substr(offs, size);
+        offs += size;
+        reps.push_back(r);
+    }
+    return reps;
+}
+
+std::string testData(size_t size, char c = 'a') {
+    std::string d(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        d[i] = c + i % 26;
+    }
+    return d;
+}
+
+} // namespace
+
+void system_notify_event(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata,
+        unsigned flags) {
+}
+
+bool hal_ble_is_initialized(void* reserved) {
+    return true;
+}
+
+int hal_ble_stack_init(void* reserved) {
+    return 0;
+}
+
+int hal_ble_gatt_server_add_service(uint8_t type, const hal_ble_uuid_t* uuid, hal_ble_attr_handle_t* handle, void* reserved) {
+    *handle = 1;
+    return 0;
+}
+
+int hal_ble_gatt_server_add_characteristic(const hal_ble_char_init_t* charInit, hal_ble_char_handles_t* handles, void* reserved) {
+    FakeBle::instance()->addCharacteristic(charInit, handles);
+    return 0;
+}
+
+ssize_t hal_ble_gatt_server_set_characteristic_value(hal_ble_attr_handle_t handle, const uint8_t* buf, size_t len, void* reserved) {
+    return len;
+}
+
+ssize_t hal_ble_gatt_server_notify_characteristic_value(hal_ble_attr_handle_t handle, const uint8_t* buf, size_t len, void* reserved) {
+    return FakeBle::instance()->notify(handle, buf, len);
+}
+
+int hal_ble_set_callback_on_periph_link_events(hal_ble_on_link_evt_cb_t callback, void* context, void* reserved) {
+    FakeBle::instance()->setLinkCallback(callback, context);
+    return 0;
+}
+
+int hal_ble_gap_disconnect(hal_ble_conn_handle_t handle, void* reserved) {
+    FakeBle::instance()->disconnect();
+    return 0;
+}
+
+TEST_CASE("BleControlRequestChannel") {
+    FakeBle ble;
+    Handler handler;
+    BleControlRequestChannel channel(&handler);
+    REQUIRE(channel.init() == 0);
+
+    SECTION("processes all requests received in one iteration") {
+        ble.connect();
+        channel.run();
+        std::string d;
+        for (uint16_t id = 1; id <= 4; ++id) {
+            d += requestMessage(id, testData(id * 10));
+        }
+        ble.write(d, BLE_MIN_ATTR_VALUE_PACKET_SIZE);
+        channel.run(); // Receive the requests
+        channel.run(); // Send the replies
+        const auto reps = parseReplies(ble.read());
+        REQUIRE(reps.size() == 4);
+        for (uint16_t id = 1; id <= 4; ++id) {
+            CHECK(reps[id - 1].id == id);
+            CHECK(reps[id - 1].result == 0);
+            CHECK(reps[id - 1].data == testData(id * 10));
+        }
+    }
+
+    SECTION("requests can be completed out of order") {
+        handler.echo(false);
+        ble.connect();
+        channel.run();
+        for (uint16_t id = 1; id <= 3; ++id) {
+            ble.write(requestMessage(id, testData(5)), BLE_MIN_ATTR_VALUE_PACKET_SIZE);
+        }
+        channel.run();
+        REQUIRE(handler.pendingCount() == 3);
+        handler.complete(2);
+        handler.complete(0);
+        channel.run();
+        auto reps = parseReplies(ble.read());
+        REQUIRE(reps.size() == 2);
+        CHECK(reps[0].id == 3);
+        CHECK(reps[1].id == 1);
+        handler.complete(1);
+        channel.run();
+        reps = parseReplies(ble.read());
+        REQUIRE(reps.size() == 1);
+        CHECK(reps[0].id == 2);
+    }
+
+    SECTION("sends packets of the negotiated size") {
+        ble.connect(BLE_MAX_ATT_MTU_SIZE);
+        channel.run();
+        const auto data = testData(1000);
+        ble.write(requestMessage(1, data), BLE_MAX_ATTR_VALUE_PACKET_SIZE);
+        channel.run();
+        channel.run();
+        const size_t total = data.size() + MESSAGE_HEADER_SIZE + REPLY_HEADER_SIZE;
+        const auto& packets = ble.packets();
+        REQUIRE(packets.size() == (total + BLE_MAX_ATTR_VALUE_PACKET_SIZE - 1) / BLE_MAX_ATTR_VALUE_PACKET_SIZE);
+        for (size_t i = 0; i < packets.size() - 1; ++i) {
+            CHECK(packets[i].size() == BLE_MAX_ATTR_VALUE_PACKET_SIZE);
+        }
+        const auto reps = parseReplies(ble.read());
+        REQUIRE(reps.size() == 1);
+        CHECK(reps[0].data == data);
+    }
+
+    SECTION("coalesces small replies into a single packet") {
+        ble.connect(BLE_MAX_ATT_MTU_SIZE);
+        channel.run();
+        for (uint16_t id = 1; id <= 3; ++id) {
+            ble.write(requestMessage(id, testData(10)), BLE_MAX_ATTR_VALUE_PACKET_SIZE);
+        }
+        channel.run();
+        channel.run();
+        CHECK(ble.packets().size() == 1);
+        CHECK(parseReplies(ble.read()).size() == 3);
+    }
+
+    SECTION("limits the number of packets sent in one iteration") {
+        ble.connect();
+        channel.run();
+        const auto data = testData(2000);
+        const auto msg = requestMessage(1, data);
+        // The client can't write faster than the device processes the data
+        for (size_t offs = 0; offs < msg.size(); offs += 400) {
+            ble.write(msg.substr(offs, 400), BLE_MIN_ATTR_VALUE_PACKET_SIZE);
+            channel.run();
+        }
+        REQUIRE(ble.packets().empty());
+        channel.run();
+        const size_t total = data.size() + MESSAGE_HEADER_SIZE + REPLY_HEADER_SIZE;
+        const size_t n = ble.packets().size();
+        CHECK(n > 1);
+        CHECK(n < (total + BLE_MIN_ATTR_VALUE_PACKET_SIZE - 1) / BLE_MIN_ATTR_VALUE_PACKET_SIZE);
+        for (unsigned i = 0; i < 1000 && ble.packets().size() * BLE_MIN_ATTR_VALUE_PACKET_SIZE < total; ++i) {
+            channel.run();
+        }
+        const auto reps = parseReplies(ble.read());
+        REQUIRE(reps.size() == 1);
+        CHECK(reps[0].data == data);
+    }
+
+    SECTION("disconnects the client if a packet cannot be sent") {
+        ble.connect();
+        channel.run();
+        ble.write(requestMessage(1, testData(10)), BLE_MIN_ATTR_VALUE_PACKET_SIZE);
+        channel.run();
+        ble.notifyResult(SYSTEM_ERROR_INTERNAL);
+        channel.run();
+        CHECK(ble.disconnected());
+    }
+}
+
+TEST_CASE("BleControlRequestChannel benchmark", "[.][benchmark]") {
+    const unsigned ITERATIONS = 10000;
+    const unsigned BATCH = 8;
+
+    for (size_t size: { 32, 1024 }) {
+        FakeBle ble;
+        Handler handler;
+        BleControlRequestChannel channel(&handler);
+        REQUIRE(channel.init() == 0);
+        ble.connect(BLE_MAX_ATT_MTU_SIZE);
+        channel.run();
+        const auto data = testData(size);
+        const size_t replySize = (size + MESSAGE_HEADER_SIZE + REPLY_HEADER_SIZE) * BATCH;
+        unsigned runs = 0;
+        const double ns = particle::test::benchmark(ITERATIONS / BATCH, [&](unsigned) {
+            for (unsigned i = 0; i < BATCH; ++i) {
+                ble.write(requestMessage(i + 1, data), BLE_MAX_ATTR_VALUE_PACKET_SIZE);
+                channel.run();
+                ++runs;
+            }
+            size_t received = ble.read().size();
+            while (received < replySize) {
+                REQUIRE_FALSE(ble.disconnected());
+                channel.run();
+                ++runs;
+                received += ble.read().size();
+            }
+        }) / BATCH;
+        const auto name = "Request (" + std::to_string(size) + " bytes)";
+        particle::test::printBenchmark(name, ns);
+        particle::test::printBenchmark(name + ", loop iterations", (double)runs / ITERATIONS, "iterations/op");
+    }
+}
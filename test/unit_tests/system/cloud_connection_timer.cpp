@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_cloud_connection_timer.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace particle::system;
+
+TEST_CASE("CloudConnectionTimer") {
+    CloudConnectionTimer timer;
+    system_tick_t now = 1000;
+
+    SECTION("measures the duration of each phase") {
+        timer.start(now);
+        CHECK(timer.isRunning());
+        timer.phaseDone(CloudConnectionTimer::NETWORK, now + 3000);
+        timer.phaseDone(CloudConnectionTimer::RESOLVE, now + 3100);
+        timer.phaseDone(CloudConnectionTimer::SOCKET, now + 3150);
+        timer.phaseDone(CloudConnectionTimer::HANDSHAKE, now + 4150);
+        REQUIRE(timer.finish(now + 4400));
+        CHECK_FALSE(timer.isRunning());
+        CHECK(timer.duration(CloudConnectionTimer::NETWORK) == 3000);
+        CHECK(timer.duration(CloudConnectionTimer::RESOLVE) == 100);
+        CHECK(timer.duration(CloudConnectionTimer::SOCKET) == 50);
+        CHECK(timer.duration(CloudConnectionTimer::HANDSHAKE) == 1000);
+        CHECK(timer.duration(CloudConnectionTimer::SESSION) == 250);
+        CHECK(timer.totalDuration() == 4400);
+    }
+
+    SECTION("accounts the phases that were not reached as having taken no time") {
+        timer.start(now);
+        timer.phaseDone(CloudConnectionTimer::SOCKET, now + 100);
+        timer.phaseDone(CloudConnectionTimer::HANDSHAKE, now + 500);
+        REQUIRE(timer.finish(now + 600));
+        CHECK(timer.duration(CloudConnectionTimer::NETWORK) == 0);
+        CHECK(timer.duration(CloudConnectionTimer::RESOLVE) == 0);
+        CHECK(timer.duration(CloudConnectionTimer::SOCKET) == 100);
+        CHECK(timer.duration(CloudConnectionTimer::HANDSHAKE) == 400);
+        CHECK(timer.duration(CloudConnectionTimer::SESSION) == 100);
+        CHECK(timer.totalDuration() == 600);
+    }
+
+    SECTION("keeps the first recorded end of a phase across connection attempts") {
+        timer.start(now);
+        timer.phaseDone(CloudConnectionTimer::NETWORK, now + 100);
+        timer.phaseDone(CloudConnectionTimer::RESOLVE, now + 200);
+        // The socket connection fails and is retried after a backoff period
+        timer.start(now + 5000);
+        timer.phaseDone(CloudConnectionTimer::RESOLVE, now + 10000);
+        timer.phaseDone(CloudConnectionTimer::SOCKET, now + 10100);
+        REQUIRE(timer.finish(now + 11000));
+        CHECK(timer.duration(CloudConnectionTimer::RESOLVE) == 100);
+        CHECK(timer.duration(CloudConnectionTimer::SOCKET) == 9900);
+        CHECK(timer.totalDuration() == 11000);
+    }
+
+    SECTION("handles the wrap-around of the tick counter") {
+        now = 0xffffff00;
+        timer.start(now);
+        timer.phaseDone(CloudConnectionTimer::NETWORK, now + 0x80);
+        timer.phaseDone(CloudConnectionTimer::RESOLVE, now + 0x180);
+        REQUIRE(timer.finish(now + 0x200));
+        CHECK(timer.duration(CloudConnectionTimer::NETWORK) == 0x80);
+        CHECK(timer.duration(CloudConnectionTimer::RESOLVE) == 0x100);
+        CHECK(timer.duration(CloudConnectionTimer::SESSION) == 0x80);
+        CHECK(timer.totalDuration() == 0x200);
+    }
+
+    SECTION("ignores the phases recorded when no measurement is in progress") {
+        timer.phaseDone(CloudConnectionTimer::NETWORK, now);
+        CHECK_FALSE(timer.finish(now + 100));
+        timer.start(now);
+        timer.cancel();
+        CHECK_FALSE(timer.isRunning());
+        CHECK_FALSE(timer.finish(now + 100));
+    }
+
+    SECTION("formats the results of the measurement") {
+        timer.start(now);
+        timer.phaseDone(CloudConnectionTimer::NETWORK, now + 10);
+        timer.phaseDone(CloudConnectionTimer::HANDSHAKE, now + 30);
+        REQUIRE(timer.finish(now + 60));
+        const std::string expected = "network: 10 ms, resolve: 0 ms, socket: 0 ms, handshake: 20 ms, session: 30 ms";
+        char buf[128] = {};
+        CHECK(timer.format(buf, sizeof(buf)) == (int)expected.size());
+        CHECK(std::string(buf) == expected);
+        char small[16] = {};
+        CHECK(timer.format(small, sizeof(small)) == (int)expected.size());
+        CHECK(std::string(small) == expected.substr(0, sizeof(small) - 1));
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_describe_cache.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace particle::system;
+
+namespace {
+
+// State of the simulated Describe data
+struct DescribeState {
+    std::string data;
+    unsigned encodeCount;
+    unsigned checksumCount;
+    bool failEncoding;
+};
+
+DescribeState g_state = {};
+
+// Encodes the Describe data in small chunks like nanopb does
+bool encode(appender_fn appender, void* appendData, void* reserved) {
+    ++g_state.encodeCount;
+    if (g_state.failEncoding) {
+        return false;
+    }
+    for (size_t offs = 0; offs < g_state.data.size(); offs += 7) {
+        const size_t n = std::min<size_t>(7, g_state.data.size() - offs);
+        if (!appender(appendData, (const uint8_t*)g_state.data.data() + offs, n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t checksum() {
+    ++g_state.checksumCount;
+    uint32_t sum = 0;
+    for (char c: g_state.data) {
+        sum = sum * 31 + (uint8_t)c;
+    }
+    return sum;
+}
+
+bool appendToString(void* appender, const uint8_t* data, size_t size) {
+    static_cast<std::string*>(appender)->append((const char*)data, size);
+    return true;
+}
+
+std::string uncachedData() {
+    std::string s;
+    REQUIRE(encode(appendToString, &s, nullptr));
+    return s;
+}
+
+std::string cachedData(DescribeCache& cache, DescribeCache::Type type = DescribeCache::SYSTEM) {
+    std::string s;
+    REQUIRE(cache.append(type, encode, appendToString, &s));
+    return s;
+}
+
+std::string makeData(size_t size, char first) {
+    std::string s;
+    for (size_t i = 0; i < size; ++i) {
+        s += (char)(first + i % 26);
+    }
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("DescribeCache") {
+    g_state = DescribeState();
+    DescribeCache cache;
+
+    SECTION("produces the same data as the uncached encoder") {
+        for (size_t size: { 0, 1, 7, 100, 255, 256, 257, 1500 }) {
+            g_state.data = makeData(size, 'a');
+            cache.invalidate(DescribeCache::SYSTEM);
+            const auto expected = uncachedData();
+            CHECK(cachedData(cache) == expected);
+            CHECK(cachedData(cache) == expected);
+        }
+    }
+
+    SECTION("doesn't re-encode the data until it's invalidated") {
+        g_state.data = makeData(500, 'a');
+        const auto d1 = cachedData(cache);
+        CHECK(g_state.encodeCount == 1);
+        g_state.data = makeData(500, 'A'); // Changed without invalidating the cache
+        CHECK(cachedData(cache) == d1);
+        CHECK(g_state.encodeCount == 1);
+        cache.invalidate(DescribeCache::SYSTEM);
+        CHECK(cachedData(cache) == uncachedData());
+        CHECK(g_state.encodeCount == 3); // Including the uncached encoding
+    }
+
+    SECTION("caches the checksum") {
+        g_state.data = "abc";
+        const auto c1 = cache.checksum(DescribeCache::SYSTEM, ::checksum);
+        CHECK(c1 == ::checksum());
+        CHECK(cache.checksum(DescribeCache::SYSTEM, ::checksum) == c1);
+        CHECK(g_state.checksumCount == 2);
+        g_state.data = "def";
+        cache.invalidate(DescribeCache::SYSTEM);
+        CHECK(cache.checksum(DescribeCache::SYSTEM, ::checksum) == ::checksum());
+        CHECK(g_state.checksumCount == 4);
+    }
+
+    SECTION("tracks the Describe types separately") {
+        g_state.data = "abc";
+        CHECK(cachedData(cache, DescribeCache::SYSTEM) == "abc");
+        g_state.data = "def";
+        CHECK(cachedData(cache, DescribeCache::APP) == "def");
+        CHECK(cachedData(cache, DescribeCache::SYSTEM) == "abc");
+        const auto gen = cache.generation(DescribeCache::SYSTEM);
+        cache.invalidate(DescribeCache::APP);
+        CHECK(cache.generation(DescribeCache::SYSTEM) == gen);
+        CHECK(cachedData(cache, DescribeCache::SYSTEM) == "abc");
+        g_state.data = "ghi";
+        CHECK(cachedData(cache, DescribeCache::APP) == "ghi");
+    }
+
+    SECTION("doesn't cache the data if the encoding fails") {
+        g_state.data = "abc";
+        g_state.failEncoding = true;
+        std::string s;
+        CHECK_FALSE(cache.append(DescribeCache::SYSTEM, encode, appendToString, &s));
+        g_state.failEncoding = false;
+        CHECK(cachedData(cache) == "abc");
+        CHECK(g_state.encodeCount == 2);
+    }
+
+    SECTION("discards all cached data") {
+        g_state.data = "abc";
+        CHECK(cachedData(cache) == "abc");
+        cache.checksum(DescribeCache::SYSTEM, ::checksum);
+        cache.clear();
+        g_state.data = "def";
+        CHECK(cachedData(cache) == "def");
+        CHECK(cache.checksum(DescribeCache::SYSTEM, ::checksum) == ::checksum());
+    }
+}
@@ -0,0 +1,230 @@
+#include "active_object.h"
+
+#include "util/random.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+struct TestTask: ISRTaskQueue::Task {
+    std::vector<TestTask*>* log;
+    unsigned calls;
+    bool requeue;
+
+    explicit TestTask(std::vector<TestTask*>* log = nullptr) :
+            ISRTaskQueue::Task(callback),
+            log(log),
+            calls(0),
+            requeue(false) {
+    }
+
+    static ISRTaskQueue* queue;
+
+    static void callback(ISRTaskQueue::Task* task) {
+        const auto t = static_cast<TestTask*>(task);
+        ++t->calls;
+        if (t->log) {
+            t->log->push_back(t);
+        }
+        if (t->requeue) {
+            t->requeue = false;
+            queue->enqueue(t);
+        }
+    }
+};
+
+ISRTaskQueue* TestTask::queue = nullptr;
+
+struct StressTask: ISRTaskQueue::Task {
+    std::atomic<unsigned> requested;
+    std::atomic<unsigned> calls;
+
+    StressTask() :
+            ISRTaskQueue::Task(callback),
+            requested(0),
+            calls(0) {
+    }
+
+    static void callback(ISRTaskQueue::Task* task) {
+        const auto t = static_cast<StressTask*>(task);
+        t->requested.store(0);
+        t->calls.fetch_add(1);
+    }
+};
+
+unsigned processAll(ISRTaskQueue* queue) {
+    unsigned n = 0;
+    while (queue->process()) {
+        ++n;
+    }
+    return n;
+}
+
+// Adds the tasks to the queue from multiple threads while the queue is being processed
+void runStressTest(bool removeTasks) {
+    const unsigned PRODUCER_COUNT = 4;
+    const unsigned TASK_COUNT = 16;
+    const unsigned ITERATIONS = 100000;
+
+    ISRTaskQueue q;
+    std::unique_ptr<StressTask[]> tasks(new StressTask[TASK_COUNT]);
+    std::atomic<bool> done(false);
+    std::atomic<unsigned> enqueued(0);
+
+    std::vector<std::thread> producers;
+    for (unsigned i = 0; i < PRODUCER_COUNT; ++i) {
+        const auto seed = particle::test::randGen()();
+        producers.emplace_back([&, seed]() {
+            std::minstd_rand gen(seed);
+            for (unsigned j = 0; j < ITERATIONS; ++j) {
+                auto& t = tasks[gen() % TASK_COUNT];
+                t.requested.store(1);
+                q.enqueue(&t);
+                enqueued.fetch_add(1);
+            }
+        });
+    }
+    std::thread consumer([&]() {
+        std::minstd_rand gen(particle::test::randGen()());
+        for (;;) {
+            const bool stop = done.load();
+            if (removeTasks && gen() % 4 == 0) {
+                q.remove(&tasks[gen() % TASK_COUNT]);
+            }
+            if (!q.process() && stop) {
+                break;
+            }
+        }
+    });
+    for (auto& t: producers) {
+        t.join();
+    }
+    done.store(true);
+    consumer.join();
+
+    unsigned calls = 0;
+    for (unsigned i = 0; i < TASK_COUNT; ++i) {
+        calls += tasks[i].calls.load();
+        if (!removeTasks) {
+            // Every request has been followed by an invocation of the task
+            CHECK(tasks[i].requested.load() == 0);
+        }
+    }
+    CHECK(calls <= enqueued.load());
+    CHECK(calls > 0);
+
+    // The queue is still consistent: every task is invoked exactly once
+    for (unsigned i = 0; i < TASK_COUNT; ++i) {
+        tasks[i].calls.store(0);
+        q.enqueue(&tasks[i]);
+        q.enqueue(&tasks[i]);
+    }
+    CHECK(processAll(&q) == TASK_COUNT);
+    for (unsigned i = 0; i < TASK_COUNT; ++i) {
+        CHECK(tasks[i].calls.load() == 1);
+    }
+}
+
+} // namespace
+
+TEST_CASE("ISRTaskQueue") {
+    ISRTaskQueue q;
+    TestTask::queue = &q;
+    std::vector<TestTask*> log;
+    TestTask t1(&log), t2(&log), t3(&log);
+
+    SECTION("processes the tasks in the order in which they were added") {
+        CHECK_FALSE(q.process());
+        q.enqueue(&t1);
+        q.enqueue(&t2);
+        CHECK(q.process());
+        q.enqueue(&t3);
+        CHECK(processAll(&q) == 2);
+        CHECK(log == std::vector<TestTask*>({ &t1, &t2, &t3 }));
+    }
+
+    SECTION("ignores a task that is already in the queue") {
+        q.enqueue(&t1);
+        q.enqueue(&t2);
+        q.enqueue(&t1);
+        CHECK(q.process()); // Moves the pending tasks to the consumer's list
+        q.enqueue(&t2);
+        CHECK(processAll(&q) == 1);
+        CHECK(log == std::vector<TestTask*>({ &t1, &t2 }));
+    }
+
+    SECTION("allows a task to add itself to the queue again") {
+        t1.requeue = true;
+        q.enqueue(&t1);
+        q.enqueue(&t2);
+        CHECK(processAll(&q) == 3);
+        CHECK(log == std::vector<TestTask*>({ &t1, &t2, &t1 }));
+    }
+
+    SECTION("removes a pending task") {
+        q.enqueue(&t1);
+        q.enqueue(&t2);
+        q.enqueue(&t3);
+        q.remove(&t2);
+        q.remove(&t2);
+        CHECK(processAll(&q) == 2);
+        CHECK(log == std::vector<TestTask*>({ &t1, &t3 }));
+    }
+
+    SECTION("removes a task from the consumer's list") {
+        q.enqueue(&t1);
+        q.enqueue(&t2);
+        q.enqueue(&t3);
+        CHECK(q.process());
+        q.remove(&t3);
+        q.remove(&t2);
+        CHECK_FALSE(q.process());
+        q.enqueue(&t3);
+        q.enqueue(&t2);
+        CHECK(processAll(&q) == 2);
+        CHECK(log == std::vector<TestTask*>({ &t1, &t3, &t2 }));
+    }
+
+    SECTION("removing a task that is not in the queue is a no-op") {
+        q.remove(&t1);
+        q.enqueue(&t2);
+        q.remove(&t1);
+        CHECK(processAll(&q) == 1);
+        CHECK(t1.calls == 0);
+        CHECK(t2.calls == 1);
+    }
+}
+
+TEST_CASE("ISRTaskQueue::remove()", "[concurrency]") {
+    SECTION("doesn't return while a producer is adding the task to the queue") {
+        const unsigned ITERATIONS = 1000;
+        ISRTaskQueue q;
+        for (unsigned i = 0; i < ITERATIONS; ++i) {
+            std::unique_ptr<TestTask> t(new TestTask());
+            std::thread producer([&]() {
+                q.enqueue(t.get());
+            });
+            // Wait until the producer starts adding the task
+            while (t->state.load() == 0) {
+            }
+            q.remove(t.get());
+            t.reset(); // The queue must no longer reference the task
+            producer.join();
+            CHECK_FALSE(q.process());
+        }
+    }
+}
+
+TEST_CASE("ISRTaskQueue stress test", "[concurrency]") {
+    for (bool removeTasks: { false, true }) {
+        runStressTest(removeTasks);
+    }
+}
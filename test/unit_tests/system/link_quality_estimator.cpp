@@ -0,0 +1,163 @@
+#include "system_link_quality.h"
+#include "system_error.h"
+
+#include "util/random.h"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+
+using namespace particle::system;
+
+namespace {
+
+unsigned randomInt(unsigned min, unsigned max) {
+    std::uniform_int_distribution<unsigned> dist(min, max);
+    return dist(particle::test::randGen());
+}
+
+const network_interface_t WIFI = 4;
+const network_interface_t CELLULAR = 2;
+
+// Simulates a link with a given round-trip time, jitter and loss rate
+class SimulatedLink {
+public:
+    SimulatedLink(LinkQualityEstimator* estimator, network_interface_t iface, unsigned rtt, unsigned jitter = 0,
+            unsigned loss = 0) :
+            estimator_(estimator),
+            iface_(iface),
+            rtt_(rtt),
+            jitter_(jitter),
+            loss_(loss) {
+    }
+
+    // Send a number of messages and feed the observations to the estimator
+    void run(unsigned count, system_tick_t now) {
+        for (unsigned i = 0; i < count; ++i) {
+            if ((unsigned)randomInt(0, 999) < loss_) {
+                estimator_->addDeliveries(iface_, 0, 1, now);
+                continue;
+            }
+            const unsigned rtt = rtt_ + (jitter_ ? randomInt(0, jitter_) : 0);
+            estimator_->addRoundTrip(iface_, rtt, now);
+            estimator_->addDeliveries(iface_, 1, 0, now);
+        }
+    }
+
+    void rtt(unsigned rtt) {
+        rtt_ = rtt;
+    }
+
+    void loss(unsigned loss) {
+        loss_ = loss;
+    }
+
+private:
+    LinkQualityEstimator* estimator_;
+    network_interface_t iface_;
+    unsigned rtt_;
+    unsigned jitter_;
+    unsigned loss_;
+};
+
+} // namespace
+
+TEST_CASE("LinkQualityEstimator") {
+    LinkQualityEstimator est;
+    system_tick_t now = 1000;
+
+    SECTION("converges to the round-trip time of the link") {
+        SimulatedLink wifi(&est, WIFI, 50);
+        wifi.run(50, now);
+        LinkQualityEstimator::Estimate e = {};
+        REQUIRE(est.getEstimate(WIFI, &e) == 0);
+        CHECK(e.rtt == 50);
+        CHECK(e.loss == 0);
+        CHECK(e.samples == 50);
+        wifi.rtt(200);
+        wifi.run(50, now);
+        REQUIRE(est.getEstimate(WIFI, &e) == 0);
+        CHECK(e.rtt >= 195);
+        CHECK(e.rtt <= 200);
+    }
+
+    SECTION("estimates the loss rate") {
+        est.addRoundTrip(WIFI, 100, now);
+        for (unsigned i = 0; i < 100; ++i) {
+            est.addDeliveries(WIFI, 3, 1, now);
+        }
+        LinkQualityEstimator::Estimate e = {};
+        REQUIRE(est.getEstimate(WIFI, &e) == 0);
+        CHECK(e.loss >= 150);
+        CHECK(e.loss <= 350); // Depends on the outcome of the last sample
+        est.addSocketError(WIFI, now);
+        LinkQualityEstimator::Estimate e2 = {};
+        REQUIRE(est.getEstimate(WIFI, &e2) == 0);
+        CHECK(e2.loss > e.loss);
+    }
+
+    SECTION("requires a minimum number of recent samples") {
+        CHECK(est.getEstimate(WIFI, nullptr) == SYSTEM_ERROR_NOT_FOUND);
+        for (unsigned i = 0; i < LinkQualityEstimator::MIN_SAMPLES - 1; ++i) {
+            est.addRoundTrip(WIFI, 50, now);
+        }
+        CHECK_FALSE(est.isValid(WIFI, now));
+        CHECK(est.score(WIFI, now) == UINT32_MAX);
+        est.addRoundTrip(WIFI, 50, now);
+        CHECK(est.isValid(WIFI, now));
+        CHECK(est.score(WIFI, now) == 50);
+        CHECK_FALSE(est.isValid(WIFI, now + LinkQualityEstimator::MAX_ESTIMATE_AGE + 1));
+        est.reset(WIFI);
+        CHECK_FALSE(est.isValid(WIFI, now));
+    }
+
+    SECTION("recommends switching to a clearly better link") {
+        SimulatedLink wifi(&est, WIFI, 50, 20);
+        SimulatedLink cell(&est, CELLULAR, 300, 100);
+        wifi.run(20, now);
+        cell.run(20, now);
+        CHECK(est.isBetter(WIFI, CELLULAR, now));
+        CHECK_FALSE(est.isBetter(CELLULAR, WIFI, now));
+    }
+
+    SECTION("does not flap between links of similar quality") {
+        SimulatedLink wifi(&est, WIFI, 100, 30);
+        SimulatedLink cell(&est, CELLULAR, 100, 30);
+        for (unsigned i = 0; i < 100; ++i) {
+            wifi.run(5, now);
+            cell.run(5, now);
+            CHECK_FALSE(est.isBetter(WIFI, CELLULAR, now));
+            CHECK_FALSE(est.isBetter(CELLULAR, WIFI, now));
+            now += 1000;
+        }
+    }
+
+    SECTION("recommends moving away from a degraded link without active tests") {
+        SimulatedLink wifi(&est, WIFI, 40);
+        SimulatedLink cell(&est, CELLULAR, 150);
+        wifi.run(20, now);
+        cell.run(20, now); // E.g. results of the last reachability test
+        CHECK_FALSE(est.isBetter(CELLULAR, WIFI, now));
+        // The Wi-Fi link starts losing packets and its latency goes up
+        wifi.rtt(200);
+        wifi.loss(300);
+        unsigned messages = 0;
+        while (!est.isBetter(CELLULAR, WIFI, now) && messages < 100) {
+            wifi.run(1, now);
+            ++messages;
+        }
+        CHECK(est.isBetter(CELLULAR, WIFI, now));
+        CHECK(messages < 30);
+    }
+
+    SECTION("evicts the least recently updated link when the table is full") {
+        for (unsigned i = 0; i < LinkQualityEstimator::MAX_LINKS; ++i) {
+            est.addRoundTrip(i + 1, 100, now + i);
+        }
+        est.addRoundTrip(100, 100, now + 100);
+        LinkQualityEstimator::Estimate e = {};
+        CHECK(est.getEstimate(1, &e) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(est.getEstimate(2, &e) == 0);
+        CHECK(est.getEstimate(100, &e) == 0);
+    }
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_loop_profiler.h"
+#include "system_error.h"
+#include "spark_wiring_diagnostics.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace particle;
+using namespace particle::system;
+
+namespace {
+
+uint32_t g_ticks = 0;
+
+uint32_t fakeClock() {
+    return g_ticks;
+}
+
+// Simulates a stage of the loop that takes a given number of microseconds
+void runStage(LoopProfiler* profiler, LoopProfiler::Stage stage, uint32_t duration, uint32_t ticksPerUs = 1) {
+    LoopProfilerScope scope(profiler, stage);
+    g_ticks += duration * ticksPerUs;
+}
+
+// Simulates an iteration of the system loop
+void runLoop(LoopProfiler* profiler, uint32_t cloudDuration, uint32_t ticksPerUs = 1) {
+    LoopProfilerScope scope(profiler, LoopProfiler::SYSTEM_LOOP);
+    runStage(profiler, LoopProfiler::ISR_TASK_QUEUE, 10, ticksPerUs);
+    runStage(profiler, LoopProfiler::NETWORK, 20, ticksPerUs);
+    runStage(profiler, LoopProfiler::CLOUD, cloudDuration, ticksPerUs);
+    runStage(profiler, LoopProfiler::FIRMWARE_UPDATE, 5, ticksPerUs);
+}
+
+std::string format(const LoopProfiler& profiler) {
+    std::string s;
+    s.resize(1024);
+    BufferAppender appender((uint8_t*)&s.front(), s.size());
+    REQUIRE(profiler.format(&appender) == 0);
+    REQUIRE(appender.dataSize() <= s.size());
+    s.resize(appender.dataSize());
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("LoopProfiler") {
+    g_ticks = 0x7fffffff;
+
+    SECTION("does not account anything while disabled") {
+        LoopProfiler p(fakeClock);
+        runLoop(&p, 30);
+        LoopProfiler::Stats s = {};
+        CHECK(p.getStats(LoopProfiler::CLOUD, &s) == SYSTEM_ERROR_INVALID_STATE);
+        REQUIRE(p.enable() == 0);
+        runLoop(&p, 30);
+        p.disable();
+        runLoop(&p, 30);
+        REQUIRE(p.getStats(LoopProfiler::CLOUD, &s) == 0);
+        CHECK(s.count == 1);
+    }
+
+    SECTION("attributes a slow stage correctly") {
+        LoopProfiler p(fakeClock);
+        REQUIRE(p.enable() == 0);
+        for (unsigned i = 0; i < 100; ++i) {
+            runLoop(&p, (i == 50) ? 50000 : 30);
+        }
+        LoopProfiler::Stats s = {};
+        REQUIRE(p.getStats(LoopProfiler::CLOUD, &s) == 0);
+        CHECK(s.count == 100);
+        CHECK(s.min == 30);
+        CHECK(s.max == 50000);
+        CHECK(s.avg == (99 * 30 + 50000) / 100);
+        CHECK(s.p99 >= 30);
+        CHECK(s.p99 < 50);
+        for (auto stage: { LoopProfiler::ISR_TASK_QUEUE, LoopProfiler::NETWORK, LoopProfiler::FIRMWARE_UPDATE }) {
+            REQUIRE(p.getStats(stage, &s) == 0);
+            CHECK(s.count == 100);
+            CHECK(s.max <= 20);
+        }
+        REQUIRE(p.getStats(LoopProfiler::SYSTEM_LOOP, &s) == 0);
+        CHECK(s.min == 65);
+        CHECK(s.max == 50035);
+        REQUIRE(p.getStats(LoopProfiler::APP_LOOP, &s) == 0);
+        CHECK(s.count == 0);
+    }
+
+    SECTION("converts the clock ticks to microseconds") {
+        LoopProfiler p(fakeClock, 64 /* ticksPerMicrosecond */);
+        REQUIRE(p.enable() == 0);
+        runLoop(&p, 1000, 64);
+        LoopProfiler::Stats s = {};
+        REQUIRE(p.getStats(LoopProfiler::CLOUD, &s) == 0);
+        CHECK(s.max == 1000);
+    }
+
+    SECTION("estimates the 99th percentile") {
+        LoopProfiler p(fakeClock);
+        REQUIRE(p.enable() == 0);
+        for (unsigned i = 0; i < 1000; ++i) {
+            // 2% of the iterations are slow
+            p.add(LoopProfiler::CLOUD, (i % 50 == 0) ? 10000 + i : 100);
+        }
+        LoopProfiler::Stats s = {};
+        REQUIRE(p.getStats(LoopProfiler::CLOUD, &s) == 0);
+        CHECK(s.p99 >= 10000);
+        CHECK(s.p99 <= s.max);
+    }
+
+    SECTION("keeps the distribution when a bucket count saturates") {
+        LoopProfiler p(fakeClock);
+        REQUIRE(p.enable() == 0);
+        for (unsigned i = 0; i < 100000; ++i) {
+            p.add(LoopProfiler::APP_LOOP, (i % 10 == 0) ? 5000 : 100);
+        }
+        LoopProfiler::Stats s = {};
+        REQUIRE(p.getStats(LoopProfiler::APP_LOOP, &s) == 0);
+        CHECK(s.count == 100000);
+        CHECK(s.p99 >= 5000);
+        uint32_t counts[LoopProfiler::BUCKET_COUNT] = {};
+        CHECK(p.getHistogram(LoopProfiler::APP_LOOP, counts) == 100000);
+        const auto fast = counts[AbstractHistogramDiagnosticData::bucketIndex(100, LoopProfiler::SUB_BUCKET_BITS, LoopProfiler::BUCKET_COUNT)];
+        const auto slow = counts[AbstractHistogramDiagnosticData::bucketIndex(5000, LoopProfiler::SUB_BUCKET_BITS, LoopProfiler::BUCKET_COUNT)];
+        CHECK(fast / slow >= 8);
+        CHECK(fast / slow <= 10);
+    }
+
+    SECTION("can be reset") {
+        LoopProfiler p(fakeClock);
+        REQUIRE(p.enable() == 0);
+        runLoop(&p, 30);
+        p.reset();
+        LoopProfiler::Stats s = {};
+        REQUIRE(p.getStats(LoopProfiler::CLOUD, &s) == 0);
+        CHECK(s.count == 0);
+        runLoop(&p, 40);
+        REQUIRE(p.getStats(LoopProfiler::CLOUD, &s) == 0);
+        CHECK(s.min == 40);
+    }
+
+    SECTION("formats the statistics of the executed stages") {
+        LoopProfiler p(fakeClock);
+        REQUIRE(p.enable() == 0);
+        runStage(&p, LoopProfiler::CLOUD, 30);
+        CHECK(format(p) == "{\"enabled\":true,\"stages\":[{\"name\":\"cloud\",\"n\":1,\"min\":30,\"avg\":30,\"max\":30,\"p99\":30}]}");
+    }
+}
+
+TEST_CASE("LoopProfiler on the virtual device") {
+    // Uses the microsecond timer of the virtual device
+    LoopProfiler p;
+    REQUIRE(p.enable() == 0);
+    for (unsigned i = 0; i < 5; ++i) {
+        LoopProfilerScope loop(&p, LoopProfiler::SYSTEM_LOOP);
+        {
+            LoopProfilerScope scope(&p, LoopProfiler::NETWORK);
+        }
+        {
+            LoopProfilerScope scope(&p, LoopProfiler::CLOUD);
+            if (i == 2) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+    }
+    LoopProfiler::Stats cloud = {}, network = {}, loop = {};
+    REQUIRE(p.getStats(LoopProfiler::CLOUD, &cloud) == 0);
+    REQUIRE(p.getStats(LoopProfiler::NETWORK, &network) == 0);
+    REQUIRE(p.getStats(LoopProfiler::SYSTEM_LOOP, &loop) == 0);
+    CHECK(cloud.count == 5);
+    CHECK(cloud.max >= 20000);
+    CHECK(network.max < cloud.max);
+    CHECK(loop.max >= cloud.max);
+}
@@ -0,0 +1,130 @@
+#include "message_pool.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+struct Base {
+    virtual ~Base() = default;
+};
+
+struct PooledMessage: Base, PooledObject {
+    explicit PooledMessage(int* destroyed) :
+            destroyed(destroyed) {
+    }
+
+    ~PooledMessage() {
+        ++*destroyed;
+    }
+
+    int* destroyed;
+};
+
+} // namespace
+
+TEST_CASE("MessagePool") {
+    std::unique_ptr<MessagePool> pool(new MessagePool());
+
+    SECTION("allocates the blocks from the pool until it's exhausted") {
+        std::vector<void*> blocks;
+        for (unsigned i = 0; i < MessagePool::BLOCK_COUNT; ++i) {
+            blocks.push_back(pool->alloc(MessagePool::BLOCK_SIZE));
+            REQUIRE(blocks.back());
+        }
+        CHECK(pool->usedBlocks() == MessagePool::BLOCK_COUNT);
+        CHECK(pool->heapAllocations() == 0);
+        // Blocks do not overlap
+        for (auto b: blocks) {
+            std::memset(b, 0xaa, MessagePool::BLOCK_SIZE);
+        }
+        void* p = pool->alloc(1);
+        REQUIRE(p);
+        CHECK(pool->heapAllocations() == 1);
+        pool->free(p);
+        pool->free(blocks[3]);
+        CHECK(pool->usedBlocks() == MessagePool::BLOCK_COUNT - 1);
+        // The released block is reused
+        CHECK(pool->alloc(8) == blocks[3]);
+        CHECK(pool->heapAllocations() == 1);
+        for (auto b: blocks) {
+            pool->free(b);
+        }
+        CHECK(pool->usedBlocks() == 0);
+        CHECK(pool->maxUsedBlocks() == MessagePool::BLOCK_COUNT);
+    }
+
+    SECTION("allocates an oversized object on the heap") {
+        void* p = pool->alloc(MessagePool::BLOCK_SIZE + 1);
+        REQUIRE(p);
+        CHECK(pool->usedBlocks() == 0);
+        CHECK(pool->heapAllocations() == 1);
+        pool->free(p);
+    }
+
+    SECTION("tracks the maximum number of blocks in use") {
+        void* p1 = pool->alloc(4);
+        void* p2 = pool->alloc(4);
+        pool->free(p1);
+        void* p3 = pool->alloc(4);
+        pool->free(p2);
+        pool->free(p3);
+        CHECK(pool->usedBlocks() == 0);
+        CHECK(pool->maxUsedBlocks() == 2);
+    }
+}
+
+TEST_CASE("PooledObject") {
+    const auto pool = MessagePool::instance();
+    const auto used = pool->usedBlocks();
+    int destroyed = 0;
+    Base* b = new PooledMessage(&destroyed);
+    CHECK(pool->usedBlocks() == used + 1);
+    delete b;
+    CHECK(destroyed == 1);
+    CHECK(pool->usedBlocks() == used);
+}
+
+TEST_CASE("MessagePool stress test", "[concurrency]") {
+    const unsigned THREAD_COUNT = 4;
+    const unsigned ITERATIONS = 50000;
+
+    std::unique_ptr<MessagePool> pool(new MessagePool());
+    std::atomic<unsigned> errors(0);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < THREAD_COUNT; ++i) {
+        threads.emplace_back([&, i]() {
+            const uint8_t pattern = i + 1;
+            for (unsigned j = 0; j < ITERATIONS; ++j) {
+                const auto p = static_cast<uint8_t*>(pool->alloc(MessagePool::BLOCK_SIZE));
+                if (!p) {
+                    errors.fetch_add(1);
+                    continue;
+                }
+                std::memset(p, pattern, MessagePool::BLOCK_SIZE);
+                std::this_thread::yield();
+                // Make sure no other thread has been given the same block
+                for (size_t k = 0; k < MessagePool::BLOCK_SIZE; ++k) {
+                    if (p[k] != pattern) {
+                        errors.fetch_add(1);
+                        break;
+                    }
+                }
+                pool->free(p);
+            }
+        });
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
+    CHECK(errors.load() == 0);
+    CHECK(pool->usedBlocks() == 0);
+    CHECK(pool->maxUsedBlocks() <= THREAD_COUNT);
+}
@@ -0,0 +1,176 @@
+#include "system_event_coalescer.h"
+
+#include "util/bench.h"
+
+#include <catch2/catch.hpp>
+
+#include <deque>
+#include <functional>
+#include <string>
+
+using namespace particle::system;
+
+namespace {
+
+struct Notification {
+    system_event_t event;
+    uint32_t data;
+    void* pointer;
+};
+
+// Simulates the event queue of the application thread
+class EventQueue {
+public:
+    explicit EventQueue(bool coalesce) :
+            coalesce_(coalesce),
+            maxDepth_(0) {
+    }
+
+    void notify(system_event_t event, uint32_t data, void* pointer = nullptr) {
+        if (coalesce_) {
+            unsigned slot = 0;
+            const auto r = coalescer_.add(event, data, pointer, &slot);
+            if (r == SystemEventCoalescer::MERGED) {
+                return;
+            }
+            if (r == SystemEventCoalescer::QUEUED) {
+                push([this, slot]() {
+                    Notification n = {};
+                    coalescer_.take(slot, &n.event, &n.data, &n.pointer);
+                    return n;
+                });
+                return;
+            }
+        }
+        push([event, data, pointer]() {
+            return Notification{ event, data, pointer };
+        });
+    }
+
+    std::vector<Notification> process() {
+        std::vector<Notification> notifs;
+        while (!queue_.empty()) {
+            notifs.push_back(queue_.front()());
+            queue_.pop_front();
+        }
+        return notifs;
+    }
+
+    size_t depth() const {
+        return queue_.size();
+    }
+
+    size_t maxDepth() const {
+        return maxDepth_;
+    }
+
+    SystemEventCoalescer& coalescer() {
+        return coalescer_;
+    }
+
+private:
+    std::deque<std::function<Notification()>> queue_;
+    SystemEventCoalescer coalescer_;
+    bool coalesce_;
+    size_t maxDepth_;
+
+    void push(std::function<Notification()> fn) {
+        queue_.push_back(std::move(fn));
+        maxDepth_ = std::max(maxDepth_, queue_.size());
+    }
+};
+
+} // namespace
+
+TEST_CASE("SystemEventCoalescer") {
+    EventQueue q(true /* coalesce */);
+
+    SECTION("updates a pending notification for a state-type event") {
+        int a = 0, b = 0;
+        q.notify(firmware_update, firmware_update_progress, &a);
+        q.notify(firmware_update, firmware_update_progress, &b);
+        q.notify(battery_state, 1);
+        q.notify(battery_state, 2);
+        q.notify(battery_state, 3);
+        CHECK(q.depth() == 2);
+        auto n = q.process();
+        REQUIRE(n.size() == 2);
+        CHECK(n[0].event == firmware_update);
+        CHECK(n[0].data == firmware_update_progress);
+        CHECK(n[0].pointer == &b);
+        CHECK(n[1].event == battery_state);
+        CHECK(n[1].data == 3);
+    }
+
+    SECTION("enqueues a new notification once the pending one is delivered") {
+        q.notify(power_source, 1);
+        q.process();
+        q.notify(power_source, 2);
+        CHECK(q.depth() == 1);
+        auto n = q.process();
+        REQUIRE(n.size() == 1);
+        CHECK(n[0].data == 2);
+    }
+
+    SECTION("does not coalesce transition events") {
+        q.notify(cloud_status, cloud_status_connecting);
+        q.notify(cloud_status, cloud_status_connected);
+        q.notify(network_status, network_status_connecting);
+        q.notify(network_status, network_status_connected);
+        q.notify(firmware_update, firmware_update_begin);
+        q.notify(firmware_update, firmware_update_complete);
+        CHECK(q.depth() == 6);
+        CHECK_FALSE(SystemEventCoalescer::isCoalescible(cloud_status, cloud_status_connected));
+        CHECK_FALSE(SystemEventCoalescer::isCoalescible(firmware_update, firmware_update_complete));
+        CHECK(SystemEventCoalescer::isCoalescible(firmware_update, firmware_update_progress));
+    }
+
+    SECTION("preserves the order of notifications for the same event") {
+        q.notify(firmware_update, firmware_update_begin);
+        q.notify(firmware_update, firmware_update_progress);
+        q.notify(firmware_update, firmware_update_complete);
+        // Must not be merged into the progress notification that precedes the completion one
+        q.notify(firmware_update, firmware_update_progress);
+        auto n = q.process();
+        REQUIRE(n.size() == 4);
+        CHECK(n[0].data == firmware_update_begin);
+        CHECK(n[1].data == firmware_update_progress);
+        CHECK(n[2].data == firmware_update_complete);
+        CHECK(n[3].data == firmware_update_progress);
+        // The slot is reusable after the pending notification is delivered
+        q.notify(firmware_update, firmware_update_progress);
+        q.notify(firmware_update, firmware_update_progress);
+        CHECK(q.depth() == 1);
+    }
+
+    SECTION("allows a pending notification to be canceled") {
+        auto& c = q.coalescer();
+        unsigned slot = 0;
+        REQUIRE(c.add(battery_state, 1, nullptr, &slot) == SystemEventCoalescer::QUEUED);
+        CHECK(c.add(battery_state, 2, nullptr, &slot) == SystemEventCoalescer::MERGED);
+        c.cancel(slot);
+        CHECK(c.add(battery_state, 3, nullptr, &slot) == SystemEventCoalescer::QUEUED);
+    }
+}
+
+TEST_CASE("SystemEventCoalescer benchmark", "[.][benchmark]") {
+    // A firmware update generating a progress notification per received chunk while the
+    // application thread only gets to process its queue every 50 chunks
+    for (bool coalesce: { false, true }) {
+        EventQueue q(coalesce);
+        size_t delivered = 0;
+        for (unsigned i = 0; i < 1000; ++i) {
+            q.notify(firmware_update, firmware_update_progress);
+            if (i % 10 == 0) {
+                q.notify(battery_state, i);
+            }
+            if (i % 50 == 49) {
+                delivered += q.process().size();
+            }
+        }
+        delivered += q.process().size();
+        const std::string name = coalesce ? "Coalesced" : "Not coalesced";
+        particle::test::printBenchmark(name + ", max queue depth", q.maxDepth(), "tasks");
+        particle::test::printBenchmark(name + ", delivered notifications", delivered, "tasks");
+    }
+}
@@ -4,6 +4,7 @@
 #include "mock/alloc.h"
 #include "util/random_old.h"
 #include "util/catch.h"
+#include "util/bench.h"
 
 #include "hippomocks.h"
 
@@ -22,7 +23,7 @@ ISRTaskQueue SystemISRTaskQueue;
 namespace {
 
 using namespace particle;
-using namespace test;
+using namespace ::test;
 
 // Minimum length of the data stage supported by high-speed USB devices
 const size_t MIN_WLENGTH = 64;
@@ -215,14 +216,15 @@ class Channel: public ControlRequestHandler {
 public:
     typedef std::function<void(ctrl_request*, ControlRequestChannel*)> RequestHandlerFunc;
 
-    Channel() :
+    explicit Channel(size_t ringBufferSize = 0) :
             heapAlloc_(&mocks_),
             poolAlloc_(&mocks_),
             reqHandlerCalled_(false),
             halReqCallback_(nullptr),
             halStateCallback_(nullptr),
             halReqCallbackData_(nullptr),
-            halStateCallbackData_(nullptr) {
+            halStateCallbackData_(nullptr),
+            ringBufferSize_(ringBufferSize) {
         mocks_.OnCallFunc(HAL_USB_Set_Vendor_Request_Callback).Do([this](HAL_USB_Vendor_Request_Callback callback, void* data) {
             this->halReqCallback_ = callback;
             this->halReqCallbackData_ = data;
@@ -257,6 +259,10 @@ public:
         return reqHandlerCalled_;
     }
 
+    UsbControlRequestChannel* channel() const {
+        return channel_.get();
+    }
+
     HeapAllocator& heapAllocator() {
         return heapAlloc_;
     }
@@ -272,7 +278,7 @@ public:
         poolAlloc_.reset();
         serviceRep_ = ServiceReply();
         reqHandlerCalled_ = false;
-        channel_.reset(new UsbControlRequestChannel(this));
+        channel_.reset(new UsbControlRequestChannel(this, ringBufferSize_));
     }
 
     void checkMemory() {
@@ -307,6 +313,8 @@ private:
     void* halReqCallbackData_;
     void* halStateCallbackData_;
 
+    size_t ringBufferSize_;
+
     std::unique_ptr<UsbControlRequestChannel> channel_;
 
     bool sendServiceRequest(const ServiceRequest& req) {
@@ -905,3 +913,166 @@ TEST_CASE("UsbControlRequestChannel") {
         channel.checkMemory(); // Ensure there are no memory leaks
     }
 }
+
+TEST_CASE("UsbControlRequestChannel (pipelined mode)") {
+    const size_t RING_BUFFER_SIZE = 4096;
+    Channel channel(RING_BUFFER_SIZE);
+    REQUIRE(channel.channel()->isPipelined());
+
+    const uint16_t TEST_REQ = 1234; // Application-specific request type
+
+    SECTION("receives request data into the ring buffer without waiting for an allocation") {
+        channel.heapAllocator().allocLimit(0);
+        const auto data = randomBytes(1000, 1000);
+        const char* reqData = nullptr;
+        channel.requestHandler([&](ctrl_request* req, ControlRequestChannel* ch) {
+            REQUIRE(req->request_size == data.size());
+            CHECK(std::string(req->request_data, req->request_size) == data);
+            reqData = req->request_data;
+            ch->setResult(req, SYSTEM_ERROR_NONE);
+        });
+        CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(data.size()).send());
+        auto rep = channel.serviceReply();
+        CHECK(rep.status() == ServiceReply::OK); // Channel is ready to receive payload data
+        const uint16_t id = rep.id();
+        CHECK(!processNextTask()); // No asynchronous allocation
+        CHECK(channel.serviceRequest(ServiceRequest::SEND).id(id).data(data).send());
+        CHECK(processNextTask());
+        CHECK(channel.requestHandlerCalled());
+        CHECK(reqData);
+        CHECK(channel.heapAllocator().allocSize() == 0);
+        CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+        rep = channel.serviceReply();
+        CHECK(rep.status() == ServiceReply::OK);
+        CHECK(rep.result() == SYSTEM_ERROR_NONE);
+        channel.checkMemory();
+    }
+
+    SECTION("can initiate more concurrent requests") {
+        for (unsigned i = 0; i < USB_REQUEST_MAX_PIPELINED_COUNT; ++i) {
+            CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(100).send());
+            auto rep = channel.serviceReply();
+            CHECK(rep.status() == ServiceReply::OK);
+            CHECK(rep.id() != USB_REQUEST_INVALID_ID);
+        }
+        CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).send());
+        auto rep = channel.serviceReply();
+        CHECK(rep.status() == ServiceReply::BUSY); // Too many active requests
+    }
+
+    SECTION("falls back to the regular allocation when the ring buffer is full") {
+        CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(RING_BUFFER_SIZE - 100).send());
+        CHECK(channel.serviceReply().status() == ServiceReply::OK);
+        CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(200).send());
+        CHECK(channel.serviceReply().status() == ServiceReply::PENDING); // Buffer allocation is pending
+        CHECK(processNextTask());
+        CHECK(channel.heapAllocator().allocSize() == 200);
+    }
+
+    SECTION("releases the ring buffer when a request is cancelled") {
+        CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(RING_BUFFER_SIZE - 100).send());
+        const uint16_t id = channel.serviceReply().id();
+        CHECK(channel.serviceRequest(ServiceRequest::RESET).id(id).send());
+        CHECK(channel.serviceReply().status() == ServiceReply::OK);
+        processAllTasks();
+        CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(RING_BUFFER_SIZE - 100).send());
+        CHECK(channel.serviceReply().status() == ServiceReply::OK);
+    }
+
+    SECTION("requests can be processed out of order (stress test)") {
+        struct Request {
+            std::string data;
+            ctrl_request* req;
+            uint16_t id;
+        };
+        std::list<Request> reqs; // Requests with received payload data
+        std::list<ctrl_request*> pending; // Requests being processed by the handler
+        ControlRequestChannel* reqChannel = nullptr;
+        channel.requestHandler([&](ctrl_request* req, ControlRequestChannel* ch) {
+            pending.push_back(req);
+            reqChannel = ch;
+        });
+        unsigned reqCount = 0;
+        while (reqCount < 500 || !reqs.empty()) {
+            if (reqs.size() < USB_REQUEST_MAX_PIPELINED_COUNT && reqCount < 500) {
+                Request r;
+                r.data = randomBytes(1, 600);
+                r.req = nullptr;
+                REQUIRE(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(r.data.size()).send());
+                const auto rep = channel.serviceReply();
+                if (rep.status() == ServiceReply::OK) {
+                    r.id = rep.id();
+                    REQUIRE(channel.serviceRequest(ServiceRequest::SEND).id(r.id).data(r.data).send());
+                    processAllTasks();
+                    REQUIRE(!pending.empty());
+                    r.req = pending.back();
+                    reqs.push_back(r);
+                    ++reqCount;
+                    continue;
+                }
+                REQUIRE(rep.status() == ServiceReply::PENDING); // The ring buffer is full
+                REQUIRE(channel.serviceRequest(ServiceRequest::RESET).id(rep.id()).send());
+                processAllTasks();
+            }
+            // Complete a random request
+            auto it = reqs.begin();
+            std::advance(it, randomInt(0, reqs.size() - 1));
+            REQUIRE(std::string(it->req->request_data, it->req->request_size) == it->data);
+            pending.remove(it->req);
+            reqChannel->setResult(it->req, SYSTEM_ERROR_NONE);
+            REQUIRE(channel.serviceRequest(ServiceRequest::CHECK).id(it->id).send());
+            REQUIRE(channel.serviceReply().status() == ServiceReply::OK);
+            reqs.erase(it);
+        }
+        processAllTasks();
+        channel.checkMemory();
+    }
+}
+
+TEST_CASE("UsbControlRequestChannel benchmark", "[.][benchmark]") {
+    const uint16_t TEST_REQ = 1234;
+    const unsigned ITERATIONS = 10000;
+
+    for (size_t size: { 32, 1024 }) {
+        for (bool pipelined: { false, true }) {
+            Channel channel(pipelined ? 16 * 1024 : 0);
+            channel.requestHandler([](ctrl_request* req, ControlRequestChannel* ch) {
+                ch->setResult(req, SYSTEM_ERROR_NONE);
+            });
+            const auto data = randomBytes(size, size);
+            // Each iteration sends a batch of requests and then waits for the results
+            const unsigned batch = pipelined ? USB_REQUEST_MAX_PIPELINED_COUNT : USB_REQUEST_MAX_ACTIVE_COUNT;
+            unsigned transfers = 0;
+            const double ns = particle::test::benchmark(ITERATIONS / batch, [&](unsigned) {
+                uint16_t ids[USB_REQUEST_MAX_PIPELINED_COUNT] = {};
+                bool ready[USB_REQUEST_MAX_PIPELINED_COUNT] = {};
+                for (unsigned i = 0; i < batch; ++i) {
+                    channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).size(data.size()).send();
+                    ++transfers;
+                    ids[i] = channel.serviceReply().id();
+                    ready[i] = (channel.serviceReply().status() == ServiceReply::OK);
+                }
+                processAllTasks();
+                for (unsigned i = 0; i < batch; ++i) {
+                    while (!ready[i]) {
+                        channel.serviceRequest(ServiceRequest::CHECK).id(ids[i]).send();
+                        ++transfers;
+                        ready[i] = (channel.serviceReply().status() == ServiceReply::OK);
+                        processAllTasks();
+                    }
+                    channel.serviceRequest(ServiceRequest::SEND).id(ids[i]).data(data).send();
+                    ++transfers;
+                }
+                processAllTasks();
+                for (unsigned i = 0; i < batch; ++i) {
+                    channel.serviceRequest(ServiceRequest::CHECK).id(ids[i]).send();
+                    ++transfers;
+                }
+            }) / batch;
+            const auto name = std::string(pipelined ? "Pipelined" : "Regular") + " request (" + std::to_string(size) +
+                    " bytes)";
+            particle::test::printBenchmark(name, ns);
+            particle::test::printBenchmark(name + ", transfers", (double)transfers / ITERATIONS, "transfers/op");
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+namespace particle {
+
+namespace test {
+
+/**
+ * Run a function a number of times and return the average time per iteration in nanoseconds.
+ *
+ * Benchmarks are implemented as hidden test cases tagged with `[.][benchmark]` so that they don't
+ * run as part of the regular test suite. Use `<test binary> "[benchmark]"` to run them.
+ */
+template<typename FnT>
+double benchmark(unsigned iterations, FnT&& fn) {
+    const auto t1 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        fn(i);
+    }
+    const auto t2 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+}
+
+/**
+ * Print a benchmark result.
+ */
+inline void printBenchmark(const std::string& name, double value, const char* unit = "ns/op") {
+    std::cout << std::left << std::setw(48) << name << std::right << std::setw(14) << std::fixed
+            << std::setprecision(1) << value << ' ' << unit << std::endl;
+}
+
+} // namespace test
+
+} // namespace particle
@@ -0,0 +1,293 @@
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "ble_scan_filter.h"
+
+#include "util/bench.h"
+#include "util/catch.h"
+
+using namespace particle;
+using namespace particle::ble;
+
+namespace {
+
+// Mirrors the layout of hal_ble_scan_result_evt_t, which is not available in the host build
+struct ScanResultEvent {
+    struct {
+        uint8_t addr[6];
+        uint8_t addr_type;
+    } peer_addr;
+    int8_t rssi;
+    uint8_t* adv_data;
+    uint8_t* sr_data;
+    uint16_t adv_data_len;
+    uint16_t sr_data_len;
+};
+
+class AdvData {
+public:
+    AdvData& add(uint8_t type, const void* data, size_t size) {
+        d_.push_back(size + 1);
+        d_.push_back(type);
+        d_.insert(d_.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+        return *this;
+    }
+
+    AdvData& name(const char* name, bool complete = true) {
+        return add(complete ? 0x09 : 0x08, name, strlen(name));
+    }
+
+    AdvData& uuid16(uint16_t uuid) {
+        const uint8_t d[] = { (uint8_t)uuid, (uint8_t)(uuid >> 8) };
+        return add(0x03, d, sizeof(d));
+    }
+
+    AdvData& uuid128(const uint8_t* uuid) {
+        return add(0x07, uuid, 16);
+    }
+
+    AdvData& appearance(uint16_t appearance) {
+        const uint8_t d[] = { (uint8_t)appearance, (uint8_t)(appearance >> 8) };
+        return add(0x19, d, sizeof(d));
+    }
+
+    AdvData& custom(const void* data, size_t size) {
+        return add(0xff, data, size);
+    }
+
+    uint8_t* data() {
+        return d_.data();
+    }
+
+    size_t size() const {
+        return d_.size();
+    }
+
+private:
+    std::vector<uint8_t> d_;
+};
+
+struct Report {
+    ScanResultEvent event;
+    AdvData adv;
+    AdvData sr;
+
+    explicit Report(uint32_t id = 0, int8_t rssi = -50) :
+            event() {
+        memcpy(event.peer_addr.addr, &id, sizeof(id));
+        event.peer_addr.addr_type = 1;
+        event.rssi = rssi;
+    }
+
+    const ScanResultEvent& get() {
+        event.adv_data = adv.data();
+        event.adv_data_len = adv.size();
+        event.sr_data = sr.data();
+        event.sr_data_len = sr.size();
+        return event;
+    }
+};
+
+struct Address {
+    uint8_t addr[6];
+
+    explicit Address(uint32_t id) :
+            addr() {
+        memcpy(addr, &id, sizeof(id));
+    }
+};
+
+const uint8_t UUID128[16] = { 0x7b, 0xe3, 0x27, 0x74, 0x7b, 0xf8, 0x15, 0xac, 0xdd, 0x49, 0xa9, 0x13, 0x00, 0x00, 0x72, 0xf5 };
+
+} // namespace
+
+TEST_CASE("findAdStructure()") {
+    SECTION("finds the first structure of the given type") {
+        AdvData d;
+        d.add(0x01, "\x06", 1).name("abc").name("def");
+        const uint8_t* v = nullptr;
+        REQUIRE(findAdStructure(d.data(), d.size(), 0x09, &v) == 3);
+        CHECK(memcmp(v, "abc", 3) == 0);
+        CHECK(findAdStructure(d.data(), d.size(), 0xff, &v) == 0);
+    }
+
+    SECTION("ignores truncated structures") {
+        AdvData d;
+        d.name("abcdef");
+        const uint8_t* v = nullptr;
+        CHECK(findAdStructure(d.data(), d.size() - 1, 0x09, &v) == 0);
+        CHECK(findAdStructure(nullptr, 0, 0x09, &v) == 0);
+    }
+}
+
+TEST_CASE("ScanFilterMatcher") {
+    ScanFilterMatcher m;
+    Report r(1);
+    r.adv.name("foo").uuid16(0x180f).appearance(0x0341);
+    r.sr.uuid128(UUID128).custom("\x62\x06\x01", 3);
+
+    SECTION("matches everything by default") {
+        CHECK(m.match(r.get()));
+        Report empty;
+        CHECK(m.match(empty.get()));
+    }
+
+    SECTION("matches by RSSI") {
+        m.rssiRange(-60, -40);
+        CHECK(m.match(r.get()));
+        m.rssiRange(-40, ScanFilterMatcher::INVALID_RSSI);
+        CHECK_FALSE(m.match(r.get()));
+        m.rssiRange(ScanFilterMatcher::INVALID_RSSI, -60);
+        CHECK_FALSE(m.match(r.get()));
+    }
+
+    SECTION("matches by address") {
+        REQUIRE(m.addAddress(Address(2).addr, 1) == 0);
+        CHECK_FALSE(m.match(r.get()));
+        REQUIRE(m.addAddress(r.event.peer_addr.addr, 0) == 0);
+        CHECK_FALSE(m.match(r.get())); // Address type mismatch
+        REQUIRE(m.addAddress(r.event.peer_addr.addr, 1) == 0);
+        CHECK(m.match(r.get()));
+    }
+
+    SECTION("matches by device name") {
+        REQUIRE(m.addDeviceName("fo", 2) == 0);
+        CHECK_FALSE(m.match(r.get()));
+        REQUIRE(m.addDeviceName("foo", 3) == 0);
+        CHECK(m.match(r.get()));
+        // The short local name takes precedence over the complete one
+        Report r2;
+        r2.sr.name("bar").name("baz", false /* complete */);
+        CHECK_FALSE(m.match(r2.get()));
+        m.clear();
+        REQUIRE(m.addDeviceName("baz", 3) == 0);
+        CHECK(m.match(r2.get()));
+    }
+
+    SECTION("matches by service UUID") {
+        REQUIRE(m.addServiceUuid16(0x180a) == 0);
+        CHECK_FALSE(m.match(r.get()));
+        REQUIRE(m.addServiceUuid128(UUID128) == 0);
+        CHECK(m.match(r.get()));
+        m.clear();
+        REQUIRE(m.addServiceUuid16(0x180f) == 0);
+        CHECK(m.match(r.get()));
+        // The UUID is in the second list of UUIDs of the same type
+        Report r2;
+        r2.adv.uuid16(0x1800).uuid16(0x180f);
+        CHECK(m.match(r2.get()));
+    }
+
+    SECTION("matches by appearance") {
+        REQUIRE(m.addAppearance(0x0340) == 0);
+        CHECK_FALSE(m.match(r.get()));
+        REQUIRE(m.addAppearance(0x0341) == 0);
+        CHECK(m.match(r.get()));
+        // A missing appearance is reported as BLE_SIG_APPEARANCE_UNKNOWN
+        m.clear();
+        REQUIRE(m.addAppearance(0) == 0);
+        Report r2;
+        CHECK(m.match(r2.get()));
+    }
+
+    SECTION("matches by custom data") {
+        m.customData((const uint8_t*)"\x62\x06", 2);
+        CHECK_FALSE(m.match(r.get()));
+        m.customData((const uint8_t*)"\x62\x06\x01", 3);
+        CHECK(m.match(r.get()));
+    }
+
+    SECTION("all criteria need to match") {
+        REQUIRE(m.addDeviceName("foo", 3) == 0);
+        REQUIRE(m.addServiceUuid16(0x180f) == 0);
+        m.rssiRange(-40, ScanFilterMatcher::INVALID_RSSI);
+        CHECK_FALSE(m.match(r.get()));
+        m.rssiRange(ScanFilterMatcher::INVALID_RSSI, ScanFilterMatcher::INVALID_RSSI);
+        CHECK(m.match(r.get()));
+    }
+}
+
+TEST_CASE("ScanAddressSet") {
+    SECTION("filters out duplicate addresses") {
+        ScanAddressSet s;
+        for (uint32_t i = 0; i < 100; ++i) {
+            CHECK(s.insert(Address(i).addr, 0));
+        }
+        CHECK(s.size() == 100);
+        for (uint32_t i = 0; i < 100; ++i) {
+            CHECK(s.contains(Address(i).addr, 0));
+            CHECK_FALSE(s.contains(Address(i).addr, 1));
+            CHECK_FALSE(s.insert(Address(i).addr, 0));
+        }
+        CHECK(s.size() == 100);
+        s.clear();
+        CHECK(s.size() == 0);
+        CHECK_FALSE(s.contains(Address(1).addr, 0));
+    }
+
+    SECTION("stores addresses that don't fit in the table in the overflow list") {
+        ScanAddressSet s(16);
+        for (uint32_t i = 0; i < 20; ++i) {
+            CHECK(s.insert(Address(i).addr, 0));
+        }
+        CHECK(s.size() == 20);
+        for (uint32_t i = 0; i < 20; ++i) {
+            CHECK_FALSE(s.insert(Address(i).addr, 0));
+        }
+    }
+
+    SECTION("keeps the addresses when the table grows") {
+        ScanAddressSet s;
+        for (uint32_t i = 0; i < 1000; ++i) {
+            CHECK(s.insert(Address(i * 7919).addr, i & 1));
+            CHECK(s.contains(Address(0).addr, 0));
+        }
+        CHECK(s.size() == 1000);
+        for (uint32_t i = 0; i < 1000; ++i) {
+            CHECK(s.contains(Address(i * 7919).addr, i & 1));
+            CHECK_FALSE(s.contains(Address(i * 7919).addr, !(i & 1)));
+        }
+        s.clear();
+        CHECK(s.size() == 0);
+        CHECK(s.insert(Address(1).addr, 0));
+        CHECK_FALSE(s.insert(Address(1).addr, 0));
+    }
+}
+
+TEST_CASE("ScanFilterMatcher benchmark", "[.][benchmark]") {
+    const unsigned beaconCount = 300;
+    const unsigned reportCount = 100000;
+    std::vector<Report> reports(beaconCount);
+    for (unsigned i = 0; i < beaconCount; ++i) {
+        auto& r = reports[i];
+        r = Report(i, -40 - (i % 60));
+        char name[16] = {};
+        snprintf(name, sizeof(name), "beacon-%u", i);
+        r.adv.add(0x01, "\x06", 1).name(name).uuid16(0x1800 + (i % 32));
+        r.sr.uuid128(UUID128).custom(&i, sizeof(i));
+        r.get();
+    }
+
+    ScanFilterMatcher m;
+    REQUIRE(m.addDeviceName("beacon-42", 9) == 0);
+    REQUIRE(m.addDeviceName("beacon-420", 10) == 0);
+    REQUIRE(m.addServiceUuid16(0x180a) == 0);
+    m.rssiRange(-90, ScanFilterMatcher::INVALID_RSSI);
+
+    unsigned matched = 0;
+    double ns = test::benchmark(reportCount, [&](unsigned i) {
+        matched += m.match(reports[i % beaconCount].event);
+    });
+    test::printBenchmark("ScanFilterMatcher::match()", ns);
+    CHECK(matched > 0);
+
+    ScanAddressSet s;
+    unsigned unique = 0;
+    ns = test::benchmark(reportCount, [&](unsigned i) {
+        const auto& e = reports[i % beaconCount].event;
+        unique += s.insert(e.peer_addr.addr, e.peer_addr.addr_type);
+    });
+    test::printBenchmark("ScanAddressSet::insert()", ns);
+    CHECK(unique == beaconCount);
+}
@@ -0,0 +1,106 @@
+#define LOG_CHECKED_ERRORS 1 // Log errors caught by the CHECK() macro
+
+#include <algorithm>
+
+#include "application.h"
+
+#include "mbedtls/sha256.h"
+#include "mbedtls/aes.h"
+
+#include "random.h"
+#include "scope_guard.h"
+#include "check.h"
+
+SYSTEM_MODE(SEMI_AUTOMATIC)
+SYSTEM_THREAD(ENABLED)
+
+namespace {
+
+const size_t MAX_DATA_SIZE = 16384;
+
+const size_t DATA_SIZES[] = { 64, 1024, MAX_DATA_SIZE };
+
+// Minimum total amount of data processed for each data size
+const size_t MIN_TOTAL_SIZE = 1024 * 1024;
+
+const SerialLogHandler logHandler(LOG_LEVEL_ERROR, {
+    { "app", LOG_LEVEL_ALL }
+});
+
+uint8_t inBuffer[MAX_DATA_SIZE];
+uint8_t outBuffer[MAX_DATA_SIZE];
+
+void printResult(const char* name, size_t size, unsigned count, system_tick_t usec) {
+    const double kbPerSec = (double)size * count * 1000000.0 / 1024.0 / std::max<system_tick_t>(usec, 1);
+    LOG_PRINTF(INFO, "%-24s %6u bytes: %8u us/op, %10.1f KB/s\r\n", name, (unsigned)size,
+            (unsigned)(usec / count), kbPerSec);
+}
+
+int testSha256(size_t size) {
+    const unsigned count = std::max<unsigned>(MIN_TOTAL_SIZE / size, 1);
+    uint8_t hash[32] = {};
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    const auto t1 = micros();
+    for (unsigned i = 0; i < count; ++i) {
+        mbedtls_sha256_starts(&ctx, 0 /* is224 */);
+        mbedtls_sha256_update(&ctx, inBuffer, size);
+        mbedtls_sha256_finish(&ctx, hash);
+    }
+    const auto t2 = micros();
+    mbedtls_sha256_free(&ctx);
+    printResult("SHA-256", size, count, t2 - t1);
+    return 0;
+}
+
+int testAesCbc(size_t size) {
+    const unsigned count = std::max<unsigned>(MIN_TOTAL_SIZE / size, 1);
+    uint8_t key[16] = {};
+    uint8_t iv[16] = {};
+    Random rand;
+    rand.gen((char*)key, sizeof(key));
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    SCOPE_GUARD({
+        mbedtls_aes_free(&ctx);
+    });
+    CHECK(mbedtls_aes_setkey_enc(&ctx, key, sizeof(key) * 8));
+    const auto t1 = micros();
+    for (unsigned i = 0; i < count; ++i) {
+        CHECK(mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, size, iv, inBuffer, outBuffer));
+    }
+    const auto t2 = micros();
+    printResult("AES-128-CBC (encrypt)", size, count, t2 - t1);
+    return 0;
+}
+
+int runTests() {
+    Random rand;
+    rand.gen((char*)inBuffer, sizeof(inBuffer));
+
+    for (auto size: DATA_SIZES) {
+        CHECK(testSha256(size));
+    }
+    for (auto size: DATA_SIZES) {
+        CHECK(testAesCbc(size));
+    }
+
+    LOG_PRINT(INFO, "\r\nDone.\r\n");
+
+    return 0;
+}
+
+} // namespace
+
+void setup() {
+    waitUntil(Serial.isConnected);
+    delay(1000);
+
+    int r = runTests();
+    if (r < 0) {
+        LOG(ERROR, "runTests() failed: %d", r);
+    }
+}
+
+void loop() {
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+#include "spark_wiring_vector.h"
+
+#ifndef BLE_SCAN_ADDRESS_SET_MAX_CAPACITY
+#define BLE_SCAN_ADDRESS_SET_MAX_CAPACITY 512
+#endif
+
+namespace particle {
+
+namespace ble {
+
+/**
+ * Find the first AD structure of the given type in raw advertising or scan response data.
+ *
+ * @param data Advertising data.
+ * @param size Size of the advertising data.
+ * @param type AD type.
+ * @param[out] value Pointer to the value of the AD structure.
+ * @return Size of the value, or 0 if the AD structure is not found or is empty.
+ */
+size_t findAdStructure(const uint8_t* data, size_t size, uint8_t type, const uint8_t** value);
+
+/**
+ * Precompiled representation of a BLE scan filter.
+ *
+ * The matcher operates directly on the raw AD structures of an advertising report and doesn't
+ * allocate memory in `match()`, which makes it suitable for running in the BLE HAL thread for
+ * every received report. Memory is only allocated when the filter criteria are added.
+ */
+class ScanFilterMatcher {
+public:
+    /**
+     * Invalid RSSI value. Used to disable the RSSI criteria.
+     */
+    static const int8_t INVALID_RSSI = 0x7f;
+
+    ScanFilterMatcher();
+
+    /**
+     * Add a device address.
+     *
+     * @param addr Address bytes.
+     * @param type Address type.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int addAddress(const uint8_t* addr, uint8_t type);
+
+    /**
+     * Add a device name.
+     *
+     * The name is matched against the short or complete local name in the advertising data or
+     * scan response data.
+     *
+     * @param name Device name.
+     * @param size Length of the name.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int addDeviceName(const char* name, size_t size);
+
+    /**
+     * Add a 16-bit service UUID.
+     *
+     * @param uuid Service UUID.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int addServiceUuid16(uint16_t uuid);
+
+    /**
+     * Add a 128-bit service UUID.
+     *
+     * @param uuid Service UUID bytes in little-endian order.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int addServiceUuid128(const uint8_t* uuid);
+
+    /**
+     * Add an appearance.
+     *
+     * @param appearance Appearance.
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int addAppearance(uint16_t appearance);
+
+    /**
+     * Set the manufacturer-specific data that needs to be matched exactly.
+     *
+     * The data is not copied and must remain valid for the lifetime of the matcher.
+     *
+     * @param data Data.
+     * @param size Data size.
+     */
+    void customData(const uint8_t* data, size_t size);
+
+    /**
+     * Set the RSSI range.
+     *
+     * @param minRssi Minimum RSSI, or `INVALID_RSSI`.
+     * @param maxRssi Maximum RSSI, or `INVALID_RSSI`.
+     */
+    void rssiRange(int8_t minRssi, int8_t maxRssi);
+
+    /**
+     * Remove all filter criteria.
+     */
+    void clear();
+
+    /**
+     * Check if an advertising report matches the filter.
+     *
+     * @param addr Address bytes of the advertiser.
+     * @param addrType Address type of the advertiser.
+     * @param rssi RSSI of the report.
+     * @param advData Advertising data.
+     * @param advSize Size of the advertising data.
+     * @param srData Scan response data.
+     * @param srSize Size of the scan response data.
+     * @return `true` if the report matches the filter, or `false` otherwise.
+     */
+    bool match(const uint8_t* addr, uint8_t addrType, int8_t rssi, const uint8_t* advData, size_t advSize,
+            const uint8_t* srData, size_t srSize) const;
+
+    /**
+     * Check if a scan result event matches the filter.
+     *
+     * @param event Event data (`hal_ble_scan_result_evt_t` or a structure with the same fields).
+     * @return `true` if the report matches the filter, or `false` otherwise.
+     */
+    template<typename EventT>
+    bool match(const EventT& event) const {
+        return match(event.peer_addr.addr, event.peer_addr.addr_type, event.rssi, event.adv_data, event.adv_data_len,
+                event.sr_data, event.sr_data_len);
+    }
+
+private:
+    struct Address {
+        uint8_t addr[6];
+        uint8_t type;
+    };
+
+    struct Name {
+        uint32_t hash;
+        uint16_t offset; // Offset in nameData_
+        uint16_t size;
+    };
+
+    struct Uuid128 {
+        uint8_t data[16];
+    };
+
+    Vector<Address> addrs_;
+    Vector<Name> names_;
+    Vector<char> nameData_;
+    Vector<uint16_t> uuids16_;
+    Vector<Uuid128> uuids128_;
+    Vector<uint16_t> appearances_;
+    const uint8_t* customData_;
+    size_t customDataSize_;
+    int8_t minRssi_;
+    int8_t maxRssi_;
+
+    bool matchRssi(int8_t rssi) const;
+    bool matchAddress(const uint8_t* addr, uint8_t type) const;
+    bool matchName(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const;
+    bool matchServiceUuid(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const;
+    bool matchAppearance(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const;
+    bool matchCustomData(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const;
+
+    bool matchName(const uint8_t* data, size_t size) const;
+    bool matchServiceUuid(const uint8_t* data, size_t size) const;
+};
+
+/**
+ * A set of device addresses used to filter out duplicate advertising reports.
+ *
+ * The set is backed by an open-addressing hash table that is allocated when the first address is
+ * added and grows with the number of addresses up to the maximum capacity. Addresses that don't
+ * fit in the table are stored in a linearly searched overflow list.
+ */
+class ScanAddressSet {
+public:
+    /**
+     * Construct a set.
+     *
+     * @param maxCapacity Maximum capacity of the hash table. Rounded up to a power of two.
+     */
+    explicit ScanAddressSet(size_t maxCapacity = BLE_SCAN_ADDRESS_SET_MAX_CAPACITY);
+
+    /**
+     * Add an address to the set.
+     *
+     * @param addr Address bytes.
+     * @param type Address type.
+     * @return `true` if the address was added, or `false` if it's already in the set.
+     */
+    bool insert(const uint8_t* addr, uint8_t type);
+
+    /**
+     * Check if the set contains an address.
+     *
+     * @param addr Address bytes.
+     * @param type Address type.
+     * @return `true` if the address is in the set, or `false` otherwise.
+     */
+    bool contains(const uint8_t* addr, uint8_t type) const;
+
+    /**
+     * Get the number of addresses in the set.
+     */
+    size_t size() const {
+        return count_ + overflow_.size();
+    }
+
+    /**
+     * Remove all addresses from the set.
+     */
+    void clear();
+
+private:
+    std::unique_ptr<uint64_t[]> table_;
+    Vector<uint64_t> overflow_;
+    size_t capacity_;
+    size_t maxCapacity_;
+    size_t count_;
+
+    size_t find(uint64_t key, bool* found) const;
+    bool grow();
+};
+
+} // namespace ble
+
+} // namespace particle
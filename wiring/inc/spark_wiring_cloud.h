@@ -579,6 +579,34 @@ private:
         return register_variable_fn(varKey, std::forward<T>(fn));
     }
 
+    // This method takes an argument of any callable type that generates a portion of a string
+    // variable on demand: int fn(size_t offset, char* data, size_t size). The callable returns the
+    // number of bytes written to the buffer, or a negative result code in case of an error. The
+    // variable value is requested by the cloud in blocks, so it never has to be fully stored in RAM
+    template<typename T, std::enable_if_t<std::is_convertible<typename std::result_of<T&(size_t, char*, size_t)>::type, int>::value,
+            std::nullptr_t> = nullptr>
+    static bool _variable(const char *varKey, T&& fn)
+    {
+        using CallableType = typename std::decay<T>::type;
+        // Cloud variables cannot be unregistered so it's fine to allocate a copy of the callable on
+        // the heap and never free it
+        std::unique_ptr<CallableType> p(new(std::nothrow) CallableType(std::forward<T>(fn)));
+        if (!p) {
+            return false;
+        }
+        spark_variable_t extra = {};
+        extra.size = sizeof(extra);
+        extra.read = [](const void* var, size_t offset, char* data, size_t size) -> int {
+            const auto p = (CallableType*)var;
+            return (*p)(offset, data, size);
+        };
+        const bool ok = spark_variable(varKey, p.get(), CloudVariableTypeString::TYPE_ID, &extra);
+        if (ok) {
+            p.release();
+        }
+        return ok;
+    }
+
     template<typename T>
     static int copy_variable_value(const T& val, void*& data, size_t& size) {
         size = sizeof(T);
@@ -28,6 +28,7 @@
 #include "debug.h"
 
 #include <atomic>
+#include <limits>
 
 #define PARTICLE_RETAINED_INTEGER_DIAGNOSTIC_DATA(_var, _id, _name, _val, ...) \
         PARTICLE_RETAINED ::particle::RetainedIntegerDiagnosticDataStorage _storage##_id; \
@@ -533,6 +534,175 @@ private:
     }
 };
 
+// Snapshot of a histogram
+struct DiagnosticHistogram {
+    diag_histogram info;
+    uint32_t buckets[DIAG_HISTOGRAM_MAX_BUCKETS];
+};
+
+// Snapshot of a time series
+struct DiagnosticTimeSeries {
+    diag_time_series info;
+    diag_time_series_sample samples[DIAG_TIME_SERIES_MAX_SAMPLES];
+};
+
+// Base abstract class for a data source containing a histogram of values
+class AbstractHistogramDiagnosticData: public AbstractTypeDiagnosticData<DiagnosticHistogram> {
+public:
+    static int get(DiagnosticDataId id, DiagnosticHistogram& hist);
+    static int get(const diag_source* src, DiagnosticHistogram& hist);
+
+    // Returns the index of the bucket that counts a given value
+    static unsigned bucketIndex(uint32_t val, unsigned subBucketBits, unsigned bucketCount);
+    // Returns the smallest value counted by a given bucket
+    static uint32_t bucketLowerBound(unsigned index, unsigned subBucketBits);
+
+protected:
+    explicit AbstractHistogramDiagnosticData(DiagnosticDataId id, const char* name = nullptr);
+
+    virtual int get(DiagnosticHistogram& hist) = 0;
+};
+
+// Base abstract class for a data source containing the most recent samples of a value
+class AbstractTimeSeriesDiagnosticData: public AbstractTypeDiagnosticData<DiagnosticTimeSeries> {
+public:
+    static int get(DiagnosticDataId id, DiagnosticTimeSeries& series);
+    static int get(const diag_source* src, DiagnosticTimeSeries& series);
+
+protected:
+    explicit AbstractTimeSeriesDiagnosticData(DiagnosticDataId id, const char* name = nullptr);
+
+    virtual int get(DiagnosticTimeSeries& series) = 0;
+};
+
+// Log-linear histogram. The recording methods are lock-free and can be called from an ISR
+template<unsigned BucketCountV = 32, unsigned SubBucketBitsV = 1>
+class HistogramDiagnosticData: public AbstractHistogramDiagnosticData {
+public:
+    static_assert(BucketCountV > 0 && BucketCountV <= DIAG_HISTOGRAM_MAX_BUCKETS, "Invalid number of buckets");
+    static_assert(SubBucketBitsV < 8, "Invalid number of sub-buckets");
+
+    explicit HistogramDiagnosticData(DiagnosticDataId id, const char* name = nullptr) :
+            AbstractHistogramDiagnosticData(id, name),
+            buckets_(),
+            count_(0),
+            sum_(0),
+            min_(std::numeric_limits<uint32_t>::max()),
+            max_(0) {
+    }
+
+    void record(uint32_t val) {
+        buckets_[bucketIndex(val, SubBucketBitsV, BucketCountV)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(val, std::memory_order_relaxed);
+        auto v = min_.load(std::memory_order_relaxed);
+        while (val < v && !min_.compare_exchange_weak(v, val, std::memory_order_relaxed)) {
+        }
+        v = max_.load(std::memory_order_relaxed);
+        while (val > v && !max_.compare_exchange_weak(v, val, std::memory_order_relaxed)) {
+        }
+    }
+
+    void reset() {
+        for (auto& b: buckets_) {
+            b.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store(std::numeric_limits<uint32_t>::max(), std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint32_t count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> buckets_[BucketCountV];
+    std::atomic<uint32_t> count_;
+    std::atomic<uint32_t> sum_;
+    std::atomic<uint32_t> min_;
+    std::atomic<uint32_t> max_;
+
+    virtual int get(DiagnosticHistogram& hist) override { // AbstractHistogramDiagnosticData
+        // The snapshot is not atomic as a whole: values that are being recorded concurrently may
+        // be accounted in some of the fields only
+        hist.info.size = sizeof(diag_histogram);
+        hist.info.sub_bucket_bits = SubBucketBitsV;
+        hist.info.bucket_count = BucketCountV;
+        hist.info.count = count_.load(std::memory_order_relaxed);
+        hist.info.sum = sum_.load(std::memory_order_relaxed);
+        hist.info.min = min_.load(std::memory_order_relaxed);
+        hist.info.max = max_.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < BucketCountV; ++i) {
+            hist.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        return SYSTEM_ERROR_NONE;
+    }
+};
+
+// Ring buffer of the most recent samples of a value. The recording method is lock-free and can
+// be called from an ISR
+template<unsigned SampleCountV = 16>
+class TimeSeriesDiagnosticData: public AbstractTimeSeriesDiagnosticData {
+public:
+    static_assert(SampleCountV > 0 && SampleCountV <= DIAG_TIME_SERIES_MAX_SAMPLES, "Invalid number of samples");
+    static_assert((SampleCountV & (SampleCountV - 1)) == 0, "Number of samples must be a power of two");
+
+    explicit TimeSeriesDiagnosticData(DiagnosticDataId id, const char* name = nullptr) :
+            AbstractTimeSeriesDiagnosticData(id, name),
+            samples_(),
+            head_(0) {
+    }
+
+    void record(int32_t val, uint32_t time) {
+        const uint32_t n = head_.fetch_add(1, std::memory_order_relaxed);
+        auto& s = samples_[n % SampleCountV];
+        // The sequence number is updated last so that a concurrent reader can detect an
+        // incomplete sample
+        s.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.time.store(time, std::memory_order_relaxed);
+        s.value.store(val, std::memory_order_relaxed);
+        s.seq.store(n + 1, std::memory_order_release);
+    }
+
+private:
+    struct Sample {
+        std::atomic<uint32_t> seq; // Sequence number of the sample plus one, or 0 if the sample is being updated
+        std::atomic<uint32_t> time;
+        std::atomic<int32_t> value;
+    };
+
+    Sample samples_[SampleCountV];
+    std::atomic<uint32_t> head_; // Total number of recorded samples
+
+    virtual int get(DiagnosticTimeSeries& series) override { // AbstractTimeSeriesDiagnosticData
+        const uint32_t n = head_.load(std::memory_order_acquire);
+        const uint32_t first = (n > SampleCountV) ? n - SampleCountV : 0;
+        unsigned count = 0;
+        for (uint32_t i = first; i != n; ++i) {
+            const auto& s = samples_[i % SampleCountV];
+            if (s.seq.load(std::memory_order_acquire) != i + 1) {
+                continue; // The sample is being recorded or has been overwritten
+            }
+            const auto time = s.time.load(std::memory_order_relaxed);
+            const auto val = s.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != i + 1) {
+                continue;
+            }
+            series.samples[count].time = time;
+            series.samples[count].value = val;
+            ++count;
+        }
+        series.info.size = sizeof(diag_time_series);
+        series.info.sample_count = count;
+        series.info.total_count = n;
+        return SYSTEM_ERROR_NONE;
+    }
+};
+
 template<typename ValueT>
 class RetainedDiagnosticDataStorage {
 public:
@@ -693,4 +863,49 @@ inline int AbstractUnsignedIntegerDiagnosticData::get(const diag_source* src, In
     return AbstractTypeDiagnosticData<IntType>::get(src, val);
 }
 
+inline AbstractHistogramDiagnosticData::AbstractHistogramDiagnosticData(DiagnosticDataId id, const char* name) :
+        AbstractTypeDiagnosticData<DiagnosticHistogram>(id, name, DIAG_TYPE_HISTOGRAM) {
+}
+
+inline int AbstractHistogramDiagnosticData::get(DiagnosticDataId id, DiagnosticHistogram& hist) {
+    return AbstractTypeDiagnosticData<DiagnosticHistogram>::get(id, hist);
+}
+
+inline int AbstractHistogramDiagnosticData::get(const diag_source* src, DiagnosticHistogram& hist) {
+    SPARK_ASSERT(src->type == DIAG_TYPE_HISTOGRAM);
+    return AbstractTypeDiagnosticData<DiagnosticHistogram>::get(src, hist);
+}
+
+inline unsigned AbstractHistogramDiagnosticData::bucketIndex(uint32_t val, unsigned subBucketBits, unsigned bucketCount) {
+    const uint32_t subBuckets = (uint32_t)1 << subBucketBits;
+    unsigned index = val;
+    if (val >= subBuckets) {
+        const unsigned exp = 31 - __builtin_clz(val); // exp >= subBucketBits
+        index = ((exp - subBucketBits + 1) << subBucketBits) + (val >> (exp - subBucketBits)) - subBuckets;
+    }
+    return (index < bucketCount) ? index : bucketCount - 1;
+}
+
+inline uint32_t AbstractHistogramDiagnosticData::bucketLowerBound(unsigned index, unsigned subBucketBits) {
+    const uint32_t subBuckets = (uint32_t)1 << subBucketBits;
+    if (index < subBuckets) {
+        return index;
+    }
+    const unsigned shift = (index >> subBucketBits) - 1;
+    return ((index & (subBuckets - 1)) + subBuckets) << shift;
+}
+
+inline AbstractTimeSeriesDiagnosticData::AbstractTimeSeriesDiagnosticData(DiagnosticDataId id, const char* name) :
+        AbstractTypeDiagnosticData<DiagnosticTimeSeries>(id, name, DIAG_TYPE_TIME_SERIES) {
+}
+
+inline int AbstractTimeSeriesDiagnosticData::get(DiagnosticDataId id, DiagnosticTimeSeries& series) {
+    return AbstractTypeDiagnosticData<DiagnosticTimeSeries>::get(id, series);
+}
+
+inline int AbstractTimeSeriesDiagnosticData::get(const diag_source* src, DiagnosticTimeSeries& series) {
+    SPARK_ASSERT(src->type == DIAG_TYPE_TIME_SERIES);
+    return AbstractTypeDiagnosticData<DiagnosticTimeSeries>::get(src, series);
+}
+
 } // namespace particle
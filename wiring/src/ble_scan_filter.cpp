@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "ble_scan_filter.h"
+
+#include "system_error.h"
+
+namespace particle {
+
+namespace ble {
+
+namespace {
+
+// AD types as defined in ble_hal_defines.h, which is only available on platforms with BLE support
+const uint8_t AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE = 0x02;
+const uint8_t AD_TYPE_16BIT_SERVICE_UUID_COMPLETE = 0x03;
+const uint8_t AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE = 0x06;
+const uint8_t AD_TYPE_128BIT_SERVICE_UUID_COMPLETE = 0x07;
+const uint8_t AD_TYPE_SHORT_LOCAL_NAME = 0x08;
+const uint8_t AD_TYPE_COMPLETE_LOCAL_NAME = 0x09;
+const uint8_t AD_TYPE_APPEARANCE = 0x19;
+const uint8_t AD_TYPE_MANUFACTURER_SPECIFIC_DATA = 0xff;
+
+const size_t ADDRESS_SIZE = 6;
+const size_t UUID16_SIZE = 2;
+const size_t UUID128_SIZE = 16;
+
+// Marks an occupied entry in the address table
+const uint64_t ADDRESS_KEY_USED = 0x8000000000000000ull;
+
+// Initial capacity of the address table
+const size_t MIN_ADDRESS_SET_CAPACITY = 16;
+
+uint32_t nameHash(const uint8_t* data, size_t size) {
+    // FNV-1a
+    uint32_t h = 0x811c9dc5;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= data[i];
+        h *= 0x01000193;
+    }
+    return h;
+}
+
+uint64_t addressKey(const uint8_t* addr, uint8_t type) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < ADDRESS_SIZE; ++i) {
+        key |= (uint64_t)addr[i] << (i * 8);
+    }
+    key |= (uint64_t)type << 48;
+    return key | ADDRESS_KEY_USED;
+}
+
+inline size_t addressHash(uint64_t key) {
+    return (key * 0x9e3779b97f4a7c15ull) >> 32;
+}
+
+size_t findDeviceName(const uint8_t* data, size_t size, const uint8_t** name) {
+    // The short local name takes precedence, see BleAdvertisingData::deviceName()
+    size_t n = findAdStructure(data, size, AD_TYPE_SHORT_LOCAL_NAME, name);
+    if (n > 0) {
+        return n;
+    }
+    return findAdStructure(data, size, AD_TYPE_COMPLETE_LOCAL_NAME, name);
+}
+
+uint16_t findAppearance(const uint8_t* data, size_t size) {
+    const uint8_t* value = nullptr;
+    if (findAdStructure(data, size, AD_TYPE_APPEARANCE, &value) < 2) {
+        return 0; // BLE_SIG_APPEARANCE_UNKNOWN
+    }
+    return (uint16_t)value[1] << 8 | value[0];
+}
+
+} // namespace
+
+size_t findAdStructure(const uint8_t* data, size_t size, uint8_t type, const uint8_t** value) {
+    // An AD structure is composed of a one byte length field, a one byte type field and the data
+    // field. The length field doesn't include itself
+    for (size_t i = 0; i + 3 <= size;) {
+        const size_t len = data[i];
+        if (data[i + 1] == type) {
+            if (len < 2 || i + len + 1 > size) {
+                return 0;
+            }
+            *value = data + i + 2;
+            return len - 1;
+        }
+        i += len + 1;
+    }
+    return 0;
+}
+
+ScanFilterMatcher::ScanFilterMatcher() :
+        customData_(nullptr),
+        customDataSize_(0),
+        minRssi_(INVALID_RSSI),
+        maxRssi_(INVALID_RSSI) {
+}
+
+int ScanFilterMatcher::addAddress(const uint8_t* addr, uint8_t type) {
+    Address a = {};
+    memcpy(a.addr, addr, ADDRESS_SIZE);
+    a.type = type;
+    if (!addrs_.append(a)) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    return 0;
+}
+
+int ScanFilterMatcher::addDeviceName(const char* name, size_t size) {
+    if (size > 0xffff || nameData_.size() + size > 0xffff) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    Name n = {};
+    n.hash = nameHash((const uint8_t*)name, size);
+    n.offset = nameData_.size();
+    n.size = size;
+    if (!nameData_.append(name, size) || !names_.append(n)) {
+        nameData_.resize(n.offset);
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    return 0;
+}
+
+int ScanFilterMatcher::addServiceUuid16(uint16_t uuid) {
+    if (!uuids16_.append(uuid)) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    return 0;
+}
+
+int ScanFilterMatcher::addServiceUuid128(const uint8_t* uuid) {
+    Uuid128 u = {};
+    memcpy(u.data, uuid, UUID128_SIZE);
+    if (!uuids128_.append(u)) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    return 0;
+}
+
+int ScanFilterMatcher::addAppearance(uint16_t appearance) {
+    if (!appearances_.append(appearance)) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    return 0;
+}
+
+void ScanFilterMatcher::customData(const uint8_t* data, size_t size) {
+    customData_ = data;
+    customDataSize_ = size;
+}
+
+void ScanFilterMatcher::rssiRange(int8_t minRssi, int8_t maxRssi) {
+    minRssi_ = minRssi;
+    maxRssi_ = maxRssi;
+}
+
+void ScanFilterMatcher::clear() {
+    addrs_.clear();
+    names_.clear();
+    nameData_.clear();
+    uuids16_.clear();
+    uuids128_.clear();
+    appearances_.clear();
+    customData_ = nullptr;
+    customDataSize_ = 0;
+    minRssi_ = INVALID_RSSI;
+    maxRssi_ = INVALID_RSSI;
+}
+
+bool ScanFilterMatcher::match(const uint8_t* addr, uint8_t addrType, int8_t rssi, const uint8_t* advData, size_t advSize,
+        const uint8_t* srData, size_t srSize) const {
+    // Cheapest checks go first
+    return matchRssi(rssi) &&
+            matchAddress(addr, addrType) &&
+            matchName(advData, advSize, srData, srSize) &&
+            matchServiceUuid(advData, advSize, srData, srSize) &&
+            matchAppearance(advData, advSize, srData, srSize) &&
+            matchCustomData(advData, advSize, srData, srSize);
+}
+
+bool ScanFilterMatcher::matchRssi(int8_t rssi) const {
+    if (minRssi_ != INVALID_RSSI && rssi < minRssi_) {
+        return false;
+    }
+    if (maxRssi_ != INVALID_RSSI && rssi > maxRssi_) {
+        return false;
+    }
+    return true;
+}
+
+bool ScanFilterMatcher::matchAddress(const uint8_t* addr, uint8_t type) const {
+    if (addrs_.isEmpty()) {
+        return true;
+    }
+    for (const auto& a: addrs_) {
+        if (a.type == type && memcmp(a.addr, addr, ADDRESS_SIZE) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScanFilterMatcher::matchName(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const {
+    if (names_.isEmpty()) {
+        return true;
+    }
+    return matchName(srData, srSize) || matchName(advData, advSize);
+}
+
+bool ScanFilterMatcher::matchName(const uint8_t* data, size_t size) const {
+    const uint8_t* name = nullptr;
+    const size_t nameSize = findDeviceName(data, size, &name);
+    if (!nameSize) {
+        return false;
+    }
+    const uint32_t h = nameHash(name, nameSize);
+    for (const auto& n: names_) {
+        if (n.hash == h && n.size == nameSize && memcmp(nameData_.data() + n.offset, name, nameSize) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScanFilterMatcher::matchServiceUuid(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const {
+    if (uuids16_.isEmpty() && uuids128_.isEmpty()) {
+        return true;
+    }
+    return matchServiceUuid(srData, srSize) || matchServiceUuid(advData, advSize);
+}
+
+bool ScanFilterMatcher::matchServiceUuid(const uint8_t* data, size_t size) const {
+    // Unlike findAdStructure(), this iterates over all AD structures as there can be more than one
+    // list of service UUIDs of the same type
+    for (size_t i = 0; i + 3 <= size;) {
+        const size_t len = data[i];
+        if (i + len + 1 > size) {
+            break;
+        }
+        const uint8_t type = data[i + 1];
+        const uint8_t* value = data + i + 2;
+        const size_t valueSize = (len > 0) ? len - 1 : 0;
+        if (type == AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE || type == AD_TYPE_16BIT_SERVICE_UUID_COMPLETE) {
+            for (size_t j = 0; j + UUID16_SIZE <= valueSize; j += UUID16_SIZE) {
+                const uint16_t uuid = (uint16_t)value[j + 1] << 8 | value[j];
+                for (const auto u: uuids16_) {
+                    if (u == uuid) {
+                        return true;
+                    }
+                }
+            }
+        } else if (type == AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE || type == AD_TYPE_128BIT_SERVICE_UUID_COMPLETE) {
+            for (size_t j = 0; j + UUID128_SIZE <= valueSize; j += UUID128_SIZE) {
+                for (const auto& u: uuids128_) {
+                    if (memcmp(u.data, value + j, UUID128_SIZE) == 0) {
+                        return true;
+                    }
+                }
+            }
+        }
+        i += len + 1;
+    }
+    return false;
+}
+
+bool ScanFilterMatcher::matchAppearance(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const {
+    if (appearances_.isEmpty()) {
+        return true;
+    }
+    const uint16_t srAppearance = findAppearance(srData, srSize);
+    const uint16_t advAppearance = findAppearance(advData, advSize);
+    for (const auto a: appearances_) {
+        if (a == srAppearance || a == advAppearance) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScanFilterMatcher::matchCustomData(const uint8_t* advData, size_t advSize, const uint8_t* srData, size_t srSize) const {
+    if (!customData_ || !customDataSize_) {
+        return true;
+    }
+    const uint8_t* data = nullptr;
+    size_t n = findAdStructure(srData, srSize, AD_TYPE_MANUFACTURER_SPECIFIC_DATA, &data);
+    if (n == customDataSize_ && memcmp(data, customData_, n) == 0) {
+        return true;
+    }
+    n = findAdStructure(advData, advSize, AD_TYPE_MANUFACTURER_SPECIFIC_DATA, &data);
+    if (n == customDataSize_ && memcmp(data, customData_, n) == 0) {
+        return true;
+    }
+    return false;
+}
+
+ScanAddressSet::ScanAddressSet(size_t maxCapacity) :
+        capacity_(0),
+        maxCapacity_(MIN_ADDRESS_SET_CAPACITY),
+        count_(0) {
+    while (maxCapacity_ < maxCapacity) {
+        maxCapacity_ <<= 1;
+    }
+}
+
+bool ScanAddressSet::insert(const uint8_t* addr, uint8_t type) {
+    const uint64_t key = addressKey(addr, type);
+    bool found = false;
+    size_t index = find(key, &found);
+    if (found) {
+        return false;
+    }
+    // Keep the load factor of the table below 3/4
+    if (count_ >= capacity_ - capacity_ / 4 && grow()) {
+        index = find(key, &found);
+    }
+    if (count_ < capacity_ - capacity_ / 4) {
+        table_[index] = key;
+        ++count_;
+        return true;
+    }
+    for (const auto k: overflow_) {
+        if (k == key) {
+            return false;
+        }
+    }
+    // If the overflow list can't grow, the address will be reported again
+    overflow_.append(key);
+    return true;
+}
+
+bool ScanAddressSet::contains(const uint8_t* addr, uint8_t type) const {
+    const uint64_t key = addressKey(addr, type);
+    bool found = false;
+    find(key, &found);
+    if (found) {
+        return true;
+    }
+    for (const auto k: overflow_) {
+        if (k == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScanAddressSet::clear() {
+    if (table_) {
+        memset(table_.get(), 0, capacity_ * sizeof(uint64_t));
+    }
+    overflow_.clear();
+    count_ = 0;
+}
+
+bool ScanAddressSet::grow() {
+    if (capacity_ >= maxCapacity_) {
+        return false;
+    }
+    const size_t capacity = capacity_ ? capacity_ * 2 : MIN_ADDRESS_SET_CAPACITY;
+    std::unique_ptr<uint64_t[]> table(new(std::nothrow) uint64_t[capacity]());
+    if (!table) {
+        return false;
+    }
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < capacity_; ++i) {
+        const uint64_t key = table_[i];
+        if (key) {
+            size_t index = addressHash(key) & mask;
+            while (table[index]) {
+                index = (index + 1) & mask;
+            }
+            table[index] = key;
+        }
+    }
+    table_ = std::move(table);
+    capacity_ = capacity;
+    return true;
+}
+
+size_t ScanAddressSet::find(uint64_t key, bool* found) const {
+    *found = false;
+    if (!table_) {
+        return 0;
+    }
+    const size_t mask = capacity_ - 1;
+    size_t index = addressHash(key) & mask;
+    // The table always has at least one free entry so the loop is guaranteed to terminate
+    while (table_[index]) {
+        if (table_[index] == key) {
+            *found = true;
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+} // namespace ble
+
+} // namespace particle
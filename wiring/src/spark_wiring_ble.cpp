@@ -26,6 +26,7 @@
 #include "scope_guard.h"
 #include "hex_to_bytes.h"
 #include "bytes2hexbuf.h"
+#include "ble_scan_filter.h"
 
 #include "logging.h"
 LOG_SOURCE_CATEGORY("wiring.ble")
@@ -2302,7 +2303,8 @@ public:
               targetCount_(0),
               foundCount_(0),
               scanResultCallback_(nullptr),
-              scanResultCallbackRef_(nullptr) {
+              scanResultCallbackRef_(nullptr),
+              allowDuplicates_(false) {
         resultsVector_.clear();
     }
 
@@ -2311,14 +2313,14 @@ public:
     int start(BleOnScanResultCallback callback, void* context) {
         scanResultCallback_ = callback ? std::bind(callback, _1, context) : (std::function<void(const BleScanResult*)>)nullptr;
         scanResultCallbackRef_ = nullptr;
-        CHECK(hal_ble_gap_start_scan(onScanResultCallback, this, nullptr));
+        CHECK(startScan());
         return foundCount_;
     }
 
     int start(BleOnScanResultCallbackRef callback, void* context) {
         scanResultCallback_ = nullptr;
         scanResultCallbackRef_ = callback ? std::bind(callback, _1, context) : (BleOnScanResultStdFunction)nullptr;
-        CHECK(hal_ble_gap_start_scan(onScanResultCallback, this, nullptr));
+        CHECK(startScan());
         return foundCount_;
     }
 
@@ -2327,27 +2329,26 @@ public:
         scanResultCallbackRef_ = nullptr;
         resultsPtr_ = results;
         targetCount_ = resultCount;
-        CHECK(hal_ble_gap_start_scan(onScanResultCallback, this, nullptr));
+        CHECK(startScan());
         return foundCount_;
     }
 
     Vector<BleScanResult> start() {
         scanResultCallback_ = nullptr;
         scanResultCallbackRef_ = nullptr;
-        hal_ble_gap_start_scan(onScanResultCallback, this, nullptr);
+        startScan();
         return resultsVector_;
     }
 
     int start(const BleOnScanResultStdFunction& callback) {
         scanResultCallback_ = nullptr;
         scanResultCallbackRef_ = callback;
-        CHECK(hal_ble_gap_start_scan(onScanResultCallback, this, nullptr));
+        CHECK(startScan());
         return foundCount_;
     }
 
-    BleScanDelegator& setScanFilter(const BleScanFilter& filter) {
-        filter_ = filter;
-        return *this;
+    int setScanFilter(const BleScanFilter& filter) {
+        return compileFilter(filter);
     }
 
 private:
@@ -2360,11 +2361,16 @@ private:
     static void onScanResultCallback(const hal_ble_scan_result_evt_t* event, void* context) {
         BleScanDelegator* delegator = static_cast<BleScanDelegator*>(context);
 
-        if (!delegator->filter_.allowDuplicates()) {
-            if (delegator->isCachedDevice(event->peer_addr)) {
+        if (!delegator->allowDuplicates_) {
+            if (!delegator->cachedDevices_.insert(event->peer_addr.addr, event->peer_addr.addr_type)) {
                 return;
             }
-            delegator->cachedDevices_.append(event->peer_addr);
+        }
+
+        // Match the raw advertising data before constructing a scan result
+        if (!delegator->filter_.match(*event)) {
+            LOG_DEBUG(TRACE, "Scan result filtered out.");
+            return;
         }
 
         BleScanResult result = {};
@@ -2372,15 +2378,6 @@ private:
               .scanResponse(event->sr_data, event->sr_data_len)
               .advertisingData(event->adv_data, event->adv_data_len);
 
-        if (!delegator->filterByRssi(result) ||
-              !delegator->filterByAddress(result) ||
-              !delegator->filterByDeviceName(result) ||
-              !delegator->filterByServiceUUID(result) ||
-              !delegator->filterByAppearance(result) ||
-              !delegator->filterByCustomData(result)) {
-            return;
-        }
-
         if (delegator->scanResultCallback_) {
             delegator->foundCount_++;
             delegator->scanResultCallback_(&result);
@@ -2404,152 +2401,36 @@ private:
         delegator->resultsVector_.append(result);
     }
 
-    bool filterByRssi(const BleScanResult& result) {
-        int8_t filterRssi = filter_.minRssi();
-        if (filterRssi != BLE_RSSI_INVALID && result.rssi() < filterRssi) {
-            LOG_DEBUG(TRACE, "Exceed min. RSSI");
-            return false;
+    int compileFilter(const BleScanFilter& filter) {
+        filter_.clear();
+        filter_.rssiRange(filter.minRssi(), filter.maxRssi());
+        for (const auto& address : filter.addresses()) {
+            const hal_ble_addr_t addr = address.halAddress();
+            CHECK(filter_.addAddress(addr.addr, addr.addr_type));
         }
-        filterRssi = filter_.maxRssi();
-        if (filterRssi != BLE_RSSI_INVALID && result.rssi() > filterRssi) {
-            LOG_DEBUG(TRACE, "Exceed max. RSSI.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByAddress(const BleScanResult& result) {
-        auto filerAddresses = filter_.addresses();
-        if (filerAddresses.size() > 0) {
-            for (const auto& address : filerAddresses) {
-                if (address == result.address()) {
-                    return true;
-                }
-            }
-            LOG_DEBUG(TRACE, "Address mismatched.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByDeviceName(const BleScanResult& result) {
-        auto filterDeviceNames = filter_.deviceNames();
-        if (filterDeviceNames.size() > 0) {
-            String srName = result.scanResponse().deviceName();
-            String advName = result.advertisingData().deviceName();
-            if (srName.length() == 0 && advName.length() == 0) {
-                LOG_DEBUG(TRACE, "Device name mismatched.");
-                return false;
-            }
-            for (const auto& name : filterDeviceNames) {
-                if (name == srName || name == advName) {
-                    return true;
-                }
-            }
-            LOG_DEBUG(TRACE, "Device name mismatched.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByServiceUUID(const BleScanResult& result) {
-        auto filterServiceUuids = filter_.serviceUUIDs();
-        if (filterServiceUuids.size() > 0) {
-            const Vector<BleUuid>& srUuids = result.scanResponse().serviceUUID();
-            const Vector<BleUuid>& advUuids = result.advertisingData().serviceUUID();
-            if (srUuids.size() <= 0 && advUuids.size() <= 0) {
-                LOG_DEBUG(TRACE, "Service UUID mismatched.");
-                return false;
-            }
-            for (const auto& uuid : filterServiceUuids) {
-                for (const auto& found : srUuids) {
-                    if (uuid == found) {
-                        return true;
-                    }
-                }
-                for (const auto& found : advUuids) {
-                    if (uuid == found) {
-                        return true;
-                    }
-                }
-            }
-            LOG_DEBUG(TRACE, "Service UUID mismatched.");
-            return false;
+        for (const auto& name : filter.deviceNames()) {
+            CHECK(filter_.addDeviceName(name.c_str(), name.length()));
         }
-        return true;
-    }
-
-    bool filterByAppearance(const BleScanResult& result) {
-        auto filterAppearances = filter_.appearances();
-        if (filterAppearances.size() > 0) {
-            ble_sig_appearance_t srAppearance = result.scanResponse().appearance();
-            ble_sig_appearance_t advAppearance = result.advertisingData().appearance();
-            for (const auto& appearance : filterAppearances) {
-                if (appearance == srAppearance || appearance == advAppearance) {
-                    return true;
-                }
+        for (const auto& uuid : filter.serviceUUIDs()) {
+            if (uuid.type() == BleUuidType::SHORT) {
+                CHECK(filter_.addServiceUuid16(uuid.shorted()));
+            } else {
+                CHECK(filter_.addServiceUuid128(uuid.rawBytes()));
             }
-            LOG_DEBUG(TRACE, "Appearance mismatched.");
-            return false;
         }
-        return true;
-    }
-
-    bool filterByCustomData(const BleScanResult& result) {
-        size_t filterCustomDatalen;
-        const uint8_t* filterCustomData = filter_.customData(&filterCustomDatalen);
-        if (filterCustomData != nullptr && filterCustomDatalen > 0) {
-            size_t srLen = result.scanResponse().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, nullptr, BLE_MAX_SUPPORTED_ADV_DATA_LEN);
-            size_t advLen = result.advertisingData().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, nullptr, BLE_MAX_SUPPORTED_ADV_DATA_LEN);
-            if (srLen != filterCustomDatalen && advLen != filterCustomDatalen) {
-                LOG_DEBUG(TRACE, "Custom data mismatched.");
-                return false;
-            }
-            if (srLen == filterCustomDatalen) {
-                uint8_t* buf = (uint8_t*)malloc(srLen);
-                SCOPE_GUARD({
-                    if (buf) {
-                        free(buf);
-                    }
-                });
-                if (!buf) {
-                    LOG(ERROR, "Failed to allocate memory!");
-                    return false;
-                }
-                result.scanResponse().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, buf, srLen);
-                if (!memcmp(buf, filterCustomData, srLen)) {
-                    return true;
-                }
-            }
-            if (advLen == filterCustomDatalen) {
-                uint8_t* buf = (uint8_t*)malloc(advLen);
-                SCOPE_GUARD({
-                    if (buf) {
-                        free(buf);
-                    }
-                });
-                if (!buf) {
-                    LOG(ERROR, "Failed to allocate memory!");
-                    return false;
-                }
-                result.advertisingData().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, buf, advLen);
-                if (!memcmp(buf, filterCustomData, advLen)) {
-                    return true;
-                }
-            }
-            LOG_DEBUG(TRACE, "Custom data mismatched.");
-            return false;
+        for (const auto& appearance : filter.appearances()) {
+            CHECK(filter_.addAppearance(appearance));
         }
-        return true;
+        size_t customDataLen = 0;
+        const uint8_t* customData = filter.customData(&customDataLen);
+        filter_.customData(customData, customDataLen);
+        allowDuplicates_ = filter.allowDuplicates();
+        return 0;
     }
 
-    bool isCachedDevice(const BleAddress& address) const {
-        for (const auto& addr : cachedDevices_) {
-            if (address == addr) {
-                return true;
-            }
-        }
-        return false;
+    int startScan() {
+        cachedDevices_.clear();
+        return hal_ble_gap_start_scan(onScanResultCallback, this, nullptr);
     }
 
     Vector<BleScanResult> resultsVector_;
@@ -2558,8 +2439,9 @@ private:
     size_t foundCount_;
     std::function<void(const BleScanResult*)> scanResultCallback_;
     BleOnScanResultStdFunction scanResultCallbackRef_;
-    BleScanFilter filter_;
-    Vector<BleAddress> cachedDevices_;
+    ScanFilterMatcher filter_;
+    ScanAddressSet cachedDevices_;
+    bool allowDuplicates_;
 };
 
 int BleLocalDevice::setScanTimeout(uint16_t timeout) const {
@@ -2626,17 +2508,20 @@ Vector<BleScanResult> BleLocalDevice::scan() const {
 
 int BleLocalDevice::scanWithFilter(const BleScanFilter& filter, const BleOnScanResultStdFunction& callback) const {
     BleScanDelegator scanner;
-    return scanner.setScanFilter(filter).start(callback);
+    CHECK(scanner.setScanFilter(filter));
+    return scanner.start(callback);
 }
 
 int BleLocalDevice::scanWithFilter(const BleScanFilter& filter, BleOnScanResultCallback callback, void* context) const {
     BleScanDelegator scanner;
-    return scanner.setScanFilter(filter).start(callback, context);
+    CHECK(scanner.setScanFilter(filter));
+    return scanner.start(callback, context);
 }
 
 int BleLocalDevice::scanWithFilter(const BleScanFilter& filter, BleOnScanResultCallbackRef callback, void* context) const {
     BleScanDelegator scanner;
-    return scanner.setScanFilter(filter).start(callback, context);
+    CHECK(scanner.setScanFilter(filter));
+    return scanner.start(callback, context);
 }
 
 int BleLocalDevice::scanWithFilter(const BleScanFilter& filter, BleScanResult* results, size_t resultCount) const {
@@ -2644,12 +2529,16 @@ int BleLocalDevice::scanWithFilter(const BleScanFilter& filter, BleScanResult* r
         return SYSTEM_ERROR_INVALID_ARGUMENT;
     }
     BleScanDelegator scanner;
-    return scanner.setScanFilter(filter).start(results, resultCount);
+    CHECK(scanner.setScanFilter(filter));
+    return scanner.start(results, resultCount);
 }
 
 Vector<BleScanResult> BleLocalDevice::scanWithFilter(const BleScanFilter& filter) const {
     BleScanDelegator scanner;
-    return scanner.setScanFilter(filter).start();
+    if (scanner.setScanFilter(filter) < 0) {
+        return Vector<BleScanResult>();
+    }
+    return scanner.start();
 }
 
 int BleLocalDevice::stopScanning() const {